@@ -0,0 +1,132 @@
+from http.server import ThreadingHTTPServer, BaseHTTPRequestHandler
+import base64
+import json
+import ssl
+import os
+import sys
+import threading
+
+# Local stand-in for the data and GraphQL endpoints. Point DATA_URL or the
+# GraphQL endpoint at https://<host ip>:8002/ to see how many TLS handshakes
+# the firmware does and how many requests it sends over each connection.
+#
+#   python serve_data_sink.py               accept plain payloads only
+#   python serve_data_sink.py --heatshrink  advertise heatshrink, check compressed payloads
+
+# Get the current directory
+current_dir = os.path.dirname(os.path.abspath(__file__))
+
+# Certificates from generate_cert.sh
+cert_path = os.path.join(current_dir, 'cert.pem')
+key_path = os.path.join(current_dir, 'key.pem')
+
+lock = threading.Lock()
+stats = {'connections': 0, 'resumed': 0, 'requests': 0, 'compressed': 0, 'bytes': 0, 'uncompressed_bytes': 0}
+
+accept_heatshrink = '--heatshrink' in sys.argv
+
+
+def b64url_decode(part):
+    return base64.urlsafe_b64decode(part + '=' * (-len(part) % 4))
+
+
+def heatshrink_decompress(data, window_bits, lookahead_bits):
+    # Same bit format as src/backend/heatshrink.cpp
+    bits = ''.join(format(byte, '08b') for byte in data)
+    output = bytearray()
+    position = 0
+    while position < len(bits):
+        if bits[position] == '1':
+            if position + 9 > len(bits):
+                break
+            output.append(int(bits[position + 1:position + 9], 2))
+            position += 9
+            continue
+        if position + 1 + window_bits + lookahead_bits > len(bits):
+            break
+        position += 1
+        distance = int(bits[position:position + window_bits], 2) + 1
+        position += window_bits
+        count = int(bits[position:position + lookahead_bits], 2) + 1
+        position += lookahead_bits
+        for _ in range(count):
+            output.append(output[-distance])
+    return bytes(output)
+
+
+def check_jwt(jwt):
+    parts = jwt.split('.')
+    if len(parts) != 3:
+        return
+    header = json.loads(b64url_decode(parts[0]))
+    payload = b64url_decode(parts[1])
+    with lock:
+        stats['bytes'] += len(jwt)
+    if header.get('zip') == 'heatshrink':
+        plain = heatshrink_decompress(payload, header['zw'], header['zl'])
+        json.loads(plain)
+        with lock:
+            stats['compressed'] += 1
+            stats['uncompressed_bytes'] += len(plain)
+        print("Compressed payload %d -> %d bytes" % (len(plain), len(payload)))
+
+
+class SinkHandler(BaseHTTPRequestHandler):
+    # HTTP/1.1 keeps the connection open between requests
+    protocol_version = 'HTTP/1.1'
+
+    def setup(self):
+        super().setup()
+        self.requests_on_connection = 0
+        with lock:
+            stats['connections'] += 1
+            if self.connection.session_reused:
+                stats['resumed'] += 1
+        print("New TLS connection from %s (session resumed: %s)" % (self.client_address[0], self.connection.session_reused))
+
+    def finish(self):
+        super().finish()
+        print("Connection from %s closed after %d requests" % (self.client_address[0], self.requests_on_connection))
+
+    def respond(self, body):
+        self.requests_on_connection += 1
+        with lock:
+            stats['requests'] += 1
+            print("Request %d on connection, totals: %s" % (self.requests_on_connection, stats))
+        self.send_response(200)
+        if accept_heatshrink:
+            # RFC 7694, tells the firmware it may compress its payloads
+            self.send_header('Accept-Encoding', 'heatshrink')
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_POST(self):
+        length = int(self.headers.get('Content-Length', 0))
+        body = self.rfile.read(length)
+        if self.headers.get('Content-Type') == 'text/plain':
+            check_jwt(body.decode(errors='replace'))
+        self.respond(b'{"data":{}}')
+
+    def do_GET(self):
+        self.respond(b'{}')
+
+    def log_message(self, format, *args):
+        pass
+
+
+# Create HTTPS server
+httpd = ThreadingHTTPServer(('0.0.0.0', 8002), SinkHandler)
+
+# Create SSL context
+context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+context.load_cert_chain(cert_path, key_path)
+
+# Wrap the socket
+httpd.socket = context.wrap_socket(httpd.socket, server_side=True)
+
+print("Accepting data at https://localhost:8002")
+print("Advertising heatshrink: %s" % accept_heatshrink)
+print("Using certificates from: " + current_dir)
+httpd.serve_forever()
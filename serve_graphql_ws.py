@@ -0,0 +1,182 @@
+import base64
+import hashlib
+import json
+import os
+import socket
+import ssl
+import struct
+import sys
+import threading
+import time
+
+# Local stand-in for the GraphQL WebSocket at wss://api.srcful.dev/.
+# Point the requestSubscription URL in backend_api_task.cpp at
+# wss://<host ip>:8003/ and the device will get a request task every few
+# seconds. The server answers setConfiguration mutations sent over the socket
+# and prints the time from sending a request task to getting its response.
+#
+#   python serve_graphql_ws.py               answer every mutation
+#   python serve_graphql_ws.py --no-results  never answer, the device falls back to HTTP
+
+# Get the current directory
+current_dir = os.path.dirname(os.path.abspath(__file__))
+
+# Certificates from generate_cert.sh
+cert_path = os.path.join(current_dir, 'cert.pem')
+key_path = os.path.join(current_dir, 'key.pem')
+
+WS_GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC11B85'
+REQUEST_INTERVAL = 5  # Seconds between request tasks
+
+send_results = '--no-results' not in sys.argv
+
+
+def read_exact(conn, length):
+    data = b''
+    while len(data) < length:
+        chunk = conn.recv(length - len(data))
+        if not chunk:
+            raise ConnectionError('closed')
+        data += chunk
+    return data
+
+
+def read_frame(conn):
+    first, second = read_exact(conn, 2)
+    opcode = first & 0x0F
+    length = second & 0x7F
+    if length == 126:
+        length = struct.unpack('>H', read_exact(conn, 2))[0]
+    elif length == 127:
+        length = struct.unpack('>Q', read_exact(conn, 8))[0]
+    mask = read_exact(conn, 4) if second & 0x80 else b'\0\0\0\0'
+    payload = bytes(b ^ mask[i % 4] for i, b in enumerate(read_exact(conn, length)))
+    return opcode, payload
+
+
+def send_frame(conn, lock, payload, opcode=0x01):
+    header = bytes([0x80 | opcode])
+    if len(payload) < 126:
+        header += bytes([len(payload)])
+    elif len(payload) < 65536:
+        header += bytes([126]) + struct.pack('>H', len(payload))
+    else:
+        header += bytes([127]) + struct.pack('>Q', len(payload))
+    with lock:
+        conn.sendall(header + payload)
+
+
+def send_json(conn, lock, message):
+    send_frame(conn, lock, json.dumps(message).encode())
+
+
+def jwt_part(jwt, index):
+    part = jwt.split('.')[index]
+    return json.loads(base64.urlsafe_b64decode(part + '=' * (-len(part) % 4)))
+
+
+def handshake(conn):
+    request = b''
+    while b'\r\n\r\n' not in request:
+        chunk = conn.recv(1024)
+        if not chunk:
+            raise ConnectionError('closed during handshake')
+        request += chunk
+    headers = {}
+    for line in request.decode(errors='replace').split('\r\n')[1:]:
+        if ':' in line:
+            name, value = line.split(':', 1)
+            headers[name.strip().lower()] = value.strip()
+    accept = base64.b64encode(hashlib.sha1((headers['sec-websocket-key'] + WS_GUID).encode()).digest()).decode()
+    conn.sendall(('HTTP/1.1 101 Switching Protocols\r\n'
+                  'Upgrade: websocket\r\n'
+                  'Connection: Upgrade\r\n'
+                  'Sec-WebSocket-Accept: ' + accept + '\r\n'
+                  'Sec-WebSocket-Protocol: graphql-ws\r\n\r\n').encode())
+
+
+def push_requests(conn, lock, sent, stop):
+    # Request tasks arrive as data on the settings subscription (operation id 1)
+    count = 0
+    while not stop.wait(REQUEST_INTERVAL):
+        count += 1
+        request_id = 'req-%d' % count
+        task = {'id': request_id, 'path': '/api/name', 'method': 'GET', 'timestamp': int(time.time() * 1000)}
+        sent[request_id] = time.monotonic()
+        try:
+            send_json(conn, lock, {'type': 'data', 'id': '1', 'payload': {'data': {
+                'configurationDataChanges': {'subKey': 'request', 'data': json.dumps(task)}}}})
+        except OSError:
+            return
+        print('Sent request task %s' % request_id)
+
+
+def handle_mutation(conn, lock, operation_id, query, sent):
+    jwt = query.split('jwt: "', 1)[1].split('"', 1)[0]
+    header = jwt_part(jwt, 0)
+    payload = jwt_part(jwt, 1)
+
+    request_id = payload.get('id')
+    if header.get('subKey') == 'response' and request_id in sent:
+        print('Response to %s over WebSocket after %.0f ms (operation %s)' % (
+            request_id, (time.monotonic() - sent.pop(request_id)) * 1000, operation_id))
+    else:
+        print('Mutation %s over WebSocket, subKey %s' % (operation_id, header.get('subKey')))
+
+    if send_results:
+        send_json(conn, lock, {'type': 'data', 'id': operation_id, 'payload': {'data': {'setConfiguration': {'success': True}}}})
+        send_json(conn, lock, {'type': 'complete', 'id': operation_id})
+
+
+def serve_client(conn, address):
+    print('Connection from %s' % address[0])
+    lock = threading.Lock()
+    stop = threading.Event()
+    sent = {}
+    try:
+        handshake(conn)
+        while True:
+            opcode, payload = read_frame(conn)
+            if opcode == 0x08:
+                break
+            if opcode == 0x09:
+                send_frame(conn, lock, payload, 0x0A)
+                continue
+            if opcode != 0x01:
+                continue
+
+            message = json.loads(payload)
+            if message.get('type') == 'connection_init':
+                send_json(conn, lock, {'type': 'connection_ack'})
+            elif message.get('type') == 'start':
+                query = message['payload']['query']
+                if 'subscription' in query:
+                    print('Subscription started, sending a request task every %d s' % REQUEST_INTERVAL)
+                    threading.Thread(target=push_requests, args=(conn, lock, sent, stop), daemon=True).start()
+                elif 'setConfiguration' in query:
+                    handle_mutation(conn, lock, message['id'], query, sent)
+    except (ConnectionError, OSError, ValueError) as error:
+        print('Connection from %s ended: %s' % (address[0], error))
+    finally:
+        stop.set()
+        conn.close()
+
+
+# Create SSL context
+context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+context.load_cert_chain(cert_path, key_path)
+
+server = socket.create_server(('0.0.0.0', 8003))
+
+print("Serving GraphQL WebSocket at wss://localhost:8003/")
+print("Answering mutations: %s" % send_results)
+print("Using certificates from: " + current_dir)
+while True:
+    client, address = server.accept()
+    try:
+        client = context.wrap_socket(client, server_side=True)
+    except (ssl.SSLError, OSError) as error:
+        print('TLS handshake failed: %s' % error)
+        client.close()
+        continue
+    threading.Thread(target=serve_client, args=(client, address), daemon=True).start()
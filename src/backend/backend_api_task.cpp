@@ -2,6 +2,7 @@
 #include "crypto.h"
 #include "config.h"
 #include "./graphql.h"
+#include "http_connection_manager.h"
 #include "json_light/json_light.h"
 #include "firmware_version.h"
 #include <time.h>
@@ -12,6 +13,15 @@ static const char* TAG = "backend_api_task";
 
 // DEFAULT_STATE_UPDATE_INTERVAL is now in state_handler.cpp
 
+// Command responses first, then data, then state, then OTA. The budget is the deadline of a run, shared by all its requests.
+static const BackendScheduler::JobConfig COMMAND_JOB = {"command", BackendScheduler::Priority::INTERACTIVE, 100, 200, 5000};
+static const BackendScheduler::JobConfig DATA_JOB = {"data", BackendScheduler::Priority::DATA, 100, 5000, 10000};
+static const BackendScheduler::JobConfig STATE_JOB = {"state", BackendScheduler::Priority::STATE, 1000, 30000, 10000};
+static const BackendScheduler::JobConfig OTA_JOB = {"ota", BackendScheduler::Priority::OTA, 1000, 5 * 60 * 1000, 15000};
+
+// Idle wait when no job is due, also the time to notice WiFi or BLE changes
+static const uint32_t MAX_IDLE_MS = 100;
+
 BackendApiTask::BackendApiTask(uint32_t stackSize, UBaseType_t priority) 
     : stackSize(stackSize), priority(priority), shouldRun(false),
       wifiManager(nullptr), // Removed lastUpdateTime
@@ -23,7 +33,6 @@ BackendApiTask::BackendApiTask(uint32_t stackSize, UBaseType_t priority)
 
 BackendApiTask::~BackendApiTask() {
     stop();
-    http.end(); // Clean up the HTTP client connection
 }
 
 void BackendApiTask::begin(WifiManager* wifiManager) {
@@ -34,15 +43,27 @@ void BackendApiTask::begin(WifiManager* wifiManager) {
     this->wifiManager = wifiManager;
     shouldRun = true;
     
-    // Configure HTTP client once
-    http.setTimeout(10000);  // 10 second timeout
-    
+    dataSender.begin(wifiManager);
+
     // Initialize StateHandler
-    stateHandler.begin(wifiManager);
+    stateHandler.begin(wifiManager, &requestSubscription);
     // stateHandler.setInterval(0); // Ensure immediate update, handled by stateHandler.begin()
     
     // Initialize OtaChecker
     otaChecker.begin();
+
+    scheduler.add(COMMAND_JOB, [](void* context, unsigned long now, const Deadline& deadline) {
+        static_cast<BackendApiTask*>(context)->requestSubscription.loop(now, deadline);
+    }, this);
+    scheduler.add(DATA_JOB, [](void* context, unsigned long now, const Deadline& deadline) {
+        static_cast<BackendApiTask*>(context)->dataSender.loop(deadline);
+    }, this);
+    scheduler.add(STATE_JOB, [](void* context, unsigned long now, const Deadline& deadline) {
+        static_cast<BackendApiTask*>(context)->stateHandler.loop(now, deadline);
+    }, this);
+    scheduler.add(OTA_JOB, [](void* context, unsigned long now, const Deadline& deadline) {
+        static_cast<BackendApiTask*>(context)->otaChecker.loop(now, deadline);
+    }, this);
         
     xTaskCreatePinnedToCore(
         taskFunction,
@@ -88,17 +109,16 @@ void BackendApiTask::taskFunction(void* parameter) {
     vTaskDelay(pdMS_TO_TICKS(2000));
     
     while (task->shouldRun) {
-        const unsigned long currentTime = millis(); // Keep for other potential uses or remove if only for state update timing
+        uint32_t idleMs = MAX_IDLE_MS;
 
+        // One job per round so the most urgent job is picked again after every job
         if (task->wifiManager && task->wifiManager->isConnected() && !task->bleActive) {
-            task->dataSender.loop();
-            task->requestSubscription.loop(currentTime);
-            task->stateHandler.loop(currentTime); // Call StateHandler's loop
-            task->otaChecker.loop(currentTime);   // Call OtaChecker's loop
+            idleMs = task->scheduler.runNext() ? 0 : task->scheduler.getIdleMs(MAX_IDLE_MS);
         }
+        HttpConnectionManager::closeIdle();
         
-        // Small delay to prevent task from hogging CPU
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Always yield at least a tick so lower priority tasks get to run
+        vTaskDelay(idleMs > 0 ? pdMS_TO_TICKS(idleMs) : 1);
     }
     
     if (task->requestSubscription.isConnected()) {
@@ -3,7 +3,6 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <HTTPClient.h>
 
 #include "../wifi/wifi_manager.h"
 #include "json_light/json_light.h"
@@ -12,6 +11,7 @@
 #include "data_sender.h"
 #include "state_handler.h" // Include the new StateHandler header
 #include "ota_checker.h"   // Include the OtaChecker header
+#include "backend_scheduler.h"
 
 class BackendApiTask {
 public:
@@ -31,8 +31,16 @@ public:
     // Trigger an immediate state update
     void triggerStateUpdate(); // Will now delegate to StateHandler
 
-    QueueHandle_t getQueueHandle() {
-        return dataSender.getQueueHandle();
+    SpscRing& getDataRing() {
+        return dataSender.getDataRing();
+    }
+
+    const UploadController& getUploadController() const {
+        return dataSender.getUploadController();
+    }
+
+    const BackendScheduler& getScheduler() const {
+        return scheduler;
     }
     
 private:
@@ -50,10 +58,10 @@ private:
     bool bleActive;
 
 
-    HTTPClient http;  // Reuse HTTPClient instance
-
     GraphQLSubscriptionClient requestSubscription;
 
     StateHandler stateHandler; // Instance of StateHandler for managing state updates
     OtaChecker otaChecker;     // Instance of OtaChecker for OTA updates
+
+    BackendScheduler scheduler; // Runs the loops above by priority
 };
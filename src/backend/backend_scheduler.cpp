@@ -0,0 +1,128 @@
+#include "backend_scheduler.h"
+#include <Arduino.h>
+
+// Signed time from a to b, correct across millis() wrap-around
+static long elapsed(unsigned long from, unsigned long to) {
+    return (long)(to - from);
+}
+
+BackendScheduler::BackendScheduler() : _jobs() {
+}
+
+int BackendScheduler::add(const JobConfig& config, JobFunction function, void* context) {
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        if (_jobs[i].function == nullptr) {
+            _jobs[i] = Job();
+            _jobs[i].config = config;
+            _jobs[i].function = function;
+            _jobs[i].context = context;
+            _jobs[i].dueAt = millis();
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void BackendScheduler::cancel(int id) {
+    if (id >= 0 && (size_t)id < MAX_JOBS) {
+        _jobs[id].function = nullptr;
+    }
+}
+
+int BackendScheduler::pick(unsigned long now) const {
+    int best = -1;
+    bool bestLate = false;
+    long bestDeadline = 0;
+
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        const Job& job = _jobs[i];
+        const long waited = elapsed(job.dueAt, now);
+        if (job.function == nullptr || waited < 0) {
+            continue;
+        }
+
+        // Time left until the maximum latency, negative once it is passed
+        const long deadline = (long)job.config.maxLatencyMs - waited;
+        const bool late = deadline < 0;
+
+        bool better;
+        if (best < 0) {
+            better = true;
+        } else if (late != bestLate) {
+            better = late;
+        } else if (late) {
+            better = deadline < bestDeadline;
+        } else if (job.config.priority != _jobs[best].config.priority) {
+            better = job.config.priority < _jobs[best].config.priority;
+        } else {
+            better = deadline < bestDeadline;
+        }
+
+        if (better) {
+            best = (int)i;
+            bestLate = late;
+            bestDeadline = deadline;
+        }
+    }
+    return best;
+}
+
+bool BackendScheduler::runNext() {
+    const unsigned long start = millis();
+    const int index = pick(start);
+    if (index < 0) {
+        return false;
+    }
+
+    Job& job = _jobs[index];
+    const uint32_t latency = (uint32_t)(start - job.dueAt);
+    job.dueAt = start + job.config.periodMs;
+
+    // The budget bounds all the requests of the run together
+    job.function(job.context, start, Deadline::at(start + job.config.budgetMs));
+
+    const uint32_t runTime = (uint32_t)(millis() - start);
+    JobStats& stats = job.stats;
+    stats.runs++;
+    stats.totalLatencyMs += latency;
+    stats.totalRunMs += runTime;
+    if (latency > job.config.maxLatencyMs) {
+        stats.late++;
+    }
+    if (latency > stats.maxLatencyMs) {
+        stats.maxLatencyMs = latency;
+    }
+    if (runTime > job.config.budgetMs) {
+        stats.overruns++;
+    }
+    if (runTime > stats.maxRunMs) {
+        stats.maxRunMs = runTime;
+    }
+    return true;
+}
+
+uint32_t BackendScheduler::getIdleMs(uint32_t limit) const {
+    const unsigned long now = millis();
+    uint32_t idle = limit;
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        if (_jobs[i].function == nullptr) {
+            continue;
+        }
+        const long wait = elapsed(now, _jobs[i].dueAt);
+        if (wait <= 0) {
+            return 0;
+        }
+        if ((uint32_t)wait < idle) {
+            idle = (uint32_t)wait;
+        }
+    }
+    return idle;
+}
+
+const char* BackendScheduler::getName(size_t index) const {
+    return index < MAX_JOBS && _jobs[index].function != nullptr ? _jobs[index].config.name : nullptr;
+}
+
+const BackendScheduler::JobStats* BackendScheduler::getStats(size_t index) const {
+    return index < MAX_JOBS && _jobs[index].function != nullptr ? &_jobs[index].stats : nullptr;
+}
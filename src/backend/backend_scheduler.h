@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "deadline.h"
+
+/**
+ * @brief Runs the backend jobs of one task by deadline and priority
+ *
+ * Every job has a period, the most latency it tolerates and a time budget.
+ * runNext() runs one due job: a job that waited past its maximum latency
+ * goes first, earliest deadline first, otherwise the due job with the
+ * highest priority. Returning after every job means a slow job delays the
+ * others by one run at most, an interactive job never waits behind a queue.
+ *
+ * Jobs cannot be preempted. The budget sets the deadline the job is run with,
+ * the job hands it to its requests so all of them together block for about
+ * the budget at worst. Runs that take longer are counted as overruns.
+ *
+ * Times are millis() values, wrap-around is handled.
+ */
+class BackendScheduler {
+public:
+    static const size_t MAX_JOBS = 8;
+
+    enum class Priority : uint8_t {
+        INTERACTIVE,    // Command responses
+        DATA,           // Meter data uploads
+        STATE,          // State updates
+        OTA             // Firmware update checks
+    };
+
+    typedef void (*JobFunction)(void* context, unsigned long now, const Deadline& deadline);
+
+    struct JobConfig {
+        const char* name;
+        Priority priority;
+        uint32_t periodMs;      // Time from the start of a run until the job is due again
+        uint32_t maxLatencyMs;  // Wait after becoming due before the job preempts priorities
+        uint32_t budgetMs;      // Expected worst case run time, the deadline of a run
+    };
+
+    struct JobStats {
+        uint32_t runs;
+        uint32_t late;          // Runs that started after the maximum latency
+        uint32_t overruns;      // Runs longer than the budget
+        uint32_t maxLatencyMs;  // Longest wait from due to start
+        uint64_t totalLatencyMs;
+        uint32_t maxRunMs;
+        uint64_t totalRunMs;
+    };
+
+    BackendScheduler();
+
+    /**
+     * @brief Add a job, it is due right away
+     *
+     * @return Id for cancel(), -1 when all slots are taken
+     */
+    int add(const JobConfig& config, JobFunction function, void* context);
+
+    // Remove a job, it is not run again, its slot can be reused
+    void cancel(int id);
+
+    /**
+     * @brief Run the most urgent due job
+     *
+     * @return false if no job was due
+     */
+    bool runNext();
+
+    /**
+     * @brief Milliseconds until the next job is due, 0 if one is due now
+     *
+     * @param limit Returned when there are no jobs or the next is further away
+     */
+    uint32_t getIdleMs(uint32_t limit) const;
+
+    // Jobs for reporting, unused slots are nullptr
+    const char* getName(size_t index) const;
+    const JobStats* getStats(size_t index) const;
+
+private:
+    struct Job {
+        JobConfig config;
+        JobFunction function;   // nullptr when the slot is unused
+        void* context;
+        unsigned long dueAt;
+        JobStats stats;
+    };
+
+    // Index of the job to run, -1 if none is due
+    int pick(unsigned long now) const;
+
+    Job _jobs[MAX_JOBS];
+};
@@ -0,0 +1,103 @@
+#include "chunked_decoder.h"
+#include <cstring>
+
+ChunkedDecoder::ChunkedDecoder() {
+    reset();
+}
+
+void ChunkedDecoder::reset() {
+    _state = State::SIZE;
+    _remaining = 0;
+    _hasDigits = false;
+}
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+size_t ChunkedDecoder::decode(uint8_t* data, size_t length) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length && _state != State::DONE && _state != State::ERROR) {
+        if (_state == State::DATA) {
+            // Move as much chunk data as possible in one go
+            size_t count = length - in;
+            if (count > _remaining) {
+                count = _remaining;
+            }
+            if (out != in) {
+                memmove(data + out, data + in, count);
+            }
+            in += count;
+            out += count;
+            _remaining -= count;
+            if (_remaining == 0) {
+                _state = State::DATA_CR;
+            }
+            continue;
+        }
+
+        const uint8_t c = data[in++];
+        switch (_state) {
+            case State::SIZE: {
+                const int digit = hexValue(c);
+                if (digit >= 0) {
+                    if (_remaining > (UINT32_MAX >> 4)) {
+                        _state = State::ERROR;     // Larger than we could ever buffer
+                        break;
+                    }
+                    _remaining = (_remaining << 4) | (uint32_t)digit;
+                    _hasDigits = true;
+                } else if (!_hasDigits) {
+                    _state = State::ERROR;
+                } else if (c == '\r') {
+                    _state = State::SIZE_LF;
+                } else if (c == ';' || c == ' ' || c == '\t') {
+                    _state = State::EXTENSION;
+                } else {
+                    _state = State::ERROR;
+                }
+                break;
+            }
+            case State::EXTENSION:
+                if (c == '\r') {
+                    _state = State::SIZE_LF;
+                }
+                break;
+            case State::SIZE_LF:
+                if (c != '\n') {
+                    _state = State::ERROR;
+                } else if (_remaining == 0) {
+                    _state = State::TRAILER;
+                } else {
+                    _state = State::DATA;
+                }
+                _hasDigits = false;
+                break;
+            case State::DATA_CR:
+                _state = c == '\r' ? State::DATA_LF : State::ERROR;
+                break;
+            case State::DATA_LF:
+                _state = c == '\n' ? State::SIZE : State::ERROR;
+                break;
+            case State::TRAILER:
+                _state = c == '\r' ? State::FINAL_LF : State::TRAILER_LINE;
+                break;
+            case State::TRAILER_LINE:
+                if (c == '\n') {
+                    _state = State::TRAILER;
+                }
+                break;
+            case State::FINAL_LF:
+                _state = c == '\n' ? State::DONE : State::ERROR;
+                break;
+            default:
+                break;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Incremental decoder for HTTP/1.1 chunked transfer encoding
+ *
+ * The body can arrive in blocks split anywhere. Each block is decoded in
+ * place, the chunk data is moved to the front of the block, so a response can
+ * be read straight into its final buffer. Chunk extensions and trailers are
+ * skipped.
+ */
+class ChunkedDecoder {
+public:
+    ChunkedDecoder();
+
+    /**
+     * @brief Decode the next block of the body
+     *
+     * @param data Raw bytes, overwritten with the decoded bytes
+     * @param length Number of raw bytes
+     * @return Number of decoded bytes now at the start of data
+     */
+    size_t decode(uint8_t* data, size_t length);
+
+    /**
+     * @brief The last chunk and trailers have been read, bytes after that are ignored
+     */
+    bool isDone() const { return _state == State::DONE; }
+
+    bool hasError() const { return _state == State::ERROR; }
+
+    void reset();
+
+private:
+    enum class State {
+        SIZE,           // Hex digits of the chunk size
+        EXTENSION,      // Skipping to the end of the size line
+        SIZE_LF,
+        DATA,
+        DATA_CR,
+        DATA_LF,
+        TRAILER,        // Start of a trailer line or the final empty line
+        TRAILER_LINE,   // Skipping a trailer line
+        FINAL_LF,
+        DONE,
+        ERROR
+    };
+
+    State _state;
+    uint32_t _remaining;    // Chunk size while reading it, then data bytes left
+    bool _hasDigits;
+};
@@ -13,18 +13,33 @@
 #include "endpoints/endpoint_types.h"
 #include "endpoints/endpoints.h"
 #include "backend/request_handler.h" // Ensure RequestHandler is included
+#include "backend/signing_task.h"
 #include "backend/graphql.h" // Include for GQL namespace used in removed methods
 #include "../zap_log.h" // Added for logging
 
 // Define TAG for logging
 static const char* TAG = "config_subscription";
 
+// Starts at the old fixed 5 s reconnect delay
+static const RetryPolicy::Config RECONNECT_POLICY = {5000, 5 * 60 * 1000, 10, 10 * 60 * 1000};
+
 class RequestHandlerExternals : public zap::backend::RequestHandler::Externals {
 public:
+    GraphQLSubscriptionClient* subscription = nullptr;
+
     GQL::BoolResponse setConfiguration(const zap::Str& jwt) override {
+        // Command responses go back over the socket the request came in on
+        if (subscription != nullptr) {
+            return subscription->setConfiguration(jwt);
+        }
         return GQL::setConfiguration(jwt);
     }
 
+    zap::Str createJwt(const char* header, const char* payload) override {
+        // Command responses go ahead of any queued meter data
+        return g_signingTask.sign(header, payload, SignJob::Priority::HIGH);
+    }
+
     const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) override {
         return EndpointMapper::toEndpoint(path, verb);
     }
@@ -37,8 +52,9 @@ public:
 RequestHandlerExternals g_requestHandlerExternals;
 
 // Constructor
-GraphQLSubscriptionClient::GraphQLSubscriptionClient(const char* wsUrl) : requestHandler(g_requestHandlerExternals), url(wsUrl) {
+GraphQLSubscriptionClient::GraphQLSubscriptionClient(const char* wsUrl) : reconnectPolicy("websocket", RECONNECT_POLICY), requestHandler(g_requestHandlerExternals), frameDecoder(RECEIVE_BUFFER_SIZE), url(wsUrl) {
     parseUrl(url);
+    g_requestHandlerExternals.subscription = this;
     LOG_I(TAG, "GraphQLSubscriptionClient initialized with URL: %s", wsUrl);
 }
 
@@ -73,18 +89,25 @@ void GraphQLSubscriptionClient::parseUrl(String urlString) {
 }
 
 // Initialize the client
-bool GraphQLSubscriptionClient::begin() {
+bool GraphQLSubscriptionClient::begin(const Deadline& deadline) {
     LOG_I(TAG, "Connecting to WebSocket server: %s:%d%s", host.c_str(), port, path.c_str());
 
+    const uint32_t timeoutMs = deadline.remainingMs();
+    if (timeoutMs == 0) {
+        LOG_W(TAG, "Deadline passed, not connecting");
+        return false;
+    }
+
     client.setInsecure(); // Accept all SSL certificates (not recommended for production)
-    client.setTimeout(10);
+    // Socket reads and writes take whole seconds, at least one
+    client.setTimeout((timeoutMs + 999) / 1000);
     
-    if (client.connect(host.c_str(), port)) {
+    if (client.connect(host.c_str(), port, timeoutMs)) {
         LOG_I(TAG, "TCP Connection established");
         _isConnected = true;
         
         // Perform WebSocket handshake
-        if (performWebSocketHandshake()) {
+        if (performWebSocketHandshake(deadline)) {
             LOG_I(TAG, "WebSocket handshake successful");
             isWebSocketHandshakeDone = true;
             sendConnectionInit();
@@ -104,7 +127,7 @@ bool GraphQLSubscriptionClient::begin() {
 }
 
 // Perform WebSocket handshake
-bool GraphQLSubscriptionClient::performWebSocketHandshake() {
+bool GraphQLSubscriptionClient::performWebSocketHandshake(const Deadline& deadline) {
     // Generate random key for the handshake
     String key = "";
     for (int i = 0; i < 16; i++) {
@@ -142,9 +165,8 @@ bool GraphQLSubscriptionClient::performWebSocketHandshake() {
     client.print("\r\n");
     
     // Wait for server response
-    unsigned long timeout = millis() + 5000;
     while (client.available() == 0) {
-        if (millis() > timeout) {
+        if (deadline.hasPassed()) {
             LOG_E(TAG, "Handshake timeout");
             return false;
         }
@@ -174,12 +196,18 @@ bool GraphQLSubscriptionClient::performWebSocketHandshake() {
 }
 
 // Main loop function to handle WebSocket events
-void GraphQLSubscriptionClient::loop(const unsigned long currentMillis) {
+void GraphQLSubscriptionClient::loop(const unsigned long currentMillis, const Deadline& deadline) {
+    fallBackToHttp(currentMillis, deadline);
+
     if (!_isConnected) {
-        if (currentMillis - lastConnectAttempt > RECONNECT_DELAY) {
-            lastConnectAttempt = currentMillis;
+        if (reconnectPolicy.shouldAttempt(currentMillis)) {
             LOG_I(TAG, "Attempting to reconnect WebSocket...");
-            begin();
+            if (begin(deadline)) {
+                reconnectPolicy.onSuccess(millis());
+            } else {
+                reconnectPolicy.onFailure(millis());
+                LOG_I(TAG, "Next WebSocket attempt in %u ms", (unsigned int)reconnectPolicy.getWaitMs(millis()));
+            }
         }
         return;
     }
@@ -192,26 +220,27 @@ void GraphQLSubscriptionClient::loop(const unsigned long currentMillis) {
         pingPongDiff += 1;
     }
     
-    // Check for available data
-    if (client.available()) {
-        LOG_V(TAG, "Web socket Data available");
-        uint8_t buffer[1024]; // Adjust buffer size as needed
-        size_t length = client.read(buffer, sizeof(buffer));
-        
-        
-        if (length > 0) {
-            processWebSocketData(buffer, length);
+    // Read whatever has arrived straight into the frame decoder
+    while (_isConnected && client.available()) {
+        size_t space;
+        uint8_t* buffer = frameDecoder.writeBuffer(space);
+        int length = client.read(buffer, space);
+        if (length <= 0) {
+            break;
         }
+        LOG_V(TAG, "Web socket received %d bytes", length);
+        frameDecoder.commitWrite(length);
+        processWebSocketData(deadline);
     }
 
     // Check if ping pong has timed out
     if (pingPongDiff > 2) {
         LOG_W(TAG, "Ping pong timeout, two pings sent without response...");
         LOG_W(TAG, "Closing connection...");
-        _isConnected = false;
+        markDisconnected();
         pingPongDiff = 0;
-        isWebSocketHandshakeDone = false;
         client.stop();
+        reconnectPolicy.onFailure(currentMillis);
 
         return;
     }
@@ -219,173 +248,103 @@ void GraphQLSubscriptionClient::loop(const unsigned long currentMillis) {
     // Check if connection is still alive
     if (!client.connected()) {
         LOG_W(TAG, "Connection lost");
-        _isConnected = false;
-        isWebSocketHandshakeDone = false;
+        markDisconnected();
         client.stop();
+        reconnectPolicy.onFailure(currentMillis);
     }
 }
 
-// Process WebSocket frames
-void GraphQLSubscriptionClient::processWebSocketData(uint8_t* buffer, size_t length) {
-
-    // Verbose logging of received hex data
-    if (get_log_level() >= ZLOG_LEVEL_VERBOSE) { 
-        zap::Str hexData;
-        for (size_t i = 0; i < length; i++) {
-            char byteHex[4];
-            sprintf(byteHex, "%02X ", buffer[i]);
-            hexData += byteHex;
+// Process the WebSocket messages decoded so far
+void GraphQLSubscriptionClient::processWebSocketData(const Deadline& deadline) {
+    WsFrameDecoder::Message message;
+    while (frameDecoder.next(message)) {
+        handleMessage(message, deadline);
+        if (!_isConnected) {
+            return;     // Closed while handling, the decoder was reset
         }
-        
-        LOG_V(TAG, "Received %d bytes:", length);
-        LOG_V(TAG, hexData.c_str());
     }
 
-    // Very basic WebSocket frame parsing
-    if (length < 2) return;
-    
-    // Check if this is a final fragment and get opcode
-    bool fin = (buffer[0] & 0x80) != 0;
-    uint8_t opcode = buffer[0] & 0x0F;
-    
-    // Check if masked
-    bool masked = (buffer[1] & 0x80) != 0;
-    
-    // Get payload length
-    uint64_t payload_length = buffer[1] & 0x7F;
-    size_t header_length = 2;
-    
-    if (payload_length == 126) {
-        // Extended payload length (16 bits)
-        if (length < 4) return;
-        payload_length = (buffer[2] << 8) | buffer[3];
-        header_length = 4;
-    } else if (payload_length == 127) {
-        // Extended payload length (64 bits)
-        if (length < 10) return;
-        payload_length = 0;
-        for (int i = 0; i < 8; i++) {
-            payload_length = (payload_length << 8) | buffer[2 + i];
-        }
-        header_length = 10;
-    }
-    
-    // Get masking key (if masked)
-    uint8_t mask[4] = {0, 0, 0, 0};
-    if (masked) {
-        if (length < header_length + 4) return;
-        for (int i = 0; i < 4; i++) {
-            mask[i] = buffer[header_length + i];
-        }
-        header_length += 4;
+    if (frameDecoder.hasError()) {
+        LOG_E(TAG, "Invalid WebSocket frame received, reconnecting");
+        stop();
+        reconnectPolicy.onFailure(millis());
     }
-    
-    // Validate length
-    if (length < header_length + payload_length) return;
-    
-    // Process based on opcode
-    switch (opcode) {
-        case 0x01: // Text frame
+}
+
+void GraphQLSubscriptionClient::handleMessage(const WsFrameDecoder::Message& message, const Deadline& deadline) {
+    switch (message.opcode) {
+        case WsFrameDecoder::TEXT:
         {
-            // Allocate buffer for payload
-            char* payload = new char[payload_length + 1];
+            // Parse JSON straight from the receive buffer, indexed once for the lookups below.
+            // The buffer is ours until the next frame, so strings may be unescaped in it.
+            JsonParser doc(message.data, message.length);
+            JsonTapeEntry tape[MESSAGE_TAPE_ENTRIES];
+            doc.index(tape, MESSAGE_TAPE_ENTRIES);
             
-            // Unmask payload
-            if (masked) {
-                for (size_t i = 0; i < payload_length; i++) {
-                    payload[i] = buffer[header_length + i] ^ mask[i % 4];
+            JsonStringView type;
+            if (doc.getStringView("type", type)) {
+
+                // Results of our own mutations carry the id they were started with
+                JsonStringView idView;
+                char id[12] = "";
+                if (doc.getStringView("id", idView)) {
+                    idView.copyTo(id, sizeof(id));
                 }
-            } else {
-                for (size_t i = 0; i < payload_length; i++) {
-                    payload[i] = buffer[header_length + i];
-                }
-            }
-            
-            // Null-terminate
-            payload[payload_length] = '\0';
-            
-            // Parse JSON
-            JsonParser doc(payload);
-            
-            zap::Str type;
-            if (doc.getString("type", type)) {
-            
-                if (type == "connection_ack") {
+                const uint32_t operationId = (uint32_t)atol(id);
+
+                if (type.equals("connection_ack")) {
                     LOG_I(TAG, "Connection acknowledged, sending subscription");
+                    isAcknowledged = true;
                     subscribeToSettings();
-                } else if (type == "data") {
-                    LOG_D(TAG, "Received data: %s", payload);
+                } else if (operationId >= MutationTracker::FIRST_ID && (type.equals("data") || type.equals("error"))) {
+                    handleMutationResult(operationId, doc, type.equals("error"), deadline);
+                } else if (type.equals("data")) {
+                    LOG_D(TAG, "Received data: %s", message.data);
                     JsonParser configChanges("");
                     if (doc.getObjectByPath("payload.data.configurationDataChanges", configChanges)) {
 
-                        zap::Str subKey;
-                        if (configChanges.getString("subKey", subKey)) {
+                        JsonStringView subKey;
+                        if (configChanges.getStringView("subKey", subKey)) {
                         
-                            if (subKey == SETTINGS_SUBKEY) {
-                                LOG_I(TAG, "Handling settings update for subKey: %s", subKey.c_str());
+                            if (subKey.equals(SETTINGS_SUBKEY)) {
+                                LOG_I(TAG, "Handling settings update for subKey: %s", SETTINGS_SUBKEY);
                                 handleSettings(configChanges);
                             }
-                            else if (subKey == REQUEST_TASK_SUBKEY) {
-                                LOG_I(TAG, "Handling request task for subKey: %s", subKey.c_str());
+                            else if (subKey.equals(REQUEST_TASK_SUBKEY)) {
+                                LOG_I(TAG, "Handling request task for subKey: %s", REQUEST_TASK_SUBKEY);
                                 requestHandler.handleRequestTask(configChanges);
                             }
                         }
                     }
                 }
             }
-            delete[] payload;
         }
         break;
-        case 0x08: // Close frame
+        case WsFrameDecoder::CLOSE:
         {
             uint16_t closeCode = 0;
-            if (payload_length >= 2) {
-                closeCode = (buffer[header_length] << 8) | buffer[header_length + 1];
+            if (message.length >= 2) {
+                closeCode = ((uint8_t)message.data[0] << 8) | (uint8_t)message.data[1];
             }
             
             LOG_I(TAG, "Received close frame with code: %d", closeCode);
             
-            if (payload_length > 2) {
-                // Extract close reason if provided
-                char* reason = new char[payload_length - 2];
-                for (size_t i = 0; i < payload_length - 2; i++) {
-                    if (masked) {
-                        reason[i] = buffer[header_length + 2 + i] ^ mask[(i + 2) % 4];
-                    } else {
-                        reason[i] = buffer[header_length + 2 + i];
-                    }
-                }
-                reason[payload_length - 2] = '\0';
-                LOG_I(TAG, "Close reason: %s", reason);
-                delete[] reason;
+            if (message.length > 2) {
+                LOG_I(TAG, "Close reason: %s", message.data + 2);
             }
             
             stop();
+            reconnectPolicy.onFailure(millis());
         }
         break;
-        case 0x09: // Ping frame, we never seem to get this
+        case WsFrameDecoder::PING: // We never seem to get this
         {
-            // Respond with pong
+            // Respond with pong carrying the same payload
             LOG_D(TAG, "Received ping, sending pong");
-            // Extract ping payload
-            uint8_t* pingPayload = new uint8_t[payload_length];
-            for (size_t i = 0; i < payload_length; i++) {
-                if (masked) {
-                    pingPayload[i] = buffer[header_length + i] ^ mask[i % 4];
-                } else {
-                    pingPayload[i] = buffer[header_length + i];
-                }
-            }
-            
-            // Send pong with same payload
-            client.write(0x8A); // FIN bit set, opcode 0x0A (pong)
-            client.write((uint8_t)payload_length); // Payload length
-            client.write(pingPayload, payload_length); // Payload
-            
-            delete[] pingPayload;
+            sendFrame((const uint8_t*)message.data, message.length, WsFrameDecoder::PONG);
         }
         break;
-        case 0x0A: // Pong frame
+        case WsFrameDecoder::PONG:
         {
             
             if (pingPongDiff > 0) {
@@ -399,7 +358,7 @@ void GraphQLSubscriptionClient::processWebSocketData(uint8_t* buffer, size_t len
         break;
         default:
         {
-            LOG_W(TAG, "Received unknown frame type: %d", opcode);
+            LOG_W(TAG, "Received unknown frame type: %d", message.opcode);
         }
         break;
     }
@@ -407,10 +366,12 @@ void GraphQLSubscriptionClient::processWebSocketData(uint8_t* buffer, size_t len
 
 // Send a WebSocket frame
 void GraphQLSubscriptionClient::sendFrame(const zap::Str& data, uint8_t opcode) {
+    sendFrame((const uint8_t*)data.c_str(), data.length(), opcode);
+}
+
+void GraphQLSubscriptionClient::sendFrame(const uint8_t* payload, size_t length, uint8_t opcode) {
     if (!_isConnected || !isWebSocketHandshakeDone) return;
     
-    size_t length = data.length();
-    
     // Create a random mask (required for client to server communication)
     uint8_t mask[4];
     for (int i = 0; i < 4; i++) {
@@ -438,7 +399,6 @@ void GraphQLSubscriptionClient::sendFrame(const zap::Str& data, uint8_t opcode)
     client.write(mask, 4);
     
     // Write masked payload
-    const char* payload = data.c_str();
     uint8_t retries = 0;
     for (size_t i = 0; i < length && retries < 5; ) {
         if (client.write(payload[i] ^ mask[i % 4]) ) {
@@ -522,13 +482,13 @@ void GraphQLSubscriptionClient::subscribeToSettings() {
 
 // Generate the GraphQL subscription query with authentication
 zap::Str GraphQLSubscriptionClient::getSubscriptionQuery() {
-    // The GraphQL query template
+    // The GraphQL query template, $0 serial, $1 timestamp and $2 signature
     const char* queryTemplate = R"(
     subscription {
       configurationDataChanges(deviceAuth: {
-        id: "$serial",
-        timestamp: "$timestamp",
-        signedIdAndTimestamp: "$signature"
+        id: "$0",
+        timestamp: "$1",
+        signedIdAndTimestamp: "$2"
       }) {
         data
         subKey
@@ -546,17 +506,13 @@ zap::Str GraphQLSubscriptionClient::getSubscriptionQuery() {
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &timeinfo);
     
     // Get device serial number and signature
-    zap::Str serial = crypto_getId();
+    const zap::Str& serial = crypto_getId();
     zap::Str message = serial + ":" + zap::Str(timestamp);
-    zap::Str signature = crypto_create_signature_hex(message.c_str(), PRIVATE_KEY_HEX);
+    zap::Str signature = crypto_create_signature_hex(message.c_str());
     
-    // Replace placeholders in the query
-    zap::Str query = zap::Str(queryTemplate);
-    query.replace("$serial", serial.c_str());
-    query.replace("$timestamp", timestamp);
-    query.replace("$signature", signature.c_str());
-    
-    return query;
+    // Fill the placeholders in one pass, the query is JSON escaped when the message is built
+    const char* params[] = {serial.c_str(), timestamp, signature.c_str()};
+    return GQL::fillTemplate(queryTemplate, params, 3);
 }
 
 // Process settings update
@@ -587,8 +543,76 @@ void GraphQLSubscriptionClient::stop() {
         delay(100); // Give time for the close frame to be sent
     }
     
+    markDisconnected();
+    client.stop();
+}
+
+void GraphQLSubscriptionClient::markDisconnected() {
     _isConnected = false;
     isWebSocketHandshakeDone = false;
-    client.stop();
+    isAcknowledged = false;
+    frameDecoder.reset();
+}
+
+GQL::BoolResponse GraphQLSubscriptionClient::setConfiguration(const zap::Str& jwt, const Deadline& deadline) {
+    if (!mutationsOverWebSocket || !_isConnected || !isAcknowledged) {
+        return GQL::setConfiguration(jwt, deadline);
+    }
+
+    const uint32_t id = pendingMutations.add(jwt, millis());
+    if (id == 0) {
+        LOG_W(TAG, "Too many mutations waiting for a result, using HTTP");
+        return GQL::setConfiguration(jwt, deadline);
+    }
+
+    // The payload is the same request body that is sent over HTTP
+    zap::Str message = "{\"id\":\"" + zap::Str(id) + "\",\"type\":\"start\",\"payload\":" + GQL::setConfigurationRequest(jwt) + "}";
+    sendFrame(message);
+
+    LOG_D(TAG, "Sent mutation %u over WebSocket", (unsigned int)id);
+    return GQL::BoolResponse::ok(true);
+}
+
+void GraphQLSubscriptionClient::handleMutationResult(uint32_t id, JsonParser& doc, bool isError, const Deadline& deadline) {
+    zap::Str jwt;
+    unsigned long sentAt;
+    if (!pendingMutations.take(id, jwt, sentAt)) {
+        LOG_W(TAG, "Result for unknown mutation %u", (unsigned int)id);
+        return;
+    }
+
+    GQL::BoolResponse response = GQL::BoolResponse::gqlError(zap::Str("Mutation failed"));
+    JsonParser payload("");
+    if (!isError && doc.getObject("payload", payload)) {
+        zap::Str result;
+        payload.asString(result);
+        response = GQL::parseSetConfigurationResult(result.c_str());
+    }
+
+    if (response.isSuccess()) {
+        LOG_I(TAG, "Mutation %u confirmed in %lu ms", (unsigned int)id, millis() - sentAt);
+        return;
+    }
+
+    LOG_W(TAG, "Mutation %u failed over WebSocket (%s), retrying over HTTP", (unsigned int)id, response.error.c_str());
+    response = GQL::setConfiguration(jwt, deadline);
+    if (!response.isSuccess()) {
+        LOG_E(TAG, "Mutation failed over HTTP: %s", response.error.c_str());
+    }
+}
+
+void GraphQLSubscriptionClient::fallBackToHttp(const unsigned long currentMillis, const Deadline& deadline) {
+    // Once the socket is down no results will come, send everything now
+    const unsigned long timeout = _isConnected ? MUTATION_TIMEOUT : 0;
+
+    zap::Str jwt;
+    // Those left once the deadline passed go in the next run
+    while (!deadline.hasPassed() && pendingMutations.takeExpired(currentMillis, timeout, jwt)) {
+        LOG_W(TAG, "No mutation result over WebSocket, sending over HTTP");
+        GQL::BoolResponse response = GQL::setConfiguration(jwt, deadline);
+        if (!response.isSuccess()) {
+            LOG_E(TAG, "Mutation failed over HTTP: %s", response.error.c_str());
+        }
+    }
 }
 
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
@@ -9,6 +11,9 @@
 #include "endpoints/endpoint_types.h"
 #include "endpoints/endpoints.h"
 #include "backend/request_handler.h" // Include the new RequestHandler header
+#include "backend/mutation_tracker.h"
+#include "backend/ws_frame_decoder.h"
+#include "backend/retry_policy.h"
 
 // Forward declarations
 class Crypto;
@@ -22,7 +27,9 @@ class GraphQLSubscriptionClient {
 private:
     // Constants
     const unsigned long PING_INTERVAL = 45000; // 45 seconds in milliseconds
-    const unsigned long RECONNECT_DELAY = 5000; // 5 seconds in milliseconds
+    const unsigned long MUTATION_TIMEOUT = 5000; // Result wait before falling back to HTTP
+    static const size_t RECEIVE_BUFFER_SIZE = 4096; // Largest message that is not dropped
+    static const size_t MESSAGE_TAPE_ENTRIES = 48;  // JSON values indexed per message, more are scanned
     const char* SETTINGS_SUBKEY = "settings";
     const char* REQUEST_TASK_SUBKEY = "request";
 
@@ -34,22 +41,26 @@ private:
     String url;
     bool _isConnected = false;
     bool isWebSocketHandshakeDone = false;
+    bool isAcknowledged = false;    // connection_ack received, operations can be started
+    bool mutationsOverWebSocket = true;
     unsigned long pingPongDiff = 0;
     unsigned long lastPingTime = 0;
     unsigned long lastPongTime = 0;
-    unsigned long lastConnectAttempt = 0;
+    RetryPolicy reconnectPolicy;    // Backoff between connection attempts
 
     zap::backend::RequestHandler requestHandler; // Add RequestHandler instance
+    MutationTracker pendingMutations;
+    WsFrameDecoder frameDecoder;
 
 public:
 
     explicit GraphQLSubscriptionClient(const char* wsUrl);
     
-    // Initialize connection
-    bool begin();
+    // Initialize connection, connecting and the handshake give up at the deadline
+    bool begin(const Deadline& deadline = Deadline::in(HttpConnectionManager::DEFAULT_TIMEOUT_MS));
     
-    // Must be called in the main loop
-    void loop(const unsigned long currentMillis);
+    // Must be called in the main loop, a reconnect and HTTP fallbacks give up at the deadline
+    void loop(const unsigned long currentMillis, const Deadline& deadline);
     
     // Restart connection
     void restart();
@@ -69,6 +80,25 @@ public:
     bool isConnected() const {
         return _isConnected;
     }
+
+    /**
+     * @brief Send a setConfiguration mutation, over the WebSocket when it is up
+     *
+     * Over the WebSocket the mutation is only sent here, a success response
+     * means it is on its way. Its result is matched by operation id in loop()
+     * and the mutation is sent over HTTP if the result is an error or does not
+     * arrive in time. Without a WebSocket this is GQL::setConfiguration().
+     *
+     * @param jwt The signed JWT to set
+     * @param deadline When to give up on the request over HTTP
+     */
+    GQL::BoolResponse setConfiguration(const zap::Str& jwt,
+                                       const Deadline& deadline = Deadline::in(HttpConnectionManager::DEFAULT_TIMEOUT_MS));
+
+    // Send all mutations over HTTP when disabled
+    void setMutationsOverWebSocket(bool enabled) {
+        mutationsOverWebSocket = enabled;
+    }
     
     
 private:
@@ -76,20 +106,33 @@ private:
     void parseUrl(String url);
     
     // Perform WebSocket handshake
-    bool performWebSocketHandshake();
+    bool performWebSocketHandshake(const Deadline& deadline);
     
     // Send ping to keep connection alive
     void sendPing();
     
     // Send a WebSocket frame
     void sendFrame(const zap::Str& data, uint8_t opcode = 0x01); // 0x01 = text frame
+    void sendFrame(const uint8_t* payload, size_t length, uint8_t opcode);
     
-    // Process received WebSocket data
-    void processWebSocketData(uint8_t* data, size_t length);
+    // Process the messages in the frame decoder
+    void processWebSocketData(const Deadline& deadline);
+
+    // Handle one complete message
+    void handleMessage(const WsFrameDecoder::Message& message, const Deadline& deadline);
     
     // Helper for handling settings data
     void handleSettings(JsonParser& configData);
     
     void processConfiguration(const char* configData);
+
+    // Match a mutation result to its pending mutation
+    void handleMutationResult(uint32_t id, JsonParser& doc, bool isError, const Deadline& deadline);
+
+    // Send pending mutations over HTTP, all of them when the socket is down
+    void fallBackToHttp(const unsigned long currentMillis, const Deadline& deadline);
+
+    // Reset the state of a closed socket
+    void markDisconnected();
 };
 
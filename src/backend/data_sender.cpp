@@ -5,80 +5,200 @@
 #include "../data/p1data_funcs.h"
 #include "../data/data_package.h"
 #include "../json_light/json_light.h"
+#include "signing_task.h"
+#include "http_connection_manager.h"
+#include "heatshrink.h"
 #include <esp_log.h>
 
 #include "zap_log.h"
 
 static const char* TAG = "data_sender";
 
-zap::Str createP1JWT(const char* privateKey, const zap::Str& deviceId, const char* szPayload) {
-    // Create the header
-   
+static const RetryPolicy::Config RETRY_POLICY = {2000, 2 * 60 * 1000, 5, 5 * 60 * 1000};
+
+// A batch that does not fill up is sent anyway after this long
+static const unsigned long MAX_BATCH_WAIT_MS = 5 * 60 * 1000;
+
+// Payloads are compressed before signing once the data host lists this coding in Accept-Encoding.
+// A 1 KB window reaches back to the previous reading in a batch, see heatshrink_test for other sizes.
+static const char* COMPRESSION_CODING = "heatshrink";
+static const Heatshrink::Params COMPRESSION_PARAMS = {10, 5};
+static const size_t COMPRESS_BUFFER_SIZE = 4096;
+
+static zap::Str createP1JWTHeader(bool compressed) {
     JsonBuilder header;
     header.beginObject()
-        .add("alg", "ES256")
-        .add("typ", "JWT")
-        .add("device", deviceId.c_str())
         .add("opr", "production")
         .add("model", "p1zap")
         .add("dtype", "p1_telnet_json")
         .add("sn", METER_SN);
+    if (compressed) {
+        // The payload is heatshrink compressed with these window and lookahead sizes
+        header.add("zip", COMPRESSION_CODING)
+            .add("zw", (int)COMPRESSION_PARAMS.windowBits)
+            .add("zl", (int)COMPRESSION_PARAMS.lookaheadBits);
+    }
+    zap::Str fields = header.end();
 
-    zap::Str headerStr = header.end();
- 
-    
-    
-    // Use the crypto_create_jwt function from the crypto module
-    zap::Str jwt = crypto_create_jwt(headerStr.c_str(), szPayload, privateKey);
-    
-    return jwt;
+    // Splice our fields in after the device part of the header
+    return crypto_get_identity().jwtHeaderPrefix + "," + fields.substring(1);
 }
 
-DataSenderTask::DataSenderTask() : bleActive(true) {    // ble will need to be actively disabled for the sending to start
-    
-    // Create the queue for data packages (store up to 3 packages)
-    p1DataQueue = xQueueCreate(3, sizeof(DataPackage));
-    if (p1DataQueue == nullptr) {
-        LOG_E(TAG, "Data sender task: Failed to create queue");
-    }
+DataSenderTask::DataSenderTask() : bleActive(true), wifiManager(nullptr), dataRing(DATA_RING_SIZE), signPending(false), signDone(false),
+      batchCount(0), batchReady(false), signingBatch(false), batchStartedAt(0), compressBuffer(nullptr), retryPolicy("data", RETRY_POLICY) {    // ble will need to be actively disabled for the sending to start
+    signJob.header = nullptr;
+    signJob.payload = nullptr;
+    signJob.payloadLength = 0;
+    signJob.context = this;
+    signJob.onDone = [](SignJob& job) {
+        static_cast<DataSenderTask*>(job.context)->signDone.store(true, std::memory_order_release);
+    };
 }
 
 DataSenderTask::~DataSenderTask() {
+    delete[] compressBuffer;
+}
+
+void DataSenderTask::begin(WifiManager* wifiManager) {
+    this->wifiManager = wifiManager;
 }
 
+void DataSenderTask::loop(const Deadline& deadline) {
+    const uint8_t backlogPercent = (uint8_t)(dataRing.usedBytes() * 100 / dataRing.getArenaSize());
+    uploadController.update(millis(), wifiManager != nullptr ? wifiManager->getRSSI() : 0, backlogPercent);
+
+    // A failed JWT goes first, new readings queue up in the ring meanwhile
+    if (!unsentJwt.isEmpty()) {
+        if (!retryPolicy.shouldAttempt(millis()) || !sendJWT(unsentJwt, deadline)) {
+            return;
+        }
+        unsentJwt.clear();
+    }
+
+    // Pipeline: the next payload is signed on the SigningTask while we post the previous JWT
+    zap::Str jwt;
+    bool hasJwt = false;
 
-QueueHandle_t DataSenderTask::getQueueHandle() {
-    return p1DataQueue;
+    if (signPending && signDone.load(std::memory_order_acquire)) {
+        jwt = signJob.jwt;
+        hasJwt = true;
+        signPending = false;
+        // The payload is in the JWT now
+        if (signingBatch) {
+            batchPayload.clear();
+            batchCount = 0;
+            batchReady = false;
+        } else {
+            dataRing.release();
+        }
+    }
+
+    if (!signPending) {
+        submitNext();
+    }
+
+    if (hasJwt && !sendJWT(jwt, deadline)) {
+        unsentJwt = jwt;
+    }
 }
 
-void DataSenderTask::loop() {
-    if (uxQueueMessagesWaiting(p1DataQueue) > 0) {
-        // Serial.println("Data sender task: Found data in queue to send");
-        
-        // Get the oldest package from the queue (FIFO behavior)
-        DataPackage package;
-        if (xQueueReceive(p1DataQueue, &package, 0) == pdTRUE) {
-            // Serial.println("Data sender task: Retrieved package from queue");
-            
-            // Convert char array back to zap::Str for sending
-            zap::Str dataStr(package.data);
-            
-            // Send the data from the package
-            sendJWT(dataStr);
+void DataSenderTask::submitNext() {
+    const uint8_t batchSize = uploadController.getBatchSize();
+    if (batchSize > 1 || batchCount > 0) {
+        submitBatch(batchSize);
+        return;
+    }
+
+    // The payload is signed straight from the ring, it is only released once signed
+    SpscRing::Record record;
+    if (!dataRing.peek(record)) {
+        return;
+    }
+
+    const char* payload = reinterpret_cast<const char*>(record.data);
+    if (payload[0] == '\0') {
+        LOG_W(TAG, "Data sender task: Empty payload, not sending");
+        dataRing.release();
+        return;
+    }
+
+    submitSignJob(payload, record.length - 1, false);
+}
+
+void DataSenderTask::submitBatch(uint8_t batchSize) {
+    if (!batchReady) {
+        // Readings are moved out of the ring so it keeps room while the batch grows.
+        // Each is {"<timestamp>":{...}}, the batch is one object with all the timestamps.
+        SpscRing::Record record;
+        while (batchCount < batchSize && dataRing.peek(record)) {
+            const char* payload = reinterpret_cast<const char*>(record.data);
+            const size_t length = strlen(payload);
+            if (length >= 2 && payload[0] == '{' && payload[length - 1] == '}') {
+                if (batchCount == 0) {
+                    batchPayload.clear();
+                    batchPayload.reserve(length * batchSize + 1);
+                    batchPayload.append(payload, length - 1);
+                    batchStartedAt = millis();
+                } else {
+                    batchPayload += ',';
+                    batchPayload.append(payload + 1, length - 2);
+                }
+                batchCount++;
+            }
+            dataRing.release();
         }
-    } else {
-        // Serial.println("Data sender task: No data in queue to send");
+
+        // The batch size may have dropped since the batch was started
+        if (batchCount == 0 || (batchCount < batchSize && millis() - batchStartedAt < MAX_BATCH_WAIT_MS)) {
+            return;
+        }
+        batchPayload += '}';
+        batchReady = true;
+        LOG_D(TAG, "Batch of %d readings ready", batchCount);
     }
+
+    submitSignJob(batchPayload.c_str(), batchPayload.length(), true);
 }
 
-void DataSenderTask::sendJWT(const zap::Str& payload) {
-    if (payload.length() == 0) {
+void DataSenderTask::submitSignJob(const char* payload, size_t length, bool batch) {
+    if (p1Header.isEmpty()) {
+        // The headers never change so they are only built once
+        p1Header = createP1JWTHeader(false);
+        p1HeaderCompressed = createP1JWTHeader(true);
+    }
+
+    signJob.header = p1Header.c_str();
+    signJob.payload = payload;
+    signJob.payloadLength = 0;
+
+    if (HttpConnectionManager::acceptsEncoding(DATA_URL, COMPRESSION_CODING)) {
+        if (compressBuffer == nullptr) {
+            compressBuffer = new uint8_t[COMPRESS_BUFFER_SIZE];
+        }
+
+        // Only used when it gets smaller, the buffer stays untouched until the job is signed
+        const size_t capacity = length - 1 < COMPRESS_BUFFER_SIZE ? length - 1 : COMPRESS_BUFFER_SIZE;
+        size_t compressedLength;
+        if (Heatshrink::compress(COMPRESSION_PARAMS, reinterpret_cast<const uint8_t*>(payload), length,
+                                 compressBuffer, capacity, compressedLength) && compressedLength > 0) {
+            LOG_D(TAG, "Payload compressed from %d to %d bytes", (int)length, (int)compressedLength);
+            signJob.header = p1HeaderCompressed.c_str();
+            signJob.payload = reinterpret_cast<const char*>(compressBuffer);
+            signJob.payloadLength = compressedLength;
+        }
+    }
+
+    signingBatch = batch;
+    signDone.store(false, std::memory_order_relaxed);
+    signPending = g_signingTask.submit(&signJob, SignJob::Priority::BULK);
+}
+
+bool DataSenderTask::sendJWT(const zap::Str& jwt, const Deadline& deadline) {
+    if (jwt.isEmpty()) {
         LOG_W(TAG, "Data sender task: Empty JWT, not sending");
-        return;
+        return true;
     }
 
-    zap::Str jwt = createP1JWT(PRIVATE_KEY_HEX, crypto_getId(), payload.c_str());
-    
     // Serial.println("Data sender task: Sending JWT...");
     // Serial.print("Data sender task jwt:");
     // Serial.println(jwt.c_str());
@@ -86,28 +206,21 @@ void DataSenderTask::sendJWT(const zap::Str& payload) {
     // Serial.print("Data sender task: Sending JWT to: ");
     // Serial.println(DATA_URL);
     
-    // Close any previous connections and start a new one
-    http.end();
+    // Sent over the kept-alive connection to the data host when there is one
+    zap::Str response;
+    const unsigned long start = millis();
+    int httpResponseCode = HttpConnectionManager::post(DATA_URL, "text/plain", jwt.c_str(), response, deadline);
+    uploadController.onUpload(millis() - start, httpResponseCode > 0 && httpResponseCode < 500);
     
-    // Start the request
-    if (http.begin(DATA_URL)) {
-        // Add headers
-        http.addHeader("Content-Type", "text/plain");
-        
-        // Send POST request with JWT as body
-        int httpResponseCode = http.POST(jwt.c_str());
-        
-        if (httpResponseCode > 0) {
-            LOG_I(TAG, "HTTP Response code: %d", httpResponseCode);
-            zap::Str response(http.getString().c_str());
-            LOG_D(TAG, "Response: %s", response.c_str());
-        } else {
-            LOG_W(TAG, "HTTP Error code: %d", httpResponseCode);
-        }
-        
-        // Note: Don't call http.end() here to reuse the connection
-        // The connection will be closed when needed or in the destructor
-    } else {
-        LOG_E(TAG, "Failed to connect to server");
+    // Server errors and network errors are worth retrying, a rejected JWT is not
+    if (httpResponseCode > 0 && httpResponseCode < 500) {
+        LOG_I(TAG, "HTTP Response code: %d", httpResponseCode);
+        LOG_D(TAG, "Response: %s", response.c_str());
+        retryPolicy.onSuccess(millis());
+        return true;
     }
+
+    retryPolicy.onFailure(millis());
+    LOG_W(TAG, "HTTP Error code: %d, retrying in %u ms", httpResponseCode, (unsigned int)retryPolicy.getWaitMs(millis()));
+    return false;
 }
\ No newline at end of file
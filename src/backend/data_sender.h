@@ -3,9 +3,13 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
-#include <HTTPClient.h>
 #include "../zap_str.h"
+#include "../data/spsc_ring.h"
+#include "sign_queue.h"
+#include "retry_policy.h"
+#include "upload_controller.h"
+#include "deadline.h"
+#include <atomic>
 
 #include "wifi/wifi_manager.h"
 
@@ -13,20 +17,46 @@ class DataSenderTask {
 public:
     DataSenderTask();
     ~DataSenderTask();
+
+    void begin(WifiManager* wifiManager);
         
     
-    // Get the queue handle to be used by the DataReaderTask
-    QueueHandle_t getQueueHandle();
+    // Get the ring to be used by the DataReaderTask, it is the single producer
+    SpscRing& getDataRing() { return dataRing; }
+
+    // Get the controller that sets the batch size here and the downsampling in the DataReaderTask
+    const UploadController& getUploadController() const { return uploadController; }
 
-    void loop();
+    // Requests made here give up at the deadline
+    void loop(const Deadline& deadline);
 
     
 private:
-    void sendJWT(const zap::Str& payload);
+    void submitNext();
+    void submitBatch(uint8_t batchSize);
+    void submitSignJob(const char* payload, size_t length, bool batch);
+    bool sendJWT(const zap::Str& jwt, const Deadline& deadline);
 
 
     bool bleActive;
+    WifiManager* wifiManager;   // For the RSSI
     
-    HTTPClient http;  // Reuse HTTPClient instance
-    QueueHandle_t p1DataQueue;  // Queue for P1 data packages
+    SpscRing dataRing;  // Ring of P1 JWT payloads, we are the single consumer
+
+    zap::Str p1Header;              // JWT header for meter data, built on first use
+    zap::Str p1HeaderCompressed;    // The same for a compressed payload
+    SignJob signJob;                // Signs the payload at the tail of the ring
+    bool signPending;               // signJob is queued or being signed
+    std::atomic<bool> signDone;     // Set by the SigningTask when signJob has its JWT
+
+    UploadController uploadController;
+    zap::Str batchPayload;          // Readings moved out of the ring, one JSON object keyed by timestamp
+    uint8_t batchCount;             // Readings in batchPayload
+    bool batchReady;                // batchPayload is closed and waits to be signed
+    bool signingBatch;              // signJob signs batchPayload rather than a ring record
+    unsigned long batchStartedAt;
+    uint8_t* compressBuffer;        // Compressed payload being signed, allocated once the backend takes compression
+
+    zap::Str unsentJwt;             // Signed but not delivered, retried on the policy's schedule
+    RetryPolicy retryPolicy;
 };
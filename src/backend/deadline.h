@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+/**
+ * @brief The millis() time by which a backend job has to be done
+ *
+ * The BackendScheduler hands one to every job run, the job passes it on to its
+ * requests, and each connect, send and read waits at most for the time that is
+ * left. Wrap-around of millis() is handled.
+ */
+class Deadline {
+public:
+    // The deadline ms from now
+    static Deadline in(uint32_t ms) { return Deadline(millis() + ms); }
+    static Deadline at(unsigned long time) { return Deadline(time); }
+
+    // Milliseconds left, 0 once it has passed
+    uint32_t remainingMs() const {
+        const long left = (long)(_at - millis());
+        return left > 0 ? (uint32_t)left : 0;
+    }
+
+    bool hasPassed() const { return remainingMs() == 0; }
+
+    unsigned long getTime() const { return _at; }
+
+private:
+    explicit Deadline(unsigned long at) : _at(at) {}
+
+    unsigned long _at;
+};
@@ -3,105 +3,146 @@
 #include "json_light/json_light.h"
 #include "crypto.h"
 #include <time.h>
-#include <HTTPClient.h>
+#include "http_connection_manager.h"
 #include "zap_log.h" // Added for logging
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // Define TAG for logging
 static const char* TAG = "graphql";
 
-zap::Str GQL::prepareGraphQLQuery(const zap::Str& rawQuery) {
-    zap::Str prepared = rawQuery;
-    prepared.replace("\"", "\\\"");
-    prepared.replace("\n", "\\n");
-    return prepared;
+// Request bodies with the query already escaped for JSON, $0..$9 are the parameter slots
+static constexpr char FETCH_GATEWAY_NAME_REQUEST[] =
+    "{\"query\":\"{ gatewayConfiguration { gatewayName(id:\\\"$0\\\") { name } } }\"}";
+
+static constexpr char SET_CONFIGURATION_REQUEST[] =
+    "{\"query\":\"mutation SetGatewayConfigurationWithDeviceJWT { "
+    "setConfiguration(deviceConfigurationInputType: { jwt: \\\"$0\\\" }) { success } }\"}";
+
+static constexpr char GET_CONFIGURATION_REQUEST[] =
+    "{\"query\":\"{ gatewayConfiguration { configuration(deviceAuth: { "
+    "id: \\\"$0\\\", timestamp: \\\"$1\\\", signedIdAndTimestamp: \\\"$2\\\", subKey: \\\"$3\\\" "
+    "}) { data } } }\"}";
+
+struct GQL::ResponseBuffer::Slot {
+    char* data;
+    size_t capacity;
+    SemaphoreHandle_t mutex;
+};
+
+static char s_responseData[GQL::RESPONSE_BUFFER_SIZE];
+static StaticSemaphore_t s_responseMutexBuffer;
+static GQL::ResponseBuffer::Slot s_responseSlot = {s_responseData, sizeof(s_responseData),
+                                                   xSemaphoreCreateMutexStatic(&s_responseMutexBuffer)};
+
+static char s_nameResponseData[GQL::NAME_RESPONSE_BUFFER_SIZE];
+static StaticSemaphore_t s_nameResponseMutexBuffer;
+static GQL::ResponseBuffer::Slot s_nameResponseSlot = {s_nameResponseData, sizeof(s_nameResponseData),
+                                                       xSemaphoreCreateMutexStatic(&s_nameResponseMutexBuffer)};
+
+GQL::ResponseBuffer::ResponseBuffer(Use use, const Deadline& deadline) : data(nullptr), capacity(0), length(0) {
+    Slot* slot = use == Use::NAME ? &s_nameResponseSlot : &s_responseSlot;
+    if (xSemaphoreTake(slot->mutex, pdMS_TO_TICKS(deadline.remainingMs())) != pdTRUE) {
+        _slot = nullptr;
+        return;
+    }
+    _slot = slot;
+    data = slot->data;
+    capacity = slot->capacity;
+    data[0] = '\0';
 }
 
-GQL::StringResponse GQL::makeGraphQLRequest(const zap::Str& query, const char* endpoint) {
-    // Print memory info
-    
-    HTTPClient http;
-    http.setTimeout(10000);
-    
-    if (!http.begin(endpoint)) {
-        return StringResponse::networkError(zap::Str("Unable to begin HTTP connection"));
+GQL::ResponseBuffer::~ResponseBuffer() {
+    if (_slot != nullptr) {
+        xSemaphoreGive(_slot->mutex);
     }
-    
-    http.addHeader("Content-Type", "application/json");
-    
-    // Construct JSON manually to avoid ArduinoJson memory overhead
-    zap::Str preparedQuery = prepareGraphQLQuery(query);
-    zap::Str requestBody = "{\"query\":\"" + preparedQuery + "\"}";
-    
+}
+
+static constexpr bool isSlot(const char* s) {
+    return s[0] == '$' && s[1] >= '0' && s[1] <= '9';
+}
+
+static constexpr size_t countSlots(const char* s) {
+    return *s == '\0' ? 0 : (isSlot(s) ? 1 : 0) + countSlots(s + 1);
+}
+
+static_assert(countSlots(FETCH_GATEWAY_NAME_REQUEST) == 1, "fetchGatewayName takes one parameter");
+static_assert(countSlots(SET_CONFIGURATION_REQUEST) == 1, "setConfiguration takes one parameter");
+static_assert(countSlots(GET_CONFIGURATION_REQUEST) == 4, "getConfiguration takes four parameters");
+
+zap::Str GQL::fillTemplate(const char* requestTemplate, const char* const* params, size_t count) {
+    // Size the result up front so it is allocated once
+    size_t length = 0;
+    for (const char* p = requestTemplate; *p != '\0'; p++) {
+        if (isSlot(p) && (size_t)(p[1] - '0') < count) {
+            length += strlen(params[p[1] - '0']);
+            p++;
+        } else {
+            length++;
+        }
+    }
+
+    zap::Str result;
+    result.reserve(length + 1);
+
+    const char* literal = requestTemplate;
+    const char* p = requestTemplate;
+    for (; *p != '\0'; p++) {
+        if (isSlot(p) && (size_t)(p[1] - '0') < count) {
+            result.append(literal, p - literal);
+            result += params[p[1] - '0'];
+            literal = p + 2;
+            p++;
+        }
+    }
+    result.append(literal, p - literal);
+    return result;
+}
+
+GQL::BoolResponse GQL::makeGraphQLRequest(const zap::Str& requestBody, const char* endpoint, ResponseBuffer& response,
+                                          const Deadline& deadline) {
+    if (!response.isHeld()) {
+        LOG_E(TAG, "Response buffer still in use at the deadline");
+        return BoolResponse::networkError(zap::Str("Response buffer busy"));
+    }
+
     LOG_D(TAG, "Sending GraphQL request: %s", requestBody.c_str());
     
-    int httpResponseCode = http.POST(requestBody.c_str());
+    // Read straight into the buffer, chunked responses are decoded on the way in
+    int httpResponseCode = HttpConnectionManager::post(endpoint, "application/json", requestBody.c_str(),
+                                                       response.data, response.capacity, response.length, deadline);
     
     if (httpResponseCode != 200) {
         LOG_E(TAG, "HTTP Error: %d", httpResponseCode);
-        http.end();
-        return StringResponse::networkError("HTTP error: " + zap::Str(httpResponseCode));
+        return BoolResponse::networkError("HTTP error: " + zap::Str(httpResponseCode));
     }
-    
-    // Stream the response instead of loading it all at once
-    WiFiClient* stream = http.getStreamPtr();
-    zap::Str responseData;
-    responseData.reserve(512); // Pre-allocate space
-    
-    while (stream->available()) {
-        responseData += (char)stream->read();
-    }
-    
-    // this is the raw bytes so it is likely a size, newline the data, a 0 and then two newlines messing things up
-    // but we are expecting a json object so we can pick the data between the first and last }
-
-    //2e
-    //{"data":{"setConfiguration":{"success":true}}}
-    //0
-    //
-    //
 
-    const int start = responseData.indexOf('{');
-    const int end = responseData.lastIndexOf('}');
-    if (start < 0 || end < 0 || start >= end) {
-        http.end();
-        return StringResponse::invalidResponse(zap::Str("Invalid response format"));
-    }
-    responseData = responseData.substring(start, end + 1);
-
-    LOG_D(TAG, "Response received: %s", responseData.c_str());
-    http.end();
+    LOG_D(TAG, "Response received: %s", response.data);
     
     // Check for GraphQL errors
-    if (responseData.indexOf("\"errors\":") >= 0) {
-        return StringResponse::gqlError("GraphQL returned errors: " + responseData);
+    if (strstr(response.data, "\"errors\":") != nullptr) {
+        return BoolResponse::gqlError("GraphQL returned errors: " + zap::Str(response.data));
     }
     
-    return StringResponse::ok(responseData);
+    return BoolResponse::ok(true);
 }
 
-
-
-
-
 GQL::StringResponse GQL::fetchGatewayName(const zap::Str& serialNumber) {
-    zap::Str query = R"({
-        gatewayConfiguration {
-          gatewayName(id:")" + serialNumber + R"(") {
-            name
-          }
-        }
-    })";
+    const char* params[] = {serialNumber.c_str()};
     
-    StringResponse response = makeGraphQLRequest(query, API_URL);
+    const Deadline deadline = Deadline::in(HttpConnectionManager::DEFAULT_TIMEOUT_MS);
+    ResponseBuffer buffer(ResponseBuffer::Use::NAME, deadline);
+    BoolResponse response = makeGraphQLRequest(fillTemplate(FETCH_GATEWAY_NAME_REQUEST, params, 1), API_URL, buffer,
+                                               deadline);
     
     if (!response.isSuccess()) {
-        return response; // Return the error as is
+        return StringResponse{response.status, zap::Str(), response.error}; // Return the error as is
     }
 
     // Parse JSON response to check success status
     zap::Str name;
 
-    JsonParser parser(response.data.c_str());
+    JsonParser parser(buffer.data);
     if (!parser.getStringByPath("data.gatewayConfiguration.gatewayName.name", name)) {
         return StringResponse::invalidResponse(zap::Str("Invalid response structure"));
     }
@@ -109,26 +150,27 @@ GQL::StringResponse GQL::fetchGatewayName(const zap::Str& serialNumber) {
     return StringResponse::ok(name);
 }
 
-GQL::BoolResponse GQL::setConfiguration(const zap::Str& jwt) {
-    zap::Str query = R"(mutation SetGatewayConfigurationWithDeviceJWT {
-        setConfiguration(deviceConfigurationInputType: {
-            jwt: ")" + jwt + R"("
-        }) {
-            success
-        }
-    })";
-    
-    StringResponse response = makeGraphQLRequest(query, API_URL);
+zap::Str GQL::setConfigurationRequest(const zap::Str& jwt) {
+    const char* params[] = {jwt.c_str()};
+    return fillTemplate(SET_CONFIGURATION_REQUEST, params, 1);
+}
+
+GQL::BoolResponse GQL::setConfiguration(const zap::Str& jwt, const Deadline& deadline) {
+    ResponseBuffer buffer(ResponseBuffer::Use::CONFIGURATION, deadline);
+    BoolResponse response = makeGraphQLRequest(setConfigurationRequest(jwt), API_URL, buffer, deadline);
     
     if (!response.isSuccess()) {
-        // Convert StringResponse error to BoolResponse with same status
-        return BoolResponse{response.status, false, response.error};
+        return response;
     }
     
+    return parseSetConfigurationResult(buffer.data);
+}
+
+GQL::BoolResponse GQL::parseSetConfigurationResult(const char* json) {
     // Parse JSON response to check success status
     bool successValue;
 
-    JsonParser parser(response.data.c_str());
+    JsonParser parser(json);
     if (!parser.getBoolByPath("data.setConfiguration.success", successValue)) {
         return BoolResponse::invalidResponse(zap::Str("No success field in response"));
     }
@@ -140,49 +182,37 @@ GQL::BoolResponse GQL::setConfiguration(const zap::Str& jwt) {
     return BoolResponse::ok(true);
 }
 
-GQL::StringResponse GQL::getConfiguration(const zap::Str& subKey) {
+GQL::StringResponse GQL::getConfiguration(const zap::Str& subKey, const Deadline& deadline) {
     // Create authentication components (device ID, timestamp, signature)
-    zap::Str serialNumber = crypto_getId();
+    const zap::Str& serialNumber = crypto_getId();
     
     // Generate timestamp in UTC format (Y-m-dTH:M:S)
     time_t now;
     time(&now);
     char timestamp[24];
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", gmtime(&now));
-    zap::Str timestampStr = zap::Str(timestamp);
     
     // Create the message to sign: deviceId|timestamp
-    zap::Str message = serialNumber + ":" + timestampStr;
+    zap::Str message = serialNumber + ":" + zap::Str(timestamp);
 
     LOG_D(TAG, "Message to sign: %s", message.c_str());
     
     // Sign the message
-    extern const char* PRIVATE_KEY_HEX;
-    zap::Str signature = crypto_create_signature_hex(message.c_str(), PRIVATE_KEY_HEX);
+    zap::Str signature = crypto_create_signature_hex(message.c_str());
     
     // Create GraphQL query
-    zap::Str query = R"({
-        gatewayConfiguration {
-            configuration(deviceAuth: {
-                id: ")" + serialNumber + R"(",
-                timestamp: ")" + timestampStr + R"(",
-                signedIdAndTimestamp: ")" + signature + R"(",
-                subKey: ")" + subKey + R"("
-            }) {
-                data
-            }
-        }
-    })";
+    const char* params[] = {serialNumber.c_str(), timestamp, signature.c_str(), subKey.c_str()};
     
-    StringResponse response = makeGraphQLRequest(query, API_URL);
+    ResponseBuffer buffer(ResponseBuffer::Use::CONFIGURATION, deadline);
+    BoolResponse response = makeGraphQLRequest(fillTemplate(GET_CONFIGURATION_REQUEST, params, 4), API_URL, buffer, deadline);
     
     if (!response.isSuccess()) {
-        return response; // Return the error as is
+        return StringResponse{response.status, zap::Str(), response.error}; // Return the error as is
     }
 
     // Parse JSON response to extract configuration data
     zap::Str configData;
-    JsonParser parser(response.data.c_str());
+    JsonParser parser(buffer.data);
 
     if (parser.isFieldNullByPath("data.gatewayConfiguration.configuration.data")) {
         // Handle null data case - return empty string
@@ -1,5 +1,6 @@
 #pragma once
 #include "zap_str.h"
+#include "http_connection_manager.h"
 
 
 class GQL {
@@ -57,11 +58,76 @@ public:
     using StringResponse = Response<zap::Str>;
     
     // Updated method signatures
-    static BoolResponse setConfiguration(const zap::Str& jwt);
+    // The deadline bounds the whole request, from waiting for the connection to reading the response
+    static BoolResponse setConfiguration(const zap::Str& jwt,
+                                         const Deadline& deadline = Deadline::in(HttpConnectionManager::DEFAULT_TIMEOUT_MS));
     static StringResponse fetchGatewayName(const zap::Str& serialNumber);
-    static StringResponse getConfiguration(const zap::Str& subKey);
-    
-private:
-    static StringResponse makeGraphQLRequest(const zap::Str& query, const char* endpoint);
-    static zap::Str prepareGraphQLQuery(const zap::Str& rawQuery);
+    static StringResponse getConfiguration(const zap::Str& subKey,
+                                           const Deadline& deadline = Deadline::in(HttpConnectionManager::DEFAULT_TIMEOUT_MS));
+
+    // The setConfiguration request body and its result, shared with the WebSocket transport
+    static zap::Str setConfigurationRequest(const zap::Str& jwt);
+    static BoolResponse parseSetConfigurationResult(const char* json);
+
+    /**
+     * @brief Fill the $0..$9 slots of a request template
+     *
+     * Parameters are inserted as they are, they must not need JSON escaping.
+     *
+     * @param requestTemplate Request body with the query already escaped
+     * @param params One parameter per slot, indexed by slot number
+     * @param count Number of parameters
+     */
+    static zap::Str fillTemplate(const char* requestTemplate, const char* const* params, size_t count);
+
+    // The largest response is getConfiguration with a configuration document. The same documents arrive
+    // over the subscription, whose receive buffer of GraphQLSubscriptionClient::RECEIVE_BUFFER_SIZE (4 KB)
+    // already drops larger ones, so a larger buffer here would not let larger configurations through.
+    // The other responses are around 100 bytes.
+    static const size_t RESPONSE_BUFFER_SIZE = 4096;
+
+    // The gateway name is fetched by the web server task, which must not wait for a configuration
+    // request of the backend task. It has a buffer of its own, the name response is around 100 bytes.
+    static const size_t NAME_RESPONSE_BUFFER_SIZE = 512;
+
+    /**
+     * @brief Response body read into a fixed buffer and parsed where it is
+     *
+     * There are two buffers, allocated once: one for the configuration requests and one for the
+     * gateway name. A buffer is held from construction to destruction, requests from other tasks
+     * wait for it until their deadline. If it is still taken then, data is nullptr.
+     */
+    class ResponseBuffer {
+    public:
+        enum class Use {
+            CONFIGURATION,
+            NAME
+        };
+
+        // A buffer with its mutex, defined in graphql.cpp
+        struct Slot;
+
+        ResponseBuffer(Use use, const Deadline& deadline);
+        ~ResponseBuffer();
+        ResponseBuffer(const ResponseBuffer&) = delete;
+        ResponseBuffer& operator=(const ResponseBuffer&) = delete;
+
+        bool isHeld() const { return data != nullptr; }
+
+        char* data;
+        size_t capacity;
+        size_t length;
+
+    private:
+        Slot* _slot;
+    };
+
+    /**
+     * @brief Send a request body and check the response for errors
+     *
+     * @param response Receives the response body, fails with NETWORK_ERROR if it is not held
+     * @param deadline When to give up on the request
+     */
+    static BoolResponse makeGraphQLRequest(const zap::Str& requestBody, const char* endpoint, ResponseBuffer& response,
+                                           const Deadline& deadline);
 };
@@ -0,0 +1,160 @@
+#include "heatshrink.h"
+
+// Writes bits MSB first, the last byte is padded with zeros
+struct BitWriter {
+    uint8_t* output;
+    size_t capacity;
+    size_t length;
+    uint8_t bits;       // Bits used in output[length]
+    bool overflow;
+
+    void write(uint16_t value, uint8_t count) {
+        while (count > 0) {
+            if (bits == 0) {
+                if (length >= capacity) {
+                    overflow = true;
+                    return;
+                }
+                output[length] = 0;
+            }
+            const uint8_t space = 8 - bits;
+            const uint8_t take = count < space ? count : space;
+            const uint8_t chunk = (value >> (count - take)) & ((1 << take) - 1);
+            output[length] |= chunk << (space - take);
+            bits += take;
+            count -= take;
+            if (bits == 8) {
+                bits = 0;
+                length++;
+            }
+        }
+    }
+
+    size_t finish() const {
+        return bits > 0 ? length + 1 : length;
+    }
+};
+
+struct BitReader {
+    const uint8_t* input;
+    size_t length;
+    size_t position;    // In bits
+
+    bool has(uint8_t count) const {
+        return position + count <= length * 8;
+    }
+
+    uint16_t read(uint8_t count) {
+        uint16_t value = 0;
+        while (count > 0) {
+            const uint8_t bit = (input[position / 8] >> (7 - position % 8)) & 1;
+            value = (value << 1) | bit;
+            position++;
+            count--;
+        }
+        return value;
+    }
+};
+
+bool Heatshrink::isValid(const Params& params) {
+    return params.windowBits >= MIN_WINDOW_BITS && params.windowBits <= MAX_WINDOW_BITS &&
+           params.lookaheadBits >= MIN_LOOKAHEAD_BITS && params.lookaheadBits < params.windowBits;
+}
+
+bool Heatshrink::compress(const Params& params, const uint8_t* input, size_t inputLength,
+                          uint8_t* output, size_t capacity, size_t& length) {
+    length = 0;
+    if (!isValid(params)) {
+        return false;
+    }
+
+    const size_t window = (size_t)1 << params.windowBits;
+    const size_t maxMatch = (size_t)1 << params.lookaheadBits;
+    const size_t backrefBits = 1 + params.windowBits + params.lookaheadBits;
+
+    BitWriter writer = {output, capacity, 0, 0, false};
+    size_t position = 0;
+    while (position < inputLength && !writer.overflow) {
+        const size_t limit = inputLength - position < maxMatch ? inputLength - position : maxMatch;
+        const size_t start = position > window ? position - window : 0;
+
+        // Longest match, the nearest one when lengths tie
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        for (size_t candidate = position; candidate-- > start;) {
+            if (input[candidate] != input[position]) {
+                continue;
+            }
+            size_t matchLength = 1;
+            while (matchLength < limit && input[candidate + matchLength] == input[position + matchLength]) {
+                matchLength++;
+            }
+            if (matchLength > bestLength) {
+                bestLength = matchLength;
+                bestDistance = position - candidate;
+                if (matchLength == limit) {
+                    break;
+                }
+            }
+        }
+
+        // A back reference only pays off when it is shorter than the literals
+        if (bestLength * 9 > backrefBits) {
+            writer.write(0, 1);
+            writer.write((uint16_t)(bestDistance - 1), params.windowBits);
+            writer.write((uint16_t)(bestLength - 1), params.lookaheadBits);
+            position += bestLength;
+        } else {
+            writer.write(1, 1);
+            writer.write(input[position], 8);
+            position++;
+        }
+    }
+
+    if (writer.overflow) {
+        return false;
+    }
+    length = writer.finish();
+    return true;
+}
+
+bool Heatshrink::decompress(const Params& params, const uint8_t* input, size_t inputLength,
+                            uint8_t* output, size_t capacity, size_t& length) {
+    length = 0;
+    if (!isValid(params)) {
+        return false;
+    }
+
+    BitReader reader = {input, inputLength, 0};
+    size_t written = 0;
+    while (reader.has(1)) {
+        if (reader.read(1) == 1) {
+            if (!reader.has(8)) {
+                break;
+            }
+            if (written >= capacity) {
+                return false;
+            }
+            output[written++] = (uint8_t)reader.read(8);
+            continue;
+        }
+
+        // Zero padding at the end is too short to be a back reference
+        if (!reader.has(params.windowBits + params.lookaheadBits)) {
+            break;
+        }
+        const size_t distance = (size_t)reader.read(params.windowBits) + 1;
+        const size_t count = (size_t)reader.read(params.lookaheadBits) + 1;
+        if (distance > written || count > capacity - written) {
+            return false;
+        }
+        // Byte by byte, a reference may overlap what it writes
+        for (size_t i = 0; i < count; i++) {
+            output[written] = output[written - distance];
+            written++;
+        }
+    }
+
+    length = written;
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief LZSS compression in the heatshrink format
+ *
+ * The output can be decompressed by the heatshrink library with the same
+ * window and lookahead sizes. A literal is a 1 bit followed by the byte, a
+ * back reference a 0 bit followed by the distance - 1 in windowBits bits and
+ * the length - 1 in lookaheadBits bits, all MSB first.
+ *
+ * The input is searched in place, the encoder uses no memory besides the
+ * output. A larger window finds more matches but costs search time, a longer
+ * lookahead allows longer matches but makes every match cost more bits.
+ */
+class Heatshrink {
+public:
+    static const uint8_t MIN_WINDOW_BITS = 4;
+    static const uint8_t MAX_WINDOW_BITS = 15;
+    static const uint8_t MIN_LOOKAHEAD_BITS = 3;
+
+    struct Params {
+        uint8_t windowBits;     // Back references reach 2^windowBits bytes back
+        uint8_t lookaheadBits;  // Back references are up to 2^lookaheadBits bytes long, less than windowBits
+    };
+
+    static bool isValid(const Params& params);
+
+    /**
+     * @brief Compress a buffer
+     *
+     * @param length Receives the compressed length
+     * @return false if the output does not fit or the params are invalid
+     */
+    static bool compress(const Params& params, const uint8_t* input, size_t inputLength,
+                         uint8_t* output, size_t capacity, size_t& length);
+
+    /**
+     * @brief Decompress a buffer
+     *
+     * @param length Receives the decompressed length
+     * @return false if the output does not fit, the params are invalid or a
+     *         back reference points before the start
+     */
+    static bool decompress(const Params& params, const uint8_t* input, size_t inputLength,
+                           uint8_t* output, size_t capacity, size_t& length);
+};
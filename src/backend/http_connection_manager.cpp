@@ -0,0 +1,419 @@
+#include "http_connection_manager.h"
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "../zap_log.h"
+#include "../metrics.h"
+#include "chunked_decoder.h"
+
+static const char* TAG = "http_connections";
+
+// The last one counts requests that got no status back: refused, timed out or cut off
+static const char* const RESPONSE_CLASSES[] = {"1xx", "2xx", "3xx", "4xx", "5xx", "failed"};
+static const size_t FAILED = sizeof(RESPONSE_CLASSES) / sizeof(RESPONSE_CLASSES[0]) - 1;
+static LabeledCounter responses("zap_backend_responses_total", "Backend HTTP responses", "code",
+                                RESPONSE_CLASSES, sizeof(RESPONSE_CLASSES) / sizeof(RESPONSE_CLASSES[0]));
+
+static const uint16_t HTTP_TIMEOUT_MAX_MS = 60000;     // HTTPClient takes 16 bit timeouts
+static const size_t READ_BLOCK_SIZE = 1024;
+static const char* COLLECTED_HEADERS[] = {"Transfer-Encoding", "Accept-Encoding"};
+
+// Where a response body goes, a string, a fixed buffer or a reader
+struct ResponseTarget {
+    zap::Str* str;
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    HttpConnectionManager::BodyReader* reader;
+};
+
+struct Connection {
+    char host[64];          // Empty when the slot is unused
+    uint16_t port;
+    unsigned long lastUsed;
+    uint8_t users;          // Requests holding or waiting for the lock, the slot is not taken over meanwhile
+    bool reset;             // Taken over for another host, the old connection is closed under the lock
+    char acceptEncoding[32];    // Codings the host takes in requests, from its last response (RFC 7694)
+    SemaphoreHandle_t lock;     // Held for a whole request, the fields above are under the mutex
+    WiFiClientSecure client;
+    HTTPClient http;
+};
+
+static Connection connections[HttpConnectionManager::MAX_HOSTS];
+// Guards the slot table and the stats, only held briefly
+static SemaphoreHandle_t mutex = nullptr;
+static HttpConnectionManager::Stats stats = {};
+// Blocks on their way to a BodyReader, only used under the reader mutex
+static uint8_t readerBlock[READ_BLOCK_SIZE + 1];
+static SemaphoreHandle_t readerMutex = nullptr;
+
+// Time left for one step of a request, capped for HTTPClient
+static uint16_t stepTimeout(const Deadline& deadline) {
+    const uint32_t remaining = deadline.remainingMs();
+    return remaining < HTTP_TIMEOUT_MAX_MS ? (uint16_t)remaining : HTTP_TIMEOUT_MAX_MS;
+}
+
+// Split "https://host[:port]/path" into host and port
+static bool parseHost(const char* url, char* host, size_t hostSize, uint16_t& port) {
+    const char* start = strstr(url, "://");
+    if (start == nullptr || strncmp(url, "https", 5) != 0) {
+        return false;
+    }
+    start += 3;
+
+    size_t length = strcspn(start, ":/");
+    if (length == 0 || length >= hostSize) {
+        return false;
+    }
+    memcpy(host, start, length);
+    host[length] = '\0';
+
+    port = 443;
+    if (start[length] == ':') {
+        port = (uint16_t)atoi(start + length + 1);
+    }
+    return true;
+}
+
+// Close connections nobody used for a while, each holds on to its TLS session. Called under the mutex.
+static void closeIdleConnections(unsigned long now) {
+    for (Connection& connection : connections) {
+        if (connection.host[0] != '\0' && connection.users == 0 && now - connection.lastUsed > HttpConnectionManager::IDLE_CLOSE_MS) {
+            LOG_D(TAG, "Closing idle connection to %s", connection.host);
+            connection.client.stop();
+            connection.host[0] = '\0';
+        }
+    }
+}
+
+// Find the connection for a host, taking over an unused or the least recently used idle one if needed.
+// Called under the mutex, nullptr when every connection is busy with another host.
+static Connection* connectionFor(const char* host, uint16_t port) {
+    Connection* oldest = nullptr;
+    for (Connection& connection : connections) {
+        if (connection.host[0] != '\0' && connection.port == port && strcmp(connection.host, host) == 0) {
+            return &connection;
+        }
+        if (connection.users > 0) {
+            continue;
+        }
+        if (oldest == nullptr || (oldest->host[0] != '\0' && (connection.host[0] == '\0' || connection.lastUsed < oldest->lastUsed))) {
+            oldest = &connection;
+        }
+    }
+
+    if (oldest != nullptr) {
+        strcpy(oldest->host, host);
+        oldest->port = port;
+        oldest->acceptEncoding[0] = '\0';
+        oldest->reset = true;
+    }
+    return oldest;
+}
+
+// Errors from HTTPClient before the server can have seen a whole request
+static bool nothingSent(int code) {
+    return code == HTTPC_ERROR_CONNECTION_REFUSED || code == HTTPC_ERROR_NOT_CONNECTED || code == HTTPC_ERROR_SEND_HEADER_FAILED;
+}
+
+// Read the body into the buffer in blocks, decoding chunked transfer encoding in place.
+// A reader gets each block as soon as it is decoded instead.
+static int readBodyInto(HTTPClient& http, ResponseTarget& target, uint8_t* buffer, size_t capacity, const Deadline& deadline) {
+    const bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    int remaining = http.getSize();     // -1 when chunked or not known
+    WiFiClient* stream = http.getStreamPtr();
+    ChunkedDecoder decoder;
+
+    target.length = 0;
+    while (chunked ? !decoder.isDone() : remaining != 0) {
+        size_t space = capacity - 1 - target.length;
+        if (space == 0) {
+            LOG_W(TAG, "Response larger than %u bytes", (unsigned int)target.capacity);
+            return HTTPC_ERROR_TOO_LESS_RAM;
+        }
+        if (space > READ_BLOCK_SIZE) {
+            space = READ_BLOCK_SIZE;
+        }
+        if (!chunked && remaining > 0 && space > (size_t)remaining) {
+            space = remaining;
+        }
+
+        const int available = stream->available();
+        if (available <= 0) {
+            if (!stream->connected()) {
+                // Without a length or chunks the body ends when the server closes
+                if (!chunked && remaining < 0) {
+                    break;
+                }
+                return HTTPC_ERROR_CONNECTION_LOST;
+            }
+            if (deadline.hasPassed()) {
+                return HTTPC_ERROR_READ_TIMEOUT;
+            }
+            delay(1);
+            continue;
+        }
+        if ((size_t)available < space) {
+            space = available;
+        }
+
+        const int count = stream->read(buffer + target.length, space);
+        if (count <= 0) {
+            continue;
+        }
+
+        if (chunked) {
+            target.length += decoder.decode(buffer + target.length, count);
+            if (decoder.hasError()) {
+                return HTTPC_ERROR_ENCODING;
+            }
+        } else {
+            target.length += count;
+            if (remaining > 0) {
+                remaining -= count;
+            }
+        }
+
+        if (target.reader != nullptr && target.length > 0) {
+            if (!target.reader->read((const char*)buffer, target.length)) {
+                return HTTPC_ERROR_STREAM_WRITE;
+            }
+            target.length = 0;
+        }
+    }
+
+    buffer[target.length] = '\0';
+    return 0;
+}
+
+static int readBody(HTTPClient& http, ResponseTarget& target, const Deadline& deadline) {
+    if (target.reader == nullptr) {
+        return readBodyInto(http, target, (uint8_t*)target.buffer, target.capacity, deadline);
+    }
+    xSemaphoreTake(readerMutex, portMAX_DELAY);
+    const int result = readBodyInto(http, target, readerBlock, sizeof(readerBlock), deadline);
+    xSemaphoreGive(readerMutex);
+    return result;
+}
+
+static int sendRequest(const char* url, const char* contentType, const char* body, ResponseTarget& response, const Deadline& deadline) {
+    char host[sizeof(Connection::host)];
+    uint16_t port;
+    if (!parseHost(url, host, sizeof(host), port)) {
+        LOG_E(TAG, "Unsupported url: %s", url);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    if (mutex == nullptr) {
+        LOG_E(TAG, "Not initialized");
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    // The slot is claimed under the mutex, the request itself only holds the lock of its connection
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    closeIdleConnections(millis());
+    Connection* slot = connectionFor(host, port);
+    if (slot != nullptr) {
+        slot->users++;
+    }
+    xSemaphoreGive(mutex);
+    if (slot == nullptr) {
+        LOG_W(TAG, "No free connection for %s", host);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    Connection& connection = *slot;
+    HttpConnectionManager::Stats counted = {};
+    char acceptEncoding[sizeof(Connection::acceptEncoding)];
+    bool responded = false;
+    int code = HTTPC_ERROR_READ_TIMEOUT;
+
+    // A request to the same host may hold the connection, it is only waited for until the deadline
+    const bool locked = xSemaphoreTake(connection.lock, pdMS_TO_TICKS(deadline.remainingMs())) == pdTRUE;
+    if (!locked) {
+        LOG_W(TAG, "Connection to %s busy until the deadline", host);
+    } else if (connection.reset) {
+        connection.client.stop();
+        connection.client.setInsecure();
+        connection.reset = false;
+    }
+
+    for (int attempt = 0; locked && attempt < 2; attempt++) {
+        const uint16_t timeoutMs = stepTimeout(deadline);
+        if (timeoutMs == 0) {
+            LOG_W(TAG, "Deadline passed before the request to %s", host);
+            code = HTTPC_ERROR_READ_TIMEOUT;
+            break;
+        }
+
+        const bool reused = connection.client.connected();
+        if (reused) {
+            counted.reused++;
+        } else {
+            connection.client.stop();
+            const unsigned long start = millis();
+            if (!connection.client.connect(host, port, timeoutMs)) {
+                LOG_W(TAG, "Failed to connect to %s:%d", host, port);
+                code = HTTPC_ERROR_CONNECTION_REFUSED;
+                break;
+            }
+            counted.handshakes++;
+            counted.handshakeMs += millis() - start;
+        }
+
+        // HTTPClient sees the open connection and sends over it
+        connection.http.setReuse(true);
+        connection.http.setTimeout(timeoutMs);
+        connection.http.begin(connection.client, url);
+        if (contentType != nullptr) {
+            connection.http.addHeader("Content-Type", contentType);
+        }
+        connection.http.collectHeaders(COLLECTED_HEADERS, 2);
+
+        counted.requests++;
+        code = body != nullptr ? connection.http.POST((uint8_t*)body, strlen(body)) : connection.http.GET();
+        if (code > 0) {
+            responded = true;
+            strncpy(acceptEncoding, connection.http.header("Accept-Encoding").c_str(), sizeof(acceptEncoding) - 1);
+            acceptEncoding[sizeof(acceptEncoding) - 1] = '\0';
+
+            if (response.buffer != nullptr || response.reader != nullptr) {
+                const int error = readBody(connection.http, response, deadline);
+                if (error < 0) {
+                    // The rest of the body is still on the connection
+                    code = error;
+                    connection.http.end();
+                    connection.client.stop();
+                    break;
+                }
+            } else {
+                *response.str = connection.http.getString().c_str();
+            }
+            connection.http.end();  // Keeps the connection open unless the server asked to close it
+            break;
+        }
+
+        connection.http.end();
+        connection.client.stop();
+        // A POST that went out may have been acted on even though the response was lost,
+        // the caller decides whether to send it again
+        if (!reused || (body != nullptr && !nothingSent(code))) {
+            break;
+        }
+        // The server closed the idle connection, try once more on a new one
+        LOG_D(TAG, "Kept-alive connection to %s lost, reconnecting", host);
+    }
+    if (locked) {
+        xSemaphoreGive(connection.lock);
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    connection.users--;
+    connection.lastUsed = millis();
+    if (responded) {
+        strcpy(connection.acceptEncoding, acceptEncoding);
+    }
+    stats.requests += counted.requests;
+    stats.reused += counted.reused;
+    stats.handshakes += counted.handshakes;
+    stats.handshakeMs += counted.handshakeMs;
+    xSemaphoreGive(mutex);
+    return code;
+}
+
+static int request(const char* url, const char* contentType, const char* body, ResponseTarget& response, const Deadline& deadline) {
+    const int code = sendRequest(url, contentType, body, response, deadline);
+    responses.increment(code >= 100 && code < 600 ? code / 100 - 1 : FAILED);
+    return code;
+}
+
+// Find a token in a comma separated header value, parameters such as ;q= are ignored
+static bool listContains(const char* list, const char* token) {
+    const size_t tokenLength = strlen(token);
+    while (*list != '\0') {
+        list += strspn(list, " ,");
+        const size_t length = strcspn(list, " ,;");
+        if (length == tokenLength && strncasecmp(list, token, length) == 0) {
+            return true;
+        }
+        list += strcspn(list, ",");
+    }
+    return false;
+}
+
+bool HttpConnectionManager::acceptsEncoding(const char* url, const char* coding) {
+    char host[sizeof(Connection::host)];
+    uint16_t port;
+    if (mutex == nullptr || !parseHost(url, host, sizeof(host), port)) {
+        return false;
+    }
+
+    bool accepted = false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (const Connection& connection : connections) {
+        if (connection.port == port && strcmp(connection.host, host) == 0) {
+            accepted = listContains(connection.acceptEncoding, coding);
+            break;
+        }
+    }
+    xSemaphoreGive(mutex);
+    return accepted;
+}
+
+void HttpConnectionManager::begin() {
+    if (mutex != nullptr) {
+        return;
+    }
+    for (Connection& connection : connections) {
+        connection.lock = xSemaphoreCreateMutex();
+    }
+    readerMutex = xSemaphoreCreateMutex();
+    mutex = xSemaphoreCreateMutex();
+}
+
+void HttpConnectionManager::closeIdle() {
+    if (mutex == nullptr) {
+        return;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    closeIdleConnections(millis());
+    xSemaphoreGive(mutex);
+}
+
+int HttpConnectionManager::post(const char* url, const char* contentType, const char* body, zap::Str& response,
+                                const Deadline& deadline) {
+    ResponseTarget target = {&response, nullptr, 0, 0, nullptr};
+    return request(url, contentType, body, target, deadline);
+}
+
+int HttpConnectionManager::post(const char* url, const char* contentType, const char* body, char* buffer, size_t capacity, size_t& length,
+                                const Deadline& deadline) {
+    ResponseTarget target = {nullptr, buffer, capacity, 0, nullptr};
+    const int code = request(url, contentType, body, target, deadline);
+    length = target.length;
+    return code;
+}
+
+int HttpConnectionManager::get(const char* url, zap::Str& response, const Deadline& deadline) {
+    ResponseTarget target = {&response, nullptr, 0, 0, nullptr};
+    return request(url, nullptr, nullptr, target, deadline);
+}
+
+int HttpConnectionManager::get(const char* url, BodyReader& reader, const Deadline& deadline) {
+    ResponseTarget target = {nullptr, nullptr, 0, 0, &reader};
+    return request(url, nullptr, nullptr, target, deadline);
+}
+
+HttpConnectionManager::Stats HttpConnectionManager::getStats() {
+    if (mutex == nullptr) {
+        return stats;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const Stats copy = stats;
+    xSemaphoreGive(mutex);
+    return copy;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+#include "../zap_str.h"
+#include "deadline.h"
+
+/**
+ * @brief Shared HTTPS connections to the backend hosts
+ *
+ * Keeps one TLS connection per host open with HTTP/1.1 keep-alive so that
+ * repeated requests to the same host skip the TLS handshake. A connection the
+ * server closed while idle is reopened and a GET retried once, a POST only if
+ * none of it went out. Connections unused for IDLE_CLOSE_MS are closed to free
+ * their TLS memory, so hosts that are only seen now and then hold none.
+ * Requests to the same host are serialised, requests to different hosts run
+ * side by side.
+ *
+ * Every request has a deadline, waiting for the connection, connecting,
+ * sending, reading and a retry all get only the time left until then.
+ */
+class HttpConnectionManager {
+public:
+    static const int MAX_HOSTS = 3;
+    static const unsigned long IDLE_CLOSE_MS = 2 * 60 * 1000;
+    static const uint32_t DEFAULT_TIMEOUT_MS = 10000;   // For requests made without a deadline
+
+    struct Stats {
+        uint32_t requests;      // Requests sent, including retries
+        uint32_t reused;        // Requests sent over an already open connection
+        uint32_t handshakes;    // TLS connections opened
+        uint32_t handshakeMs;   // Total time spent opening TLS connections
+    };
+
+    /**
+     * @brief Takes a response body block by block as it is read
+     */
+    class BodyReader {
+    public:
+        virtual ~BodyReader() {}
+
+        // Returns false to give up on the rest of the body
+        virtual bool read(const char* data, size_t length) = 0;
+    };
+
+    /**
+     * @brief Set up the manager, call once before any task uses it
+     */
+    static void begin();
+
+    /**
+     * @brief POST a body and read the whole response
+     *
+     * @param response Receives the response body
+     * @return HTTP status code, or a negative HTTPClient error code
+     */
+    static int post(const char* url, const char* contentType, const char* body, zap::Str& response,
+                    const Deadline& deadline = Deadline::in(DEFAULT_TIMEOUT_MS));
+
+    /**
+     * @brief POST a body and read the response into a fixed buffer
+     *
+     * The response is read in large blocks straight into the buffer, a
+     * chunked response is decoded in place.
+     *
+     * @param buffer Receives the NUL terminated response body
+     * @param capacity Size of the buffer including the terminator
+     * @param length Receives the length of the response body
+     * @return HTTP status code, or a negative HTTPClient error code, also when the body does not fit
+     */
+    static int post(const char* url, const char* contentType, const char* body, char* buffer, size_t capacity, size_t& length,
+                    const Deadline& deadline = Deadline::in(DEFAULT_TIMEOUT_MS));
+
+    /**
+     * @brief GET a url and read the whole response
+     *
+     * @param response Receives the response body
+     * @return HTTP status code, or a negative HTTPClient error code
+     */
+    static int get(const char* url, zap::Str& response,
+                   const Deadline& deadline = Deadline::in(DEFAULT_TIMEOUT_MS));
+
+    /**
+     * @brief GET a url and hand the response body to a reader as it arrives
+     *
+     * Only one block of the body is in memory at a time, a chunked response
+     * is decoded on the way.
+     *
+     * @return HTTP status code, or a negative HTTPClient error code, also when the reader gave up
+     */
+    static int get(const char* url, BodyReader& reader,
+                   const Deadline& deadline = Deadline::in(DEFAULT_TIMEOUT_MS));
+
+    /**
+     * @brief Check whether a host takes a content coding in requests
+     *
+     * Hosts list the codings they take in the Accept-Encoding header of their
+     * responses (RFC 7694). Only known once a request to the host got a response.
+     *
+     * @param url Any url on the host
+     * @param coding Coding name, case insensitive
+     */
+    static bool acceptsEncoding(const char* url, const char* coding);
+
+    /**
+     * @brief Close the connections unused for IDLE_CLOSE_MS, call now and then
+     *
+     * Requests do it too, this is for when there are none.
+     */
+    static void closeIdle();
+
+    static Stats getStats();
+};
@@ -0,0 +1,69 @@
+#include "mutation_tracker.h"
+
+MutationTracker::MutationTracker() : _count(0), _nextId(FIRST_ID) {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        _entries[i].id = 0;
+        _entries[i].sentAt = 0;
+    }
+}
+
+uint32_t MutationTracker::add(const zap::Str& jwt, unsigned long now) {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        Entry& entry = _entries[i];
+        if (entry.id != 0) {
+            continue;
+        }
+
+        entry.id = _nextId;
+        entry.sentAt = now;
+        entry.jwt = jwt;
+        _count++;
+
+        _nextId++;
+        if (_nextId < FIRST_ID) {
+            _nextId = FIRST_ID;     // Wrapped around
+        }
+        return entry.id;
+    }
+    return 0;
+}
+
+bool MutationTracker::take(uint32_t id, zap::Str& jwt, unsigned long& sentAt) {
+    if (id == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (_entries[i].id == id) {
+            sentAt = _entries[i].sentAt;
+            release(_entries[i], jwt);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MutationTracker::takeExpired(unsigned long now, unsigned long timeoutMs, zap::Str& jwt) {
+    Entry* oldest = nullptr;
+    for (size_t i = 0; i < CAPACITY; i++) {
+        Entry& entry = _entries[i];
+        if (entry.id == 0 || now - entry.sentAt < timeoutMs) {
+            continue;
+        }
+        if (oldest == nullptr || now - entry.sentAt > now - oldest->sentAt) {
+            oldest = &entry;
+        }
+    }
+
+    if (oldest == nullptr) {
+        return false;
+    }
+    release(*oldest, jwt);
+    return true;
+}
+
+void MutationTracker::release(Entry& entry, zap::Str& jwt) {
+    jwt = entry.jwt;
+    entry.jwt.clear();  // The buffer is reused by the next mutation in this slot
+    entry.id = 0;
+    _count--;
+}
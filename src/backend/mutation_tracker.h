@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "../zap_str.h"
+
+/**
+ * @brief Mutations sent over the GraphQL WebSocket that are waiting for their result
+ *
+ * Each mutation gets an operation id that the server echoes in its result.
+ * The JWT is kept until the result arrives so that the mutation can be sent
+ * over HTTP instead if the result is an error, never arrives, or the socket
+ * goes down first.
+ */
+class MutationTracker {
+public:
+    static const size_t CAPACITY = 4;
+    static const uint32_t FIRST_ID = 2;     // Operation id 1 is the settings subscription
+
+    MutationTracker();
+
+    /**
+     * @brief Track a mutation that is about to be sent
+     *
+     * @param jwt JWT of the mutation, kept for the HTTP fallback
+     * @param now Current time in milliseconds
+     * @return Operation id to send the mutation with, 0 if all slots are taken
+     */
+    uint32_t add(const zap::Str& jwt, unsigned long now);
+
+    /**
+     * @brief Stop tracking a mutation because its result arrived
+     *
+     * @param id Operation id from the result
+     * @param jwt Receives the JWT of the mutation
+     * @param sentAt Receives the time passed to add()
+     * @return false if the id is not tracked, e.g. the result came after the timeout
+     */
+    bool take(uint32_t id, zap::Str& jwt, unsigned long& sentAt);
+
+    /**
+     * @brief Stop tracking the oldest mutation that has waited too long
+     *
+     * @param now Current time in milliseconds
+     * @param timeoutMs How long a result may take, 0 takes any mutation
+     * @param jwt Receives the JWT of the mutation
+     * @return false if no mutation has timed out
+     */
+    bool takeExpired(unsigned long now, unsigned long timeoutMs, zap::Str& jwt);
+
+    size_t size() const { return _count; }
+    bool isEmpty() const { return _count == 0; }
+
+private:
+    struct Entry {
+        uint32_t id;            // 0 when the slot is free
+        unsigned long sentAt;
+        zap::Str jwt;
+    };
+
+    void release(Entry& entry, zap::Str& jwt);
+
+    Entry _entries[CAPACITY];
+    size_t _count;
+    uint32_t _nextId;
+};
@@ -1,6 +1,8 @@
 #include "ota_checker.h"
 #include "../firmware_version.h" 
 #include "ota/ota_handler.h"    
+#include "http_connection_manager.h"
+#include <HTTPClient.h>
 #include "../json_light/json_light.h" // Ensure JsonParser is included
 #include "ota/ota_handler.h"
 
@@ -13,27 +15,31 @@ static constexpr LogTag TAG = LogTag("ota_checker", ZLOG_LEVEL_DEBUG);
 #define OTA_CHECK_BASE_URL "https://sleipner.srcful.dev/api/devices/sn/"
 #define OTA_CHECK_ENDPOINT "/firmwares/latest"
 
+static const RetryPolicy::Config RETRY_POLICY = {60 * 1000, 30 * 60 * 1000, 5, 60 * 60 * 1000};
+
 OtaChecker::OtaChecker()
     : lastOtaCheckTime(0),
-      otaCheckInterval(DEFAULT_OTA_CHECK_INTERVAL), initialCheckDone(false) {
+      otaCheckInterval(DEFAULT_OTA_CHECK_INTERVAL), initialCheckDone(false),
+      retryPolicy("ota", RETRY_POLICY) {
 }
 
 void OtaChecker::begin() {
     lastOtaCheckTime = 0;
     otaCheckInterval = 1 * 60 * 1000; // we wait for one minute before the first check so that all other tasks can do their thing
     initialCheckDone = false;
-    httpClient.setTimeout(15000); 
 }
 
-void OtaChecker::loop(const unsigned long currentTime) {
+void OtaChecker::loop(const unsigned long currentTime, const Deadline& deadline) {
 
-    if (isTimeForOtaCheck(currentTime)) {
+    // After a failure the retry policy decides, not the check interval
+    const bool due = retryPolicy.hasFailures() ? retryPolicy.shouldAttempt(currentTime) : isTimeForOtaCheck(currentTime);
+    if (due) {
         if (!initialCheckDone) {
             otaCheckInterval = DEFAULT_OTA_CHECK_INTERVAL;
             initialCheckDone = true;
         }
         lastOtaCheckTime = currentTime;
-        checkForUpdate();
+        checkForUpdate(deadline);
     }
 }
 
@@ -41,9 +47,9 @@ bool OtaChecker::isTimeForOtaCheck(unsigned long currentTime) const {
     return (currentTime - lastOtaCheckTime >= otaCheckInterval);
 }
 
-void OtaChecker::checkForUpdate() {
+void OtaChecker::checkForUpdate(const Deadline& deadline) {
 
-    zap::Str deviceId = crypto_getId();
+    const zap::Str& deviceId = crypto_getId();
     if (deviceId.isEmpty()) {
         LOG_TE(TAG, "Device ID is empty, cannot check for OTA update.");
         return;
@@ -52,54 +58,74 @@ void OtaChecker::checkForUpdate() {
     zap::Str url = zap::Str(OTA_CHECK_BASE_URL) + deviceId + zap::Str(OTA_CHECK_ENDPOINT);
     LOG_TI(TAG, "Checking for OTA update at: %s", url.c_str());
 
-    httpClient.begin(url.c_str()); 
-    int httpCode = httpClient.GET();
+    firmwareResponse.begin();
+    int httpCode = HttpConnectionManager::get(url.c_str(), firmwareResponse, deadline);
+
+    // Network and server errors are retried, anything else waits for the next check
+    if (httpCode > 0 && httpCode < 500) {
+        retryPolicy.onSuccess(millis());
+    } else {
+        retryPolicy.onFailure(millis());
+    }
 
     if (httpCode > 0) {
         LOG_TI(TAG, "HTTP GET successful, code: %d", httpCode);
         if (httpCode == HTTP_CODE_OK) {
-            zap::Str payload(httpClient.getString().c_str()); 
-            LOG_TD(TAG, "Response payload: %s", payload.c_str());
-            parseFirmwareResponse(payload);
+            parseFirmwareResponse();
         } else {
             LOG_TW(TAG, "HTTP GET failed with code: %d", httpCode);
         }
     } else {
-        LOG_TE(TAG, "HTTP GET failed, error: %s", httpClient.errorToString(httpCode).c_str());
+        LOG_TE(TAG, "HTTP GET failed, error: %s", HTTPClient::errorToString(httpCode).c_str());
     }
-    httpClient.end();
 }
 
-void OtaChecker::parseFirmwareResponse(const zap::Str& payload) { 
+OtaChecker::FirmwareResponse::FirmwareResponse()
+    : fields{JsonPathField("version", version, sizeof(version)),
+             JsonPathField("binary.downloadUrl", downloadUrl, sizeof(downloadUrl)),
+             JsonPathField("binary.hash", hash, sizeof(hash))},
+      _parser(_token, sizeof(_token), _path, sizeof(_path)) {
+    begin();
+}
+
+void OtaChecker::FirmwareResponse::begin() {
+    _parser.reset();
+    for (JsonPathField& field : fields) {
+        field.found = false;
+        field.value[0] = '\0';
+    }
+}
+
+bool OtaChecker::FirmwareResponse::read(const char* data, size_t length) {
+    // The whole body is read even when it is malformed so the connection can be kept
+    _parser.extract(data, length, fields, 3);
+    return true;
+}
+
+void OtaChecker::parseFirmwareResponse() { 
     LOG_TI(TAG, "Parsing firmware response...");
-    JsonParser parser(payload.c_str()); // Use JsonParser
+    if (!firmwareResponse.isValid()) {
+        LOG_TW(TAG, "Firmware response is not a complete JSON document.");
+        return;
+    }
 
-    zap::Str newVersion;
-    if (parser.getString("version", newVersion)) { // Use JsonParser::getString
-        LOG_TD(TAG, "Latest firmware version available: %s", newVersion.c_str());
+    if (firmwareResponse.fields[0].found) {
+        const char* newVersion = firmwareResponse.version;
+        LOG_TD(TAG, "Latest firmware version available: %s", newVersion);
         LOG_TD(TAG, "Current firmware version: %s", FIRMWARE_VERSION_STRING);
 
-        if (newVersion != FIRMWARE_VERSION_STRING) {
+        if (strcmp(newVersion, FIRMWARE_VERSION_STRING) != 0) {
             LOG_TI(TAG, "A different firmware version found");
-            LOG_TD(TAG, "Found firmware version: %s", newVersion.c_str());
-            
-            JsonParser binaryParser(""); // Initialize with an empty string
-            if (parser.getObject("binary", binaryParser)) { // Use JsonParser::getObject
-                zap::Str downloadUrl;
-                zap::Str hash;
-
-                if (binaryParser.getString("downloadUrl", downloadUrl) && 
-                    binaryParser.getString("hash", hash)) {
-                    LOG_TD(TAG, "Download URL: %s", downloadUrl.c_str());
-                    LOG_TD(TAG, "Hash: %s", hash.c_str());
-                    // Example: OtaHandler::getInstance()->startOta(downloadUrl, hash);
-                    extern OTAHandler g_otaHandler; // Assuming OtaHandler is defined elsewhere
-                    g_otaHandler.requestOTAUpdate(downloadUrl, newVersion);
-                } else {
-                    LOG_TW(TAG, "Could not parse download URL or hash from binary object.");
-                }
+            LOG_TD(TAG, "Found firmware version: %s", newVersion);
+
+            if (firmwareResponse.fields[1].found && firmwareResponse.fields[2].found) {
+                LOG_TD(TAG, "Download URL: %s", firmwareResponse.downloadUrl);
+                LOG_TD(TAG, "Hash: %s", firmwareResponse.hash);
+                // Example: OtaHandler::getInstance()->startOta(downloadUrl, hash);
+                extern OTAHandler g_otaHandler; // Assuming OtaHandler is defined elsewhere
+                g_otaHandler.requestOTAUpdate(zap::Str(firmwareResponse.downloadUrl), zap::Str(newVersion));
             } else {
-                LOG_TW(TAG, "Binary object not found or not an object in JSON response.");
+                LOG_TW(TAG, "Could not parse download URL or hash from binary object.");
             }
         } else {
             LOG_TD(TAG, "Firmware is up to date.");
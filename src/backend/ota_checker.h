@@ -3,28 +3,57 @@
 
 #include <stdint.h>
 #include "wifi/wifi_manager.h" // For WifiManager type
-#include "HTTPClient.h"      // For HTTPClient
 #include "json_light/json_light.h" // For JSON parsing
+#include "json_light/json_pull_parser.h"
+#include "http_connection_manager.h"
 #include "../zap_log.h"      // For logging
 #include "../crypto.h"       // For crypto_getId()
 #include "../zap_str.h"      // Include zap_str.h
+#include "retry_policy.h"
 
 class OtaChecker {
 public:
     OtaChecker();
     void begin();
-    void loop(const unsigned long currentTime);
+    void loop(const unsigned long currentTime, const Deadline& deadline);
     void triggerOtaCheck();
 
 private:
     bool isTimeForOtaCheck(unsigned long currentTime) const;
-    void checkForUpdate();
-    void parseFirmwareResponse(const zap::Str& payload); // Changed to zap::Str
+    void checkForUpdate(const Deadline& deadline);
+    void parseFirmwareResponse();
+
+    /**
+     * @brief Picks the latest firmware out of the response while it is read
+     *
+     * The response never has to be in memory as a whole, only the longest value,
+     * which is the download url.
+     */
+    class FirmwareResponse : public HttpConnectionManager::BodyReader {
+    public:
+        static const size_t MAX_URL_LENGTH = 512;
+
+        char version[32];
+        char downloadUrl[MAX_URL_LENGTH];
+        char hash[80];
+        JsonPathField fields[3];    // version, binary.downloadUrl, binary.hash
+
+        FirmwareResponse();
+        void begin();
+        bool read(const char* data, size_t length) override;
+        bool isValid() const { return _parser.isDone(); }
+
+    private:
+        char _token[MAX_URL_LENGTH];
+        char _path[32];
+        JsonPullParser _parser;
+    };
 
-    HTTPClient httpClient;
     unsigned long lastOtaCheckTime;
     uint32_t otaCheckInterval;
     bool initialCheckDone; 
+    RetryPolicy retryPolicy;   // Schedules the next check after a failed one
+    FirmwareResponse firmwareResponse;
 };
 
 #endif // OTA_CHECKER_H
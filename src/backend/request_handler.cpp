@@ -8,6 +8,9 @@
 
 static const char *TAG_rh = "request_handler";
 
+// A request has eight members and a small body, larger ones fall back to scanning
+static const size_t REQUEST_TAPE_ENTRIES = 32;
+
 // --- RequestHandler Implementation ---
 
 using namespace zap::backend;
@@ -19,17 +22,26 @@ RequestHandler::RequestHandler(Externals& ext) : _ext(ext) {
 void RequestHandler::handleRequestTask(JsonParser& configData) {
     LOG_I(TAG_rh, "Processing configuration data");
 
-    // extract the data string and convert it to a json string
-    zap::Str data;
-    if (!configData.getString("data", data)) {
+    // The request is JSON escaped into the data string
+    JsonStringView dataView;
+    if (!configData.getStringView("data", dataView)) {
         LOG_E(TAG_rh, "Failed to extract data from configuration");
         return;
     }
-    LOG_I(TAG_rh, "Received data: %s", data.c_str());
-    // Replace escaped characters - TODO: Improve this handling
-    //data.replace("\\u0022", "\"");
 
-    JsonParser dataDoc(data.c_str());
+    // Unescaped where it is when the message buffer may be rewritten, otherwise copied
+    zap::Str copy;
+    const char* data = configData.unescapeInPlace(dataView);
+    if (data == nullptr) {
+        dataView.copyTo(copy);
+        data = copy.c_str();
+    }
+    LOG_I(TAG_rh, "Received data: %s", data);
+
+    JsonParser dataDoc(data);
+    // Indexed once, the lookups below then only walk the members
+    JsonTapeEntry tape[REQUEST_TAPE_ENTRIES];
+    dataDoc.index(tape, REQUEST_TAPE_ENTRIES);
 
     // Check if this is a request to handle
     if (dataDoc.contains("id") && dataDoc.contains("path") && dataDoc.contains("method")) {
@@ -48,8 +60,9 @@ void RequestHandler::handleRequest(JsonParser& requestData) {
     zap::Str id; requestData.getString("id", id);
     zap::Str path; requestData.getString("path", path);
     zap::Str method; requestData.getString("method", method);
-    zap::Str query; requestData.getString("query", query);
-    zap::Str headers; requestData.getString("headers", headers);
+    // Not used yet, viewed rather than copied
+    JsonStringView query; requestData.getStringView("query", query);
+    JsonStringView headers; requestData.getStringView("headers", headers);
     uint64_t timestamp; requestData.getUInt64("timestamp", timestamp);
 
 
@@ -110,14 +123,8 @@ void RequestHandler::sendResponse(const zap::Str& requestId, int statusCode, con
     gettimeofday(&tv, NULL);
     uint64_t epochTimeMs = (uint64_t)(tv.tv_sec) * 1000 + (uint64_t)(tv.tv_usec) / 1000;
 
-    // Use JsonBuilder to create JWT header
-    JsonBuilder headerBuilder;
-    headerBuilder.beginObject()
-        .add("alg", "ES256")
-        .add("typ", "JWT")
-        .add("device", crypto_getId().c_str())
-        .add("subKey", "response");
-    zap::Str header = headerBuilder.end();
+    // JWT header, the device part is serialised once at boot
+    zap::Str header = crypto_get_identity().jwtHeaderPrefix + ",\"subKey\":\"response\"}";
 
     // Use JsonBuilder to create JWT payload
     // Need to properly escape the responseData if it's intended to be a JSON string within the payload
@@ -138,7 +145,7 @@ void RequestHandler::sendResponse(const zap::Str& requestId, int statusCode, con
     zap::Str payload = payloadBuilder.end();
 
     // Sign and generate JWT
-    zap::Str jwt = crypto_create_jwt(header.c_str(), payload.c_str(), PRIVATE_KEY_HEX);
+    zap::Str jwt = _ext.createJwt(header.c_str(), payload.c_str());
 
     if (jwt.length() == 0) {
         LOG_E(TAG_rh, "Failed to create JWT for response to request %s", requestId.c_str());
@@ -13,6 +13,7 @@ public:
     class Externals {
         public:
             virtual GQL::BoolResponse setConfiguration(const zap::Str& jwt) = 0;
+            virtual zap::Str createJwt(const char* header, const char* payload) = 0;
 
             virtual const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) = 0;
             virtual EndpointResponse route(const EndpointRequest& request) = 0;
@@ -23,6 +24,9 @@ public:
     /**
      * @brief Processes incoming configuration data, specifically looking for requests.
      *
+     * The request is unescaped in place when configData was given a writable buffer, the
+     * document is not valid afterwards.
+     *
      * @param configData A JsonParser instance containing the configuration data payload.
      */
     void handleRequestTask(JsonParser& configData);
@@ -0,0 +1,114 @@
+#include "retry_policy.h"
+
+RetryPolicy* RetryPolicy::s_policies[RetryPolicy::MAX_POLICIES] = {};
+
+RetryPolicy::RetryPolicy(const char* name, const Config& config)
+    : _name(name), _config(config), _state(State::CLOSED), _stats(),
+      _sleepMs(config.baseDelayMs), _failedAt(0), _random(0x9e3779b9) {
+    for (size_t i = 0; i < MAX_POLICIES; i++) {
+        if (s_policies[i] == nullptr) {
+            s_policies[i] = this;
+            break;
+        }
+    }
+}
+
+RetryPolicy::~RetryPolicy() {
+    for (size_t i = 0; i < MAX_POLICIES; i++) {
+        if (s_policies[i] == this) {
+            s_policies[i] = nullptr;
+        }
+    }
+}
+
+bool RetryPolicy::shouldAttempt(unsigned long now) {
+    if (!hasFailures()) {
+        return true;
+    }
+    if (now - _failedAt < _stats.delayMs) {
+        return false;
+    }
+
+    if (_state == State::OPEN) {
+        // Probe once, if the probe is never reported another one is allowed after the next period
+        _state = State::HALF_OPEN;
+        _failedAt = now;
+        _stats.delayMs = _config.openDurationMs;
+    }
+    return true;
+}
+
+void RetryPolicy::onSuccess(unsigned long now) {
+    _stats.successes++;
+    _stats.consecutiveFailures = 0;
+    _stats.delayMs = 0;
+    _state = State::CLOSED;
+    _sleepMs = _config.baseDelayMs;
+}
+
+void RetryPolicy::onFailure(unsigned long now) {
+    _stats.failures++;
+    _stats.consecutiveFailures++;
+    _failedAt = now;
+
+    if (_state == State::HALF_OPEN || _stats.consecutiveFailures >= _config.failuresToOpen) {
+        if (_state != State::OPEN) {
+            _stats.opened++;
+        }
+        _state = State::OPEN;
+        _stats.delayMs = _config.openDurationMs + random(0, _config.openDurationMs / 2);
+        return;
+    }
+
+    // Decorrelated jitter, random between the base and three times the previous delay
+    uint64_t high = (uint64_t)_sleepMs * 3;
+    if (high > _config.maxDelayMs) {
+        high = _config.maxDelayMs;
+    }
+    if (high < _config.baseDelayMs) {
+        high = _config.baseDelayMs;
+    }
+    _sleepMs = random(_config.baseDelayMs, (uint32_t)high);
+    _stats.delayMs = _sleepMs;
+}
+
+uint32_t RetryPolicy::getWaitMs(unsigned long now) const {
+    if (!hasFailures() || now - _failedAt >= _stats.delayMs) {
+        return 0;
+    }
+    return _stats.delayMs - (uint32_t)(now - _failedAt);
+}
+
+void RetryPolicy::seed(uint32_t seed) {
+    _random = seed != 0 ? seed : 0x9e3779b9;
+}
+
+uint32_t RetryPolicy::random(uint32_t low, uint32_t high) {
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    const uint64_t span = (uint64_t)high - low + 1;
+    return low + (uint32_t)(_random % span);
+}
+
+RetryPolicy* RetryPolicy::get(size_t index) {
+    return index < MAX_POLICIES ? s_policies[index] : nullptr;
+}
+
+const char* RetryPolicy::stateName(State state) {
+    switch (state) {
+        case State::CLOSED: return "closed";
+        case State::OPEN: return "open";
+        case State::HALF_OPEN: return "half_open";
+    }
+    return "unknown";
+}
+
+void RetryPolicy::seedAll(uint32_t seed) {
+    for (size_t i = 0; i < MAX_POLICIES; i++) {
+        if (s_policies[i] != nullptr) {
+            // Different streams per policy from the same device seed
+            s_policies[i]->seed(seed ^ (0x9e3779b9 * (uint32_t)(i + 1)));
+        }
+    }
+}
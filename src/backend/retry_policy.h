@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief When to try a network operation again after it failed
+ *
+ * Delays after a failure grow exponentially with decorrelated jitter: each
+ * delay is random between the base delay and three times the previous delay,
+ * capped at the maximum. Devices that failed at the same moment, e.g. during
+ * a backend outage, therefore spread out instead of retrying in lockstep.
+ *
+ * After a number of consecutive failures the circuit opens and only one probe
+ * attempt is made per open period. A success closes the circuit and resets
+ * the delay.
+ *
+ * Every policy registers itself so the debug report can list them. Times are
+ * millis() values, wrap-around is handled.
+ */
+class RetryPolicy {
+public:
+    static const size_t MAX_POLICIES = 8;
+
+    struct Config {
+        uint32_t baseDelayMs;
+        uint32_t maxDelayMs;
+        uint32_t failuresToOpen;    // Consecutive failures that open the circuit
+        uint32_t openDurationMs;    // Wait before the probe, up to half of it is added as jitter
+    };
+
+    enum class State {
+        CLOSED,     // Attempts allowed, backing off after failures
+        OPEN,       // Waiting for the open period to end
+        HALF_OPEN   // One probe attempt allowed
+    };
+
+    struct Stats {
+        uint32_t successes;
+        uint32_t failures;
+        uint32_t consecutiveFailures;
+        uint32_t opened;            // Times the circuit opened
+        uint32_t delayMs;           // Current wait after the last failure
+    };
+
+    RetryPolicy(const char* name, const Config& config);
+    ~RetryPolicy();
+
+    RetryPolicy(const RetryPolicy&) = delete;
+    RetryPolicy& operator=(const RetryPolicy&) = delete;
+
+    /**
+     * @brief Check whether an attempt may be made now
+     *
+     * Always true until something failed. An open circuit turns half open
+     * here when its period has ended.
+     */
+    bool shouldAttempt(unsigned long now);
+
+    void onSuccess(unsigned long now);
+    void onFailure(unsigned long now);
+
+    bool hasFailures() const { return _stats.consecutiveFailures > 0; }
+    State getState() const { return _state; }
+    const char* getName() const { return _name; }
+    const Stats& getStats() const { return _stats; }
+
+    /**
+     * @brief Milliseconds until shouldAttempt() turns true, 0 if it is already
+     */
+    uint32_t getWaitMs(unsigned long now) const;
+
+    /**
+     * @brief Seed the jitter, different per device so devices do not retry in step
+     */
+    void seed(uint32_t seed);
+
+    // Registered policies for reporting, indexed up to MAX_POLICIES, unused slots are nullptr
+    static RetryPolicy* get(size_t index);
+    static const char* stateName(State state);
+
+    // Seed every live policy from one device specific seed
+    static void seedAll(uint32_t seed);
+
+private:
+    uint32_t random(uint32_t low, uint32_t high);
+
+    const char* _name;
+    Config _config;
+    State _state;
+    Stats _stats;
+    uint32_t _sleepMs;          // Previous delay for the decorrelated jitter
+    unsigned long _failedAt;    // Time of the last failure or of turning half open
+    uint32_t _random;           // xorshift32 state
+
+    static RetryPolicy* s_policies[MAX_POLICIES];
+};
@@ -0,0 +1,30 @@
+#include "sign_queue.h"
+
+SignQueue::SignQueue() {
+    for (Lane& lane : _lanes) {
+        lane.head = 0;
+        lane.count = 0;
+    }
+}
+
+bool SignQueue::push(SignJob* job, SignJob::Priority priority) {
+    Lane& lane = _lanes[static_cast<size_t>(priority)];
+    if (lane.count == LANE_CAPACITY) {
+        return false;
+    }
+    lane.jobs[(lane.head + lane.count) % LANE_CAPACITY] = job;
+    lane.count++;
+    return true;
+}
+
+SignJob* SignQueue::pop() {
+    for (Lane& lane : _lanes) {
+        if (lane.count > 0) {
+            SignJob* job = lane.jobs[lane.head];
+            lane.head = (lane.head + 1) % LANE_CAPACITY;
+            lane.count--;
+            return job;
+        }
+    }
+    return nullptr;
+}
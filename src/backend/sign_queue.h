@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include "../zap_str.h"
+
+/**
+ * @brief A JWT to be signed by the SigningTask
+ *
+ * The header and payload must stay valid until the callback has been called.
+ * The callback runs on the signing task, it should only hand the result over.
+ */
+struct SignJob {
+    enum class Priority {
+        HIGH,   // State updates and command responses, someone is waiting for these
+        BULK    // Meter data
+    };
+
+    typedef void (*Callback)(SignJob& job);
+
+    const char* header;
+    const char* payload;
+    size_t payloadLength;   // 0 for a NUL terminated payload
+    Callback onDone;
+    void* context;      // For the callback, not used by the queue or task
+    zap::Str jwt;       // The signed JWT, empty if signing failed
+};
+
+/**
+ * @brief Bounded two-lane queue of sign jobs
+ *
+ * High priority jobs are always handed out before bulk jobs, jobs within a
+ * lane are handed out in submission order. The queue only stores pointers and
+ * does no locking, the owner serialises access.
+ */
+class SignQueue {
+public:
+    static const size_t LANE_CAPACITY = 4;
+
+    SignQueue();
+
+    /**
+     * @brief Add a job to the lane of the given priority
+     *
+     * @param job Job to queue, not copied
+     * @param priority Lane to use
+     * @return false if that lane is full
+     */
+    bool push(SignJob* job, SignJob::Priority priority);
+
+    /**
+     * @brief Take the next job to sign
+     *
+     * @return The oldest high priority job, else the oldest bulk job, else nullptr
+     */
+    SignJob* pop();
+
+    size_t size() const { return _lanes[0].count + _lanes[1].count; }
+    bool isEmpty() const { return size() == 0; }
+
+private:
+    struct Lane {
+        SignJob* jobs[LANE_CAPACITY];
+        size_t head;
+        size_t count;
+    };
+
+    Lane _lanes[2];     // Indexed by priority
+};
@@ -0,0 +1,150 @@
+#include "signing_task.h"
+#include "../crypto.h"
+#include "../zap_log.h"
+
+static constexpr LogTag TAG_st = LogTag("signing_task", ZLOG_LEVEL_INFO);
+
+SigningTask::SigningTask(uint32_t stackSize, UBaseType_t priority)
+    : taskHandle(nullptr), stackSize(stackSize), priority(priority), shouldRun(false), exited(nullptr), queueMutex(nullptr) {
+}
+
+SigningTask::~SigningTask() {
+    stop();
+    if (queueMutex != nullptr) {
+        vSemaphoreDelete(queueMutex);
+        queueMutex = nullptr;
+    }
+    if (exited != nullptr) {
+        vSemaphoreDelete(exited);
+        exited = nullptr;
+    }
+}
+
+void SigningTask::begin() {
+    if (taskHandle != nullptr) {
+        return; // Task already running
+    }
+
+    if (queueMutex == nullptr) {
+        queueMutex = xSemaphoreCreateMutex();
+        if (queueMutex == nullptr) {
+            LOG_TE(TAG_st, "Failed to create mutex, signing inline");
+            return;
+        }
+    }
+
+    if (exited == nullptr) {
+        exited = xSemaphoreCreateBinary();
+        if (exited == nullptr) {
+            LOG_TE(TAG_st, "Failed to create semaphore, signing inline");
+            return;
+        }
+    }
+
+    shouldRun = true;
+    xTaskCreatePinnedToCore(
+        taskFunction,
+        "SigningTask",
+        stackSize,
+        this,
+        priority,
+        &taskHandle,
+        0  // Run on core 0
+    );
+}
+
+void SigningTask::stop() {
+    if (taskHandle == nullptr) {
+        return; // Task not running
+    }
+
+    shouldRun = false;
+    xTaskNotifyGive(taskHandle);
+    // A job being signed is finished first, which may take a while
+    xSemaphoreTake(exited, portMAX_DELAY);
+    taskHandle = nullptr;
+
+    // Complete whatever was still queued so no caller waits forever
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    while (SignJob* job = queue.pop()) {
+        signJob(*job);
+    }
+    xSemaphoreGive(queueMutex);
+}
+
+void SigningTask::signJob(SignJob& job) {
+    job.jwt = job.payloadLength > 0 ? crypto_create_jwt(job.header, job.payload, job.payloadLength)
+                                    : crypto_create_jwt(job.header, job.payload);
+    if (job.jwt.length() == 0) {
+        LOG_TE(TAG_st, "Failed to sign JWT");
+    }
+    job.onDone(job);
+}
+
+bool SigningTask::submit(SignJob* job, SignJob::Priority priority) {
+    if (taskHandle == nullptr) {
+        signJob(*job);
+        return true;
+    }
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    const bool queued = queue.push(job, priority);
+    xSemaphoreGive(queueMutex);
+
+    if (queued) {
+        xTaskNotifyGive(taskHandle);
+    }
+    return queued;
+}
+
+zap::Str SigningTask::sign(const char* header, const char* payload, SignJob::Priority priority) {
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (done == nullptr) {
+        return crypto_create_jwt(header, payload);
+    }
+
+    SignJob job;
+    job.header = header;
+    job.payload = payload;
+    job.payloadLength = 0;
+    job.context = done;
+    job.onDone = [](SignJob& job) {
+        xSemaphoreGive(static_cast<SemaphoreHandle_t>(job.context));
+    };
+
+    // The high priority lane only fills up if many tasks wait at once, sign inline then
+    zap::Str jwt;
+    if (submit(&job, priority)) {
+        xSemaphoreTake(done, portMAX_DELAY);
+        jwt = job.jwt;
+    } else {
+        jwt = crypto_create_jwt(header, payload);
+    }
+
+    vSemaphoreDelete(done);
+    return jwt;
+}
+
+void SigningTask::taskFunction(void* parameter) {
+    SigningTask* task = static_cast<SigningTask*>(parameter);
+
+    while (task->shouldRun) {
+        xSemaphoreTake(task->queueMutex, portMAX_DELAY);
+        SignJob* job = task->queue.pop();
+        xSemaphoreGive(task->queueMutex);
+
+        if (job == nullptr) {
+            // Woken by submit() or stop()
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        signJob(*job);
+    }
+
+    // Task cleanup, nothing of the SigningTask is touched once stop() may go on
+    xSemaphoreGive(task->exited);
+    vTaskDelete(NULL);
+}
+
+SigningTask g_signingTask;
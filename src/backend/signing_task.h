@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include "sign_queue.h"
+#include <atomic>
+
+/**
+ * @brief Task that signs JWTs so the backend task can do network I/O meanwhile
+ *
+ * Jobs are submitted with a priority and completed through their callback on
+ * this task. Before begin() or after stop() jobs are signed inline by the caller.
+ */
+class SigningTask {
+public:
+    explicit SigningTask(uint32_t stackSize = 1024 * 8, UBaseType_t priority = 4);
+    ~SigningTask();
+
+    void begin();
+    /**
+     * @brief Stop the task once it has exited and sign whatever was still queued
+     */
+    void stop();
+
+    /**
+     * @brief Queue a job for signing
+     *
+     * @param job Job to sign, must stay valid until its callback has been called
+     * @param priority HIGH jobs are signed before any queued BULK job
+     * @return false if the queue for that priority is full, the job is not queued
+     */
+    bool submit(SignJob* job, SignJob::Priority priority);
+
+    /**
+     * @brief Sign a JWT on the signing task and wait for it
+     *
+     * @return The JWT or an empty string on failure
+     */
+    zap::Str sign(const char* header, const char* payload, SignJob::Priority priority = SignJob::Priority::HIGH);
+
+private:
+    static void taskFunction(void* parameter);
+    static void signJob(SignJob& job);
+
+    TaskHandle_t taskHandle;
+    uint32_t stackSize;
+    UBaseType_t priority;
+    std::atomic<bool> shouldRun;
+    SemaphoreHandle_t exited;       // Given by the task right before it deletes itself
+
+    SemaphoreHandle_t queueMutex;
+    SignQueue queue;
+};
+
+extern SigningTask g_signingTask;
@@ -6,6 +6,8 @@
 #include <time.h>
 #include "zap_log.h"
 #include "backend/graphql.h" // For GQL functions
+#include "backend/signing_task.h"
+#include "backend/config_subscription.h"
 
 // Define TAG for logging
 static const char* TAG = "state_handler";
@@ -13,13 +15,17 @@ static const char* TAG = "state_handler";
 // Define default state update interval (moved from BackendApiTask)
 #define DEFAULT_STATE_UPDATE_INTERVAL (5 * 60 * 1000) // 5 minutes
 
+static const RetryPolicy::Config RETRY_POLICY = {30 * 1000, 5 * 60 * 1000, 5, 15 * 60 * 1000};
+
 StateHandler::StateHandler()
-    : wifiManagerInstance(nullptr), lastUpdateTime(0),
-      stateUpdateInterval(DEFAULT_STATE_UPDATE_INTERVAL), initialUpdateDone(false) {
+    : wifiManagerInstance(nullptr), subscription(nullptr), lastUpdateTime(0),
+      stateUpdateInterval(DEFAULT_STATE_UPDATE_INTERVAL), initialUpdateDone(false),
+      retryPolicy("state", RETRY_POLICY) {
 }
 
-void StateHandler::begin(WifiManager* wifiManager) {
+void StateHandler::begin(WifiManager* wifiManager, GraphQLSubscriptionClient* subscription) {
     this->wifiManagerInstance = wifiManager;
+    this->subscription = subscription;
     // Force immediate state update by setting lastUpdateTime to a value that will
     // trigger an immediate update in the loop, and interval to 0.
     lastUpdateTime = 0;
@@ -27,19 +33,21 @@ void StateHandler::begin(WifiManager* wifiManager) {
     initialUpdateDone = false;
 }
 
-void StateHandler::loop(const unsigned long currentTime) {
+void StateHandler::loop(const unsigned long currentTime, const Deadline& deadline) {
     if (!wifiManagerInstance || !wifiManagerInstance->isConnected()) {
         // LOG_D(TAG, "WiFi not connected, skipping state update loop.");
         return;
     }
 
-    if (isTimeForStateUpdate(currentTime)) {
+    // After a failure the retry policy decides, not the update interval
+    const bool due = retryPolicy.hasFailures() ? retryPolicy.shouldAttempt(currentTime) : isTimeForStateUpdate(currentTime);
+    if (due) {
         if (!initialUpdateDone) {
             stateUpdateInterval = DEFAULT_STATE_UPDATE_INTERVAL;
             initialUpdateDone = true;
         }
         lastUpdateTime = currentTime;
-        sendStateUpdate();
+        sendStateUpdate(deadline);
     }
 }
 
@@ -47,7 +55,7 @@ bool StateHandler::isTimeForStateUpdate(unsigned long currentTime) const {
     return (currentTime - lastUpdateTime >= stateUpdateInterval);
 }
 
-void StateHandler::sendStateUpdate() {
+void StateHandler::sendStateUpdate(const Deadline& deadline) {
     if (!wifiManagerInstance || !wifiManagerInstance->isConnected()) {
         LOG_W(TAG, "WiFi not connected, cannot send state update.");
         return;
@@ -55,14 +63,8 @@ void StateHandler::sendStateUpdate() {
 
     LOG_I(TAG, "Preparing state update");
 
-    // Use JsonBuilder to create JWT header
-    JsonBuilder headerBuilder;
-    headerBuilder.beginObject()
-        .add("alg", "ES256")
-        .add("typ", "JWT")
-        .add("device", crypto_getId().c_str())
-        .add("subKey", "state");
-    zap::Str header = headerBuilder.end();
+    // JWT header, the device part is serialised once at boot
+    zap::Str header = crypto_get_identity().jwtHeaderPrefix + ",\"subKey\":\"state\"}";
 
     // Get current epoch time in milliseconds
     struct timeval tv;
@@ -93,8 +95,8 @@ void StateHandler::sendStateUpdate() {
         .add("timestamp", epochTimeMs);
     zap::Str payload = payloadBuilder.end();
 
-    // Sign and generate JWT
-    zap::Str jwt = crypto_create_jwt(header.c_str(), payload.c_str(), PRIVATE_KEY_HEX);
+    // Sign and generate JWT, ahead of any queued meter data
+    zap::Str jwt = g_signingTask.sign(header.c_str(), payload.c_str(), SignJob::Priority::HIGH);
 
     if (jwt.length() == 0) {
         LOG_E(TAG, "Failed to create JWT");
@@ -103,12 +105,13 @@ void StateHandler::sendStateUpdate() {
 
     LOG_I(TAG, "JWT created successfully");
 
-    // Send the JWT using GraphQL
-    GQL::BoolResponse response = GQL::setConfiguration(jwt);
+    // Send the JWT using GraphQL, over the WebSocket if it is up
+    GQL::BoolResponse response = subscription != nullptr ? subscription->setConfiguration(jwt, deadline) : GQL::setConfiguration(jwt, deadline);
 
     // Handle the response
     if (response.isSuccess() && response.data) {
         LOG_I(TAG, "State update sent successfully");
+        retryPolicy.onSuccess(millis());
     } else {
         // Handle different error cases
         switch (response.status) {
@@ -126,14 +129,8 @@ void StateHandler::sendStateUpdate() {
                 break;
         }
 
-        // Retry sooner on failure (after 1 minute instead of default)
-        // Ensure stateUpdateInterval is not already very short to avoid busy loop
-        if (stateUpdateInterval > 60000) { // Check if current interval is more than 1 min
-             lastUpdateTime = millis() - (stateUpdateInterval - 60000); // effectively sets next update in 1 min
-        } else {
-            // if interval is already short, just use current time to retry at that short interval
-            lastUpdateTime = millis(); 
-        }
+        retryPolicy.onFailure(millis());
+        LOG_I(TAG, "Retrying state update in %u ms", (unsigned int)retryPolicy.getWaitMs(millis()));
     }
 }
 
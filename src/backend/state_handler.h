@@ -3,26 +3,31 @@
 
 #include <stdint.h>
 #include "wifi/wifi_manager.h" // For WifiManager type
+#include "backend/retry_policy.h"
+#include "backend/deadline.h"
 
 // Forward declaration if preferred and possible, but full include for simplicity here
 // class WifiManager; 
+class GraphQLSubscriptionClient;
 
 class StateHandler {
 public:
     StateHandler();
-    void begin(WifiManager* wifiManager);
-    void loop(const unsigned long currentTime);
+    void begin(WifiManager* wifiManager, GraphQLSubscriptionClient* subscription);
+    void loop(const unsigned long currentTime, const Deadline& deadline);
     void triggerStateUpdate();
     void setInterval(uint32_t interval);
 
 private:
     bool isTimeForStateUpdate(unsigned long currentTime) const;
-    void sendStateUpdate();
+    void sendStateUpdate(const Deadline& deadline);
 
     WifiManager* wifiManagerInstance;
+    GraphQLSubscriptionClient* subscription; // Sends the update over its WebSocket when connected
     unsigned long lastUpdateTime;
     uint32_t stateUpdateInterval;
     bool initialUpdateDone; // To manage setting default interval after first run
+    RetryPolicy retryPolicy; // Schedules the next attempt after a failed update
 };
 
 #endif // STATE_HANDLER_H
@@ -0,0 +1,91 @@
+#include "upload_controller.h"
+
+// Frames every 10 s become a reading every minute and an upload every 8 minutes at worst
+const UploadController::Config UploadController::DEFAULT_CONFIG = {8, 6, 30 * 1000, -67, -80, 800, 3000};
+
+// Backlog levels, the ring holds only a few readings so it fills fast
+static const uint8_t GOOD_BACKLOG_PERCENT = 25;
+static const uint8_t POOR_BACKLOG_PERCENT = 50;
+static const uint8_t GOOD_FAILURE_PERCENT = 5;
+static const uint8_t POOR_FAILURE_PERCENT = 25;
+
+UploadController::UploadController(const Config& config)
+    : _config(config), _batch(1), _downsample(1), _link(Link::GOOD), _rssi(0),
+      _latencyMs(0), _failurePercent(0), _backlogPercent(0), _hasSample(false), _evaluatedAt(0) {
+}
+
+void UploadController::onUpload(uint32_t latencyMs, bool success) {
+    // Moving averages weighing the newest sample by a quarter
+    _latencyMs = _hasSample ? (_latencyMs * 3 + latencyMs) / 4 : latencyMs;
+    _failurePercent = (uint8_t)((_failurePercent * 3 + (success ? 0 : 100)) / 4);
+    _hasSample = true;
+}
+
+void UploadController::update(unsigned long now, int rssi, uint8_t backlogPercent) {
+    _rssi = rssi;
+    _backlogPercent = backlogPercent;
+
+    if (now - _evaluatedAt < _config.evaluateIntervalMs) {
+        return;
+    }
+    _evaluatedAt = now;
+    evaluate();
+}
+
+UploadController::Link UploadController::classify() const {
+    const bool knownRssi = _rssi != 0;
+
+    if ((knownRssi && _rssi < _config.poorRssi) ||
+        _latencyMs > _config.poorLatencyMs ||
+        _failurePercent > POOR_FAILURE_PERCENT ||
+        _backlogPercent > POOR_BACKLOG_PERCENT) {
+        return Link::POOR;
+    }
+
+    if ((!knownRssi || _rssi >= _config.goodRssi) &&
+        _latencyMs <= _config.goodLatencyMs &&
+        _failurePercent < GOOD_FAILURE_PERCENT &&
+        _backlogPercent < GOOD_BACKLOG_PERCENT) {
+        return Link::GOOD;
+    }
+    return Link::FAIR;
+}
+
+void UploadController::evaluate() {
+    _link = classify();
+
+    uint8_t batch = getBatchSize();
+    uint8_t downsample = getDownsample();
+
+    if (_link == Link::POOR) {
+        // Fewer requests first, fewer readings only when batching is maxed out
+        if (batch < _config.maxBatch) {
+            batch = batch * 2 < _config.maxBatch ? batch * 2 : _config.maxBatch;
+        } else if (downsample < _config.maxDownsample) {
+            downsample++;
+        }
+    } else if (_link == Link::GOOD) {
+        // Full resolution first, then lower latency
+        if (downsample > 1) {
+            downsample--;
+        } else if (batch > 1) {
+            batch /= 2;
+        }
+    }
+
+    _batch.store(batch, std::memory_order_relaxed);
+    _downsample.store(downsample, std::memory_order_relaxed);
+}
+
+UploadController::Stats UploadController::getStats() const {
+    return Stats{_link, getBatchSize(), getDownsample(), _rssi, _latencyMs, _failurePercent, _backlogPercent};
+}
+
+const char* UploadController::linkName(Link link) {
+    switch (link) {
+        case Link::GOOD: return "good";
+        case Link::FAIR: return "fair";
+        case Link::POOR: return "poor";
+    }
+    return "unknown";
+}
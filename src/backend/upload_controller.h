@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+/**
+ * @brief Adapts the meter data upload cadence to the link
+ *
+ * Watches upload latency and failures, the WiFi RSSI and the backlog in the
+ * data ring. On a good link every meter frame is uploaded on its own. When the
+ * link turns poor the batch size doubles first, so fewer requests carry the
+ * same readings, then frames are downsampled, several frames averaged into one
+ * reading. When the link is good again the steps are undone in reverse order.
+ * One step is taken per evaluation interval so a single slow request does not
+ * swing the cadence.
+ *
+ * update() and onUpload() are called from the backend task. The batch size and
+ * downsampling can be read from any task.
+ */
+class UploadController {
+public:
+    struct Config {
+        uint8_t maxBatch;           // Readings per upload at most
+        uint8_t maxDownsample;      // Meter frames per reading at most
+        uint32_t evaluateIntervalMs;
+        int goodRssi;               // dBm, at or above is good
+        int poorRssi;               // dBm, below is poor
+        uint32_t goodLatencyMs;     // At or below is good
+        uint32_t poorLatencyMs;     // Above is poor
+    };
+
+    enum class Link {
+        GOOD,   // Undo a step
+        FAIR,   // Keep the cadence
+        POOR    // Take a step
+    };
+
+    struct Stats {
+        Link link;
+        uint8_t batch;
+        uint8_t downsample;
+        int rssi;                   // 0 when unknown
+        uint32_t latencyMs;         // Moving average of the upload latency
+        uint8_t failurePercent;     // Moving average of failed uploads
+        uint8_t backlogPercent;     // Last seen fill level of the data ring
+    };
+
+    static const Config DEFAULT_CONFIG;
+
+    explicit UploadController(const Config& config = DEFAULT_CONFIG);
+
+    /**
+     * @brief Record the outcome of an upload
+     *
+     * @param latencyMs Time the request took, also when it failed
+     */
+    void onUpload(uint32_t latencyMs, bool success);
+
+    /**
+     * @brief Feed the link state, evaluates it once per evaluation interval
+     *
+     * @param rssi Current RSSI in dBm, 0 when unknown
+     * @param backlogPercent How full the queue of readings is
+     */
+    void update(unsigned long now, int rssi, uint8_t backlogPercent);
+
+    uint8_t getBatchSize() const { return _batch.load(std::memory_order_relaxed); }
+    uint8_t getDownsample() const { return _downsample.load(std::memory_order_relaxed); }
+
+    Stats getStats() const;
+
+    static const char* linkName(Link link);
+
+private:
+    Link classify() const;
+    void evaluate();
+
+    Config _config;
+    std::atomic<uint8_t> _batch;
+    std::atomic<uint8_t> _downsample;
+
+    Link _link;
+    int _rssi;
+    uint32_t _latencyMs;
+    uint8_t _failurePercent;
+    uint8_t _backlogPercent;
+    bool _hasSample;
+    unsigned long _evaluatedAt;
+};
@@ -0,0 +1,209 @@
+#include "ws_frame_decoder.h"
+#include <cstring>
+
+static const size_t MAX_CONTROL_PAYLOAD = 125;
+
+WsFrameDecoder::WsFrameDecoder(size_t capacity)
+    : _capacity(capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity), _droppedCount(0) {
+    _buffer = new uint8_t[_capacity + 1];
+    reset();
+}
+
+WsFrameDecoder::~WsFrameDecoder() {
+    delete[] _buffer;
+}
+
+void WsFrameDecoder::reset() {
+    _length = 0;
+    _messageLength = 0;
+    _messageOpcode = CONTINUATION;
+    _skipMessage = false;
+    _skipBytes = 0;
+    _error = false;
+    _holding = false;
+    _heldSize = 0;
+    _heldStart = 0;
+    _terminatorAt = 0;
+    _savedByte = 0;
+}
+
+uint8_t* WsFrameDecoder::writeBuffer(size_t& space) {
+    releaseHeld();
+    space = _capacity - _length;
+    return _buffer + _length;
+}
+
+void WsFrameDecoder::commitWrite(size_t length) {
+    if (length > _capacity - _length) {
+        length = _capacity - _length;
+    }
+    _length += length;
+}
+
+size_t WsFrameDecoder::feed(const uint8_t* data, size_t length) {
+    size_t space;
+    uint8_t* target = writeBuffer(space);
+    if (length > space) {
+        length = space;
+    }
+    memcpy(target, data, length);
+    commitWrite(length);
+    return length;
+}
+
+bool WsFrameDecoder::next(Message& out) {
+    releaseHeld();
+
+    while (!_error) {
+        const size_t available = _length - _messageLength;
+        uint8_t* frame = _buffer + _messageLength;
+
+        // Throw away the payload of a frame that did not fit
+        if (_skipBytes > 0) {
+            const size_t count = _skipBytes < available ? (size_t)_skipBytes : available;
+            removeBytes(_messageLength, count);
+            _skipBytes -= count;
+            if (_skipBytes > 0) {
+                return false;
+            }
+            continue;
+        }
+
+        if (available < 2) {
+            return false;
+        }
+
+        const bool fin = (frame[0] & 0x80) != 0;
+        const uint8_t opcode = frame[0] & 0x0F;
+        const bool masked = (frame[1] & 0x80) != 0;
+        const bool control = (opcode & 0x08) != 0;
+
+        uint64_t payloadLength = frame[1] & 0x7F;
+        size_t lengthBytes = 0;
+        if (payloadLength == 126) {
+            lengthBytes = 2;
+        } else if (payloadLength == 127) {
+            lengthBytes = 8;
+        }
+        const size_t maskOffset = 2 + lengthBytes;
+        const size_t headerLength = maskOffset + (masked ? 4 : 0);
+        if (available < headerLength) {
+            return false;
+        }
+
+        if (lengthBytes > 0) {
+            payloadLength = 0;
+            for (size_t i = 0; i < lengthBytes; i++) {
+                payloadLength = (payloadLength << 8) | frame[2 + i];
+            }
+        }
+
+        // Reserved bits need an extension we never negotiate
+        bool valid = (frame[0] & 0x70) == 0 && (payloadLength >> 63) == 0;
+        if (control) {
+            valid = valid && fin && payloadLength <= MAX_CONTROL_PAYLOAD &&
+                    (opcode == CLOSE || opcode == PING || opcode == PONG);
+        } else if (opcode == CONTINUATION) {
+            valid = valid && (_messageOpcode != CONTINUATION || _skipMessage);
+        } else {
+            valid = valid && (opcode == TEXT || opcode == BINARY) &&
+                    _messageOpcode == CONTINUATION && !_skipMessage;
+        }
+        if (!valid) {
+            _error = true;
+            return false;
+        }
+
+        const size_t room = _capacity - _messageLength;
+        if (headerLength + payloadLength > room) {
+            if (control) {
+                // Only possible behind a large unfinished message, give that up to make room
+                removeBytes(0, _messageLength);
+                _messageLength = 0;
+                _messageOpcode = CONTINUATION;
+                _skipMessage = true;
+                _droppedCount++;
+                continue;
+            }
+
+            if (!_skipMessage) {
+                _droppedCount++;
+            }
+            removeBytes(0, _messageLength + headerLength);
+            _messageLength = 0;
+            _messageOpcode = CONTINUATION;
+            _skipMessage = !fin;
+            _skipBytes = payloadLength;
+            continue;
+        }
+
+        if (available < headerLength + payloadLength) {
+            return false;
+        }
+
+        if (!control && _skipMessage) {
+            // The rest of a message whose start was dropped
+            removeBytes(_messageLength, headerLength + (size_t)payloadLength);
+            _skipMessage = !fin;
+            continue;
+        }
+
+        uint8_t* payload = frame + headerLength;
+        if (masked) {
+            const uint8_t* mask = frame + maskOffset;
+            for (size_t i = 0; i < payloadLength; i++) {
+                payload[i] ^= mask[i % 4];
+            }
+        }
+
+        if (control) {
+            out.opcode = opcode;
+            out.data = (char*)payload;
+            out.length = (size_t)payloadLength;
+            hold(_messageLength, headerLength + (size_t)payloadLength, _messageLength + headerLength + (size_t)payloadLength);
+            return true;
+        }
+
+        // Join the payload to the message by moving it over the header
+        removeBytes(_messageLength, headerLength);
+        if (opcode != CONTINUATION) {
+            _messageOpcode = opcode;
+        }
+        _messageLength += (size_t)payloadLength;
+        if (!fin) {
+            continue;
+        }
+
+        out.opcode = _messageOpcode;
+        out.data = (char*)_buffer;
+        out.length = _messageLength;
+        hold(0, _messageLength, _messageLength);
+        _messageLength = 0;
+        _messageOpcode = CONTINUATION;
+        return true;
+    }
+    return false;
+}
+
+void WsFrameDecoder::removeBytes(size_t start, size_t count) {
+    memmove(_buffer + start, _buffer + start + count, _length - start - count);
+    _length -= count;
+}
+
+void WsFrameDecoder::hold(size_t start, size_t size, size_t terminatorAt) {
+    _holding = true;
+    _heldStart = start;
+    _heldSize = size;
+    _terminatorAt = terminatorAt;
+    _savedByte = _buffer[terminatorAt];
+    _buffer[terminatorAt] = '\0';
+}
+
+void WsFrameDecoder::releaseHeld() {
+    if (!_holding) {
+        return;
+    }
+    _buffer[_terminatorAt] = _savedByte;
+    removeBytes(_heldStart, _heldSize);
+    _holding = false;
+}
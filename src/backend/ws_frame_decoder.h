@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Incremental decoder for WebSocket frames received by a client
+ *
+ * Socket data is read straight into a fixed buffer owned by the decoder and
+ * can be split or coalesced in any way. Payloads are unmasked in place and
+ * the fragments of a message are joined in place by moving them over the
+ * frame headers, so a complete message is one NUL terminated block inside
+ * the buffer that a JSON parser can read directly. Control frames may arrive
+ * between the fragments of a message.
+ *
+ * A message that does not fit in the buffer is skipped as it arrives and
+ * counted as dropped. A protocol violation stops the decoder until reset().
+ */
+class WsFrameDecoder {
+public:
+    static const size_t MIN_CAPACITY = 256;     // Any control frame fits
+
+    enum Opcode : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xA
+    };
+
+    struct Message {
+        uint8_t opcode;     // Of the first frame, never CONTINUATION
+        char* data;         // NUL terminated, valid until the next call to the decoder
+        size_t length;      // Without the terminator
+    };
+
+    explicit WsFrameDecoder(size_t capacity);
+    ~WsFrameDecoder();
+
+    WsFrameDecoder(const WsFrameDecoder&) = delete;
+    WsFrameDecoder& operator=(const WsFrameDecoder&) = delete;
+
+    /**
+     * @brief Get the free part of the buffer to read socket data into
+     *
+     * Invalidates the last message returned by next().
+     *
+     * @param space Receives the number of bytes that can be written
+     * @return Where to write
+     */
+    uint8_t* writeBuffer(size_t& space);
+
+    /**
+     * @brief Add bytes written to writeBuffer()
+     */
+    void commitWrite(size_t length);
+
+    /**
+     * @brief Copy bytes in, for data that is not read straight into writeBuffer()
+     *
+     * @return Number of bytes taken, less than length if the buffer is full
+     */
+    size_t feed(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Decode the next complete message
+     *
+     * Invalidates the message returned by the previous call.
+     *
+     * @param out Receives the message
+     * @return false if more data is needed or the decoder hit a protocol error
+     */
+    bool next(Message& out);
+
+    /**
+     * @brief Forget all state, for a new connection
+     */
+    void reset();
+
+    bool hasError() const { return _error; }
+    uint32_t getDroppedCount() const { return _droppedCount; }
+    size_t getCapacity() const { return _capacity; }
+
+private:
+    void removeBytes(size_t start, size_t count);
+    void hold(size_t start, size_t size, size_t terminatorAt);
+    void releaseHeld();
+
+    uint8_t* _buffer;           // One byte more than the capacity for the terminator
+    size_t _capacity;
+    size_t _length;             // Bytes in the buffer
+    size_t _messageLength;      // Joined payload of the message being received, undecoded bytes follow
+    uint8_t _messageOpcode;     // Opcode of the message being received, CONTINUATION if none
+    bool _skipMessage;          // Dropping the rest of a message that did not fit
+    uint64_t _skipBytes;        // Payload bytes of a dropped frame still to discard
+    bool _error;
+    uint32_t _droppedCount;
+
+    // The last message handed out, removed on the next call
+    bool _holding;
+    size_t _heldStart;
+    size_t _heldSize;
+    size_t _terminatorAt;
+    uint8_t _savedByte;         // The byte the terminator replaced
+};
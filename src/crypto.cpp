@@ -4,14 +4,19 @@
 #include <mbedtls/ecdsa.h>
 #include <mbedtls/ecp.h>
 #include <mbedtls/sha256.h>
+#include <mbedtls/md.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
+#include <mbedtls/platform_util.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #include <esp_efuse.h>
 #include <esp_system.h>
 // #include <Arduino.h>
 #include <esp_random.h>
 #include <soc/efuse_reg.h>
+#include <atomic>
 
 #include "zap_log.h"
 
@@ -19,6 +24,29 @@ static const char* TAG = "crypto";
 
 static int crypto_convert_to_der(const uint8_t *signature, uint8_t *der, size_t *der_len);
 
+// Number of random generator requests between reseeds from the entropy pool
+static const int SIGNER_RESEED_INTERVAL = 1000;
+
+// Long-lived signing state set up by crypto_init(). Keeping the group alive also keeps
+// the fixed-point comb table for the generator that mbedtls builds on the first multiplication.
+struct SignerContext {
+    bool ready;
+    std::atomic<bool> deterministic;    // Set from any task, also before crypto_init()
+    SemaphoreHandle_t mutex;
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d;
+    mbedtls_ecp_point Q;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+};
+
+static SignerContext signer = {};
+
+static DeviceIdentity identity;
+
+static void identity_build_id();
+static bool identity_build_public_key();
+
 // Helper functions
 static bool hex_string_to_bytes(const char* hex_string, uint8_t* bytes, size_t length) {
     if (strlen(hex_string) != length * 2) {
@@ -149,7 +177,7 @@ cleanup:
     return false;
 }
 
-bool Crypto::signMessage(const uint8_t* privateKey, const uint8_t* message, size_t messageLen, uint8_t* signature) {
+bool Crypto::signMessage(const uint8_t* privateKey, const uint8_t* message, size_t messageLen, uint8_t* signature, bool deterministic) {
     // Use mbedtls for ECDSA signatures
     
     // Initialize mbedtls structures
@@ -194,7 +222,12 @@ bool Crypto::signMessage(const uint8_t* privateKey, const uint8_t* message, size
     mbedtls_sha256(message, messageLen, hash, 0);
     
     // Sign the hash
-    ret = mbedtls_ecdsa_sign(&ecdsa.grp, &r, &s, &d, hash, 32, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (deterministic) {
+        // The random generator is only used for blinding, the result does not depend on it
+        ret = mbedtls_ecdsa_sign_det_ext(&ecdsa.grp, &r, &s, &d, hash, 32, MBEDTLS_MD_SHA256, mbedtls_ctr_drbg_random, &ctr_drbg);
+    } else {
+        ret = mbedtls_ecdsa_sign(&ecdsa.grp, &r, &s, &d, hash, 32, mbedtls_ctr_drbg_random, &ctr_drbg);
+    }
     if (ret != 0) {
         LOG_E(TAG, "Failed to sign message");
         goto cleanup;
@@ -254,70 +287,194 @@ zap::Str crypto_get_public_key(const char* private_key_hex) {
     return zap::Str(hex_result);
 }
 
-zap::Str crypto_create_jwt(const char* header, const char* payload, const char* private_key_hex) {
+static void signer_free() {
+    mbedtls_ecp_point_free(&signer.Q);
+    mbedtls_mpi_free(&signer.d);
+    mbedtls_ecp_group_free(&signer.grp);
+    mbedtls_ctr_drbg_free(&signer.ctr_drbg);
+    mbedtls_entropy_free(&signer.entropy);
+    signer.ready = false;
+}
+
+bool crypto_init(const char* private_key_hex) {
     uint8_t privateKey[32];
     if (!hex_string_to_bytes(private_key_hex, privateKey, 32)) {
-        return zap::Str();
+        LOG_E(TAG, "Failed to convert private key hex to bytes");
+        return false;
     }
-    
+
+    if (signer.mutex == nullptr) {
+        signer.mutex = xSemaphoreCreateMutex();
+        if (signer.mutex == nullptr) {
+            LOG_E(TAG, "Failed to create signer mutex");
+            return false;
+        }
+    }
+
+    xSemaphoreTake(signer.mutex, portMAX_DELAY);
+
+    if (signer.ready) {
+        signer_free();
+    }
+
+    if (identity.id.isEmpty()) {
+        identity_build_id();
+    }
+
+    mbedtls_entropy_init(&signer.entropy);
+    mbedtls_ctr_drbg_init(&signer.ctr_drbg);
+    mbedtls_ecp_group_init(&signer.grp);
+    mbedtls_mpi_init(&signer.d);
+    mbedtls_ecp_point_init(&signer.Q);
+
+    const char *pers = "ecdsa_sign";
+    int ret = mbedtls_ctr_drbg_seed(&signer.ctr_drbg, mbedtls_entropy_func, &signer.entropy, (const unsigned char *)pers, strlen(pers));
+    if (ret != 0) {
+        LOG_E(TAG, "Failed to seed random number generator");
+    }
+
+    if (ret == 0) {
+        mbedtls_ctr_drbg_set_reseed_interval(&signer.ctr_drbg, SIGNER_RESEED_INTERVAL);
+        ret = mbedtls_ecp_group_load(&signer.grp, MBEDTLS_ECP_DP_SECP256R1);
+        if (ret != 0) {
+            LOG_E(TAG, "Failed to load ECP group");
+        }
+    }
+
+    if (ret == 0) {
+        ret = mbedtls_mpi_read_binary(&signer.d, privateKey, 32);
+        if (ret == 0) {
+            ret = mbedtls_ecp_check_privkey(&signer.grp, &signer.d);
+        }
+        if (ret != 0) {
+            LOG_E(TAG, "Failed to import private key");
+        }
+    }
+
+    if (ret == 0) {
+        // Also builds the comb table for the generator so the first signature is not slower
+        ret = mbedtls_ecp_mul(&signer.grp, &signer.Q, &signer.d, &signer.grp.G, mbedtls_ctr_drbg_random, &signer.ctr_drbg);
+        if (ret != 0) {
+            LOG_E(TAG, "Failed to derive public key");
+        }
+    }
+
+    mbedtls_platform_zeroize(privateKey, sizeof(privateKey));
+
+    if (ret == 0 && !identity_build_public_key()) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        signer.ready = true;
+    } else {
+        signer_free();
+    }
+
+    xSemaphoreGive(signer.mutex);
+    return signer.ready;
+}
+
+void crypto_set_deterministic_signing(bool enabled) {
+    signer.deterministic.store(enabled);
+}
+
+// Sign a message with the device key, signature is r and s, 32 bytes each
+static bool signer_sign(const uint8_t* message, size_t messageLen, uint8_t* signature) {
+    if (signer.mutex == nullptr) {
+        LOG_E(TAG, "Signer not initialized");
+        return false;
+    }
+
+    unsigned char hash[32];
+    mbedtls_sha256(message, messageLen, hash, 0);
+
+    mbedtls_mpi r, s;
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+
+    xSemaphoreTake(signer.mutex, portMAX_DELAY);
+
+    int ret = -1;
+    if (!signer.ready) {
+        LOG_E(TAG, "Signer not initialized");
+    } else {
+        if (signer.deterministic.load()) {
+            ret = mbedtls_ecdsa_sign_det_ext(&signer.grp, &r, &s, &signer.d, hash, 32, MBEDTLS_MD_SHA256, mbedtls_ctr_drbg_random, &signer.ctr_drbg);
+        } else {
+            ret = mbedtls_ecdsa_sign(&signer.grp, &r, &s, &signer.d, hash, 32, mbedtls_ctr_drbg_random, &signer.ctr_drbg);
+        }
+        if (ret != 0) {
+            LOG_E(TAG, "Failed to sign message");
+        }
+    }
+
+    xSemaphoreGive(signer.mutex);
+
+    if (ret == 0) {
+        ret = mbedtls_mpi_write_binary(&r, signature, 32);
+    }
+    if (ret == 0) {
+        ret = mbedtls_mpi_write_binary(&s, signature + 32, 32);
+    }
+
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+
+    return ret == 0;
+}
+
+zap::Str crypto_create_jwt(const char* header, const char* payload) {
+    return crypto_create_jwt(header, payload, strlen(payload));
+}
+
+zap::Str crypto_create_jwt(const char* header, const char* payload, size_t payloadLength) {
     // Create the JWT parts
     zap::Str encodedHeader = base64url_encode(header, strlen(header));
-    zap::Str encodedPayload = base64url_encode(payload, strlen(payload));
+    zap::Str encodedPayload = base64url_encode(payload, payloadLength);
     zap::Str signatureInput = encodedHeader + "." + encodedPayload;
     
     // Create signature
-    uint8_t signature[64];  // Changed to 64 bytes
-    if (!Crypto::signMessage(privateKey, (const uint8_t*)signatureInput.c_str(), signatureInput.length(), signature)) {
+    uint8_t signature[64];
+    if (!signer_sign((const uint8_t*)signatureInput.c_str(), signatureInput.length(), signature)) {
         return zap::Str();
     }
     
     // Encode signature
-    zap::Str encodedSignature = base64url_encode((const char*)signature, 64);  // Changed to 64 bytes
+    zap::Str encodedSignature = base64url_encode((const char*)signature, 64);
     
     // Combine all parts
-    return encodedHeader + "." + encodedPayload + "." + encodedSignature;
+    return signatureInput + "." + encodedSignature;
 }
 
-zap::Str crypto_create_signature_base64url(const char* data, const char* private_key_hex) {
-    uint8_t privateKey[32];
-    if (!hex_string_to_bytes(private_key_hex, privateKey, 32)) {
-        return zap::Str();
-    }
-    
-    uint8_t signature[64];  // Changed to 64 bytes
-    if (!Crypto::signMessage(privateKey, (const uint8_t*)data, strlen(data), signature)) {
-        return zap::Str();
-    }
-    
-    return base64url_encode((const char*)signature, 64);  // Changed to 64 bytes
+zap::Str crypto_create_signature_base64url(const char* data) {
+    return crypto_create_signature_base64url((const uint8_t*)data, strlen(data));
 }
 
-zap::Str crypto_create_signature_hex(const char* data, const char* private_key_hex) {
-    uint8_t privateKey[32];
-    if (!hex_string_to_bytes(private_key_hex, privateKey, 32)) {
+zap::Str crypto_create_signature_base64url(const uint8_t* data, size_t length) {
+    uint8_t signature[64];
+    if (!signer_sign(data, length, signature)) {
         return zap::Str();
     }
     
-    uint8_t signature[64];  // Changed to 64 bytes
-    if (!Crypto::signMessage(privateKey, (const uint8_t*)data, strlen(data), signature)) {
+    return base64url_encode((const char*)signature, 64);
+}
+
+zap::Str crypto_create_signature_hex(const char* data) {
+    uint8_t signature[64];
+    if (!signer_sign((const uint8_t*)data, strlen(data), signature)) {
         return zap::Str();
     }
     
-    char hex_result[129];  // Changed to 129 to accommodate 64 bytes (128 hex chars + null terminator)
-    bytes_to_hex_string(signature, 64, hex_result);  // Changed to 64 bytes
+    char hex_result[129];  // 64 bytes as 128 hex chars + null terminator
+    bytes_to_hex_string(signature, 64, hex_result);
     return zap::Str(hex_result);
 } 
 
 
-zap::Str crypto_create_signature_der_hex(const char* data, const char* private_key_hex) {
+zap::Str crypto_create_signature_der_hex(const char* data) {
     uint8_t signature[64];
-
-    uint8_t privateKey[32];
-    if (!hex_string_to_bytes(private_key_hex, privateKey, 32)) {
-        return zap::Str();
-    }
-    
-    if (!Crypto::signMessage(privateKey, (const uint8_t*)data, strlen(data), signature)) {
+    if (!signer_sign((const uint8_t*)data, strlen(data), signature)) {
         return zap::Str();
     }
 
@@ -327,7 +484,7 @@ zap::Str crypto_create_signature_der_hex(const char* data, const char* private_k
         return zap::Str();
     }
 
-    char der_hex[der_len * 2];
+    char der_hex[der_len * 2 + 1];
     bytes_to_hex_string(der, der_len, der_hex);
     return zap::Str(der_hex);
 }
@@ -373,28 +530,47 @@ static int crypto_convert_to_der(const uint8_t *signature, uint8_t *der, size_t
     return 1;
 } 
 
-zap::Str crypto_getId() {
-  // Debug flag
+static void identity_build_id() {
   uint64_t chipId = ESP.getEfuseMac();
   
   // Convert 64-bit chipId to 16 hex characters
-  char serial[17]; // 16 hex chars + null terminator
+  char id[4 + 16 + 1] = "zap-";
+  static const char hexDigits[] = "0123456789abcdef"; // lowercase for consistency
   for (int i = 0; i < 8; i++) {
     uint8_t byte = (chipId >> ((7-i) * 8)) & 0xFF;
-    char hexDigits[] = "0123456789abcdef"; // lowercase for consistency
-    serial[i*2] = hexDigits[(byte >> 4) & 0xF];
-    serial[i*2+1] = hexDigits[byte & 0xF];
+    id[4 + i*2] = hexDigits[(byte >> 4) & 0xF];
+    id[4 + i*2+1] = hexDigits[byte & 0xF];
   }
-  serial[16] = '\0';
+  id[20] = '\0';
   
-  zap::Str id = "zap-" + zap::Str(serial);
-  
-  while (id.length() < 18) {
-    // Pad with 'e' if shorter
-    id += 'e';
+  identity.id = id;
+  identity.jwtHeaderPrefix = zap::Str("{\"alg\":\"ES256\",\"typ\":\"JWT\",\"device\":\"") + identity.id + "\"";
+}
+
+// Called by crypto_init() with the signer mutex held
+static bool identity_build_public_key() {
+  if (mbedtls_mpi_write_binary(&signer.Q.X, identity.publicKey, 32) != 0 ||
+      mbedtls_mpi_write_binary(&signer.Q.Y, identity.publicKey + 32, 32) != 0) {
+    LOG_E(TAG, "Failed to export public key");
+    return false;
   }
-  
-  return id;
+
+  char hex_result[129];
+  bytes_to_hex_string(identity.publicKey, 64, hex_result);
+  identity.publicKeyHex = hex_result;
+  identity.publicKeyBase64Url = base64url_encode((const char*)identity.publicKey, 64);
+  return true;
+}
+
+const DeviceIdentity& crypto_get_identity() {
+  if (identity.id.isEmpty()) {
+    identity_build_id();
+  }
+  return identity;
+}
+
+const zap::Str& crypto_getId() {
+  return crypto_get_identity().id;
 }
 
 bool crypto_create_private_key(uint8_t* privateKey) {
@@ -10,7 +10,8 @@ class Crypto {
 public:
     static bool generateKeyPair(uint8_t* privateKey, uint8_t* publicKey);
     static bool verifySignature(const uint8_t* publicKey, const uint8_t* message, size_t messageLen, const uint8_t* signature);
-    static bool signMessage(const uint8_t* privateKey, const uint8_t* message, size_t messageLen, uint8_t* signature);
+    // With deterministic set the nonce is derived from key and message as in RFC 6979, so equal input gives equal signatures
+    static bool signMessage(const uint8_t* privateKey, const uint8_t* message, size_t messageLen, uint8_t* signature, bool deterministic = false);
 };
 
 
@@ -18,15 +19,40 @@ void bytes_to_hex_string(const uint8_t* bytes, size_t length, char* hex_string);
 
 bool crypto_create_private_key(uint8_t* privateKey);    // this need to be 32 bytes
 
+// Set up the device signer with the given key, must be called once at boot before any crypto_create_* function.
+// The parsed key, curve and seeded random generator are kept for the lifetime of the device.
+bool crypto_init(const char* private_key_hex);
+
+// Use RFC 6979 deterministic nonces in the crypto_create_* functions. Signatures are then reproducible
+// and signing does not draw from the random generator for the nonce. Off by default.
+void crypto_set_deterministic_signing(bool enabled);
+
 // Legacy functions for backward compatibility
 zap::Str crypto_get_public_key(const char* private_key_hex);
-zap::Str crypto_create_jwt(const char* header, const char* payload, const char* private_key_hex);
-zap::Str crypto_create_signature_base64url(const char* data, const char* private_key_hex);
+
+// The crypto_create_* functions sign with the key given to crypto_init() and are safe to call from any task
+zap::Str crypto_create_jwt(const char* header, const char* payload);
+zap::Str crypto_create_jwt(const char* header, const char* payload, size_t payloadLength);   // For binary payloads such as compressed data
+zap::Str crypto_create_signature_base64url(const char* data);
+zap::Str crypto_create_signature_base64url(const uint8_t* data, size_t length);   // For binary data such as a MerkleTree root
 
 // Create a signature and return it as hex string
-zap::Str crypto_create_signature_hex(const char* data, const char* private_key_hex);
+zap::Str crypto_create_signature_hex(const char* data);
 
 // Create a signature and return it as DER string in hex format
-zap::Str crypto_create_signature_der_hex(const char* data, const char* private_key_hex);
+zap::Str crypto_create_signature_der_hex(const char* data);
+
+// Identity of this device. The id is derived from the chip, the rest is filled in by crypto_init()
+// and none of it changes after that.
+struct DeviceIdentity {
+    zap::Str id;                    // "zap-" followed by the chip id in hex
+    uint8_t publicKey[64];          // Raw X and Y coordinates
+    zap::Str publicKeyHex;
+    zap::Str publicKeyBase64Url;
+    zap::Str jwtHeaderPrefix;       // {"alg":"ES256","typ":"JWT","device":"<id>" without the closing brace
+};
+
+const DeviceIdentity& crypto_get_identity();
 
-zap::Str crypto_getId();
\ No newline at end of file
+// Same as crypto_get_identity().id
+const zap::Str& crypto_getId();
\ No newline at end of file
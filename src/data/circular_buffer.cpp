@@ -1,4 +1,7 @@
 #include "circular_buffer.h"
+#include "metrics.h"
+
+static Counter overflowBytes("zap_meter_buffer_overflow_bytes_total", "Meter bytes lost to a full buffer");
 
 CircularBuffer::CircularBuffer(size_t bufferSize)
     : _bufferSize(bufferSize),
@@ -40,6 +43,7 @@ bool CircularBuffer::addByte(uint8_t byte, unsigned long currentTime) {
         // Buffer full, move read index to keep space
         _readIndex = (_readIndex + 1) % _bufferSize;
         _overflowCount++;
+        overflowBytes.increment();
     }
     
     return true;
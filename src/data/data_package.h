@@ -4,10 +4,8 @@
 // Maximum data size (adjust as needed)
 #define MAX_DATA_SIZE (512 * 3) // typical payload size is 1000 bytes
 
-// Define a struct for the data package using char arrays instead of Strings
-typedef struct {
-    char data[MAX_DATA_SIZE];  // Generic data array (can store JWT or any other data)
-    unsigned long timestamp;   // Timestamp when the data was created
-} DataPackage;
+// Size of the ring shared between the reader and the sender, must be a power of two.
+// Holds about three typical payloads, the same as the queue it replaced.
+#define DATA_RING_SIZE (4096)
 
 #endif // DATA_PACKAGE_H
\ No newline at end of file
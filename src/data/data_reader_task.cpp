@@ -3,21 +3,28 @@
 #include "decoding/ascii_decoder.h"
 #include "p1data_funcs.h"
 #include "debug.h"
+#include "metrics.h"
 #include "../zap_log.h" // Added for logging
 
 // Define TAG for logging
 static constexpr LogTag TAG = LogTag("data_reader_task", ZLOG_LEVEL_INFO);
 
+static const uint32_t DECODE_BUCKETS_US[] = {500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+static Histogram decodeTime("zap_meter_decode_microseconds", "Time to decode a meter frame",
+                            DECODE_BUCKETS_US, sizeof(DECODE_BUCKETS_US) / sizeof(DECODE_BUCKETS_US[0]));
+static Counter readingsDropped("zap_readings_dropped_total", "Queued readings dropped for newer ones");
+static Counter readingsRejected("zap_readings_rejected_total", "Readings that found no room in the queue");
+
 DataReaderTask::DataReaderTask(uint32_t stackSize, UBaseType_t priority) 
     : taskHandle(nullptr), stackSize(stackSize), priority(priority), shouldRun(false),
-      p1DataQueue(nullptr), readInterval(10000), lastReadTime(0), baudRateIx(0) {
+      dataRing(nullptr), uploadController(nullptr), readInterval(10000), lastReadTime(0), baudRateIx(0) {
 }
 
 DataReaderTask::~DataReaderTask() {
     stop();
 }
 
-void DataReaderTask::begin(QueueHandle_t dataQueue) {
+void DataReaderTask::begin(SpscRing* dataRing, const UploadController* uploadController) {
     if (taskHandle != nullptr) {
         return; // Task already running
     }
@@ -32,7 +39,8 @@ void DataReaderTask::begin(QueueHandle_t dataQueue) {
     }
 
     LOG_TI(TAG, "P1 meter initialized with baud rate %d", p1Meter.getConfig(baudRateIx).baudRate);
-    this->p1DataQueue = dataQueue;
+    this->dataRing = dataRing;
+    this->uploadController = uploadController;
     shouldRun = true;
     xTaskCreatePinnedToCore(
         taskFunction,
@@ -66,36 +74,48 @@ void DataReaderTask::setInterval(uint32_t interval) {
 }
 
 void DataReaderTask::enqueueData(const P1Data& p1data) {
-    if (p1DataQueue != nullptr) {
-        // Create a data package with char array, this is ok as the xQueueSendToBack function will copy the data
-        DataPackage package;
-        
-        // Clear the data buffer first
-        
-        // Check if the JWT was created successfully
-        if (createP1JWTPayload(p1data, package.data, MAX_DATA_SIZE)) {
-            LOG_TE(TAG, "Failed to create JWT");
-            return;
-        }
-        // Copy the JWT to the data object
-        package.timestamp = millis();
-        if (uxQueueSpacesAvailable(p1DataQueue) == 0) {
-            // Queue is full, remove the oldest item first
-            DataPackage oldPackage;
-            xQueueReceive(p1DataQueue, &oldPackage, 0);
-            LOG_TW(TAG, "Queue full, removed oldest item");
-        }
-        
-        // Add the new package to the back (FIFO behavior)
-        BaseType_t result = xQueueSendToBack(p1DataQueue, &package, pdMS_TO_TICKS(100));
-        if (result == pdPASS) {
-            LOG_TD(TAG, "Added data package to queue");
-        } else {
-            LOG_TE(TAG, "Failed to add data package to queue");
-        }            
+    if (dataRing == nullptr) {
+        return;
+    }
+
+    const uint32_t droppedBefore = dataRing->getDroppedCount();
+
+    // Reserve room for the largest payload and build it directly in the ring, no copies
+    char* payload = reinterpret_cast<char*>(dataRing->reserve(MAX_DATA_SIZE));
+    if (payload == nullptr) {
+        readingsRejected.increment();
+        LOG_TE(TAG, "Data ring full, reading rejected");
+        return;
+    }
+    if (dataRing->getDroppedCount() != droppedBefore) {
+        readingsDropped.increment(dataRing->getDroppedCount() - droppedBefore);
+        LOG_TW(TAG, "Data ring full, dropped %d oldest item(s)", dataRing->getDroppedCount() - droppedBefore);
+    }
+
+    if (createP1JWTPayload(p1data, payload, MAX_DATA_SIZE)) {
+        // The reservation is simply never committed
+        LOG_TE(TAG, "Failed to create JWT");
+        return;
+    }
+
+    // Keep the terminator so the sender can use the record as a C string
+    if (dataRing->commit(strlen(payload) + 1)) {
+        LOG_TD(TAG, "Added data package to ring");
+    } else {
+        LOG_TE(TAG, "Failed to add data package to ring");
     }
 }
 
+void DataReaderTask::publishEvent(const P1Data& p1data) {
+    // Serialised once here, every live subscriber is sent the same bytes
+    char* event = readingEvents.beginEvent();
+    const size_t length = createP1Event(p1data, event, EventStream::MAX_EVENT_SIZE);
+    if (length == 0) {
+        LOG_TW(TAG, "Reading too large for a live event");
+    }
+    readingEvents.publish(length);
+}
+
 // New method to handle complete frames received from P1Meter
 void DataReaderTask::handleFrame(const IFrameData& frame) {
     
@@ -114,8 +134,10 @@ void DataReaderTask::handleFrame(const IFrameData& frame) {
     // Decode the frame
     DLMSDecoder decoder;
     AsciiDecoder asciiDecoder;
-    P1Data p1data;
+    P1Data& p1data = lastDecodedData.beginWrite();
+    p1data.clear();
     bool isDecoded = false;
+    const unsigned long decodeStart = micros();
 
     switch (frame.getFrameTypeId()) {
         case IFrameData::Type::FRAME_TYPE_HDLC:
@@ -142,16 +164,30 @@ void DataReaderTask::handleFrame(const IFrameData& frame) {
             break;
     }
 
+    decodeTime.observe(micros() - decodeStart);
     LOG_TI(TAG, "Frame decoded %s", isDecoded ? "true" : "false");
     
     if (isDecoded) {
         Debug::addFrame();
         lastReadTime = millis();
         p1data.setTimeStamp();
-        enqueueData(p1data);
+        publishEvent(p1data);
+
+        // On a poor link several frames are averaged into one reading
+        const uint8_t downsample = uploadController != nullptr ? uploadController->getDownsample() : 1;
+        if (downsample <= 1 && aggregator.isEmpty()) {
+            enqueueData(p1data);
+        } else {
+            aggregator.add(p1data);
+            if (aggregator.getCount() >= downsample) {
+                enqueueData(aggregator.finish());
+                aggregator.reset();
+            }
+        }
         
-        lastDecodedData = p1data; // Store the last decoded data for potential future use
+        lastDecodedData.publish(); // Make the data visible to the endpoints
     } else {
+        lastDecodedData.abortWrite();
         Debug::addFailedFrame();
         Debug::clearFaultyFrameData();
         for (size_t i = 0; i < frameSize; i++) {
@@ -5,13 +5,17 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
 #include "../zap_str.h"
 
 #include "decoding/p1data.h" // Local include since p1data is now in the data directory
 #include "../crypto.h"
 #include "../config.h"
 #include "data_package.h"  // Include the new data package header
+#include "spsc_ring.h"
+#include "snapshot_buffer.h"
+#include "event_stream.h"
+#include "reading_aggregator.h"
+#include "../backend/upload_controller.h"
 
 #include "p1_meter.h"  // Include P1Meter class for reading data
 #include "decoding/IFrameData.h"  // Include IFrameData interface for frame data handling
@@ -21,16 +25,25 @@ public:
     explicit DataReaderTask(uint32_t stackSize = 1024 * 10, UBaseType_t priority = 4);
     ~DataReaderTask();
     
-    void begin(QueueHandle_t dataQueue);
+    void begin(SpscRing* dataRing, const UploadController* uploadController = nullptr);
     void stop();
     
     // Set the interval for reading data (in milliseconds)
     void setInterval(uint32_t interval);
 
-    const P1Data& getLastDecodedData() const {
-        return lastDecodedData;  // Return the last decoded P1 data
+    // Copy the last decoded P1 data, safe to call from any task
+    uint32_t readLastDecodedData(P1Data& out) const {
+        return lastDecodedData.read(out);
     }
 
+    // Goes up with every decoded reading
+    uint32_t getLastDecodedVersion() const {
+        return lastDecodedData.getVersion();
+    }
+
+    // Every decoded reading as a server-sent event, for the live endpoint
+    EventStream& getEventStream() { return readingEvents; }
+
 
     
 private:
@@ -38,6 +51,7 @@ private:
     static void taskFunction(void* parameter);
     zap::Str generateP1JWT();
     void enqueueData(const P1Data& p1data);
+    void publishEvent(const P1Data& p1data);
     
     // Handle a complete frame from P1 meter
     void handleFrame(const IFrameData& frame);
@@ -47,13 +61,16 @@ private:
     UBaseType_t priority;
     bool shouldRun;
     
-    QueueHandle_t p1DataQueue;
+    SpscRing* dataRing;    // Shared with the DataSenderTask, we are the producer
+    const UploadController* uploadController;  // Tells how many frames go into one reading
+    ReadingAggregator aggregator;
     uint32_t readInterval;
 
     unsigned long lastReadTime;
     unsigned char baudRateIx;
 
-    P1Data lastDecodedData;  // Store the last decoded P1 data
+    SnapshotBuffer<P1Data> lastDecodedData;  // Decoded into in place, published to other tasks
+    EventStream readingEvents;  // Live readings for the web server
 
     P1Meter p1Meter;  // Pointer to the P1Meter instance for reading data
 };
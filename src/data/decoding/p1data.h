@@ -26,14 +26,20 @@ public:
     void setTimeStamp();
 
     // Constructor
-    P1Data() :
-        obisStringCount(0) {
-            szDeviceId[0] = '\0';
-            szMeterModel[0] = '\0';
-            for (int i = 0; i < MAX_OBIS_STRINGS; ++i) {
-                obisStrings[i][0] = '\0';
-            }
+    P1Data() {
+        clear();
+    }
+
+    // Reset to the freshly constructed state, used when a buffer is reused for decoding
+    void clear() {
+        obisStringCount = 0;
+        szDeviceId[0] = '\0';
+        szMeterModel[0] = '\0';
+        for (int i = 0; i < MAX_OBIS_STRINGS; ++i) {
+            obisStrings[i][0] = '\0';
         }
+        timestamp = 0;
+    }
 
     // Method to add OBIS string based on components
     bool addObisString(uint8_t obis_c, uint8_t obis_d, float value, const char* unit) {
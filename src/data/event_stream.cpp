@@ -0,0 +1,159 @@
+#include "event_stream.h"
+#include <cstring>
+
+EventStream::EventStream() : head(0), listener(nullptr), isWriting(false), stats() {
+    for (Slot& slot : slots) {
+        slot.seq.store(0, std::memory_order_relaxed);
+        slot.number.store(0, std::memory_order_relaxed);
+        slot.length.store(0, std::memory_order_relaxed);
+    }
+    for (Subscriber& subscriber : subscribers) {
+        subscriber.active = false;
+        subscriber.next = 0;
+        subscriber.offset = 0;
+        subscriber.length = 0;
+    }
+}
+
+char* EventStream::beginEvent() {
+    const uint32_t number = head.load(std::memory_order_relaxed);
+    Slot& slot = slots[number % SLOTS];
+    if (!isWriting) {
+        // Odd sequence marks the slot as being written, subscribers copying from it notice
+        slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        isWriting = true;
+    }
+    return slot.data;
+}
+
+void EventStream::publish(size_t length) {
+    if (!isWriting) {
+        return;
+    }
+    isWriting = false;
+
+    const uint32_t number = head.load(std::memory_order_relaxed);
+    Slot& slot = slots[number % SLOTS];
+    const bool valid = length > 0 && length <= MAX_EVENT_SIZE;
+    if (length > MAX_EVENT_SIZE) {
+        stats.rejected++;
+    }
+    // A given up event may have written over the one the slot held, an empty slot is never sent
+    slot.number.store(number, std::memory_order_relaxed);
+    slot.length.store(valid ? (uint32_t)length : 0, std::memory_order_relaxed);
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (!valid) {
+        return;
+    }
+
+    head.store(number + 1, std::memory_order_release);
+    stats.published++;
+
+    Listener* current = listener.load(std::memory_order_acquire);
+    if (current != nullptr) {
+        current->onPublish();
+    }
+}
+
+int EventStream::subscribe() {
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        Subscriber& subscriber = subscribers[i];
+        if (!subscriber.active) {
+            // The latest event goes out right away, a new client should not wait for the next one
+            const uint32_t published = head.load(std::memory_order_acquire);
+            subscriber.active = true;
+            subscriber.next = published > 0 ? published - 1 : 0;
+            subscriber.offset = 0;
+            subscriber.length = 0;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void EventStream::unsubscribe(int id) {
+    if (id >= 0 && (size_t)id < MAX_SUBSCRIBERS) {
+        subscribers[id].active = false;
+    }
+}
+
+size_t EventStream::getSubscriberCount() const {
+    size_t count = 0;
+    for (const Subscriber& subscriber : subscribers) {
+        if (subscriber.active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool EventStream::hasPending(int id) const {
+    if (id < 0 || (size_t)id >= MAX_SUBSCRIBERS || !subscribers[id].active) {
+        return false;
+    }
+    return head.load(std::memory_order_acquire) != subscribers[id].next;
+}
+
+int EventStream::peek(int id, char* out, size_t capacity) {
+    if (id < 0 || (size_t)id >= MAX_SUBSCRIBERS || !subscribers[id].active || capacity == 0) {
+        return 0;
+    }
+    Subscriber& subscriber = subscribers[id];
+
+    for (;;) {
+        const uint32_t published = head.load(std::memory_order_acquire);
+        const uint32_t behind = published - subscriber.next;
+        if (behind == 0) {
+            return 0;
+        }
+
+        if (behind > SLOTS) {
+            if (subscriber.offset > 0) {
+                stats.overruns++;
+                return OVERRUN;
+            }
+            stats.dropped += behind - SLOTS;
+            subscriber.next = published - SLOTS;
+        }
+
+        const Slot& slot = slots[subscriber.next % SLOTS];
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+            const uint32_t number = slot.number.load(std::memory_order_relaxed);
+            const size_t length = slot.length.load(std::memory_order_relaxed);
+            size_t copied = 0;
+            if (number == subscriber.next && length > subscriber.offset) {
+                copied = length - subscriber.offset < capacity ? length - subscriber.offset : capacity;
+                memcpy(out, slot.data + subscriber.offset, copied);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (copied > 0 && slot.seq.load(std::memory_order_relaxed) == seq) {
+                subscriber.length = length;
+                return (int)copied;
+            }
+        }
+
+        // The producer has written over the event
+        if (subscriber.offset > 0) {
+            stats.overruns++;
+            return OVERRUN;
+        }
+        stats.dropped++;
+        subscriber.next++;
+    }
+}
+
+void EventStream::consume(int id, size_t sent) {
+    if (id < 0 || (size_t)id >= MAX_SUBSCRIBERS || !subscribers[id].active) {
+        return;
+    }
+    Subscriber& subscriber = subscribers[id];
+    subscriber.offset += sent;
+    if (subscriber.offset >= subscriber.length) {
+        subscriber.next++;
+        subscriber.offset = 0;
+        subscriber.length = 0;
+        stats.delivered++;
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+/**
+ * @brief Fan-out of serialised events from one producer to a few subscribers
+ *
+ * The producer writes each event once, in place, into the next of SLOTS fixed slots.
+ * Subscribers do not get a copy. Each one keeps the number of the next event it has to
+ * send and how much of it went out already, and copies from the shared slot as its
+ * socket takes the bytes. The backlog of a subscriber is therefore bounded by SLOTS
+ * events. When it falls further behind, its oldest unsent events are dropped and
+ * counted. If the event it is halfway through gets overwritten, the stream of that
+ * subscriber can no longer be continued cleanly and peek() tells the caller to close it.
+ *
+ * Slots are guarded by sequence counters like SnapshotBuffer, so the producer never
+ * waits for a subscriber. Subscribe, peek and consume are for one consumer task only.
+ */
+class EventStream {
+public:
+    // A meter sends a frame every 1 to 10 s and the server sends it on within one poll, so a
+    // subscriber is behind by one event at most. The second slot takes the next event while
+    // the last one is still going out, and gives a stalled socket a frame interval to recover.
+    static const size_t SLOTS = 2;
+    // A full P1Data, 36 rows of 35 characters, comes to about 1.4 KB as an event. Meters
+    // send less, a 27 row DSMR frame is 748 bytes and an 11 row DLMS frame 323.
+    static const size_t MAX_EVENT_SIZE = 1536;
+    static const size_t MAX_SUBSCRIBERS = 3;
+    static const int OVERRUN = -1;
+
+    /**
+     * @brief Called by the producer after each publish, from the producer task
+     */
+    class Listener {
+        public:
+            virtual void onPublish() = 0;
+    };
+
+    struct Stats {
+        uint32_t published;
+        uint32_t rejected;      // Events that did not fit in MAX_EVENT_SIZE
+        uint32_t delivered;     // Events fully handed to a subscriber
+        uint32_t dropped;       // Events a subscriber fell too far behind to get
+        uint32_t overruns;      // Subscribers cut off halfway through an event
+    };
+
+    EventStream();
+
+    EventStream(const EventStream&) = delete;
+    EventStream& operator=(const EventStream&) = delete;
+
+    // --- Producer side ---
+
+    /** @brief MAX_EVENT_SIZE bytes to serialise the next event into */
+    char* beginEvent();
+
+    /** @brief Publishes the event from beginEvent(), a length of 0 gives it up */
+    void publish(size_t length);
+
+    void setListener(Listener* listener) { this->listener.store(listener, std::memory_order_release); }
+
+    // --- Consumer side ---
+
+    /** @brief Adds a subscriber that starts at the latest event, -1 when all are taken */
+    int subscribe();
+    void unsubscribe(int id);
+    size_t getSubscriberCount() const;
+
+    bool hasPending(int id) const;
+
+    /**
+     * @brief Copies the unsent part of the next event of a subscriber
+     *
+     * @return Bytes copied, 0 when there is nothing to send and OVERRUN when the subscriber
+     *         lost the event it was sending and has to be closed
+     */
+    int peek(int id, char* out, size_t capacity);
+
+    /** @brief Marks bytes from peek() as sent */
+    void consume(int id, size_t sent);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;      // Odd while the producer writes the slot
+        std::atomic<uint32_t> number;   // Event in the slot
+        std::atomic<uint32_t> length;
+        char data[MAX_EVENT_SIZE];
+    };
+
+    struct Subscriber {
+        bool active;
+        uint32_t next;      // Event to send
+        size_t offset;      // Bytes of it sent
+        size_t length;      // Its length as of the last peek
+    };
+
+    Slot slots[SLOTS];
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    std::atomic<uint32_t> head;     // Events published so far
+    std::atomic<Listener*> listener;
+    bool isWriting;
+    Stats stats;
+};
@@ -1,6 +1,9 @@
 #include "frame_detector.h"
 #include <vector>
 #include <cstdint>
+#include "metrics.h"
+
+static Counter framesDetected("zap_meter_frames_detected_total", "Complete frames found in the meter data");
 
 FrameDetector::FrameDetector(
     const std::vector<FrameDelimiterInfo>& delimiterConfigs,
@@ -102,6 +105,7 @@ bool FrameDetector::extractCompleteFrame(const CircularBuffer& buffer, FrameInfo
                 _activeDelimiterInfo = nullptr;
                 
                 _frameCount++;
+                framesDetected.increment();
                 
                 return true;
             }
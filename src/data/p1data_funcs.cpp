@@ -2,43 +2,28 @@
 #include "json_light/json_light.h"
 #include "crypto.h"
 #include "config.h"
+#include <sys/time.h>
 
 
 
 bool createP1JWTPayload(const P1Data& p1data, char* outBuffer, size_t outBufferSize) {
     
     
-    // we get the unitx time in ms from the system clock
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    zap::Str timestampStr(p1data.timestamp); // Assuming timestamp is already in milliseconds
+    // TODO: this is somewhat redundant as we get the timestamp in obis format (esp for ascii)
+    // but we also need it in msek for the jwt format
+    // The timestamp in milliseconds is the key of the nested object
+    char timestampKey[zap::JsonNumberFormat::MAX_LENGTH + 1];
+    timestampKey[zap::JsonNumberFormat::format(p1data.timestamp, timestampKey)] = '\0';
     
     // Start the payload object
     JsonBuilderFixed payload(outBuffer, outBufferSize);
     payload.beginObject();
-    
-    // Create a nested object for the timestamp
-    JsonBuilder dataObj;
-    payload.beginObject(timestampStr.c_str());
+    payload.beginObject(timestampKey);
 
     payload.add("serial_number", METER_SN);
 
-    // Use a vector of Str instead of an array of C-style strings
-    std::vector<zap::Str> rows;
-
-    // Iterate through the obisStrings array
-    for (int i = 0; i < p1data.obisStringCount; i++) {
-        // Directly add the string from the obisStrings array
-        rows.push_back(zap::Str(p1data.obisStrings[i]));
-    }
-    
-    // Format timestamp
-    // TODO: this is somewhat redundant as we get the timestamp in obis format (esp for ascii)
-    // but we also need it in msek for the jwt format
-    // This is not needed anymore and should be moved to the binary decoder and just added as the obis string
-    
-    // Add the rows to the data object
-    payload.addArray("rows", rows);
+    // The rows straight from the obis strings, nothing is copied to the heap
+    payload.addArray("rows", (const char*)p1data.obisStrings, p1data.obisStringCount, P1Data::MAX_OBIS_STRING_LEN);
     
     // TODO: Calculate checksum idk if this is really needed
     payload.add("checksum", "DEAD");
@@ -50,3 +35,27 @@ bool createP1JWTPayload(const P1Data& p1data, char* outBuffer, size_t outBufferS
     return payload.hasOverflow();
 }
 
+
+size_t createP1Event(const P1Data& p1data, char* outBuffer, size_t outBufferSize) {
+    static const char PREFIX[] = "data: ";
+    static const size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+    // The JSON is built behind the prefix with room left for the two line feeds
+    if (outBufferSize < PREFIX_LENGTH + 3) {
+        return 0;
+    }
+    memcpy(outBuffer, PREFIX, PREFIX_LENGTH);
+
+    JsonBuilderFixed json(outBuffer + PREFIX_LENGTH, outBufferSize - PREFIX_LENGTH - 2);
+    json.beginObject()
+        .add("ts", p1data.timestamp)
+        .addArray("data", (const char*)p1data.obisStrings, p1data.obisStringCount, P1Data::MAX_OBIS_STRING_LEN);
+    json.end();
+    if (json.hasOverflow()) {
+        return 0;
+    }
+
+    size_t length = PREFIX_LENGTH + json.length();
+    outBuffer[length++] = '\n';
+    outBuffer[length++] = '\n';
+    return length;
+}
@@ -3,4 +3,8 @@
 #include "decoding/p1data.h"
 
 // function to parse the p1 data into a json jwt payload string.
-bool createP1JWTPayload(const P1Data& p1data, char* outBuffer, size_t outBufferSize);
\ No newline at end of file
+bool createP1JWTPayload(const P1Data& p1data, char* outBuffer, size_t outBufferSize);
+
+// Writes the reading as one server-sent event, "data: <json>" and a blank line.
+// Returns the length of the event or 0 when it does not fit.
+size_t createP1Event(const P1Data& p1data, char* outBuffer, size_t outBufferSize);
@@ -0,0 +1,126 @@
+#include "reading_aggregator.h"
+#include <cstdlib>
+
+// Value groups C of the electricity rows that are averaged: total and per phase power (1, 2, 21, 22, 41, 42,
+// 61, 62), current (31, 51, 71) and voltage (32, 52, 72). Other rows with D = 7 are counters, such as the
+// power failures in 0-0:96.7.21 and 0-0:96.7.9.
+static bool isAveraged(long c) {
+    switch (c) {
+        case 1: case 2:
+        case 21: case 22: case 41: case 42: case 61: case 62:
+        case 31: case 51: case 71:
+        case 32: case 52: case 72:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Find the value of an instantaneous power, current or voltage row "1-B:C.7.E(value*unit)", false for any other row
+static bool parseInstantaneous(const char* row, size_t& codeLength, float& value) {
+    const char* open = strchr(row, '(');
+    const char* colon = strchr(row, ':');
+    if (open == nullptr || colon == nullptr || colon > open) {
+        return false;
+    }
+
+    // Medium A is electricity
+    char* end;
+    if (strtol(row, &end, 10) != 1 || *end != '-') {
+        return false;
+    }
+
+    // Value group C and D of C.D.E
+    const long c = strtol(colon + 1, &end, 10);
+    if (end == colon + 1 || end > open || end[0] != '.' || end[1] != '7' || end[2] != '.' || !isAveraged(c)) {
+        return false;
+    }
+
+    value = strtof(open + 1, &end);
+    if (end == open + 1 || (*end != '*' && *end != ')')) {
+        return false;
+    }
+    codeLength = open - row;
+    return true;
+}
+
+ReadingAggregator::ReadingAggregator() : _count(0) {
+    reset();
+}
+
+void ReadingAggregator::reset() {
+    _count = 0;
+    for (size_t i = 0; i < P1Data::MAX_OBIS_STRINGS; i++) {
+        _sums[i].code[0] = '\0';
+    }
+}
+
+ReadingAggregator::Sum* ReadingAggregator::sumFor(const char* code, size_t length) {
+    if (length >= CODE_LENGTH) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < P1Data::MAX_OBIS_STRINGS; i++) {
+        Sum& sum = _sums[i];
+        if (sum.code[0] == '\0') {
+            memcpy(sum.code, code, length);
+            sum.code[length] = '\0';
+            sum.sum = 0;
+            sum.count = 0;
+            return &sum;
+        }
+        if (strncmp(sum.code, code, length) == 0 && sum.code[length] == '\0') {
+            return &sum;
+        }
+    }
+    return nullptr;
+}
+
+void ReadingAggregator::add(const P1Data& frame) {
+    for (uint8_t i = 0; i < frame.obisStringCount; i++) {
+        size_t codeLength;
+        float value;
+        if (!parseInstantaneous(frame.obisStrings[i], codeLength, value)) {
+            continue;
+        }
+        Sum* sum = sumFor(frame.obisStrings[i], codeLength);
+        if (sum != nullptr) {
+            sum->sum += value;
+            sum->count++;
+        }
+    }
+
+    _latest = frame;
+    _count++;
+}
+
+const P1Data& ReadingAggregator::finish() {
+    for (uint8_t i = 0; i < _latest.obisStringCount; i++) {
+        char* row = _latest.obisStrings[i];
+        size_t codeLength;
+        float value;
+        if (!parseInstantaneous(row, codeLength, value)) {
+            continue;
+        }
+        const Sum* sum = sumFor(row, codeLength);
+        if (sum == nullptr || sum->count < 2) {
+            continue;
+        }
+
+        // Keep the meter's number of decimals and the unit
+        const char* valueStart = row + codeLength + 1;
+        const char* point = strchr(valueStart, '.');
+        const size_t valueLength = strcspn(valueStart, "*)");
+        int decimals = 0;
+        if (point != nullptr && point < valueStart + valueLength) {
+            decimals = (int)(valueStart + valueLength - point - 1);
+        }
+
+        char suffix[P1Data::MAX_OBIS_STRING_LEN];
+        strncpy(suffix, valueStart + valueLength, sizeof(suffix) - 1);
+        suffix[sizeof(suffix) - 1] = '\0';
+
+        snprintf(row + codeLength, P1Data::MAX_OBIS_STRING_LEN - codeLength, "(%.*f%s",
+                 decimals, sum->sum / sum->count, suffix);
+    }
+    return _latest;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "decoding/p1data.h"
+
+/**
+ * @brief Averages several meter frames into one reading
+ *
+ * Instantaneous values, OBIS codes C.7.x such as power, voltage and current,
+ * are averaged over the window. Every other row, meter readings and
+ * identifiers, is taken from the latest frame, as is the timestamp. A row that
+ * is missing from some frames is averaged over the frames that had it.
+ */
+class ReadingAggregator {
+public:
+    ReadingAggregator();
+
+    // Add a decoded frame to the window
+    void add(const P1Data& frame);
+
+    /**
+     * @brief Get the reading for the window
+     *
+     * Valid until the next add() or reset().
+     */
+    const P1Data& finish();
+
+    void reset();
+
+    uint8_t getCount() const { return _count; }
+    bool isEmpty() const { return _count == 0; }
+
+private:
+    static const size_t CODE_LENGTH = 16;
+
+    struct Sum {
+        char code[CODE_LENGTH];     // OBIS code up to the '(', empty when unused
+        float sum;
+        uint8_t count;
+    };
+
+    Sum* sumFor(const char* code, size_t length);
+
+    P1Data _latest;
+    Sum _sums[P1Data::MAX_OBIS_STRINGS];
+    uint8_t _count;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * @brief Single-writer publication of the latest value to any number of readers
+ *
+ * The value is kept in N slots, each guarded by its own sequence counter
+ * (a seqlock). The writer fills a slot that is not the published one in
+ * place and then publishes its index, so publishing never copies the value.
+ * Readers copy the published slot out and retry if the writer touched that
+ * slot during the copy. Readers never block the writer and the writer never
+ * waits for readers.
+ *
+ * With three slots the writer works two publications ahead of the slot most
+ * readers are copying from, so retries only happen to readers that are
+ * preempted for a whole publication cycle.
+ *
+ * T must be trivially copyable as readers copy it byte by byte.
+ */
+template <typename T, size_t N = 3>
+class SnapshotBuffer {
+    static_assert(N >= 2, "SnapshotBuffer needs at least two slots");
+    static_assert(std::is_trivially_copyable<T>::value, "SnapshotBuffer values are copied with memcpy");
+
+public:
+    SnapshotBuffer() : _published(0), _writing(0), _isWriting(false), _version(0) {
+        for (size_t i = 0; i < N; i++) {
+            _slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+    // --- Writer side ---
+
+    /**
+     * @brief Get a slot to fill with the next value
+     *
+     * The slot holds whatever was written to it before, the caller is
+     * responsible for resetting it. Calling beginWrite() again before
+     * publish() or abortWrite() returns the same slot.
+     *
+     * @return Reference to the unpublished slot
+     */
+    T& beginWrite() {
+        if (!_isWriting) {
+            _writing = (_published.load(std::memory_order_relaxed) + 1) % N;
+            Slot& slot = _slots[_writing];
+            // Odd sequence marks the slot as being written, readers retry
+            slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            _isWriting = true;
+        }
+        return _slots[_writing].value;
+    }
+
+    /**
+     * @brief Make the slot from beginWrite() the latest value
+     */
+    void publish() {
+        if (!_isWriting) {
+            return;
+        }
+        endWrite();
+        _published.store(_writing, std::memory_order_release);
+        _version.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Give up the slot from beginWrite() without publishing it
+     */
+    void abortWrite() {
+        if (_isWriting) {
+            endWrite();
+        }
+    }
+
+    // --- Reader side ---
+
+    /**
+     * @brief Copy the latest published value
+     *
+     * Before the first publish() this is the default constructed value.
+     *
+     * @param out Receives a consistent copy
+     * @return Number of values published so far, the copy may be newer than that
+     */
+    uint32_t read(T& out) const {
+        while (true) {
+            const uint32_t version = _version.load(std::memory_order_acquire);
+            const Slot& slot = _slots[_published.load(std::memory_order_acquire)];
+
+            const uint32_t before = slot.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;   // The writer moved on to this slot already
+            }
+            memcpy(static_cast<void*>(&out), static_cast<const void*>(&slot.value), sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == before) {
+                return version;
+            }
+        }
+    }
+
+    /**
+     * @brief Get the number of values published so far
+     *
+     * @return Publication count, wraps at 2^32
+     */
+    uint32_t getVersion() const { return _version.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;   // Odd while the writer owns the slot
+        T value{};
+    };
+
+    void endWrite() {
+        Slot& slot = _slots[_writing];
+        slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        _isWriting = false;
+    }
+
+    Slot _slots[N];
+    std::atomic<size_t> _published;
+    size_t _writing;        // Writer only
+    bool _isWriting;        // Writer only
+    std::atomic<uint32_t> _version;
+};
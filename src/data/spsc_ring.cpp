@@ -0,0 +1,181 @@
+#include "spsc_ring.h"
+
+SpscRing::SpscRing(size_t arenaSize, Policy policy)
+    : _arena(nullptr),
+      _arenaSize(0),
+      _mask(0),
+      _policy(policy),
+      _head(0),
+      _tail(0),
+      _hold(HOLD_NONE),
+      _reservedPadding(0),
+      _reservedLength(0),
+      _hasReservation(false),
+      _peekPosition(0),
+      _hasPeek(false),
+      _committedCount(0),
+      _droppedCount(0),
+      _rejectedCount(0) {
+
+    // Round down to a power of two so the free-running counters can wrap
+    size_t size = 2 * ALIGNMENT;
+    while (size * 2 <= arenaSize) {
+        size *= 2;
+    }
+    _arenaSize = size;
+    _mask = static_cast<uint32_t>(_arenaSize - 1);
+
+    _arena = new uint8_t[_arenaSize];
+    // Note: as in CircularBuffer a failed allocation leaves a nullptr which
+    // makes every reservation fail
+}
+
+SpscRing::~SpscRing() {
+    if (_arena != nullptr) {
+        delete[] _arena;
+        _arena = nullptr;
+    }
+}
+
+size_t SpscRing::recordSizeAt(uint32_t position) const {
+    return recordSize(headerAt(position)->length);
+}
+
+bool SpscRing::dropOldest(uint32_t tail) {
+    const bool isPadding = (headerAt(tail)->flags & FLAG_PADDING) != 0;
+    const uint32_t next = tail + static_cast<uint32_t>(recordSizeAt(tail));
+
+    if (!_tail.compare_exchange_strong(tail, next, std::memory_order_seq_cst)) {
+        return false;   // The consumer released it first, nothing was dropped
+    }
+    if (!isPadding) {
+        // A record the consumer was picking up at the same moment may still be
+        // delivered, so this count is an upper bound
+        _droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+uint8_t* SpscRing::reserve(size_t maxLength) {
+    _hasReservation = false;
+
+    if (_arena == nullptr || maxLength > maxRecordLength()) {
+        _rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    const uint32_t head = _head.load(std::memory_order_relaxed);
+    const size_t toEnd = _arenaSize - (head & _mask);
+    const size_t size = recordSize(maxLength);
+    // A record never wraps, pad out the end of the arena instead
+    const uint32_t padding = size > toEnd ? static_cast<uint32_t>(toEnd) : 0;
+    const size_t needed = size + padding;
+
+    while (true) {
+        // seq_cst pairs with the store/load order in peek() so that either we
+        // see the consumer's hold or the consumer sees our moved tail
+        const uint32_t tail = _tail.load(std::memory_order_seq_cst);
+        const uint32_t hold = _hold.load(std::memory_order_seq_cst);
+
+        uint32_t effectiveTail = tail;
+        if (hold != HOLD_NONE) {
+            const uint32_t held = hold & ~HOLD_FLAG;
+            if (tail - held <= _arenaSize) {
+                effectiveTail = held;   // The held record still occupies the arena
+            }
+        }
+
+        if (_arenaSize - (head - effectiveTail) >= needed) {
+            break;
+        }
+
+        // The held record is the oldest one, dropping anything else would not
+        // give us contiguous space at the head
+        if (_policy == Policy::REJECT_NEW || tail == head || hold != HOLD_NONE) {
+            _rejectedCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        dropOldest(tail);
+    }
+
+    _reservedPadding = padding;
+    _reservedLength = maxLength;
+    _hasReservation = true;
+
+    return _arena + ((head + padding) & _mask) + HEADER_SIZE;
+}
+
+bool SpscRing::commit(size_t length) {
+    if (!_hasReservation || length > _reservedLength) {
+        return false;
+    }
+    _hasReservation = false;
+
+    const uint32_t head = _head.load(std::memory_order_relaxed);
+
+    if (_reservedPadding > 0) {
+        Header* pad = headerAt(head);
+        pad->length = static_cast<uint16_t>(_reservedPadding - HEADER_SIZE);
+        pad->flags = FLAG_PADDING;
+    }
+
+    Header* header = headerAt(head + _reservedPadding);
+    header->length = static_cast<uint16_t>(length);
+    header->flags = 0;
+
+    // Release so the consumer sees the payload and headers before the new head
+    _head.store(head + _reservedPadding + static_cast<uint32_t>(recordSize(length)), std::memory_order_release);
+    _committedCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SpscRing::peek(Record& record) {
+    if (_hasPeek) {
+        const Header* header = headerAt(_peekPosition);
+        record.data = reinterpret_cast<const uint8_t*>(header) + HEADER_SIZE;
+        record.length = header->length;
+        return true;
+    }
+
+    while (true) {
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        // Announce the hold, then make sure the producer did not drop the
+        // record in the meantime (see reserve())
+        _hold.store(tail | HOLD_FLAG, std::memory_order_seq_cst);
+        if (_tail.load(std::memory_order_seq_cst) != tail) {
+            _hold.store(HOLD_NONE, std::memory_order_release);
+            continue;
+        }
+
+        const Header* header = headerAt(tail);
+        if (header->flags & FLAG_PADDING) {
+            _tail.compare_exchange_strong(tail, tail + static_cast<uint32_t>(recordSize(header->length)), std::memory_order_seq_cst);
+            _hold.store(HOLD_NONE, std::memory_order_release);
+            continue;
+        }
+
+        _peekPosition = tail;
+        _hasPeek = true;
+        record.data = reinterpret_cast<const uint8_t*>(header) + HEADER_SIZE;
+        record.length = header->length;
+        return true;
+    }
+}
+
+void SpscRing::release() {
+    if (!_hasPeek) {
+        return;
+    }
+
+    uint32_t expected = _peekPosition;
+    const uint32_t next = _peekPosition + static_cast<uint32_t>(recordSizeAt(_peekPosition));
+    // Fails if the producer already dropped the record while we held it
+    _tail.compare_exchange_strong(expected, next, std::memory_order_seq_cst);
+    _hold.store(HOLD_NONE, std::memory_order_release);
+    _hasPeek = false;
+}
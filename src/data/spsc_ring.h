@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+/**
+ * @brief Single-producer/single-consumer ring of variable-length records
+ *
+ * Records live in a fixed arena and are never copied by the ring itself. The
+ * producer reserves a contiguous region, writes into it and commits the used
+ * length. The consumer peeks at the oldest record, works on it in place and
+ * releases it when done.
+ *
+ * Head and tail are free-running 32-bit byte counters; the arena size is a
+ * power of two so the counters can wrap without ever being reset. A record
+ * that would straddle the end of the arena is preceded by a padding record
+ * that both sides skip.
+ *
+ * With the DROP_OLDEST policy a full ring makes room by discarding the oldest
+ * records, except the one the consumer currently holds. When that is not
+ * enough the reservation is rejected. Both outcomes are counted.
+ */
+class SpscRing {
+public:
+    enum class Policy {
+        DROP_OLDEST,    // Discard the oldest records to make room for new ones
+        REJECT_NEW      // Leave queued records alone, fail the reservation
+    };
+
+    /**
+     * @brief A record handed out by peek()
+     */
+    struct Record {
+        const uint8_t* data;
+        size_t length;
+    };
+
+    /**
+     * @brief Construct a new ring
+     *
+     * @param arenaSize Size of the arena in bytes. Any other size is rounded down
+     *                  to a power of two, getArenaSize() tells what was allocated
+     * @param policy What reserve() does when the ring is full
+     */
+    explicit SpscRing(size_t arenaSize = 4096, Policy policy = Policy::DROP_OLDEST);
+
+    /**
+     * @brief Destroy the ring
+     */
+    ~SpscRing();
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // --- Producer side ---
+
+    /**
+     * @brief Reserve a contiguous region for the next record
+     *
+     * Only one reservation can be outstanding. Calling reserve() again without
+     * committing simply replaces the previous reservation.
+     *
+     * @param maxLength Largest number of bytes the producer may write
+     * @return Pointer to the region or nullptr if no room could be made
+     */
+    uint8_t* reserve(size_t maxLength);
+
+    /**
+     * @brief Publish the reserved record to the consumer
+     *
+     * @param length Number of bytes actually written, at most the reserved length
+     * @return true if a record was published
+     */
+    bool commit(size_t length);
+
+    // --- Consumer side ---
+
+    /**
+     * @brief Get the oldest record without removing it
+     *
+     * The record stays valid and untouched by the producer until release().
+     *
+     * @param record Filled with a pointer to the record data and its length
+     * @return true if a record was available
+     */
+    bool peek(Record& record);
+
+    /**
+     * @brief Remove the record returned by the last successful peek()
+     */
+    void release();
+
+    // --- Status ---
+
+    /**
+     * @brief Get the largest record this ring can ever hold
+     *
+     * @return Maximum record length in bytes
+     */
+    size_t maxRecordLength() const { return _arenaSize / 2 - HEADER_SIZE; }
+
+    size_t getArenaSize() const { return _arenaSize; }
+    bool isEmpty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Get the number of bytes (records, headers and padding) in use
+     *
+     * @return Used bytes
+     */
+    size_t usedBytes() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+
+    uint32_t getCommittedCount() const { return _committedCount.load(std::memory_order_relaxed); }
+    uint32_t getDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+    uint32_t getRejectedCount() const { return _rejectedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Header {
+        uint16_t length;    // Payload length in bytes
+        uint16_t flags;
+    };
+
+    static constexpr uint16_t FLAG_PADDING = 0x0001;
+    static constexpr size_t HEADER_SIZE = sizeof(Header);
+    static constexpr size_t ALIGNMENT = 4;
+    // Held positions are always aligned, so bit 0 tells a held position apart from "nothing held"
+    static constexpr uint32_t HOLD_NONE = 0;
+    static constexpr uint32_t HOLD_FLAG = 1;
+
+    static size_t recordSize(size_t length) { return (HEADER_SIZE + length + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    Header* headerAt(uint32_t position) const { return reinterpret_cast<Header*>(_arena + (position & _mask)); }
+    size_t recordSizeAt(uint32_t position) const;
+    bool dropOldest(uint32_t tail);
+
+    uint8_t* _arena;
+    size_t _arenaSize;
+    uint32_t _mask;
+    Policy _policy;
+
+    std::atomic<uint32_t> _head;    // Written by the producer only
+    std::atomic<uint32_t> _tail;    // Advanced by the consumer, or by the producer when dropping
+    std::atomic<uint32_t> _hold;    // Position held by the consumer with HOLD_FLAG set, or HOLD_NONE
+
+    // Producer reservation state
+    uint32_t _reservedPadding;
+    size_t _reservedLength;
+    bool _hasReservation;
+
+    // Consumer peek state
+    uint32_t _peekPosition;
+    bool _hasPeek;
+
+    std::atomic<uint32_t> _committedCount;
+    std::atomic<uint32_t> _droppedCount;
+    std::atomic<uint32_t> _rejectedCount;
+};
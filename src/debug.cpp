@@ -2,24 +2,32 @@
 #include <Arduino.h>
 #include <esp_heap_caps.h> // Include for heap functions
 #include <esp_system.h> // Ensure it's included here too
+#include "backend/http_connection_manager.h"
+#include "backend/retry_policy.h"
+#include "metrics.h"
 
 
-int Debug::failedFrames = 0;
-int Debug::frames = 0;
+static Counter frames("zap_meter_frames_total", "Meter frames decoded");
+static Counter failedFrames("zap_meter_frames_failed_total", "Meter frames that could not be decoded");
 int Debug::p1MeterConfigIndex = -1; // Initialize static member
 char Debug::deviceId[32] = {0};
 char Debug::deviceModel[32] = {0};
 uint8_t Debug::faultyFrameData[1024] = {0};
 size_t Debug::faultyFrameDataSize = 0;
 CircularBuffer *Debug::pMeterDatabuffer = nullptr;
+SpscRing *Debug::pDataRing = nullptr;
+const BackendScheduler *Debug::pScheduler = nullptr;
+const UploadController *Debug::pUploadController = nullptr;
+const EventStream *Debug::pEventStream = nullptr;
+const ResponseCache *Debug::pResponseCache = nullptr;
 esp_reset_reason_t Debug::lastResetReason = ESP_RST_UNKNOWN; // Initialize static member
 
 
 void Debug::addFailedFrame() {
-    failedFrames++;
+    failedFrames.increment();
 }
 void Debug::addFrame() {
-    frames++;
+    frames.increment();
 }
 
 void Debug::setDeviceId(const char *szDeviceId) {
@@ -49,28 +57,15 @@ esp_reset_reason_t Debug::getResetReason() {
     return lastResetReason;
 }
 
-zap::Str toHexString(const CircularBuffer *pBuffer) {
-    zap::Str hexString;
-    hexString.reserve(pBuffer->available() * 2); // Reserve space for hex string
-    char temp[3]; // 2 hex digits + null terminator
-    temp[2] = '\0'; // Null terminator for sprintf
-    for (size_t i = 0; i < pBuffer->available(); i++) {
-        uint8_t byte = pBuffer->getByte(i);
-        sprintf(temp, "%02x", byte);
-        hexString += temp;
-    }
-
-    return hexString;
-}
-
-JsonBuilder& Debug::getJsonReport(JsonBuilder& jb) {
+template <typename Builder>
+Builder& Debug::getJsonReport(Builder& jb) {
     
     jb.beginObject("report")
         .add("uptime_sek", millis() / 1000)
         .add("p1CfgIx", p1MeterConfigIndex)
-        .add("failedFrames", failedFrames)
-        .add("successFrames", frames)
-        .add("totalFrames", failedFrames + frames)
+        .add("failedFrames", failedFrames.get())
+        .add("successFrames", frames.get())
+        .add("totalFrames", failedFrames.get() + frames.get())
         .add("deviceId", deviceId)
         .add("deviceModel", deviceModel)
         // Add heap information
@@ -82,11 +77,107 @@ JsonBuilder& Debug::getJsonReport(JsonBuilder& jb) {
         jb.add("faultyFrameData", faultyFrameData, faultyFrameDataSize);
     }
 
+    if (pDataRing) {
+        jb.beginObject("dataRing")
+            .add("committed", pDataRing->getCommittedCount())
+            .add("dropped", pDataRing->getDroppedCount())
+            .add("rejected", pDataRing->getRejectedCount())
+            .add("usedBytes", (uint32_t)pDataRing->usedBytes())
+        .endObject();
+    }
+
+    if (pUploadController) {
+        const UploadController::Stats uploadStats = pUploadController->getStats();
+        jb.beginObject("upload")
+            .add("link", UploadController::linkName(uploadStats.link))
+            .add("batch", (int)uploadStats.batch)
+            .add("downsample", (int)uploadStats.downsample)
+            .add("rssi", uploadStats.rssi)
+            .add("latencyMs", uploadStats.latencyMs)
+            .add("failurePercent", (int)uploadStats.failurePercent)
+            .add("backlogPercent", (int)uploadStats.backlogPercent)
+        .endObject();
+    }
+
+    if (pEventStream) {
+        const EventStream::Stats& eventStats = pEventStream->getStats();
+        jb.beginObject("events")
+            .add("subscribers", (int)pEventStream->getSubscriberCount())
+            .add("published", eventStats.published)
+            .add("rejected", eventStats.rejected)
+            .add("delivered", eventStats.delivered)
+            .add("dropped", eventStats.dropped)
+            .add("overruns", eventStats.overruns)
+        .endObject();
+    }
+
+    if (pResponseCache) {
+        const ResponseCache::Stats& cacheStats = pResponseCache->getStats();
+        jb.beginObject("responseCache")
+            .add("hits", cacheStats.hits)
+            .add("misses", cacheStats.misses)
+            .add("hitPercent", (int)pResponseCache->getHitPercent())
+            .add("notModified", cacheStats.notModified)
+            .add("evictions", cacheStats.evictions)
+            .add("uncached", cacheStats.uncached)
+        .endObject();
+    }
+
+    const HttpConnectionManager::Stats httpStats = HttpConnectionManager::getStats();
+    jb.beginObject("http")
+        .add("requests", httpStats.requests)
+        .add("reused", httpStats.reused)
+        .add("handshakes", httpStats.handshakes)
+        .add("handshakeMs", httpStats.handshakeMs)
+    .endObject();
+
+    jb.beginObject("retry");
+    for (size_t i = 0; i < RetryPolicy::MAX_POLICIES; i++) {
+        const RetryPolicy* policy = RetryPolicy::get(i);
+        if (policy == nullptr) {
+            continue;
+        }
+        const RetryPolicy::Stats& retryStats = policy->getStats();
+        jb.beginObject(policy->getName())
+            .add("state", RetryPolicy::stateName(policy->getState()))
+            .add("successes", retryStats.successes)
+            .add("failures", retryStats.failures)
+            .add("consecutiveFailures", retryStats.consecutiveFailures)
+            .add("opened", retryStats.opened)
+            .add("delayMs", retryStats.delayMs)
+        .endObject();
+    }
+    jb.endObject();
+
+    if (pScheduler) {
+        jb.beginObject("jobs");
+        for (size_t i = 0; i < BackendScheduler::MAX_JOBS; i++) {
+            const BackendScheduler::JobStats* jobStats = pScheduler->getStats(i);
+            if (jobStats == nullptr) {
+                continue;
+            }
+            const uint32_t runs = jobStats->runs > 0 ? jobStats->runs : 1;
+            jb.beginObject(pScheduler->getName(i))
+                .add("runs", jobStats->runs)
+                .add("late", jobStats->late)
+                .add("overruns", jobStats->overruns)
+                .add("avgLatencyMs", (uint32_t)(jobStats->totalLatencyMs / runs))
+                .add("maxLatencyMs", jobStats->maxLatencyMs)
+                .add("avgRunMs", (uint32_t)(jobStats->totalRunMs / runs))
+                .add("maxRunMs", jobStats->maxRunMs)
+            .endObject();
+        }
+        jb.endObject();
+    }
+
     if (pMeterDatabuffer) {
-        zap::Str hexString = toHexString(pMeterDatabuffer);
-        jb.add("meterDataBuffer", hexString);
+        // Hex encoded straight from the ring buffer, no copy of it is made
+        jb.addHex("meterDataBuffer", pMeterDatabuffer->available(), [](size_t i) { return pMeterDatabuffer->getByte(i); });
     }
 
     jb.endObject();
     return jb;
 }
+
+template JsonBuilder& Debug::getJsonReport(JsonBuilder& jb);
+template StreamingJsonBuilder& Debug::getJsonReport(StreamingJsonBuilder& jb);
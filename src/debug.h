@@ -1,13 +1,21 @@
 #pragma once
 #include "json_light/json_light.h"
+#include "endpoints/response_writer.h"
 #include "data/circular_buffer.h"
+#include "data/spsc_ring.h"
+#include "data/event_stream.h"
+#include "backend/backend_scheduler.h"
+#include "backend/upload_controller.h"
+#include "endpoints/response_cache.h"
 #include <esp_system.h> // Include for esp_reset_reason_t
 
 class Debug {
     public:
         static void addFailedFrame();
         static void addFrame();
-        static JsonBuilder& getJsonReport(JsonBuilder& jb);
+        // Instantiated for JsonBuilder and StreamingJsonBuilder
+        template <typename Builder>
+        static Builder& getJsonReport(Builder& jb);
         static void setDeviceId(const char *szDeviceId);
         static void setDeviceModel(const char *szDeviceModel);
 
@@ -21,6 +29,26 @@ class Debug {
             pMeterDatabuffer = pBuffer;
         }
 
+        static void setDataRing(SpscRing *pRing) {
+            pDataRing = pRing;
+        }
+
+        static void setEventStream(const EventStream *pStream) {
+            pEventStream = pStream;
+        }
+
+        static void setResponseCache(const ResponseCache *pCache) {
+            pResponseCache = pCache;
+        }
+
+        static void setScheduler(const BackendScheduler *pJobs) {
+            pScheduler = pJobs;
+        }
+
+        static void setUploadController(const UploadController *pController) {
+            pUploadController = pController;
+        }
+
         static void setP1MeterConfigIndex(int index) {
             p1MeterConfigIndex = index;
         }
@@ -31,8 +59,6 @@ class Debug {
     
     private:
         static int p1MeterConfigIndex;
-        static int failedFrames;
-        static int frames;
         static char deviceId[32];
         static char deviceModel[32];
 
@@ -40,6 +66,11 @@ class Debug {
         static size_t faultyFrameDataSize;
 
         static CircularBuffer *pMeterDatabuffer;
+        static SpscRing *pDataRing;
+        static const EventStream *pEventStream;
+        static const ResponseCache *pResponseCache;
+        static const BackendScheduler *pScheduler;
+        static const UploadController *pUploadController;
 
         static esp_reset_reason_t lastResetReason; // Member to store reset reason
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
 #include "data/data_reader_task.h"
 #include "endpoint_types.h"
 
@@ -12,6 +15,25 @@ class DataReaderHandler {
 
 class DataReaderGetHandler : public EndpointFunction, protected DataReaderHandler {
     public:
-        explicit DataReaderGetHandler(DataReaderTask& dataReader) : DataReaderHandler(dataReader) {}
+        explicit DataReaderGetHandler(DataReaderTask& dataReader)
+            : DataReaderHandler(dataReader), snapshotMutex(xSemaphoreCreateMutexStatic(&snapshotMutexBuffer)) {}
+        EndpointResponse handle(const zap::Str& contents) override;
+        bool getCacheVersion(uint32_t& version) override {
+            version = dataReader.getLastDecodedVersion();
+            return true;
+        }
+    private:
+        // Copy of the last decoded data, kept here to spare the stacks of the calling tasks.
+        // BLE, the web server and backend requests route at the same time, so it is used under the mutex.
+        P1Data snapshot;
+        StaticSemaphore_t snapshotMutexBuffer;
+        SemaphoreHandle_t snapshotMutex;
+};
+
+// Pushes every decoded reading to the client as a server-sent event, only over HTTP
+class DataReaderStreamHandler : public EndpointFunction, protected DataReaderHandler {
+    public:
+        explicit DataReaderStreamHandler(DataReaderTask& dataReader) : DataReaderHandler(dataReader) {}
         EndpointResponse handle(const zap::Str& contents) override;
+        void stream(const zap::Str& contents, ResponseWriter& writer) override;
 };
\ No newline at end of file
@@ -9,8 +9,10 @@ EndpointResponse DataReaderGetHandler::handle(const zap::Str& contents) {
     EndpointResponse response;
     response.contentType = "application/json";
 
-    // Get the last decoded P1 data
-    const P1Data& lastData = dataReader.getLastDecodedData();
+    // Get the last decoded P1 data, the snapshot is ours until the JSON is built
+    xSemaphoreTake(snapshotMutex, portMAX_DELAY);
+    dataReader.readLastDecodedData(snapshot);
+    const P1Data& lastData = snapshot;
 
     // Create a JSON response with the last decoded data
     JsonBuilder json;
@@ -20,9 +22,30 @@ EndpointResponse DataReaderGetHandler::handle(const zap::Str& contents) {
         .addArray("data", (const char*)lastData.obisStrings, lastData.obisStringCount, P1Data::MAX_OBIS_STRING_LEN);
     
     LOG_TI(TAG_DREH, "Last decoded P1 data lines: %d", lastData.obisStringCount);
+    xSemaphoreGive(snapshotMutex);
     
     response.data = json.end();
     response.statusCode = 200;
 
     return response;
-}
\ No newline at end of file
+}
+
+EndpointResponse DataReaderStreamHandler::handle(const zap::Str& contents) {
+    EndpointResponse response;
+    response.contentType = "application/json";
+    response.statusCode = 501;
+    response.data = "{\"status\":\"error\",\"message\":\"Event streams need the web server\"}";
+    return response;
+}
+
+void DataReaderStreamHandler::stream(const zap::Str& contents, ResponseWriter& writer) {
+    if (writer.subscribe(dataReader.getEventStream())) {
+        LOG_TI(TAG_DREH, "Live reading subscriber added, %d in total", (int)dataReader.getEventStream().getSubscriberCount());
+        return;
+    }
+
+    static const char* body = "{\"status\":\"error\",\"message\":\"No event stream available\"}";
+    writer.begin(503, "application/json", strlen(body));
+    writer.write(body, strlen(body));
+    writer.end();
+}
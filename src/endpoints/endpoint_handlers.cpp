@@ -2,6 +2,7 @@
 #include "wifi/wifi_manager.h"
 #include "crypto.h"
 #include "debug.h"
+#include "metrics.h"
 #include "main_actions.h"
 
 #include "backend/graphql.h"
@@ -21,11 +22,9 @@ EndpointResponse CryptoInfoHandler::handle(const zap::Str& contents) {
     json.beginObject()
         .add("deviceName", "software_zap");
     
-    zap::Str serialNumber = crypto_getId();
-    json.add("serialNumber", serialNumber.c_str());
-    
-    zap::Str publicKey = crypto_get_public_key(PRIVATE_KEY_HEX);
-    json.add("publicKey", publicKey.c_str());
+    const DeviceIdentity& identity = crypto_get_identity();
+    json.add("serialNumber", identity.id.c_str());
+    json.add("publicKey", identity.publicKeyHex.c_str());
     
     response.statusCode = 200;
     response.data = json.end();
@@ -77,10 +76,10 @@ EndpointResponse InitializeHandler::handle(const zap::Str& contents) {
         return response;
     }
     
-    zap::Str deviceId = crypto_getId();
+    const zap::Str& deviceId = crypto_getId();
     zap::Str idAndWallet = deviceId + ":" + zap::Str(wallet);
     
-    zap::Str signature = crypto_create_signature_hex(idAndWallet.c_str(), PRIVATE_KEY_HEX);
+    zap::Str signature = crypto_create_signature_hex(idAndWallet.c_str());
     
     JsonBuilder json;
     json.beginObject()
@@ -110,6 +109,45 @@ EndpointResponse DebugHandler::handle(const zap::Str& contents) {
     return response;
 }
 
+void DebugHandler::stream(const zap::Str& contents, ResponseWriter& writer) {
+    writer.begin(200, "application/json");
+    StreamingJsonBuilder json(writer);
+    json.beginObject()
+        .add("status", "success");
+    Debug::getJsonReport(json);
+    json.end();
+    writer.end();
+}
+
+constexpr const char* MetricsHandler::CONTENT_TYPE;
+
+// Collects a rendered response for a transport that needs it in one piece
+class StrResponseWriter : public ResponseWriter {
+    public:
+        explicit StrResponseWriter(zap::Str& body) : body(body) {}
+        void begin(int statusCode, const char* contentType, size_t contentLength) override {}
+        void write(const char* data, size_t length) override { body.append(data, length); }
+        void end() override {}
+
+    private:
+        zap::Str& body;
+};
+
+EndpointResponse MetricsHandler::handle(const zap::Str& contents) {
+    EndpointResponse response;
+    response.contentType = CONTENT_TYPE;
+    response.statusCode = 200;
+    StrResponseWriter writer(response.data);
+    Metric::renderAll(writer);
+    return response;
+}
+
+void MetricsHandler::stream(const zap::Str& contents, ResponseWriter& writer) {
+    writer.begin(200, CONTENT_TYPE);
+    Metric::renderAll(writer);
+    writer.end();
+}
+
 // BLE Stop Handler Implementation
 EndpointResponse BLEStopHandler::handle(const zap::Str& contents) {
     // Implementation for BLE stop endpoint
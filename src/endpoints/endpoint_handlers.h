@@ -11,6 +11,8 @@
 class CryptoInfoHandler : public EndpointFunction {
     public:
         EndpointResponse handle(const zap::Str& contents) override;
+        // The identity is set up once at boot
+        bool getCacheVersion(uint32_t& version) override { version = 0; return true; }
 };
 
 // Name Info Handler
@@ -34,6 +36,18 @@ class CryptoSignHandler : public EndpointFunction {
 class DebugHandler : public EndpointFunction {
     public:
         EndpointResponse handle(const zap::Str& contents) override;
+        // The report carries kilobytes of hex, over HTTP it is streamed rather than built in memory
+        void stream(const zap::Str& contents, ResponseWriter& writer) override;
+};
+
+// Counters, gauges and histograms in the Prometheus text format
+class MetricsHandler : public EndpointFunction {
+    public:
+        static constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4";
+
+        EndpointResponse handle(const zap::Str& contents) override;
+        // Rendered straight into the response, nothing is built in memory
+        void stream(const zap::Str& contents, ResponseWriter& writer) override;
 };
 
 // Echo Handler - returns the data it received
@@ -3,31 +3,37 @@
 // #include "../ble_handler.h"
 // #include "ota/ota_handler.h"
 #include "endpoint_handlers.h"
+#include "route_table.h"
+#include "response_cache.h"
 
-// Define path constants
-const char* EndpointMapper::WIFI_CONFIG_PATH = "/api/wifi";
-const char* EndpointMapper::SYSTEM_INFO_PATH = "/api/system";
-const char* EndpointMapper::SYSTEM_REBOOT_PATH = "/api/system/reboot";
-const char* EndpointMapper::WIFI_RESET_PATH = "/api/wifi";
-const char* EndpointMapper::CRYPTO_INFO_PATH = "/api/crypto";
-const char* EndpointMapper::NAME_INFO_PATH = "/api/name";
-const char* EndpointMapper::WIFI_STATUS_PATH = "/api/wifi";
-const char* EndpointMapper::WIFI_SCAN_PATH = "/api/wifi/scan";
-const char* EndpointMapper::BLE_STOP_PATH = "/api/ble/stop";
-const char* EndpointMapper::CRYPTO_SIGN_PATH = "/api/crypto/sign";
-const char* EndpointMapper::OTA_UPDATE_PATH = "/api/ota/update";
-const char* EndpointMapper::OTA_STATUS_PATH = "/api/ota/status";
-const char* EndpointMapper::DEBUG_PATH = "/api/debug";
-const char* EndpointMapper::ECHO_PATH = "/api/echo";
-
-const char* EndpointMapper::P1_DATA_PATH = "/api/data/p1/obis";
+// Path constants are defined in the header, these are for the linker
+constexpr const char* EndpointMapper::WIFI_CONFIG_PATH;
+constexpr const char* EndpointMapper::SYSTEM_INFO_PATH;
+constexpr const char* EndpointMapper::SYSTEM_REBOOT_PATH;
+constexpr const char* EndpointMapper::WIFI_RESET_PATH;
+constexpr const char* EndpointMapper::CRYPTO_INFO_PATH;
+constexpr const char* EndpointMapper::NAME_INFO_PATH;
+constexpr const char* EndpointMapper::WIFI_STATUS_PATH;
+constexpr const char* EndpointMapper::WIFI_SCAN_PATH;
+constexpr const char* EndpointMapper::BLE_STOP_PATH;
+constexpr const char* EndpointMapper::CRYPTO_SIGN_PATH;
+constexpr const char* EndpointMapper::OTA_UPDATE_PATH;
+constexpr const char* EndpointMapper::OTA_STATUS_PATH;
+constexpr const char* EndpointMapper::DEBUG_PATH;
+constexpr const char* EndpointMapper::METRICS_PATH;
+constexpr const char* EndpointMapper::ECHO_PATH;
+
+constexpr const char* EndpointMapper::P1_DATA_PATH;
+constexpr const char* EndpointMapper::P1_STREAM_PATH;
 
 // Global instance of OTA handler
 // TODO: The endpoint should be passed to the OTA handler
 
 NameInfoHandler g_nullHandler;
 
-const Endpoint endpoints[] = {
+static const char* NOT_FOUND_RESPONSE = "{\"status\":\"error\",\"message\":\"Endpoint not found\"}";
+
+constexpr Endpoint endpoints[] = {
     Endpoint(Endpoint::WIFI_CONFIG, Endpoint::Verb::POST, EndpointMapper::WIFI_CONFIG_PATH, g_wifiConfigHandler),
     Endpoint(Endpoint::SYSTEM_INFO, Endpoint::Verb::GET, EndpointMapper::SYSTEM_INFO_PATH, g_systemInfoHandler),
     Endpoint(Endpoint::SYSTEM_INFO, Endpoint::Verb::POST, EndpointMapper::SYSTEM_REBOOT_PATH, g_systemRebootHandler),
@@ -37,6 +43,7 @@ const Endpoint endpoints[] = {
     Endpoint(Endpoint::WIFI_STATUS, Endpoint::Verb::GET, EndpointMapper::WIFI_STATUS_PATH, g_wifiStatusHandler),
     Endpoint(Endpoint::WIFI_SCAN, Endpoint::Verb::GET, EndpointMapper::WIFI_SCAN_PATH, g_wifiScanHandler),
     Endpoint(Endpoint::DEBUG, Endpoint::Verb::GET, EndpointMapper::DEBUG_PATH, g_debugHandler), 
+    Endpoint(Endpoint::METRICS, Endpoint::Verb::GET, EndpointMapper::METRICS_PATH, g_metricsHandler),
     Endpoint(Endpoint::BLE_STOP, Endpoint::Verb::POST, EndpointMapper::BLE_STOP_PATH, g_bleStopHandler), 
     Endpoint(Endpoint::CRYPTO_SIGN, Endpoint::Verb::POST, EndpointMapper::CRYPTO_SIGN_PATH, g_cryptoSignHandler),
     Endpoint(Endpoint::ECHO, Endpoint::Verb::POST, EndpointMapper::ECHO_PATH, g_echoHandler), 
@@ -44,22 +51,26 @@ const Endpoint endpoints[] = {
     Endpoint(Endpoint::OTA_UPDATE, Endpoint::Verb::POST, EndpointMapper::OTA_UPDATE_PATH, g_otaUpdateHandler),
     Endpoint(Endpoint::OTA_STATUS, Endpoint::Verb::GET, EndpointMapper::OTA_STATUS_PATH, g_otaStatusHandler),
 
-    Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, EndpointMapper::P1_DATA_PATH, g_dataReaderGetHandler)
+    Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, EndpointMapper::P1_DATA_PATH, g_dataReaderGetHandler),
+    Endpoint(Endpoint::P1_STREAM, Endpoint::Verb::GET, EndpointMapper::P1_STREAM_PATH, g_dataReaderStreamHandler)
 };
 
+// Paths are looked up through a perfect hash laid out at compile time
+ROUTE_TABLE_CHECKS(endpoints);
+static constexpr route_table::RouteTable<sizeof(endpoints) / sizeof(endpoints[0])> routeTable = route_table::build(endpoints);
+
+// GET responses of handlers with a cache version, for the web server. BLE requests come
+// from another task and are always run.
+static ResponseCache responseCache;
+
 EndpointMapper::Iterator EndpointMapper::begin() const { return EndpointMapper::Iterator(endpoints); }
 EndpointMapper::Iterator EndpointMapper::end() const { return EndpointMapper::Iterator(endpoints + sizeof(endpoints) / sizeof(endpoints[0])); }
 
 const Endpoint& EndpointMapper::toEndpoint(const zap::Str& path, const zap::Str& verb) {
-    // Create an instance of EndpointMapper to use the non-static begin() and end() methods
-    Endpoint::Verb eVerb = stringToVerb(verb);
     static const Endpoint unknownEndpoint = Endpoint(Endpoint::UNKNOWN, Endpoint::Verb::UNKNOWN, "", g_nullHandler);
-    
-    for (const Endpoint& endpoint : endpointMapper) {
-        if (path == endpoint.path && endpoint.verb == eVerb) return endpoint;
-    }
-    
-    return unknownEndpoint;
+
+    const int index = routeTable.find(stringToVerb(verb), path.c_str(), path.length());
+    return index >= 0 ? endpoints[index] : unknownEndpoint;
 }
 
 Endpoint::Verb EndpointMapper::stringToVerb(const zap::Str& verb) {
@@ -88,9 +99,26 @@ EndpointResponse EndpointMapper::route(const EndpointRequest& request) {
     EndpointResponse response;
     response.statusCode = 404;
     response.contentType = "application/json";
-    response.data = "{\"status\":\"error\",\"message\":\"Endpoint not found\"}";
+    response.data = NOT_FOUND_RESPONSE;
     return response;
 }
 
+void EndpointMapper::route(const EndpointRequest& request, ResponseWriter& writer) {
+    if (&request.endpoint.handler != &g_nullHandler) {
+        if (!responseCache.serve(request, writer)) {
+            request.endpoint.handler.stream(request.content, writer);
+        }
+        return;
+    }
+
+    writer.begin(404, "application/json", strlen(NOT_FOUND_RESPONSE));
+    writer.write(NOT_FOUND_RESPONSE, strlen(NOT_FOUND_RESPONSE));
+    writer.end();
+}
+
+const ResponseCache& EndpointMapper::getResponseCache() {
+    return responseCache;
+}
+
 // Define the global instance
 EndpointMapper endpointMapper;
\ No newline at end of file
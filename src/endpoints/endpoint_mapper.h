@@ -4,36 +4,40 @@
 #include "endpoint_types.h"
 #include "endpoints.h"
 #include "zap_str.h"
+#include "response_cache.h"
 #include <array>
 
 class EndpointMapper {
 public:
-    // Define path constants
-    static const char* WIFI_CONFIG_PATH;
-    static const char* WIFI_RESET_PATH;
-    static const char* WIFI_STATUS_PATH;
-    static const char* WIFI_SCAN_PATH;
+    // Path constants, constexpr so the routing table is built at compile time
+    static constexpr const char* WIFI_CONFIG_PATH = "/api/wifi";
+    static constexpr const char* WIFI_RESET_PATH = "/api/wifi";
+    static constexpr const char* WIFI_STATUS_PATH = "/api/wifi";
+    static constexpr const char* WIFI_SCAN_PATH = "/api/wifi/scan";
 
 
-    static const char* SYSTEM_INFO_PATH;
-    static const char* SYSTEM_REBOOT_PATH;
-    static const char* DEBUG_PATH;
+    static constexpr const char* SYSTEM_INFO_PATH = "/api/system";
+    static constexpr const char* SYSTEM_REBOOT_PATH = "/api/system/reboot";
+    static constexpr const char* DEBUG_PATH = "/api/debug";
+    // Where Prometheus scrapes by default
+    static constexpr const char* METRICS_PATH = "/metrics";
 
     
-    static const char* CRYPTO_INFO_PATH;
-    static const char* CRYPTO_SIGN_PATH;
+    static constexpr const char* CRYPTO_INFO_PATH = "/api/crypto";
+    static constexpr const char* CRYPTO_SIGN_PATH = "/api/crypto/sign";
 
-    static const char* NAME_INFO_PATH;
-    static const char* ECHO_PATH;
+    static constexpr const char* NAME_INFO_PATH = "/api/name";
+    static constexpr const char* ECHO_PATH = "/api/echo";
 
 
-    static const char* BLE_STOP_PATH;
-    static const char* OTA_UPDATE_PATH;
-    static const char* OTA_STATUS_PATH;
+    static constexpr const char* BLE_STOP_PATH = "/api/ble/stop";
+    static constexpr const char* OTA_UPDATE_PATH = "/api/ota/update";
+    static constexpr const char* OTA_STATUS_PATH = "/api/ota/status";
     static const char* INITIALIZE_FORM_PATH;
     static const char* INITIALIZE_PATH;
 
-    static const char* P1_DATA_PATH;
+    static constexpr const char* P1_DATA_PATH = "/api/data/p1/obis";
+    static constexpr const char* P1_STREAM_PATH = "/api/data/p1/stream";
     
     // Iterator support
     class Iterator {
@@ -71,6 +75,10 @@ public:
     static Endpoint::Verb stringToVerb(const zap::Str& method);
     static zap::Str verbToString(Endpoint::Verb method);
     static EndpointResponse route(const EndpointRequest& request);
+    static void route(const EndpointRequest& request, ResponseWriter& writer);
+
+    // Hits and misses of the GET responses kept for the web server
+    static const ResponseCache& getResponseCache();
 };
 
 // Global instance of EndpointMapper
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "zap_str.h"
+#include "response_writer.h"
 
 // Forward declarations
 struct EndpointResponse;
@@ -9,6 +10,13 @@ struct EndpointRequest;
 class EndpointFunction {
     public:
         virtual EndpointResponse handle(const zap::Str& contents) = 0;
+
+        // Writes the response as it is produced, by default the whole response from handle()
+        virtual void stream(const zap::Str& contents, ResponseWriter& writer);
+
+        // Version of the body a GET gets, the response cache keeps it until the version changes.
+        // Handlers without one return false and are run for every request.
+        virtual bool getCacheVersion(uint32_t& version) { return false; }
 };
 
 // Define all possible endpoints as an enum
@@ -35,8 +43,10 @@ class Endpoint {
         OTA_UPDATE,
         OTA_STATUS,
         DEBUG,
+        METRICS,
         ECHO,
         P1_DATA,  
+        P1_STREAM,
         UNKNOWN
     };
     const Type type;
@@ -45,7 +55,7 @@ class Endpoint {
     // Function pointer to the handler for this endpoint
     EndpointFunction &handler;
     
-    Endpoint(Type type, Verb verb, const char* path, EndpointFunction &handler) 
+    constexpr Endpoint(Type type, Verb verb, const char* path, EndpointFunction &handler)
         : type(type), verb(verb), path(path), handler(handler) {}
 };
 
@@ -58,8 +68,16 @@ struct EndpointResponse {
 
 // Request structure that normalizes input from both BLE and HTTP
 struct EndpointRequest {
-    explicit EndpointRequest(const Endpoint& endpoint) : endpoint(endpoint), offset(0) {}
+    explicit EndpointRequest(const Endpoint& endpoint) : endpoint(endpoint), offset(0), ifNoneMatch(nullptr) {}
     const Endpoint& endpoint;
     zap::Str content;
     int offset;
-};
\ No newline at end of file
+    const char* ifNoneMatch;    // If-None-Match header of a HTTP request, nullptr without one
+};
+
+inline void EndpointFunction::stream(const zap::Str& contents, ResponseWriter& writer) {
+    const EndpointResponse response = handle(contents);
+    writer.begin(response.statusCode, response.contentType.c_str(), response.data.length());
+    writer.write(response.data.c_str(), response.data.length());
+    writer.end();
+}
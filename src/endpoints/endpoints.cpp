@@ -37,8 +37,10 @@ OTAStatusHandler g_otaStatusHandler(g_otaHandler);
 
 EchoHandler g_echoHandler;
 DebugHandler g_debugHandler;
+MetricsHandler g_metricsHandler;
 BLEStopHandler g_bleStopHandler;
 
 DataReaderGetHandler g_dataReaderGetHandler(g_dataReaderTask);
+DataReaderStreamHandler g_dataReaderStreamHandler(g_dataReaderTask);
 
 
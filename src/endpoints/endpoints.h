@@ -24,6 +24,8 @@ extern OTAUpdateHandler g_otaUpdateHandler;
 extern EchoHandler g_echoHandler;
 extern BLEStopHandler g_bleStopHandler;
 extern DebugHandler g_debugHandler;
+extern MetricsHandler g_metricsHandler;
 extern OTAUpdateHandler g_otaUpdateHandler;
 extern OTAStatusHandler g_otaStatusHandler;
-extern DataReaderGetHandler g_dataReaderGetHandler;
\ No newline at end of file
+extern DataReaderGetHandler g_dataReaderGetHandler;
+extern DataReaderStreamHandler g_dataReaderStreamHandler;
\ No newline at end of file
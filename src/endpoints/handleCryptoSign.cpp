@@ -55,7 +55,7 @@ EndpointResponse CryptoSignHandler::handle(const zap::Str& contents) {
     }
     
     // Get device serial number
-    zap::Str serialNumber = crypto_getId();
+    const zap::Str& serialNumber = crypto_getId();
     
     // Create the combined message: message|nonce|timestamp|serial
     // If message is empty, don't include the initial pipe character
@@ -67,8 +67,7 @@ EndpointResponse CryptoSignHandler::handle(const zap::Str& contents) {
     }
     
     // Sign the combined message
-    extern const char* PRIVATE_KEY_HEX;
-    zap::Str signature = crypto_create_signature_hex(combinedMessage.c_str(), PRIVATE_KEY_HEX);
+    zap::Str signature = crypto_create_signature_hex(combinedMessage.c_str());
     
     // Create the response as a json string, we put the signature first so this is sent first to void fragmented signatures in ble case
     zap::Str responseString = "{\"sign\":\"" + signature + "\",\"message\":\"" + combinedMessage + "\"}";
@@ -0,0 +1,106 @@
+#include "response_cache.h"
+#include <stdio.h>
+#include <string.h>
+
+// FNV-1a, the ETag only has to change when the body does
+static uint64_t hashBody(const char* data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+ResponseCache::ResponseCache() : useCounter(0), stats() {
+    clear();
+}
+
+void ResponseCache::clear() {
+    for (Entry& entry : entries) {
+        entry.handler = nullptr;
+        entry.version = 0;
+        entry.lastUsed = 0;
+        entry.body.clear();
+        entry.etag[0] = '\0';
+    }
+}
+
+uint8_t ResponseCache::getHitPercent() const {
+    const uint32_t total = stats.hits + stats.misses;
+    return total > 0 ? (uint8_t)((uint64_t)stats.hits * 100 / total) : 0;
+}
+
+bool ResponseCache::matches(const char* ifNoneMatch, const char* etag) {
+    if (ifNoneMatch == nullptr || etag[0] == '\0') {
+        return false;
+    }
+    if (strcmp(ifNoneMatch, "*") == 0) {
+        return true;
+    }
+    // A list of quoted tags, possibly weak, the quotes keep one tag from matching inside another
+    return strstr(ifNoneMatch, etag) != nullptr;
+}
+
+ResponseCache::Entry* ResponseCache::entryFor(const EndpointFunction* handler) {
+    Entry* oldest = &entries[0];
+    for (Entry& entry : entries) {
+        if (entry.handler == handler) {
+            return &entry;
+        }
+        if (entry.handler == nullptr || (oldest->handler != nullptr && entry.lastUsed < oldest->lastUsed)) {
+            oldest = &entry;
+        }
+    }
+    if (oldest->handler != nullptr) {
+        stats.evictions++;
+    }
+    oldest->handler = nullptr;
+    return oldest;
+}
+
+bool ResponseCache::serve(const EndpointRequest& request, ResponseWriter& writer) {
+    EndpointFunction& handler = request.endpoint.handler;
+    uint32_t version;
+    if (request.endpoint.verb != Endpoint::Verb::GET || !handler.getCacheVersion(version)) {
+        return false;
+    }
+
+    Entry* entry = entryFor(&handler);
+    if (entry->handler == &handler && entry->version == version) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+        const EndpointResponse response = handler.handle(request.content);
+        if (response.statusCode != 200 || response.data.length() > MAX_BODY_SIZE) {
+            // Whatever was kept for the handler is out of date now
+            stats.uncached++;
+            entry->handler = nullptr;
+            writer.begin(response.statusCode, response.contentType.c_str(), response.data.length());
+            writer.write(response.data.c_str(), response.data.length());
+            writer.end();
+            return true;
+        }
+
+        entry->handler = &handler;
+        entry->version = version;
+        entry->contentType = response.contentType;
+        entry->body = response.data;
+        const uint64_t hash = hashBody(entry->body.c_str(), entry->body.length());
+        snprintf(entry->etag, sizeof(entry->etag), "\"%08x%08x\"", (unsigned int)(hash >> 32), (unsigned int)hash);
+    }
+    entry->lastUsed = ++useCounter;
+
+    writer.setHeader("ETag", entry->etag);
+    if (matches(request.ifNoneMatch, entry->etag)) {
+        stats.notModified++;
+        writer.begin(304, entry->contentType.c_str(), 0);
+        writer.end();
+        return true;
+    }
+
+    writer.begin(200, entry->contentType.c_str(), entry->body.length());
+    writer.write(entry->body.c_str(), entry->body.length());
+    writer.end();
+    return true;
+}
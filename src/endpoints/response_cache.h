@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "endpoint_types.h"
+#include "zap_str.h"
+
+/**
+ * @brief Keeps the serialised GET responses of handlers that can tell when they change
+ *
+ * A handler that returns a version from getCacheVersion() is run once per version. Its
+ * body is kept together with an ETag, a hash of the body, and later GETs with the same
+ * version are answered from the copy. A handler has at most one entry, a new version
+ * replaces the old one. When all ENTRIES are taken the least recently used one goes.
+ *
+ * A request whose If-None-Match holds the ETag gets a 304 without a body. As the ETag
+ * hashes the body rather than the version, it stays valid across reboots.
+ *
+ * Only 200 responses up to MAX_BODY_SIZE are kept. Not thread safe, the web server
+ * task is the only user.
+ */
+class ResponseCache {
+public:
+    static const size_t ENTRIES = 4;
+    static const size_t MAX_BODY_SIZE = 2048;
+    static const size_t ETAG_SIZE = 19;     // 16 hex digits in quotes and a NUL
+
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t notModified;   // Answered with a 304, also counted as a hit or miss
+        uint32_t evictions;
+        uint32_t uncached;      // Responses that were not a 200 or too large to keep
+    };
+
+    ResponseCache();
+
+    /**
+     * @brief Answers a GET from the cache, running the handler when its version changed
+     *
+     * @return false when the request does not take part, the caller runs the handler
+     */
+    bool serve(const EndpointRequest& request, ResponseWriter& writer);
+
+    void clear();
+
+    const Stats& getStats() const { return stats; }
+
+    /** @brief Share of cacheable requests that did not run the handler */
+    uint8_t getHitPercent() const;
+
+    /** @brief True when an If-None-Match value names the ETag or is "*" */
+    static bool matches(const char* ifNoneMatch, const char* etag);
+
+private:
+    struct Entry {
+        const EndpointFunction* handler;    // nullptr for a free entry
+        uint32_t version;
+        uint32_t lastUsed;
+        zap::Str contentType;
+        zap::Str body;
+        char etag[ETAG_SIZE];
+    };
+
+    Entry* entryFor(const EndpointFunction* handler);
+
+    Entry entries[ENTRIES];
+    uint32_t useCounter;
+    Stats stats;
+};
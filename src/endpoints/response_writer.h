@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include "json_light/generic_json_builder.h"
+
+class EventStream;
+
+/**
+ * @brief Destination for an endpoint response that is written as it is produced
+ *
+ * A handler calls begin once, write any number of times and then end. The web server
+ * sends each write as an HTTP/1.1 chunk, so a response never has to fit in memory.
+ */
+class ResponseWriter {
+public:
+    static const size_t UNKNOWN_LENGTH = (size_t)-1;
+
+    virtual ~ResponseWriter() {}
+
+    /** @brief Starts the response, contentLength is UNKNOWN_LENGTH when the body is streamed */
+    virtual void begin(int statusCode, const char* contentType, size_t contentLength = UNKNOWN_LENGTH) = 0;
+    virtual void write(const char* data, size_t length) = 0;
+    virtual void end() = 0;
+
+    /** @brief One extra header for the next begin, transports without headers ignore it */
+    virtual void setHeader(const char* name, const char* value) {}
+
+    /**
+     * @brief Turns the response into a text/event-stream that sends every event of the stream
+     *
+     * Takes the place of begin, write and end. The connection stays open and is fed by the
+     * server until the client goes away.
+     *
+     * @return false when the transport cannot keep a response open or the stream is full
+     */
+    virtual bool subscribe(EventStream& stream) { return false; }
+};
+
+// Bytes held back before a write, this bounds the memory a streamed JSON response takes
+static const size_t RESPONSE_CHUNK_SIZE = 512;
+
+using StreamingJsonBuilder = zap::GenericJsonBuilder<zap::JsonBuilderChunkedBuffer<ResponseWriter, RESPONSE_CHUNK_SIZE>>;
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "endpoint_types.h"
+
+/**
+ * @brief Path and verb lookup over a constexpr endpoint array, laid out by the compiler.
+ *
+ * Every path+verb pair gets its own slot through a perfect hash, the seed for it is
+ * searched at compile time. A lookup hashes the path once and compares a single entry,
+ * nothing is allocated.
+ *
+ * A path whose last segment is a lone '*' is a prefix route: "/api/data/" with the '*'
+ * matches "/api/data/p1" and everything else under "/api/data/". Exact paths win, then
+ * the longest prefix.
+ *
+ * The constexpr functions are single return statements so they also build as C++11.
+ */
+namespace route_table {
+
+    static const uint8_t EMPTY_SLOT = 0xFF;
+    static const uint32_t NO_SEED = 0;
+    static const uint32_t MAX_SEED = 4096;
+
+    // Prefix routes probed per lookup, one per '/' in the request path
+    static const size_t MAX_PREFIX_DEPTH = 8;
+
+    static const uint32_t FNV_OFFSET = 2166136261u;
+    static const uint32_t FNV_PRIME = 16777619u;
+
+    constexpr bool equal(const char* a, const char* b) {
+        return *a == *b && (*a == '\0' || equal(a + 1, b + 1));
+    }
+
+    /** @brief True for paths whose last segment is a lone '*' */
+    constexpr bool isPrefix(const char* path) {
+        return path[0] != '\0' && ((path[0] == '/' && path[1] == '*' && path[2] == '\0') || isPrefix(path + 1));
+    }
+
+    constexpr uint32_t mix(uint32_t hash, uint8_t c) {
+        return (hash ^ c) * FNV_PRIME;
+    }
+
+    /** @brief Hash start for a verb, prefix routes hash apart from an exact path with the same text */
+    constexpr uint32_t start(uint32_t seed, Endpoint::Verb verb, bool prefix) {
+        return mix(FNV_OFFSET ^ seed, (uint8_t)((uint8_t)verb | (prefix ? 0x80 : 0)));
+    }
+
+    // The '*' of a prefix route is not hashed, the request path is hashed up to the '/' before it
+    constexpr uint32_t hashPath(uint32_t hash, const char* path) {
+        return (*path == '\0' || *path == '*') ? hash : hashPath(mix(hash, (uint8_t)*path), path + 1);
+    }
+
+    constexpr uint32_t hash(uint32_t seed, const Endpoint& entry) {
+        return hashPath(start(seed, entry.verb, isPrefix(entry.path)), entry.path);
+    }
+
+    /** @brief Power of two with at least four slots per entry, that keeps the seed search short */
+    constexpr size_t slotCount(size_t entries, size_t slots = 8) {
+        return slots >= entries * 4 ? slots : slotCount(entries, slots * 2);
+    }
+
+    template <size_t N>
+    constexpr uint32_t slotOf(const Endpoint (&entries)[N], uint32_t seed, size_t i) {
+        return hash(seed, entries[i]) & (slotCount(N) - 1);
+    }
+
+    template <size_t N>
+    constexpr bool collides(const Endpoint (&entries)[N], uint32_t seed, size_t i, size_t j) {
+        return j < N && (slotOf(entries, seed, i) == slotOf(entries, seed, j) || collides(entries, seed, i, j + 1));
+    }
+
+    template <size_t N>
+    constexpr bool collisionFree(const Endpoint (&entries)[N], uint32_t seed, size_t i = 0) {
+        return i >= N || (!collides(entries, seed, i, i + 1) && collisionFree(entries, seed, i + 1));
+    }
+
+    template <size_t N>
+    constexpr uint32_t findSeed(const Endpoint (&entries)[N], uint32_t low = 1, uint32_t high = MAX_SEED);
+
+    // The left half is searched once and its result passed in, the right half only when it found nothing
+    template <size_t N>
+    constexpr uint32_t seedOrRight(const Endpoint (&entries)[N], uint32_t left, uint32_t middle, uint32_t high) {
+        return left != NO_SEED ? left : findSeed(entries, middle, high);
+    }
+
+    /** @brief First seed in [low, high) without collisions, split in halves to keep the recursion shallow */
+    template <size_t N>
+    constexpr uint32_t findSeed(const Endpoint (&entries)[N], uint32_t low, uint32_t high) {
+        return high - low == 1
+            ? (collisionFree(entries, low) ? low : NO_SEED)
+            : seedOrRight(entries, findSeed(entries, low, low + (high - low) / 2), low + (high - low) / 2, high);
+    }
+
+    template <size_t N>
+    constexpr bool samePathAndVerb(const Endpoint (&entries)[N], size_t i, size_t j) {
+        return entries[i].verb == entries[j].verb && equal(entries[i].path, entries[j].path);
+    }
+
+    template <size_t N>
+    constexpr bool duplicateOf(const Endpoint (&entries)[N], size_t i, size_t j) {
+        return j < N && (samePathAndVerb(entries, i, j) || duplicateOf(entries, i, j + 1));
+    }
+
+    /** @brief True when two entries share both path and verb */
+    template <size_t N>
+    constexpr bool hasDuplicates(const Endpoint (&entries)[N], size_t i = 0) {
+        return i < N && (duplicateOf(entries, i, i + 1) || hasDuplicates(entries, i + 1));
+    }
+
+    template <size_t N>
+    constexpr uint8_t entryForSlot(const Endpoint (&entries)[N], uint32_t seed, uint32_t slot, size_t i = 0) {
+        return i >= N ? EMPTY_SLOT : (slotOf(entries, seed, i) == slot ? (uint8_t)i : entryForSlot(entries, seed, slot, i + 1));
+    }
+
+    template <size_t N>
+    constexpr bool anyPrefix(const Endpoint (&entries)[N], size_t i = 0) {
+        return i < N && (isPrefix(entries[i].path) || anyPrefix(entries, i + 1));
+    }
+
+    template <size_t... I> struct Indices {};
+    template <size_t N, size_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+    template <size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+    template <size_t N>
+    class RouteTable {
+    public:
+        static constexpr size_t SLOTS = slotCount(N);
+
+        const Endpoint* entries;
+        uint32_t seed;
+        bool hasPrefixes;
+        uint8_t slots[SLOTS];
+
+        /**
+         * @brief Index of the entry for this verb and path, or -1
+         *
+         * @param path Request path, not NUL terminated
+         * @param length Length of the path
+         */
+        int find(Endpoint::Verb verb, const char* path, size_t length) const {
+            if (verb == Endpoint::Verb::UNKNOWN) {
+                return -1;
+            }
+
+            // One pass hashes the whole path and every prefix of it up to a '/'
+            uint32_t exactHash = start(seed, verb, false);
+            uint32_t prefixHash = start(seed, verb, true);
+            uint32_t prefixHashes[MAX_PREFIX_DEPTH];
+            size_t prefixLengths[MAX_PREFIX_DEPTH];
+            size_t depth = 0;
+
+            for (size_t i = 0; i < length; i++) {
+                const uint8_t c = (uint8_t)path[i];
+                exactHash = mix(exactHash, c);
+                if (hasPrefixes) {
+                    prefixHash = mix(prefixHash, c);
+                    if (c == '/' && depth < MAX_PREFIX_DEPTH) {
+                        prefixHashes[depth] = prefixHash;
+                        prefixLengths[depth] = i + 1;
+                        depth++;
+                    }
+                }
+            }
+
+            const uint8_t exact = slots[exactHash & (SLOTS - 1)];
+            if (exact != EMPTY_SLOT && matches(entries[exact], verb, path, length, false)) {
+                return exact;
+            }
+
+            while (depth > 0) {
+                depth--;
+                const uint8_t prefix = slots[prefixHashes[depth] & (SLOTS - 1)];
+                if (prefix != EMPTY_SLOT && matches(entries[prefix], verb, path, prefixLengths[depth], true)) {
+                    return prefix;
+                }
+            }
+            return -1;
+        }
+
+    private:
+        static bool matches(const Endpoint& entry, Endpoint::Verb verb, const char* path, size_t length, bool prefix) {
+            if (entry.verb != verb || isPrefix(entry.path) != prefix) {
+                return false;
+            }
+            // A prefix route is compared without its '*'
+            const size_t entryLength = strlen(entry.path) - (prefix ? 1 : 0);
+            return entryLength == length && memcmp(entry.path, path, length) == 0;
+        }
+    };
+
+    template <size_t N>
+    constexpr size_t RouteTable<N>::SLOTS;
+
+    template <size_t N, size_t... S>
+    constexpr RouteTable<N> build(const Endpoint (&entries)[N], uint32_t seed, Indices<S...>) {
+        return RouteTable<N>{entries, seed, anyPrefix(entries), {entryForSlot(entries, seed, S)...}};
+    }
+
+    /** @brief Builds the table for a constexpr endpoint array, check it with ROUTE_TABLE_CHECKS */
+    template <size_t N>
+    constexpr RouteTable<N> build(const Endpoint (&entries)[N]) {
+        return build(entries, findSeed(entries), typename MakeIndices<RouteTable<N>::SLOTS>::type());
+    }
+}
+
+// Compile time checks for a table, fails the build on duplicate path/verb pairs or when no seed is found
+#define ROUTE_TABLE_CHECKS(entries) \
+    static_assert(!route_table::hasDuplicates(entries), "duplicate path and verb in " #entries); \
+    static_assert(route_table::findSeed(entries) != route_table::NO_SEED, "no perfect hash seed for " #entries ", raise MAX_SEED")
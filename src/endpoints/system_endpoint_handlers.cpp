@@ -63,8 +63,8 @@ EndpointResponse SystemInfoHandler::handle(const zap::Str& contents) {
     json.beginObject("zap");
     
     // Device info
-    zap::Str deviceId = crypto_getId();
-    json.add("deviceId", deviceId.c_str());
+    const DeviceIdentity& identity = crypto_get_identity();
+    json.add("deviceId", identity.id.c_str());
     json.add("cpuFreqMHz", ESP.getCpuFreqMHz());
     
     json.add("flashSizeMB", (float)ESP.getFlashChipSize() / (1024.0f * 1024.0f));
@@ -72,8 +72,7 @@ EndpointResponse SystemInfoHandler::handle(const zap::Str& contents) {
     json.add("sdkVersion", ESP.getSdkVersion());
     json.add("firmwareVersion", getFirmwareVersion());
     
-    zap::Str publicKey = crypto_get_public_key(PRIVATE_KEY_HEX);
-    json.add("publicKey", publicKey.c_str());
+    json.add("publicKey", identity.publicKeyHex.c_str());
     
     json.beginObject("network");
     // WiFi status
@@ -2,8 +2,8 @@
 
 #include "zap_str.h" // Include your existing string class
 #include <vector>
-#include <cstdio> // For sprintf used in escaping control characters
-#include <cstdarg> 
+#include <cstdio> // For snprintf when a float is outside the fast path
+#include <math.h>
 
 namespace zap {
 
@@ -11,6 +11,101 @@ namespace zap {
 class JsonBuilderDynamicBuffer;
 class JsonBuilderFixedBuffer;
 
+/**
+ * Number to text without printf, the output is the same as %d, %u, %llu and %g give.
+ * Each format() writes at most MAX_LENGTH chars to out, without a terminator, and
+ * returns how many it wrote.
+ */
+struct JsonNumberFormat {
+    static const size_t MAX_LENGTH = 24;
+
+    static size_t format(uint64_t value, char* out) {
+        // Digits are written backwards from the end of a scratch buffer and copied once
+        char digits[MAX_LENGTH];
+        char* start = digits + MAX_LENGTH;
+        do {
+            *--start = (char)('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        const size_t length = digits + MAX_LENGTH - start;
+        memcpy(out, start, length);
+        return length;
+    }
+
+    static size_t format(uint32_t value, char* out) {
+        return format((uint64_t)value, out);
+    }
+
+    static size_t format(int value, char* out) {
+        if (value >= 0) {
+            return format((uint64_t)value, out);
+        }
+        *out = '-';
+        // Through int64_t so INT_MIN negates without overflow
+        return 1 + format((uint64_t)(-(int64_t)value), out + 1);
+    }
+
+    /**
+     * %g of the float, six significant digits without trailing zeros. The float is scaled
+     * by a power of ten to a six digit integer, which is exact in a double so rint() rounds
+     * it the way printf does. Values that need an exponent, or whose rounding carries into
+     * a seventh digit, go to snprintf.
+     */
+    static size_t format(float value, char* out) {
+        static const uint32_t POWERS[] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+                                          10000000, 100000000, 1000000000};
+        const double magnitude = value < 0 ? -(double)value : (double)value;
+        if (!(magnitude < 1e6)) {
+            return formatSlow(value, out);
+        }
+        // Decimals so the integer part has six digits, up to 9 for 1e-4
+        size_t decimals = 0;
+        while (decimals < 10 && magnitude * POWERS[decimals] < 1e5) {
+            decimals++;
+        }
+        if (decimals == 10) {
+            return formatSlow(value, out);
+        }
+        const double scaled = rint(magnitude * POWERS[decimals]);
+        if (scaled >= 1e6) {
+            return formatSlow(value, out);
+        }
+
+        const uint32_t digits = (uint32_t)scaled;
+        size_t length = 0;
+        if (value < 0) {
+            out[length++] = '-';
+        }
+        length += format(digits / POWERS[decimals], out + length);
+        uint32_t fraction = digits % POWERS[decimals];
+        if (fraction != 0) {
+            size_t shown = decimals;
+            while (fraction % 10 == 0) {
+                fraction /= 10;
+                shown--;
+            }
+            out[length++] = '.';
+            for (size_t i = shown; i > 0; i--) {
+                out[length + i - 1] = (char)('0' + fraction % 10);
+                fraction /= 10;
+            }
+            length += shown;
+        }
+        return length;
+    }
+
+private:
+    static size_t formatSlow(float value, char* out) {
+        char text[MAX_LENGTH];
+        const int written = snprintf(text, sizeof(text), "%g", value);
+        if (written <= 0 || (size_t)written >= sizeof(text)) {
+            return 0;
+        }
+        memcpy(out, text, written);
+        return (size_t)written;
+    }
+};
+
 /**
  * A generic JSON builder that uses a buffer strategy pattern
  */
@@ -20,32 +115,41 @@ private:
     BufferStrategy _buffer;
     bool _firstItem;
     bool _inObject;
-    std::vector<bool> _objectStack; // Stack to track firstItem state for nested objects
+    // Objects open, endObject() always leaves an item in the parent so the depth is all
+    // there is to remember and nesting needs no heap
+    size_t _depth;
 
     // --- Helper function to append an escaped string ---
     void appendEscaped(const char* str) {
         if (!str) return;
         while (*str) {
-            char c = *str++;
+            // Copy the run of characters that need no escape in one go
+            const char* run = str;
+            while (*str && *str != '"' && *str != '\\' && static_cast<unsigned char>(*str) >= 0x20) {
+                str++;
+            }
+            if (str != run) {
+                _buffer.append(run, str - run);
+            }
+            if (!*str) {
+                break;
+            }
+            const char c = *str++;
             switch (c) {
-                case '"':  _buffer.append("\\\""); break;
-                case '\\': _buffer.append("\\\\"); break;
-                case '\b': _buffer.append("\\b"); break;
-                case '\f': _buffer.append("\\f"); break;
-                case '\n': _buffer.append("\\n"); break;
-                case '\r': _buffer.append("\\r"); break;
-                case '\t': _buffer.append("\\t"); break;
-                default:
-                    // Check for control characters (U+0000 to U+001F)
-                    if (static_cast<unsigned char>(c) < 0x20) {
-                        char hex_buf[7]; // "\\uXXXX\0"
-                        sprintf(hex_buf, "\\u%04x", static_cast<unsigned char>(c));
-                        _buffer.append(hex_buf);
-                    } else {
-                        // Regular character
-                        _buffer.append(c);
-                    }
+                case '"':  _buffer.append("\\\"", 2); break;
+                case '\\': _buffer.append("\\\\", 2); break;
+                case '\b': _buffer.append("\\b", 2); break;
+                case '\f': _buffer.append("\\f", 2); break;
+                case '\n': _buffer.append("\\n", 2); break;
+                case '\r': _buffer.append("\\r", 2); break;
+                case '\t': _buffer.append("\\t", 2); break;
+                default: {
+                    // Other control characters (U+0000 to U+001F)
+                    static const char digits[] = "0123456789abcdef";
+                    const char hex[6] = {'\\', 'u', '0', '0', digits[(c >> 4) & 0x0f], digits[c & 0x0f]};
+                    _buffer.append(hex, sizeof(hex));
                     break;
+                }
             }
         }
     }
@@ -62,13 +166,14 @@ public:
     GenericJsonBuilder(Args&&... args)
         : _buffer(std::forward<Args>(args)...),
           _firstItem(true),
-          _inObject(false) {}
+          _inObject(false),
+          _depth(0) {}
 
     // Start a new object
     GenericJsonBuilder& beginObject() {
         if (!_firstItem && _inObject) _buffer.append(','); // Add comma if not first item *in current object*
         _buffer.append('{');
-        _objectStack.push_back(_firstItem); // Save current state
+        _depth++;
         _firstItem = true;
         _inObject = true;
         return *this;
@@ -82,7 +187,7 @@ public:
         _buffer.append('"');
         _buffer.append(key);
         _buffer.append("\":{");
-        _objectStack.push_back(_firstItem); // Save current state
+        _depth++;
         _firstItem = true;
         _inObject = true;
         return *this;
@@ -91,11 +196,9 @@ public:
     // End the current object
     GenericJsonBuilder& endObject() {
         _buffer.append('}');
-        if (!_objectStack.empty()) {
-            _firstItem = _objectStack.back(); // Restore previous state
-            _objectStack.pop_back();
-            // Determine _inObject based on whether the stack is now empty
-            _inObject = !_objectStack.empty();
+        if (_depth > 0) {
+            _depth--;
+            _inObject = _depth > 0;
             _firstItem = false; // After closing an object, we've added an item to the parent context
         } else {
              _inObject = false; // No longer in any object
@@ -176,14 +279,21 @@ public:
 
     // Adds raw binary data as a hex string (already safe)
     GenericJsonBuilder& add(const char* key, const uint8_t* data, size_t size) {
+        return addHex(key, size, [data](size_t i) { return data[i]; });
+    }
+
+    // Adds size bytes as a hex string, byteAt(i) returns byte i so the bytes need not be contiguous
+    template <typename ByteAt>
+    GenericJsonBuilder& addHex(const char* key, size_t size, ByteAt byteAt) {
+        static const char digits[] = "0123456789abcdef";
         if (!_firstItem) _buffer.append(',');
         _buffer.append('"');
         _buffer.append(key);
         _buffer.append("\":\"");
         for (size_t i = 0; i < size; i++) {
-            char hex[3];
-            sprintf(hex, "%02x", data[i]);
-            _buffer.append(hex);
+            const uint8_t byte = byteAt(i);
+            const char pair[2] = {digits[byte >> 4], digits[byte & 0x0f]};
+            _buffer.append(pair, sizeof(pair));
         }
         _buffer.append('"');
         _firstItem = false;
@@ -195,7 +305,7 @@ public:
         _buffer.append('"');
         _buffer.append(key);
         _buffer.append("\":");
-        _buffer.append(value); // Note: Precision issues might occur. Consider snprintf for control.
+        _buffer.append(value); // %g, six significant digits
         _firstItem = false;
         return *this;
     }
@@ -241,9 +351,9 @@ public:
 
     // End all objects and get the result
      auto end() -> decltype(_buffer.get()) {
-        while (_inObject && !_objectStack.empty()) {
+        while (_inObject && _depth > 0) {
             _buffer.append('}');
-            _objectStack.pop_back();
+            _depth--;
         }
         _inObject = false;
         return _buffer.get();
@@ -254,7 +364,7 @@ public:
         _buffer.clear();
         _firstItem = true;
         _inObject = false;
-        _objectStack.clear();
+        _depth = 0;
     }
 
     // Delegate to buffer for status
@@ -270,16 +380,36 @@ public:
 class JsonBuilderDynamicBuffer {
 private:
     zap::Str _str;
+    size_t _reserved;
+
+    // zap::Str grows by a few bytes at a time, doubling keeps a document to a handful of reallocs
+    void grow(size_t extra) {
+        const size_t needed = _str.length() + extra + 1;
+        if (needed > _reserved) {
+            _reserved = needed > 2 * _reserved ? needed : 2 * _reserved;
+            _str.reserve(_reserved);
+        }
+    }
+
+    template <typename Number>
+    void appendNumber(Number value) {
+        char text[JsonNumberFormat::MAX_LENGTH];
+        append(text, JsonNumberFormat::format(value, text));
+    }
 
 public:
-    JsonBuilderDynamicBuffer() = default;
+    JsonBuilderDynamicBuffer() : _reserved(0) {}
 
-    void append(const char* s) { _str += s; }
-    void append(char c) { _str += c; }
-    void append(int value) { _str += value; }
-    void append(uint32_t value) { _str += value; }
-    void append(uint64_t value) { _str += value; }
-    void append(float value) { _str += zap::Str(value); } // Assuming zap::Str has float constructor
+    void append(const char* s, size_t len) {
+        grow(len);
+        _str.append(s, len);
+    }
+    void append(const char* s) { if (s) append(s, strlen(s)); }
+    void append(char c) { grow(1); _str += c; }
+    void append(int value) { appendNumber(value); }
+    void append(uint32_t value) { appendNumber(value); }
+    void append(uint64_t value) { appendNumber(value); }
+    void append(float value) { appendNumber(value); }
 
     const zap::Str& get() const { return _str; }
     void clear() { _str.clear(); }
@@ -312,8 +442,12 @@ public:
 
     void append(const char* s) {
         if (_overflow || !s) return; // Check for null input string
+        append(s, strlen(s));
+    }
+
+    void append(const char* s, size_t len) {
+        if (_overflow) return;
 
-        size_t len = strlen(s);
         // Need space for string AND null terminator
         if (_length + len >= _capacity) { // Use >= because _length is 0-based index, capacity is size
             _overflow = true;
@@ -346,55 +480,23 @@ public:
         _buffer[_length] = '\0';
     }
 
-    // Helper for appending formatted numbers to fixed buffer
-    void appendFormatted(const char* format, ...) {
-         if (_overflow) return;
-
-         va_list args;
-         va_start(args, format);
-
-         // Calculate remaining space (leaving 1 for null terminator)
-         size_t remaining_capacity = (_capacity > _length) ? (_capacity - _length) : 0;
-
-         // Use vsnprintf for safe printing into the buffer
-         int written = vsnprintf(_buffer + _length, remaining_capacity, format, args);
-
-         va_end(args);
-
-         if (written < 0 || static_cast<size_t>(written) >= remaining_capacity) {
-             // Encoding error or buffer full
-             _overflow = true;
-             if (_length < _capacity) {
-                 _buffer[_length] = '\0'; // Ensure null termination at the current point
-             }
-         } else {
-             // Success
-             _length += written;
-             // vsnprintf should have added the null terminator
-         }
-    }
-
-
-    void append(int value) {
-        appendFormatted("%d", value);
-    }
-
-    void append(uint32_t value) {
-        appendFormatted("%u", value);
-    }
-
-    void append(uint64_t value) {
-         // Check which format specifier is correct for uint64_t on your platform
-         // C99 standard uses %llu
-        appendFormatted("%llu", (unsigned long long)value);
+    // Numbers are formatted straight into the buffer when the longest one fits
+    template <typename Number>
+    void appendNumber(Number value) {
+        if (_overflow) return;
+        if (_capacity - _length > JsonNumberFormat::MAX_LENGTH) {
+            _length += JsonNumberFormat::format(value, _buffer + _length);
+            _buffer[_length] = '\0';
+        } else {
+            char text[JsonNumberFormat::MAX_LENGTH];
+            append(text, JsonNumberFormat::format(value, text));
+        }
     }
 
-    void append(float value) {
-         // Use %g for general format, but consider precision needs.
-         // %f or %e might be better depending on requirements.
-         // Adjust precision as needed, e.g., "%.7g"
-         appendFormatted("%g", value);
-    }
+    void append(int value) { appendNumber(value); }
+    void append(uint32_t value) { appendNumber(value); }
+    void append(uint64_t value) { appendNumber(value); }
+    void append(float value) { appendNumber(value); }
 
     const char* get() const { return _buffer; }
 
@@ -415,5 +517,76 @@ public:
     size_t capacity() const { return _capacity; }
 };
 
+/**
+ * Chunked buffer strategy that hands the output to a writer every CHUNK_SIZE bytes,
+ * the whole document is never in memory. Writer needs write(const char*, size_t).
+ */
+template <typename Writer, size_t CHUNK_SIZE>
+class JsonBuilderChunkedBuffer {
+private:
+    Writer& _writer;
+    char _chunk[CHUNK_SIZE];
+    size_t _used;
+    size_t _flushed;
+
+    template <typename Number>
+    void appendNumber(Number value) {
+        char text[JsonNumberFormat::MAX_LENGTH];
+        append(text, JsonNumberFormat::format(value, text));
+    }
+
+public:
+    explicit JsonBuilderChunkedBuffer(Writer& writer) : _writer(writer), _used(0), _flushed(0) {}
+
+    void append(const char* s, size_t len) {
+        while (len > 0) {
+            if (_used == CHUNK_SIZE) {
+                flush();
+            }
+            const size_t room = CHUNK_SIZE - _used;
+            const size_t part = len < room ? len : room;
+            memcpy(_chunk + _used, s, part);
+            _used += part;
+            s += part;
+            len -= part;
+        }
+    }
+
+    void append(const char* s) {
+        if (!s) return;
+        append(s, strlen(s));
+    }
+
+    void append(char c) {
+        if (_used == CHUNK_SIZE) {
+            flush();
+        }
+        _chunk[_used++] = c;
+    }
+
+    void append(int value) { appendNumber(value); }
+    void append(uint32_t value) { appendNumber(value); }
+    void append(uint64_t value) { appendNumber(value); }
+    void append(float value) { appendNumber(value); }
+
+    void flush() {
+        if (_used > 0) {
+            _writer.write(_chunk, _used);
+            _flushed += _used;
+            _used = 0;
+        }
+    }
+
+    // Writes out what is left, returns the number of bytes written in total
+    size_t get() {
+        flush();
+        return _flushed;
+    }
+
+    // What has been written out cannot be taken back, only the unsent part is dropped
+    void clear() { _used = 0; }
+    bool hasOverflow() const { return false; }
+    size_t length() const { return _flushed + _used; }
+};
 
 } // namespace zap
\ No newline at end of file
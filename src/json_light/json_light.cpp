@@ -17,7 +17,154 @@ size_t JsonParser::skipWhitespace(size_t pos) const {
     return pos;
 }
 
+// Index of the quote that ends the string starting at pos, end when there is none
+static size_t closingQuote(const char* data, size_t pos, size_t end) {
+    for (pos++; pos < end; pos++) {
+        if (data[pos] == '\\') {
+            pos++;
+        } else if (data[pos] == '"') {
+            return pos;
+        }
+    }
+    return end;
+}
+
+size_t JsonParser::index(JsonTapeEntry* entries, size_t capacity) {
+    tape = nullptr;
+    tapeIndex = 0;
+    const size_t end = endPos < dataLen ? endPos : dataLen;
+    if (end > 0xFFFF) {
+        return 0;
+    }
+
+    uint16_t open[MAX_TAPE_DEPTH];  // Containers that are not closed yet
+    size_t depth = 0;
+    size_t count = 0;
+    size_t pos = startPos;
+
+    while (true) {
+        while (pos < end && isspace(data[pos])) pos++;
+        if (pos >= end) {
+            return 0;
+        }
+
+        // In an object each value comes after its key
+        size_t keyStart = 0;
+        size_t keyLength = 0;
+        if (depth > 0 && data[entries[open[depth - 1]].valueStart] == '{') {
+            const size_t keyEnd = data[pos] == '"' ? closingQuote(data, pos, end) : end;
+            if (keyEnd >= end) {
+                return 0;
+            }
+            keyStart = pos + 1;
+            keyLength = keyEnd - keyStart;
+            pos = keyEnd + 1;
+            while (pos < end && isspace(data[pos])) pos++;
+            if (pos >= end || data[pos] != ':') {
+                return 0;
+            }
+            pos++;
+            while (pos < end && isspace(data[pos])) pos++;
+            if (pos >= end) {
+                return 0;
+            }
+        }
+
+        if (count == capacity) {
+            return 0;
+        }
+        JsonTapeEntry& entry = entries[count++];
+        entry.keyStart = (uint16_t)keyStart;
+        entry.keyLength = (uint16_t)keyLength;
+        entry.valueStart = (uint16_t)pos;
+
+        const char c = data[pos];
+        if (c == '{' || c == '[') {
+            pos++;
+            while (pos < end && isspace(data[pos])) pos++;
+            if (pos < end && data[pos] != (c == '{' ? '}' : ']')) {
+                if (depth == MAX_TAPE_DEPTH) {
+                    return 0;
+                }
+                open[depth++] = (uint16_t)(count - 1);
+                continue;
+            }
+            if (pos >= end) {
+                return 0;
+            }
+            pos++;
+        } else if (c == '"') {
+            pos = closingQuote(data, pos, end);
+            if (pos >= end) {
+                return 0;
+            }
+            pos++;
+        } else {
+            // Numbers and literals run up to the next delimiter, the getters check them
+            while (pos < end && !isspace(data[pos]) && data[pos] != ',' && data[pos] != '}' && data[pos] != ']') pos++;
+            if (pos == entry.valueStart) {
+                return 0;
+            }
+        }
+        entry.valueEnd = (uint16_t)pos;
+        entry.next = (uint16_t)count;
+
+        // Close what ends here, up to the comma before the next value
+        while (true) {
+            if (depth == 0) {
+                tape = entries;
+                return count;
+            }
+            while (pos < end && isspace(data[pos])) pos++;
+            if (pos >= end) {
+                return 0;
+            }
+            if (data[pos] == ',') {
+                pos++;
+                break;
+            }
+            JsonTapeEntry& container = entries[open[depth - 1]];
+            if (data[pos] != (data[container.valueStart] == '{' ? '}' : ']')) {
+                return 0;
+            }
+            pos++;
+            container.valueEnd = (uint16_t)pos;
+            container.next = (uint16_t)count;
+            depth--;
+        }
+    }
+}
+
+size_t JsonParser::findTapeKey(const char* key) const {
+    const JsonTapeEntry& object = tape[tapeIndex];
+    if (data[object.valueStart] != '{') {
+        return 0;
+    }
+    const size_t keyLength = strlen(key);
+    for (size_t i = tapeIndex + 1; i < object.next; i = tape[i].next) {
+        if (tape[i].keyLength == keyLength && tape[i].keyStart != 0 &&
+            memcmp(data + tape[i].keyStart, key, keyLength) == 0) {
+            return tape[i].valueStart - startPos;
+        }
+    }
+    return 0;
+}
+
+size_t JsonParser::tapeEntryAt(size_t absolute) const {
+    const size_t last = tape[tapeIndex].next;
+    for (size_t i = tapeIndex + 1; i < last; i = tape[i].next) {
+        if (tape[i].valueStart == absolute) {
+            return i;
+        }
+    }
+    return last;
+}
+
 size_t JsonParser::findKey(const char* key, size_t pos) const {
+    if (tape != nullptr && pos == 0) {
+        return findTapeKey(key);
+    }
+
     pos = skipWhitespace(pos);
     
     // If at the start of the view, expect an opening brace
@@ -213,6 +360,163 @@ int hex_to_utf8(const char* hex_chars, char* utf8_buffer) {
 }
 
 
+// Decodes the character or escape sequence at in, like getStringValue does
+// Returns the bytes written to out (at most 4) and how many characters were read
+static size_t unescapeNext(const char* in, size_t remaining, char* out, size_t& consumed) {
+    if (in[0] != '\\' || remaining < 2) {
+        out[0] = in[0];
+        consumed = 1;
+        return 1;
+    }
+    consumed = 2;
+    switch (in[1]) {
+        case 'b': out[0] = '\b'; return 1;
+        case 'f': out[0] = '\f'; return 1;
+        case 'n': out[0] = '\n'; return 1;
+        case 'r': out[0] = '\r'; return 1;
+        case 't': out[0] = '\t'; return 1;
+        case 'u':
+            if (remaining < 6) {
+                // Cut short, the rest of the text goes with it
+                consumed = remaining;
+                out[0] = '?';
+                return 1;
+            } else {
+                char hex[5] = {in[2], in[3], in[4], in[5], '\0'};
+                consumed = 6;
+                const int written = hex_to_utf8(hex, out);
+                if (written == 0) {
+                    out[0] = '?';
+                    return 1;
+                }
+                return written;
+            }
+        default:
+            // Quotes, slashes and unknown escapes are the character itself
+            out[0] = in[1];
+            return 1;
+    }
+}
+
+size_t JsonStringView::unescape(const char* in, size_t length, char* out) {
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < length) {
+        // The sequence is read before anything is written, so out may trail in
+        char utf8[4];
+        size_t consumed;
+        const size_t bytes = unescapeNext(in + pos, length - pos, utf8, consumed);
+        memcpy(out + written, utf8, bytes);
+        written += bytes;
+        pos += consumed;
+    }
+    return written;
+}
+
+bool JsonStringView::equals(const char* text) const {
+    if (!hasEscapes) {
+        return strlen(text) == length && memcmp(data, text, length) == 0;
+    }
+    size_t pos = 0;
+    while (pos < length) {
+        char utf8[4];
+        size_t consumed;
+        const size_t bytes = unescapeNext(data + pos, length - pos, utf8, consumed);
+        for (size_t i = 0; i < bytes; i++) {
+            if (text[i] == '\0' || text[i] != utf8[i]) {
+                return false;
+            }
+        }
+        text += bytes;
+        pos += consumed;
+    }
+    return *text == '\0';
+}
+
+bool JsonStringView::copyTo(char* out, size_t maxLen) const {
+    if (maxLen == 0) {
+        return false;
+    }
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < length) {
+        char utf8[4];
+        size_t consumed;
+        const size_t bytes = unescapeNext(data + pos, length - pos, utf8, consumed);
+        if (written + bytes >= maxLen) {
+            out[written] = '\0';
+            return false;
+        }
+        memcpy(out + written, utf8, bytes);
+        written += bytes;
+        pos += consumed;
+    }
+    out[written] = '\0';
+    return true;
+}
+
+void JsonStringView::copyTo(zap::Str& out) const {
+    out.clear();
+    if (!hasEscapes) {
+        out.append(data, length);
+        return;
+    }
+    size_t pos = 0;
+    while (pos < length) {
+        char utf8[4];
+        size_t consumed;
+        const size_t bytes = unescapeNext(data + pos, length - pos, utf8, consumed);
+        out.append(utf8, bytes);
+        pos += consumed;
+    }
+}
+
+bool JsonParser::getStringViewValue(size_t pos, JsonStringView& value, size_t& endPos) const {
+    pos = skipWhitespace(pos);
+    if (absPos(pos) >= dataLen || data[absPos(pos)] != '"') {
+        endPos = pos;
+        return false;
+    }
+
+    const size_t quote = closingQuote(data, absPos(pos), dataLen);
+    if (quote >= dataLen) {
+        endPos = dataLen - startPos;
+        return false;
+    }
+    value.data = data + absPos(pos) + 1;
+    value.length = quote - absPos(pos) - 1;
+    value.hasEscapes = memchr(value.data, '\\', value.length) != nullptr;
+    endPos = quote + 1 - startPos;
+    return true;
+}
+
+bool JsonParser::getStringView(const char* key, JsonStringView& value) {
+    size_t pos = findKey(key);
+    
+    if (pos == 0) {
+        return false;
+    }
+    
+    size_t endPos;
+    return getStringViewValue(pos, value, endPos);
+}
+
+bool JsonParser::getStringViewByPath(const char* path, JsonStringView& value) {
+    return getValueByPath(path, [&value](const JsonParser& parser, size_t pos, size_t& endPos) {
+        return parser.getStringViewValue(pos, value, endPos);
+    });
+}
+
+char* JsonParser::unescapeInPlace(const JsonStringView& value) {
+    if (writable == nullptr || value.data < data || value.data + value.length >= data + dataLen) {
+        return nullptr;
+    }
+    char* text = writable + (value.data - data);
+    // The closing quote is the last character that can be overwritten
+    text[JsonStringView::unescape(text, value.length, text)] = '\0';
+    return text;
+}
+
 // --- Modified getStringValue for C-style string ---
 bool JsonParser::getStringValue(size_t pos, char* value, size_t maxLen, size_t& endPos) const {
     pos = skipWhitespace(pos);
@@ -436,32 +740,8 @@ bool JsonParser::getObject(const char* key, JsonParser& result) {
         return false;
     }
     
-    // We should now be positioned at the start of an object
-    if (absPos(pos) >= dataLen || data[absPos(pos)] != '{') {
-        return false;
-    }
-    
-    // Find object boundaries
-    size_t objectStart = absPos(pos);
-    int depth = 1;
-    pos++;  // Skip opening brace
-    
-    while (absPos(pos) < dataLen && depth > 0) {
-        if (data[absPos(pos)] == '{') depth++;
-        else if (data[absPos(pos)] == '}') depth--;
-        pos++;
-    }
-    
-    if (depth != 0) {
-        return false;  // Unbalanced braces
-    }
-    
-    size_t objectEnd = absPos(pos);
-    
-    // Create a new parser as a view into this section of the buffer
-    result = JsonParser(data, dataLen, objectStart, objectEnd);
-    
-    return true;
+    size_t endPos;
+    return getObjectValue(pos, result, endPos);
 }
 
 bool JsonParser::getObjectValue(size_t pos, JsonParser& result, size_t& endPos) const {
@@ -472,6 +752,19 @@ bool JsonParser::getObjectValue(size_t pos, JsonParser& result, size_t& endPos)
         endPos = pos;
         return false;
     }
+
+    // The tape knows where it ends, and the view shares the tape
+    if (tape != nullptr) {
+        const size_t entry = tapeEntryAt(objectStart);
+        if (entry < tape[tapeIndex].next) {
+            result = JsonParser(data, dataLen, objectStart, tape[entry].valueEnd);
+            result.writable = writable;
+            result.tape = tape;
+            result.tapeIndex = (uint16_t)entry;
+            endPos = tape[entry].valueEnd - startPos;
+            return true;
+        }
+    }
     
     // Find object boundaries
     int depth = 1;
@@ -491,6 +784,7 @@ bool JsonParser::getObjectValue(size_t pos, JsonParser& result, size_t& endPos)
     
     // Create a new parser as a view into this section of the buffer
     result = JsonParser(data, dataLen, objectStart, objectEnd);
+    result.writable = writable;
     
     endPos = pos;
     return true;
@@ -11,12 +11,51 @@
 using JsonBuilder = zap::GenericJsonBuilder<zap::JsonBuilderDynamicBuffer>;
 using JsonBuilderFixed = zap::GenericJsonBuilder<zap::JsonBuilderFixedBuffer>;
 
+/**
+ * @brief One value of a document indexed by JsonParser::index
+ *
+ * Offsets are into the parser's buffer, a tape therefore covers documents up to 64 KB.
+ */
+struct JsonTapeEntry {
+    uint16_t valueStart;    // First character of the value
+    uint16_t valueEnd;      // One past its last character
+    uint16_t keyStart;      // First character of the key inside its quotes, 0 when it has none
+    uint16_t keyLength;
+    uint16_t next;          // Entry after the value and everything nested in it
+};
+
+/**
+ * @brief A string value where it is in the JSON text, without its quotes and not unescaped
+ *
+ * Nothing is copied until the text is needed, and values without escapes never have to be.
+ */
+struct JsonStringView {
+    const char* data;   // First character after the opening quote
+    size_t length;      // Up to the closing quote
+    bool hasEscapes;
+
+    JsonStringView() : data(""), length(0), hasEscapes(false) {}
+
+    // Compares the unescaped text
+    bool equals(const char* text) const;
+
+    // Unescapes into out with a terminator, false when it was cut to fit maxLen
+    bool copyTo(char* out, size_t maxLen) const;
+    void copyTo(zap::Str& out) const;
+
+    // Unescapes length characters of JSON string text, out may be in itself as the text only shrinks
+    static size_t unescape(const char* in, size_t length, char* out);
+};
+
 class JsonParser {
 private:
     const char* data;     // Original JSON buffer (not owned)
+    char* writable;       // The same buffer when the parser may rewrite it, otherwise nullptr
     size_t dataLen;       // Total length of the original buffer
     size_t startPos;      // Start position of our "view" into the buffer
     size_t endPos;        // End position of our "view"
+    const JsonTapeEntry* tape;  // Index from index(), nullptr to scan the text
+    uint16_t tapeIndex;         // Entry of this view in the tape
     
     // Helper to get absolute position in buffer
     size_t absPos(size_t relPos) const;
@@ -27,6 +66,10 @@ private:
     // Find a key in the current object
     // Returns the position of the value after the key, or 0 if not found
     size_t findKey(const char* key, size_t pos = 0) const;
+    size_t findTapeKey(const char* key) const;
+
+    // Entry of a value directly inside this view, tape[tapeIndex].next when there is none
+    size_t tapeEntryAt(size_t absolute) const;
     
     // Skip any JSON value (object, array, string, number, boolean, null)
     size_t skipValue(size_t pos) const;
@@ -34,6 +77,7 @@ private:
     // Get string value at current position
     bool getStringValue(size_t pos, char* value, size_t maxLen, size_t& endPos) const;
     bool getStringValue(size_t pos, zap::Str& value, size_t& endPos) const;
+    bool getStringViewValue(size_t pos, JsonStringView& value, size_t& endPos) const;
     
     // Get integer value at current position
     bool getIntValue(size_t pos, int& value, size_t& endPos) const;
@@ -50,16 +94,48 @@ public:
     // Constructor for full buffer
     explicit JsonParser(const char* jsonData) 
         : data(jsonData), 
+          writable(nullptr),
           dataLen(strlen(jsonData)), 
           startPos(0), 
-          endPos(strlen(jsonData)) {}
+          endPos(strlen(jsonData)),
+          tape(nullptr),
+          tapeIndex(0) {}
     
     // Constructor for a view into a buffer
     JsonParser(const char* jsonData, size_t length, size_t start, size_t end) 
         : data(jsonData), 
+          writable(nullptr),
           dataLen(length), 
           startPos(start), 
-          endPos(end) {}
+          endPos(end),
+          tape(nullptr),
+          tapeIndex(0) {}
+
+    // Constructor for a buffer that unescapeInPlace may rewrite, e.g. a receive buffer
+    JsonParser(char* jsonData, size_t length)
+        : data(jsonData),
+          writable(jsonData),
+          dataLen(length),
+          startPos(0),
+          endPos(length),
+          tape(nullptr),
+          tapeIndex(0) {}
+
+    static const size_t MAX_TAPE_DEPTH = 16;
+
+    /**
+     * @brief Indexes the view in one pass so that lookups walk the tape instead of rescanning
+     *
+     * Every value gets an entry, in document order, with its key and where it ends. Finding
+     * a key then only visits the members of the object, and views from getObject share the
+     * tape. The entries must outlive the parser and its views.
+     *
+     * @return Entries used, 0 when the view is not well formed, nested deeper than
+     *         MAX_TAPE_DEPTH, longer than 64 KB or needs more than capacity entries. The
+     *         parser then keeps scanning the text.
+     */
+    size_t index(JsonTapeEntry* entries, size_t capacity);
+    bool isIndexed() const { return tape != nullptr; }
     
     // Get an object by key as a new view
     bool getObject(const char* key, JsonParser& result);
@@ -67,6 +143,21 @@ public:
     // Get a string value by key
     bool getString(const char* key, char* value, size_t maxLen);
     bool getString(const char* key, zap::Str& value);
+
+    // Get a string value by key without copying it, see JsonStringView
+    bool getStringView(const char* key, JsonStringView& value);
+    bool getStringViewByPath(const char* path, JsonStringView& value);
+
+    /**
+     * @brief Unescapes a string value of this document where it is, without a copy
+     *
+     * For JSON that is escaped into a string of the document, it can then be parsed in
+     * place. The result is terminated and never longer than the escaped text, but the
+     * document around it is no longer valid JSON, look up everything else first.
+     *
+     * @return The unescaped text, nullptr when the parser was not given a writable buffer
+     */
+    char* unescapeInPlace(const JsonStringView& value);
     
     // Get an integer value by key
     bool getInt(const char* key, int& value);
@@ -0,0 +1,365 @@
+#include "json_pull_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// In json_light.cpp, \u escapes are decoded the same way as in JsonParser
+int hex_to_utf8(const char* hex_chars, char* utf8_buffer);
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+JsonPullParser::JsonPullParser(char* token, size_t tokenCapacity, char* path, size_t pathCapacity)
+    : _token(token), _tokenCapacity(tokenCapacity), _path(path), _pathCapacity(pathCapacity) {
+    reset();
+}
+
+void JsonPullParser::reset() {
+    _tokenLength = 0;
+    _truncated = false;
+    _pathLength = 0;
+    _pathTruncated = false;
+    _data = nullptr;
+    _length = 0;
+    _pos = 0;
+    _finished = false;
+    _depth = 0;
+    _valueEnded = false;
+    _escape = 0;
+    if (_token == nullptr || _tokenCapacity == 0 || _path == nullptr || _pathCapacity == 0) {
+        _state = State::ERROR;
+        return;
+    }
+    _token[0] = '\0';
+    _path[0] = '\0';
+    _state = State::VALUE;
+}
+
+void JsonPullParser::feed(const char* data, size_t length) {
+    _data = data;
+    _length = data != nullptr ? length : 0;
+    _pos = 0;
+}
+
+void JsonPullParser::finish() {
+    _finished = true;
+}
+
+JsonPullParser::Event JsonPullParser::fail() {
+    _state = State::ERROR;
+    return Event::ERROR;
+}
+
+void JsonPullParser::append(char c, bool key) {
+    if (key) {
+        if (_pathLength + 1 >= _pathCapacity) {
+            // The document goes on, values under this path match no field
+            _pathTruncated = true;
+            return;
+        }
+        _path[_pathLength++] = c;
+        _path[_pathLength] = '\0';
+    } else {
+        if (_tokenLength + 1 >= _tokenCapacity) {
+            // The value goes on, only its start is kept
+            _truncated = true;
+            return;
+        }
+        _token[_tokenLength++] = c;
+        _token[_tokenLength] = '\0';
+    }
+}
+
+bool JsonPullParser::stringChar(char c, bool key) {
+    if (_escape == 0) {
+        if (c == '"') {
+            return true;
+        }
+        if (c == '\\') {
+            _escape = 1;
+            return false;
+        }
+        append(c, key);
+        return false;
+    }
+
+    if (_escape == 1) {
+        if (c == 'u') {
+            _escape = 2;
+            return false;
+        }
+        _escape = 0;
+        switch (c) {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            default: break;     // Quotes, slashes and unknown escapes are the character itself
+        }
+        append(c, key);
+        return false;
+    }
+
+    // The hex digits of \uXXXX may be split over chunks, they are collected first
+    _hex[_escape - 2] = c;
+    if (++_escape < 6) {
+        return false;
+    }
+    _escape = 0;
+    _hex[4] = '\0';
+    char utf8[4];
+    int written = hex_to_utf8(_hex, utf8);
+    if (written == 0) {
+        utf8[0] = '?';
+        written = 1;
+    }
+    for (int i = 0; i < written; i++) {
+        append(utf8[i], key);
+    }
+    return false;
+}
+
+void JsonPullParser::beginValue() {
+    _tokenLength = 0;
+    _truncated = false;
+    _token[0] = '\0';
+    if (_depth == 0 || !_frames[_depth - 1].array) {
+        return;
+    }
+    // Array elements are named by their index
+    char index[8];
+    const int length = snprintf(index, sizeof(index), "[%u]", (unsigned int)_frames[_depth - 1].index++);
+    for (int i = 0; i < length; i++) {
+        append(index[i], true);
+    }
+}
+
+JsonPullParser::Event JsonPullParser::beginContainer(bool array) {
+    if (_depth == MAX_DEPTH) {
+        return fail();
+    }
+    Frame& frame = _frames[_depth++];
+    frame.pathLength = (uint16_t)_pathLength;
+    frame.pathTruncated = _pathTruncated;
+    frame.index = 0;
+    frame.array = array;
+    _state = array ? State::VALUE : State::FIRST_KEY;
+    return array ? Event::BEGIN_ARRAY : Event::BEGIN_OBJECT;
+}
+
+JsonPullParser::Event JsonPullParser::endContainer(bool array) {
+    _depth--;
+    _state = _depth == 0 ? State::DONE : State::AFTER_VALUE;
+    _valueEnded = true;
+    return array ? Event::END_ARRAY : Event::END_OBJECT;
+}
+
+JsonPullParser::Event JsonPullParser::endScalar(Event event) {
+    _state = _depth == 0 ? State::DONE : State::AFTER_VALUE;
+    _valueEnded = true;
+    return event;
+}
+
+JsonPullParser::Event JsonPullParser::endLiteral() {
+    if (strcmp(_token, "true") != 0 && strcmp(_token, "false") != 0 && strcmp(_token, "null") != 0) {
+        return fail();
+    }
+    return endScalar(Event::LITERAL);
+}
+
+JsonPullParser::Event JsonPullParser::next() {
+    if (_state == State::ERROR) {
+        return Event::ERROR;
+    }
+    if (_valueEnded) {
+        // Back to the path of the container of the value that ended
+        _valueEnded = false;
+        _pathLength = _depth > 0 ? _frames[_depth - 1].pathLength : 0;
+        _pathTruncated = _depth > 0 && _frames[_depth - 1].pathTruncated;
+        _path[_pathLength] = '\0';
+    }
+
+    while (_pos < _length) {
+        const char c = _data[_pos];
+        switch (_state) {
+            case State::VALUE:
+                if (isSpace(c)) {
+                    _pos++;
+                    break;
+                }
+                if (c == ']' && _depth > 0 && _frames[_depth - 1].array && _frames[_depth - 1].index == 0) {
+                    _pos++;
+                    return endContainer(true);
+                }
+                beginValue();
+                _pos++;
+                if (c == '{' || c == '[') {
+                    return beginContainer(c == '[');
+                } else if (c == '"') {
+                    _state = State::STRING;
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    _state = State::NUMBER;
+                    append(c, false);
+                } else if (c == 't' || c == 'f' || c == 'n') {
+                    _state = State::LITERAL;
+                    append(c, false);
+                } else {
+                    return fail();
+                }
+                break;
+
+            case State::FIRST_KEY:
+            case State::KEY:
+                if (isSpace(c)) {
+                    _pos++;
+                    break;
+                }
+                _pos++;
+                if (c == '}' && _state == State::FIRST_KEY) {
+                    return endContainer(false);
+                }
+                if (c != '"') {
+                    return fail();
+                }
+                if (_pathLength > 0) {
+                    append('.', true);
+                }
+                _state = State::KEY_STRING;
+                break;
+
+            case State::KEY_STRING:
+                _pos++;
+                if (stringChar(c, true)) {
+                    _state = State::COLON;
+                }
+                break;
+
+            case State::COLON:
+                _pos++;
+                if (c == ':') {
+                    _state = State::VALUE;
+                } else if (!isSpace(c)) {
+                    return fail();
+                }
+                break;
+
+            case State::STRING: {
+                // Copy the run up to the next quote or escape in one go
+                const char* run = _data + _pos;
+                size_t length = 0;
+                while (_escape == 0 && _pos + length < _length && run[length] != '"' && run[length] != '\\') {
+                    length++;
+                }
+                if (length > 0) {
+                    size_t copied = length;
+                    if (_tokenLength + copied >= _tokenCapacity) {
+                        copied = _tokenCapacity - 1 - _tokenLength;
+                        _truncated = true;
+                    }
+                    memcpy(_token + _tokenLength, run, copied);
+                    _tokenLength += copied;
+                    _token[_tokenLength] = '\0';
+                    _pos += length;
+                    break;
+                }
+                _pos++;
+                if (stringChar(c, false)) {
+                    return endScalar(Event::STRING);
+                }
+                break;
+            }
+
+            case State::NUMBER:
+                if (!isNumberChar(c)) {
+                    // The character after the number is read again as what follows it
+                    return endScalar(Event::NUMBER);
+                }
+                _pos++;
+                append(c, false);
+                break;
+
+            case State::LITERAL:
+                if (c < 'a' || c > 'z') {
+                    return endLiteral();
+                }
+                _pos++;
+                append(c, false);
+                break;
+
+            case State::AFTER_VALUE: {
+                _pos++;
+                if (isSpace(c)) {
+                    break;
+                }
+                const bool array = _frames[_depth - 1].array;
+                if (c == ',') {
+                    _state = array ? State::VALUE : State::KEY;
+                } else if (c == (array ? ']' : '}')) {
+                    return endContainer(array);
+                } else {
+                    return fail();
+                }
+                break;
+            }
+
+            case State::DONE:
+                if (!isSpace(c)) {
+                    return fail();
+                }
+                _pos++;
+                break;
+
+            case State::ERROR:
+                return Event::ERROR;
+        }
+    }
+
+    if (_state == State::DONE) {
+        return Event::END;
+    }
+    if (!_finished) {
+        return Event::NEED_MORE;
+    }
+    // Nothing more comes, only a number or literal can still end here
+    if (_state == State::NUMBER) {
+        return endScalar(Event::NUMBER);
+    }
+    if (_state == State::LITERAL) {
+        return endLiteral();
+    }
+    return fail();
+}
+
+bool JsonPullParser::extract(const char* data, size_t length, JsonPathField* fields, size_t count) {
+    feed(data, length);
+    for (;;) {
+        const Event event = next();
+        switch (event) {
+            case Event::NEED_MORE:
+            case Event::END:
+                return true;
+            case Event::ERROR:
+                return false;
+            case Event::STRING:
+            case Event::NUMBER:
+            case Event::LITERAL:
+                for (size_t i = 0; i < count; i++) {
+                    JsonPathField& field = fields[i];
+                    if (!field.found && !_truncated && !_pathTruncated && _tokenLength < field.capacity &&
+                        strcmp(field.path, _path) == 0) {
+                        memcpy(field.value, _token, _tokenLength + 1);
+                        field.found = true;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
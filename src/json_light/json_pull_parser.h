@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A value to pick out of a document with JsonPullParser::extract
+ *
+ * Paths are the keys from the top joined by '.', array elements are [index],
+ * e.g. "payload.data.configurationDataChanges.subKey" or "rows[2]".
+ */
+struct JsonPathField {
+    const char* path;
+    char* value;        // Receives the value with a terminator, strings unescaped, numbers and literals as written
+    size_t capacity;    // Size of value including the terminator
+    bool found;         // The path had a string, number or literal that fit here and in the token buffer
+
+    JsonPathField(const char* path, char* value, size_t capacity)
+        : path(path), value(value), capacity(capacity), found(false) {}
+};
+
+/**
+ * @brief Incremental SAX-style JSON parser for documents that arrive in pieces
+ *
+ * The text is fed in chunks split anywhere, e.g. straight from a network stream,
+ * and next() returns one event at a time with the path of its value. Only the
+ * token being read is kept, in a buffer from the caller, so the largest string or
+ * number bounds the memory rather than the document. A longer one is cut to the
+ * buffer and flagged, the rest of the document is read as usual. The path of the
+ * current value goes to a second buffer, a path longer than that is cut and flagged
+ * the same way and the values under it match no field.
+ *
+ * Strings are unescaped like JsonParser does. Numbers and literals are handed on as
+ * written, true, false and null are checked.
+ */
+class JsonPullParser {
+public:
+    static const size_t MAX_DEPTH = 16;
+
+    enum class Event {
+        NEED_MORE,      // The chunk is used up, feed the next one
+        BEGIN_OBJECT,
+        END_OBJECT,
+        BEGIN_ARRAY,
+        END_ARRAY,
+        STRING,
+        NUMBER,
+        LITERAL,        // true, false or null
+        END,            // The document is complete
+        ERROR           // Malformed or nested deeper than MAX_DEPTH
+    };
+
+    /**
+     * @param token Holds the string, number or literal being read
+     * @param tokenCapacity Size of token including the terminator
+     * @param path Holds the path of the current value
+     * @param pathCapacity Size of path including the terminator
+     */
+    JsonPullParser(char* token, size_t tokenCapacity, char* path, size_t pathCapacity);
+
+    /**
+     * @brief Hand over the next chunk, once next() returned NEED_MORE for the last one
+     *
+     * The chunk is not copied, it has to stay until it is used up.
+     */
+    void feed(const char* data, size_t length);
+
+    /**
+     * @brief There is no more input, a number at the very end is complete now
+     */
+    void finish();
+
+    /**
+     * @brief Read up to the next event in the chunk
+     */
+    Event next();
+
+    /**
+     * @brief Feed a chunk and copy the values at the paths of the fields as they pass
+     *
+     * Values that were cut to the token buffer, or whose path was cut, are not copied.
+     *
+     * @return false once the document turned out to be malformed
+     */
+    bool extract(const char* data, size_t length, JsonPathField* fields, size_t count);
+
+    // Path of the value of the last event, "" for the top level
+    const char* getPath() const { return _path; }
+    // The path was longer than the path buffer, getPath() has its start
+    bool isPathTruncated() const { return _pathTruncated; }
+    // The string, number or literal of the last event
+    const char* getValue() const { return _token; }
+    size_t getValueLength() const { return _tokenLength; }
+    // The value was longer than the token buffer, getValue() has its start
+    bool isTruncated() const { return _truncated; }
+    size_t getDepth() const { return _depth; }
+
+    bool isDone() const { return _state == State::DONE; }
+    bool hasError() const { return _state == State::ERROR; }
+
+    void reset();
+
+private:
+    enum class State {
+        VALUE,          // A value comes next
+        FIRST_KEY,      // After '{', a key or '}'
+        KEY,            // A key comes next, after a ','
+        KEY_STRING,
+        COLON,
+        STRING,
+        NUMBER,
+        LITERAL,
+        AFTER_VALUE,    // ',' or the end of the container
+        DONE,
+        ERROR
+    };
+
+    struct Frame {
+        uint16_t pathLength;    // Path of the container itself
+        uint16_t index;         // Elements so far when it is an array
+        bool array;
+        bool pathTruncated;
+    };
+
+    // True at the closing quote
+    bool stringChar(char c, bool key);
+    void append(char c, bool key);
+    void beginValue();
+    Event beginContainer(bool array);
+    Event endContainer(bool array);
+    Event endScalar(Event event);
+    Event endLiteral();
+    Event fail();
+
+    char* _token;
+    size_t _tokenCapacity;
+    size_t _tokenLength;
+    bool _truncated;
+    char* _path;
+    size_t _pathCapacity;
+    size_t _pathLength;
+    bool _pathTruncated;
+
+    const char* _data;
+    size_t _length;
+    size_t _pos;
+    bool _finished;
+
+    State _state;
+    Frame _frames[MAX_DEPTH];
+    size_t _depth;
+    bool _valueEnded;   // The path still names the value of the last event
+
+    uint8_t _escape;    // 0, 1 after a backslash, 2-5 for the hex digits of \uXXXX
+    char _hex[5];
+};
@@ -15,8 +15,12 @@
 #include "backend/data_sender.h"
 #include "data/data_reader_task.h"
 #include "backend/backend_api_task.h"
+#include "backend/signing_task.h"
+#include "backend/http_connection_manager.h"
+#include "backend/retry_policy.h"
 #include "ota/ota_handler.h"
 #include "debug.h"
+#include "metrics.h"
 #include "main_action_manager.h"
 #include "main_actions.h" 
 #include "ble/ble_handler.h"
@@ -53,6 +57,14 @@ const unsigned long REBOOT_PRESS_DURATION = 2000; // 2 seconds for reboot
 BLEHandler bleHandler; 
 unsigned long lastBLECheck = 0;  // Track last BLE check time
 
+// Read from the allocator whenever /metrics is rendered
+static Gauge heapFree("zap_heap_free_bytes", "Free heap",
+    []() { return (int32_t)ESP.getFreeHeap(); });
+static Gauge heapMinFree("zap_heap_min_free_bytes", "Lowest free heap since boot",
+    []() { return (int32_t)ESP.getMinFreeHeap(); });
+static Gauge heapLargestBlock("zap_heap_largest_free_block_bytes", "Largest heap block that can be allocated",
+    []() { return (int32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
+
 void setup() {
 
     // --- Get and store the reset reason ---
@@ -105,8 +117,11 @@ void setup() {
         }
 
         preferences.end();
+        if (!crypto_init(PRIVATE_KEY_HEX)) {
+            LOG_TE(TAG, "Failed to initialize signer!!");
+        }
         Serial.printf("serial number: %s\n", crypto_getId().c_str());
-        Serial.printf("Public key: %s\n", crypto_get_public_key(PRIVATE_KEY_HEX).c_str());
+        Serial.printf("Public key: %s\n", crypto_get_identity().publicKeyHex.c_str());
     }
     
 
@@ -138,10 +153,20 @@ void setup() {
     
     // Configure and start the data reader task
     g_dataReaderTask.setInterval(10000); // 10 seconds interval for generating data
-    g_dataReaderTask.begin(backendApiTask.getQueueHandle()); // Share the queue between tasks
+    g_dataReaderTask.begin(&backendApiTask.getDataRing(), &backendApiTask.getUploadController()); // Share the ring between tasks
+    Debug::setDataRing(&backendApiTask.getDataRing());
+    Debug::setUploadController(&backendApiTask.getUploadController());
+    Debug::setEventStream(&g_dataReaderTask.getEventStream());
+    Debug::setResponseCache(&EndpointMapper::getResponseCache());
     
+    // Start the signing task before anything that sends JWTs
+    g_signingTask.begin();
+    HttpConnectionManager::begin();
+    RetryPolicy::seedAll(esp_random()); // Devices must not back off in step
+
     // Start the backend API task
     backendApiTask.begin(&wifiManager);  // Pass the WiFi manager reference
+    Debug::setScheduler(&backendApiTask.getScheduler());
     backendApiTask.setInterval(300000);  // 5 minutes interval (300,000 ms) for state updates
     backendApiTask.setBleActive(true);   // Initialize with BLE active (same as dataSenderTask)
     
@@ -0,0 +1,176 @@
+#include "merkle_tree.h"
+#include <string.h>
+#include <mbedtls/sha256.h>
+
+static const uint8_t LEAF_PREFIX = 0x00;
+static const uint8_t NODE_PREFIX = 0x01;
+static const uint8_t ROOT_PREFIX = 0x02;
+
+MerkleTree::MerkleTree(size_t maxLeaves)
+    : _nodes(nullptr), _maxLeaves(maxLeaves), _leafCount(0), _nodeCount(0) {
+    // Carried up nodes are stored again on every level they pass, so count level by level
+    size_t nodes = maxLeaves;
+    for (size_t count = maxLeaves; count > 1; count = (count + 1) / 2) {
+        nodes += (count + 1) / 2;
+    }
+    _nodes = new uint8_t[nodes * HASH_SIZE];
+    // Note: as in CircularBuffer a failed allocation leaves a nullptr which makes every addLeaf() fail
+}
+
+MerkleTree::~MerkleTree() {
+    if (_nodes != nullptr) {
+        delete[] _nodes;
+        _nodes = nullptr;
+    }
+}
+
+void MerkleTree::clear() {
+    _leafCount = 0;
+    _nodeCount = 0;
+}
+
+void MerkleTree::hashLeaf(const uint8_t* data, size_t length, uint8_t* out) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &LEAF_PREFIX, 1);
+    mbedtls_sha256_update(&ctx, data, length);
+    mbedtls_sha256_finish(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+}
+
+void MerkleTree::hashNode(const uint8_t* left, const uint8_t* right, uint8_t* out) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &NODE_PREFIX, 1);
+    mbedtls_sha256_update(&ctx, left, HASH_SIZE);
+    mbedtls_sha256_update(&ctx, right, HASH_SIZE);
+    mbedtls_sha256_finish(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+}
+
+void MerkleTree::hashRoot(size_t leafCount, const uint8_t* top, uint8_t* out) {
+    const uint8_t count[4] = {
+        (uint8_t)(leafCount >> 24), (uint8_t)(leafCount >> 16), (uint8_t)(leafCount >> 8), (uint8_t)leafCount
+    };
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &ROOT_PREFIX, 1);
+    mbedtls_sha256_update(&ctx, count, sizeof(count));
+    mbedtls_sha256_update(&ctx, top, HASH_SIZE);
+    mbedtls_sha256_finish(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+}
+
+bool MerkleTree::addLeaf(const uint8_t* data, size_t length) {
+    if (_nodes == nullptr || _leafCount >= _maxLeaves) {
+        return false;
+    }
+    hashLeaf(data, length, nodeAt(0, _leafCount));
+    _leafCount++;
+    _nodeCount = 0;     // The root is stale now
+    return true;
+}
+
+bool MerkleTree::build() {
+    if (_leafCount == 0) {
+        return false;
+    }
+
+    size_t levelOffset = 0;
+    size_t count = _leafCount;
+    while (count > 1) {
+        const size_t nextOffset = levelOffset + count;
+        for (size_t i = 0; i + 1 < count; i += 2) {
+            hashNode(nodeAt(levelOffset, i), nodeAt(levelOffset, i + 1), nodeAt(nextOffset, i / 2));
+        }
+        if (count & 1) {
+            // No sibling, carry the node up as is
+            memcpy(nodeAt(nextOffset, count / 2), nodeAt(levelOffset, count - 1), HASH_SIZE);
+        }
+        levelOffset = nextOffset;
+        count = (count + 1) / 2;
+    }
+
+    _nodeCount = levelOffset + 1;
+    hashRoot(_leafCount, nodeAt(levelOffset, 0), _root);
+    return true;
+}
+
+const uint8_t* MerkleTree::getRoot() const {
+    if (_nodeCount == 0) {
+        return nullptr;
+    }
+    return _root;
+}
+
+size_t MerkleTree::getProofLength(size_t index) const {
+    if (index >= _leafCount) {
+        return 0;
+    }
+
+    size_t length = 0;
+    for (size_t count = _leafCount; count > 1; count = (count + 1) / 2) {
+        if ((index & 1) || index + 1 < count) {
+            length++;
+        }
+        index /= 2;
+    }
+    return length;
+}
+
+size_t MerkleTree::getProof(size_t index, uint8_t* proof, size_t proofSize) const {
+    const size_t length = getProofLength(index);
+    if (_nodeCount == 0 || index >= _leafCount || proofSize < length * HASH_SIZE) {
+        return 0;
+    }
+
+    size_t written = 0;
+    size_t levelOffset = 0;
+    for (size_t count = _leafCount; count > 1; count = (count + 1) / 2) {
+        const size_t sibling = index ^ 1;
+        if (sibling < count) {
+            memcpy(proof + written * HASH_SIZE, nodeAt(levelOffset, sibling), HASH_SIZE);
+            written++;
+        }
+        levelOffset += count;
+        index /= 2;
+    }
+    return written;
+}
+
+bool MerkleTree::verify(const uint8_t* data, size_t length, size_t index, size_t leafCount,
+                        const uint8_t* proof, size_t proofLength, const uint8_t* root) {
+    if (index >= leafCount) {
+        return false;
+    }
+
+    uint8_t hash[HASH_SIZE];
+    hashLeaf(data, length, hash);
+
+    size_t used = 0;
+    for (size_t count = leafCount; count > 1; count = (count + 1) / 2) {
+        const size_t sibling = index ^ 1;
+        if (sibling < count) {
+            if (used == proofLength) {
+                return false;
+            }
+            const uint8_t* siblingHash = proof + used * HASH_SIZE;
+            if (index & 1) {
+                hashNode(siblingHash, hash, hash);
+            } else {
+                hashNode(hash, siblingHash, hash);
+            }
+            used++;
+        }
+        index /= 2;
+    }
+
+    if (used != proofLength) {
+        return false;
+    }
+    hashRoot(leafCount, hash, hash);
+    return memcmp(hash, root, HASH_SIZE) == 0;
+}
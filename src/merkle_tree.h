@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Merkle tree over a batch of readings
+ *
+ * Lets a batch be signed with a single ECDSA signature over the root while
+ * every reading stays verifiable on its own: a reading is sent with its index
+ * and the sibling hashes on its path to the root (its inclusion proof).
+ *
+ * Leaves are SHA-256(0x00 || reading) and inner nodes are
+ * SHA-256(0x01 || left || right), the prefixes keep a leaf from ever passing
+ * as an inner node. A node without a sibling is carried up to the next level
+ * unchanged, so a proof holds at most ceil(log2(leafCount)) hashes.
+ *
+ * The root is SHA-256(0x02 || leafCount || top), leafCount as 4 bytes big
+ * endian and top the node the levels end in. Without the count a proof would
+ * also hold for a batch cut down to where a carried up node ends, and the
+ * single leaf of a batch of one would pass as its own root.
+ *
+ * Usage: clear(), addLeaf() for every reading, build(), sign getRoot() with
+ * the device key and attach getProof() to each reading.
+ *
+ * DataSenderTask does not use it yet, that waits on a backend format for
+ * signed roots and per-reading proofs.
+ */
+class MerkleTree {
+public:
+    static const size_t HASH_SIZE = 32;
+
+    /**
+     * @brief Construct a new tree
+     *
+     * @param maxLeaves Largest batch the tree can hold, all memory is allocated up front
+     */
+    explicit MerkleTree(size_t maxLeaves = 64);
+    ~MerkleTree();
+
+    MerkleTree(const MerkleTree&) = delete;
+    MerkleTree& operator=(const MerkleTree&) = delete;
+
+    /**
+     * @brief Remove all leaves to start a new batch
+     */
+    void clear();
+
+    /**
+     * @brief Hash a reading into the next leaf
+     *
+     * @return false if the tree is full
+     */
+    bool addLeaf(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Compute the inner nodes and the root from the leaves
+     *
+     * @return false if there are no leaves
+     */
+    bool build();
+
+    size_t getLeafCount() const { return _leafCount; }
+    size_t getMaxLeaves() const { return _maxLeaves; }
+
+    /**
+     * @brief Get the root hash
+     *
+     * @return HASH_SIZE bytes or nullptr if the tree has not been built since the last change
+     */
+    const uint8_t* getRoot() const;
+
+    /**
+     * @brief Get the number of hashes in the proof of a leaf
+     */
+    size_t getProofLength(size_t index) const;
+
+    /**
+     * @brief Write the inclusion proof of a leaf, the sibling hashes from the leaf up
+     *
+     * @param index Leaf index
+     * @param proof Receives getProofLength(index) * HASH_SIZE bytes
+     * @param proofSize Size of proof in bytes
+     * @return Number of hashes written, 0 if the tree is not built, the index is out of range or proof is too small
+     */
+    size_t getProof(size_t index, uint8_t* proof, size_t proofSize) const;
+
+    /**
+     * @brief Check that a reading is part of the batch with the given root
+     *
+     * @param proofLength Number of hashes in proof
+     * @return true if data, index and proof lead to root
+     */
+    static bool verify(const uint8_t* data, size_t length, size_t index, size_t leafCount,
+                       const uint8_t* proof, size_t proofLength, const uint8_t* root);
+
+    static void hashLeaf(const uint8_t* data, size_t length, uint8_t* out);
+    static void hashNode(const uint8_t* left, const uint8_t* right, uint8_t* out);
+    static void hashRoot(size_t leafCount, const uint8_t* top, uint8_t* out);
+
+private:
+    uint8_t* nodeAt(size_t levelOffset, size_t index) const { return _nodes + (levelOffset + index) * HASH_SIZE; }
+
+    uint8_t* _nodes;        // All levels back to back, leaves first, root last
+    size_t _maxLeaves;
+    size_t _leafCount;
+    size_t _nodeCount;      // Nodes in use after build(), 0 when not built
+    uint8_t _root[HASH_SIZE];
+};
@@ -0,0 +1,154 @@
+#include "metrics.h"
+
+Metric* Metric::s_metrics[Metric::MAX_METRICS] = {};
+
+Metric::Metric(const char* name, const char* help, Type type) : _name(name), _help(help), _type(type) {
+    for (size_t i = 0; i < MAX_METRICS; i++) {
+        if (s_metrics[i] == nullptr) {
+            s_metrics[i] = this;
+            break;
+        }
+    }
+}
+
+Metric::~Metric() {
+    for (size_t i = 0; i < MAX_METRICS; i++) {
+        if (s_metrics[i] == this) {
+            s_metrics[i] = nullptr;
+        }
+    }
+}
+
+Metric* Metric::get(size_t index) {
+    return index < MAX_METRICS ? s_metrics[index] : nullptr;
+}
+
+const char* Metric::typeName(Type type) {
+    switch (type) {
+        case Type::COUNTER: return "counter";
+        case Type::GAUGE: return "gauge";
+        case Type::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+size_t Metric::renderAll(ResponseWriter& writer) {
+    Output out(writer);
+    for (size_t i = 0; i < MAX_METRICS; i++) {
+        const Metric* metric = s_metrics[i];
+        if (metric == nullptr) {
+            continue;
+        }
+        out.append("# HELP ");
+        out.append(metric->_name);
+        out.append(' ');
+        out.append(metric->_help);
+        out.append("\n# TYPE ");
+        out.append(metric->_name);
+        out.append(' ');
+        out.append(typeName(metric->_type));
+        out.append('\n');
+        metric->renderSamples(out);
+    }
+    return out.get();
+}
+
+void Metric::beginSample(Output& out, const char* suffix, const char* label, const char* value) const {
+    out.append(_name);
+    out.append(suffix);
+    if (label != nullptr) {
+        out.append('{');
+        out.append(label);
+        out.append("=\"");
+        out.append(value);
+        out.append("\"}");
+    }
+    out.append(' ');
+}
+
+void Counter::renderSamples(Output& out) const {
+    beginSample(out, "");
+    out.append(get());
+    out.append('\n');
+}
+
+LabeledCounter::LabeledCounter(const char* name, const char* help, const char* label, const char* const* values, size_t count)
+    : Metric(name, help, Type::COUNTER), _label(label), _values(values), _count(count < MAX_VALUES ? count : MAX_VALUES) {
+    for (size_t i = 0; i < MAX_VALUES; i++) {
+        _counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LabeledCounter::increment(size_t index, uint32_t by) {
+    if (index < _count) {
+        _counts[index].fetch_add(by, std::memory_order_relaxed);
+    }
+}
+
+uint32_t LabeledCounter::get(size_t index) const {
+    return index < _count ? _counts[index].load(std::memory_order_relaxed) : 0;
+}
+
+void LabeledCounter::renderSamples(Output& out) const {
+    for (size_t i = 0; i < _count; i++) {
+        beginSample(out, "", _label, _values[i]);
+        out.append(get(i));
+        out.append('\n');
+    }
+}
+
+void Gauge::renderSamples(Output& out) const {
+    beginSample(out, "");
+    out.append((int)get());
+    out.append('\n');
+}
+
+Histogram::Histogram(const char* name, const char* help, const uint32_t* bounds, size_t count)
+    : Metric(name, help, Type::HISTOGRAM), _bounds(bounds), _count(count < MAX_BUCKETS ? count : MAX_BUCKETS), _sum(0) {
+    for (size_t i = 0; i <= MAX_BUCKETS; i++) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(uint32_t value) {
+    // A dozen bounds at most, a binary search would not pay off
+    size_t index = 0;
+    while (index < _count && value > _bounds[index]) {
+        index++;
+    }
+    _buckets[index].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint32_t Histogram::getBucket(size_t index) const {
+    return index <= _count ? _buckets[index].load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t Histogram::getCount() const {
+    uint32_t count = 0;
+    for (size_t i = 0; i <= _count; i++) {
+        count += getBucket(i);
+    }
+    return count;
+}
+
+void Histogram::renderSamples(Output& out) const {
+    // Buckets are cumulative in the format, the count is the +Inf bucket so the two agree
+    uint32_t cumulative = 0;
+    char bound[12];
+    for (size_t i = 0; i <= _count; i++) {
+        cumulative += getBucket(i);
+        if (i < _count) {
+            snprintf(bound, sizeof(bound), "%u", (unsigned int)_bounds[i]);
+        }
+        beginSample(out, "_bucket", "le", i < _count ? bound : "+Inf");
+        out.append(cumulative);
+        out.append('\n');
+    }
+    beginSample(out, "_sum");
+    out.append(getSum());
+    out.append('\n');
+    beginSample(out, "_count");
+    out.append(cumulative);
+    out.append('\n');
+}
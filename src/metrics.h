@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "endpoints/response_writer.h"
+
+/**
+ * @brief A named value for the /metrics endpoint, rendered in the Prometheus text format
+ *
+ * Metrics are meant to be static objects next to the code they count. Every metric
+ * registers itself, up to MAX_METRICS, so the endpoint can list them without knowing
+ * about them. Updates are relaxed atomic operations, any task may make them without a
+ * lock and without waiting for a render.
+ *
+ * renderAll() writes the text straight to a ResponseWriter in RESPONSE_CHUNK_SIZE pieces
+ * held on the stack, nothing is allocated. Values are 32 bits and wrap, which Prometheus
+ * reads as a counter reset.
+ */
+class Metric {
+public:
+    static const size_t MAX_METRICS = 32;
+
+    enum class Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    using Output = zap::JsonBuilderChunkedBuffer<ResponseWriter, RESPONSE_CHUNK_SIZE>;
+
+    Metric(const char* name, const char* help, Type type);
+    virtual ~Metric();
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    const char* getName() const { return _name; }
+    const char* getHelp() const { return _help; }
+    Type getType() const { return _type; }
+
+    // Registered metrics, indexed up to MAX_METRICS, unused slots are nullptr
+    static Metric* get(size_t index);
+    static const char* typeName(Type type);
+
+    /**
+     * @brief Writes HELP, TYPE and the samples of every registered metric
+     *
+     * @return Bytes written
+     */
+    static size_t renderAll(ResponseWriter& writer);
+
+protected:
+    // The sample lines of this metric, the name is known already
+    virtual void renderSamples(Output& out) const = 0;
+
+    // <name><suffix>{<label>="<value>"} or without braces when label is nullptr
+    void beginSample(Output& out, const char* suffix, const char* label = nullptr, const char* value = nullptr) const;
+
+private:
+    const char* _name;
+    const char* _help;
+    Type _type;
+
+    static Metric* s_metrics[MAX_METRICS];
+};
+
+/**
+ * @brief A value that only goes up
+ */
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* help) : Metric(name, help, Type::COUNTER), _value(0) {}
+
+    void increment(uint32_t by = 1) { _value.fetch_add(by, std::memory_order_relaxed); }
+    uint32_t get() const { return _value.load(std::memory_order_relaxed); }
+
+protected:
+    void renderSamples(Output& out) const override;
+
+private:
+    std::atomic<uint32_t> _value;
+};
+
+/**
+ * @brief A counter per value of one label, e.g. HTTP responses per status class
+ *
+ * The values are fixed when it is made, increment takes the index of one.
+ */
+class LabeledCounter : public Metric {
+public:
+    static const size_t MAX_VALUES = 8;
+
+    LabeledCounter(const char* name, const char* help, const char* label, const char* const* values, size_t count);
+
+    void increment(size_t index, uint32_t by = 1);
+    uint32_t get(size_t index) const;
+    size_t getCount() const { return _count; }
+
+protected:
+    void renderSamples(Output& out) const override;
+
+private:
+    const char* _label;
+    const char* const* _values;
+    size_t _count;
+    std::atomic<uint32_t> _counts[MAX_VALUES];
+};
+
+/**
+ * @brief A value that goes up and down
+ *
+ * With a reader the value is taken when the metrics are rendered, for values that are
+ * kept elsewhere already such as the free heap.
+ */
+class Gauge : public Metric {
+public:
+    typedef int32_t (*Reader)();
+
+    Gauge(const char* name, const char* help, Reader reader = nullptr)
+        : Metric(name, help, Type::GAUGE), _reader(reader), _value(0) {}
+
+    void set(int32_t value) { _value.store(value, std::memory_order_relaxed); }
+    void add(int32_t delta) { _value.fetch_add(delta, std::memory_order_relaxed); }
+    int32_t get() const { return _reader != nullptr ? _reader() : _value.load(std::memory_order_relaxed); }
+
+protected:
+    void renderSamples(Output& out) const override;
+
+private:
+    Reader _reader;
+    std::atomic<int32_t> _value;
+};
+
+/**
+ * @brief Observations counted in fixed buckets, e.g. how long requests take
+ *
+ * The upper bounds are inclusive and ascending, larger observations land in +Inf.
+ * Each observation is one bucket increment and one add to the sum. A render that
+ * races an observation may show it in the count but not yet in the sum.
+ */
+class Histogram : public Metric {
+public:
+    static const size_t MAX_BUCKETS = 12;
+
+    Histogram(const char* name, const char* help, const uint32_t* bounds, size_t count);
+
+    void observe(uint32_t value);
+
+    uint32_t getCount() const;
+    uint32_t getSum() const { return _sum.load(std::memory_order_relaxed); }
+    // Observations in the bucket, not cumulative, index count is +Inf
+    uint32_t getBucket(size_t index) const;
+
+protected:
+    void renderSamples(Output& out) const override;
+
+private:
+    const uint32_t* _bounds;
+    size_t _count;
+    std::atomic<uint32_t> _buckets[MAX_BUCKETS + 1];
+    std::atomic<uint32_t> _sum;
+};
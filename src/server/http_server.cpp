@@ -0,0 +1,748 @@
+#include "http_server.h"
+#include <Arduino.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "zap_log.h"
+#include "metrics.h"
+
+static constexpr LogTag TAG_hs = LogTag("http_server", ZLOG_LEVEL_INFO);
+
+static const char* const STATUS_CLASSES[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+static LabeledCounter responses("zap_http_responses_total", "HTTP responses sent", "code",
+                                STATUS_CLASSES, sizeof(STATUS_CLASSES) / sizeof(STATUS_CLASSES[0]));
+static const uint32_t REQUEST_BUCKETS_MS[] = {1, 5, 10, 25, 50, 100, 250, 1000, 5000};
+static Histogram requestTime("zap_http_request_milliseconds", "Time from the first byte of a request to its response",
+                             REQUEST_BUCKETS_MS, sizeof(REQUEST_BUCKETS_MS) / sizeof(REQUEST_BUCKETS_MS[0]));
+
+// lwIP never raises SIGPIPE, on the host a client that hangs up must not end the process
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char* statusText(int statusCode) {
+    switch (statusCode) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return statusCode < 400 ? "OK" : "Error";
+    }
+}
+
+// Sends what the socket takes without waiting and moves the rest to the front, false when the connection is gone
+static bool sendPending(int fd, char* data, size_t& length) {
+    size_t sent = 0;
+    while (sent < length) {
+        const ssize_t result = send(fd, data + sent, length - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        sent += result;
+    }
+    memmove(data, data + sent, length - sent);
+    length -= sent;
+    return true;
+}
+
+static const char* findHeaderEnd(const char* data, size_t length) {
+    for (size_t i = 3; i < length; i++) {
+        if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+            return data + i + 1;
+        }
+    }
+    return nullptr;
+}
+
+static bool equalsIgnoreCase(const char* text, size_t length, const char* expected) {
+    return strlen(expected) == length && strncasecmp(text, expected, length) == 0;
+}
+
+/**
+ * @brief Writes a response to a connection, collecting small pieces into one send
+ *
+ * The status line and headers go out with the start of the body, and each chunk goes
+ * out with its framing. The output buffer is sent whenever it is full and at the end,
+ * what the socket does not take stays in it for HttpServer::poll.
+ */
+class HttpServer::ConnectionWriter : public ResponseWriter {
+public:
+    ConnectionWriter(int fd, char* output, size_t capacity, size_t& used, bool keepAlive, bool http10)
+        : fd(fd), output(output), capacity(capacity), used(used), keepAlive(keepAlive), http10(http10),
+          chunked(false), begun(false), failed(false), headerName(nullptr), headerValue(nullptr),
+          stream(nullptr), subscriber(-1) {}
+
+    void setHeader(const char* name, const char* value) override {
+        headerName = name;
+        headerValue = value;
+    }
+
+    void begin(int statusCode, const char* contentType, size_t contentLength = UNKNOWN_LENGTH) override {
+        begun = true;
+        responses.increment(statusCode / 100 - 1);
+        // A 304 has no body, its headers describe the one the client already has
+        if (statusCode == 304) {
+            contentLength = 0;
+        }
+        // Without chunks a HTTP/1.0 client only sees the end of the body when the connection closes
+        chunked = contentLength == UNKNOWN_LENGTH && !http10;
+        if (contentLength == UNKNOWN_LENGTH && http10) {
+            keepAlive = false;
+        }
+
+        char line[160];
+        append(line, snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n",
+                              statusCode, statusText(statusCode), contentType), sizeof(line));
+        if (chunked) {
+            append("Transfer-Encoding: chunked\r\n");
+        } else if (contentLength != UNKNOWN_LENGTH && statusCode != 304) {
+            append(line, snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned int)contentLength), sizeof(line));
+        }
+        if (headerName != nullptr) {
+            append(line, snprintf(line, sizeof(line), "%s: %s\r\n", headerName, headerValue), sizeof(line));
+        }
+        append(keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    }
+
+    void write(const char* data, size_t length) override {
+        // An empty chunk would end the body early
+        if (length == 0) {
+            return;
+        }
+        if (chunked) {
+            char size[12];
+            append(size, snprintf(size, sizeof(size), "%x\r\n", (unsigned int)length), sizeof(size));
+            append(data, length);
+            append("\r\n", 2);
+        } else {
+            append(data, length);
+        }
+    }
+
+    void end() override {
+        if (chunked) {
+            append("0\r\n\r\n");
+        }
+        flush();
+    }
+
+    bool subscribe(EventStream& eventStream) override {
+        if (begun) {
+            return false;
+        }
+        const int id = eventStream.subscribe();
+        if (id < 0) {
+            return false;
+        }
+
+        // No length and no chunks, the body ends when the connection does
+        begun = true;
+        responses.increment(1);
+        append("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n");
+        flush();
+        if (failed) {
+            eventStream.unsubscribe(id);
+        } else {
+            stream = &eventStream;
+            subscriber = id;
+        }
+        return true;
+    }
+
+    EventStream* getStream() const { return stream; }
+    int getSubscriber() const { return subscriber; }
+
+    bool hasBegun() const { return begun; }
+    bool hasFailed() const { return failed; }
+    bool keepsAlive() const { return keepAlive && !failed; }
+
+private:
+    void append(const char* text) {
+        append(text, strlen(text));
+    }
+
+    // For snprintf results, which are the length it wanted rather than what it wrote
+    void append(const char* text, int length, size_t capacity) {
+        if (length > 0) {
+            append(text, (size_t)length < capacity ? (size_t)length : capacity - 1);
+        }
+    }
+
+    void append(const char* data, size_t length) {
+        while (length > 0 && !failed) {
+            // The client takes the response slower than the handler writes it, and there is no room left to keep it
+            if (used == capacity && (!sendPending(fd, output, used) || used == capacity)) {
+                failed = true;
+                return;
+            }
+            const size_t copied = length < capacity - used ? length : capacity - used;
+            memcpy(output + used, data, copied);
+            used += copied;
+            data += copied;
+            length -= copied;
+        }
+    }
+
+    void flush() {
+        if (used > 0 && !failed) {
+            failed = !sendPending(fd, output, used);
+        }
+    }
+
+    int fd;
+    char* output;
+    size_t capacity;
+    size_t& used;
+    bool keepAlive;
+    bool http10;
+    bool chunked;
+    bool begun;
+    bool failed;
+    const char* headerName;
+    const char* headerValue;
+    EventStream* stream;
+    int subscriber;
+};
+
+HttpServer::HttpServer(Externals& ext, uint16_t port)
+    : ext(ext), port(port), listenFd(-1), wakeFd(-1), rootRedirect(nullptr), stats() {
+    for (Connection& connection : connections) {
+        connection.fd = -1;
+        connection.used = 0;
+        connection.stream = nullptr;
+        connection.subscriber = -1;
+        connection.blocked = false;
+        connection.closing = false;
+        connection.outputUsed = 0;
+    }
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+bool HttpServer::begin() {
+    if (listenFd >= 0) {
+        return true;
+    }
+
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        LOG_TE(TAG_hs, "Failed to create socket: %d", errno);
+        return false;
+    }
+
+    const int enable = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, MAX_CONNECTIONS) < 0) {
+        LOG_TE(TAG_hs, "Failed to listen on port %d: %d", port, errno);
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    // Port 0 was given a free port
+    socklen_t length = sizeof(address);
+    if (getsockname(listenFd, (struct sockaddr*)&address, &length) == 0) {
+        port = ntohs(address.sin_port);
+    }
+
+    // Connected to itself, a datagram from the producer task makes select() return
+    wakeFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (wakeFd >= 0) {
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        length = sizeof(address);
+        if (bind(wakeFd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+            getsockname(wakeFd, (struct sockaddr*)&address, &length) < 0 ||
+            connect(wakeFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            ::close(wakeFd);
+            wakeFd = -1;
+        }
+    }
+    if (wakeFd < 0) {
+        LOG_TW(TAG_hs, "No wake socket, events wait for the next poll");
+    }
+
+    LOG_TI(TAG_hs, "Listening on port %d with %d connection slots", port, (int)MAX_CONNECTIONS);
+    return true;
+}
+
+void HttpServer::stop() {
+    for (Connection& connection : connections) {
+        closeConnection(connection);
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+    }
+    if (wakeFd >= 0) {
+        ::close(wakeFd);
+        wakeFd = -1;
+    }
+}
+
+void HttpServer::onPublish() {
+    const int fd = wakeFd;
+    if (fd >= 0) {
+        // A full socket is already awake
+        send(fd, "", 1, MSG_DONTWAIT);
+    }
+}
+
+size_t HttpServer::getOpenConnections() const {
+    size_t open = 0;
+    for (const Connection& connection : connections) {
+        if (connection.fd >= 0) {
+            open++;
+        }
+    }
+    return open;
+}
+
+void HttpServer::poll(uint32_t waitMs) {
+    if (listenFd < 0) {
+        return;
+    }
+
+    fd_set readSet;
+    fd_set writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_SET(listenFd, &readSet);
+    int maxFd = listenFd;
+    if (wakeFd >= 0) {
+        FD_SET(wakeFd, &readSet);
+        maxFd = wakeFd > maxFd ? wakeFd : maxFd;
+    }
+    for (const Connection& connection : connections) {
+        if (connection.fd >= 0) {
+            FD_SET(connection.fd, connection.blocked ? &writeSet : &readSet);
+            maxFd = connection.fd > maxFd ? connection.fd : maxFd;
+        }
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = waitMs / 1000;
+    timeout.tv_usec = (waitMs % 1000) * 1000;
+    const int ready = select(maxFd + 1, &readSet, &writeSet, nullptr, &timeout);
+
+    const unsigned long now = millis();
+    if (ready > 0) {
+        if (wakeFd >= 0 && FD_ISSET(wakeFd, &readSet)) {
+            char drain[16];
+            while (recv(wakeFd, drain, sizeof(drain), MSG_DONTWAIT) > 0) {
+            }
+        }
+        // Open connections first, a new client must not delay the ones already waiting
+        for (Connection& connection : connections) {
+            if (connection.fd >= 0 && connection.blocked && FD_ISSET(connection.fd, &writeSet)) {
+                sendOutput(connection, now);
+            }
+        }
+        for (Connection& connection : connections) {
+            if (connection.fd >= 0 && FD_ISSET(connection.fd, &readSet)) {
+                readFrom(connection, now);
+            }
+        }
+        if (FD_ISSET(listenFd, &readSet)) {
+            acceptClient(now);
+        }
+    }
+
+    for (Connection& connection : connections) {
+        if (connection.fd >= 0 && connection.stream != nullptr && !connection.blocked) {
+            sendEvents(connection, now);
+        }
+    }
+
+    expire(now);
+}
+
+void HttpServer::acceptClient(unsigned long now) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    const int fd = ::accept(listenFd, (struct sockaddr*)&address, &length);
+    if (fd < 0) {
+        return;
+    }
+
+    Connection* slot = nullptr;
+    for (Connection& connection : connections) {
+        if (connection.fd < 0) {
+            slot = &connection;
+            break;
+        }
+    }
+
+    // Responses are sent in whole pieces already, waiting for more only adds latency
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    if (slot == nullptr) {
+        stats.rejected++;
+        LOG_TW(TAG_hs, "All %d connections in use, turning a client away", (int)MAX_CONNECTIONS);
+        // A new socket has room for an error, what does not fit is lost with the connection
+        char output[256];
+        size_t used = 0;
+        sendError(fd, output, sizeof(output), used, 503);
+        ::close(fd);
+        return;
+    }
+
+    slot->fd = fd;
+    slot->used = 0;
+    slot->lastActivity = now;
+    slot->requestStart = now;
+    stats.accepted++;
+}
+
+void HttpServer::readFrom(Connection& connection, unsigned long now) {
+    if (connection.used >= REQUEST_BUFFER_SIZE) {
+        respondError(connection, 431);
+        return;
+    }
+
+    const ssize_t received = recv(connection.fd, connection.buffer + connection.used,
+                                  REQUEST_BUFFER_SIZE - connection.used, MSG_DONTWAIT);
+    if (received == 0) {
+        closeConnection(connection);
+        return;
+    }
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            closeConnection(connection);
+        }
+        return;
+    }
+
+    // An event stream client has nothing more to ask
+    if (connection.stream != nullptr) {
+        return;
+    }
+
+    if (connection.used == 0) {
+        connection.requestStart = now;
+    }
+    connection.used += received;
+    connection.lastActivity = now;
+
+    // Pipelined requests are all in the buffer already
+    while (connection.fd >= 0 && connection.used > 0 && serveRequest(connection)) {
+    }
+}
+
+bool HttpServer::serveRequest(Connection& connection) {
+    char* buffer = connection.buffer;
+    const char* headerEnd = findHeaderEnd(buffer, connection.used);
+    if (headerEnd == nullptr) {
+        if (connection.used >= REQUEST_BUFFER_SIZE) {
+            respondError(connection, 431);
+        }
+        return false;
+    }
+    const size_t headerLength = headerEnd - buffer;
+
+    // Request line: <method> <target> HTTP/1.<minor>
+    char* lineEnd = static_cast<char*>(memchr(buffer, '\r', headerLength));
+    char* methodEnd = static_cast<char*>(memchr(buffer, ' ', lineEnd - buffer));
+    char* target = methodEnd != nullptr ? methodEnd + 1 : nullptr;
+    char* targetEnd = target != nullptr ? static_cast<char*>(memchr(target, ' ', lineEnd - target)) : nullptr;
+    const char* version = targetEnd != nullptr ? targetEnd + 1 : nullptr;
+    if (methodEnd == nullptr || methodEnd == buffer || targetEnd == nullptr || targetEnd == target ||
+        lineEnd - version != 8 || strncmp(version, "HTTP/1.", 7) != 0) {
+        respondError(connection, 400);
+        return false;
+    }
+    const bool http10 = version[7] == '0';
+
+    bool keepAlive = !http10;
+    size_t contentLength = 0;
+    char* ifNoneMatch = nullptr;
+    size_t ifNoneMatchLength = 0;
+    for (char* line = lineEnd + 2; line < headerEnd - 2;) {
+        char* end = static_cast<char*>(memchr(line, '\r', headerEnd - line));
+        char* colon = static_cast<char*>(memchr(line, ':', end - line));
+        if (colon != nullptr) {
+            char* value = colon + 1;
+            while (value < end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            size_t valueLength = end - value;
+            while (valueLength > 0 && (value[valueLength - 1] == ' ' || value[valueLength - 1] == '\t')) {
+                valueLength--;
+            }
+
+            const size_t nameLength = colon - line;
+            if (equalsIgnoreCase(line, nameLength, "Content-Length")) {
+                contentLength = 0;
+                for (size_t i = 0; i < valueLength; i++) {
+                    if (value[i] < '0' || value[i] > '9' || contentLength > REQUEST_BUFFER_SIZE) {
+                        respondError(connection, value[i] < '0' || value[i] > '9' ? 400 : 413);
+                        return false;
+                    }
+                    contentLength = contentLength * 10 + (value[i] - '0');
+                }
+            } else if (equalsIgnoreCase(line, nameLength, "Connection")) {
+                if (equalsIgnoreCase(value, valueLength, "close")) {
+                    keepAlive = false;
+                } else if (equalsIgnoreCase(value, valueLength, "keep-alive")) {
+                    keepAlive = true;
+                }
+            } else if (equalsIgnoreCase(line, nameLength, "If-None-Match")) {
+                ifNoneMatch = value;
+                ifNoneMatchLength = valueLength;
+            } else if (equalsIgnoreCase(line, nameLength, "Transfer-Encoding")) {
+                // Request bodies are small, chunked ones are not worth parsing
+                respondError(connection, 501);
+                return false;
+            }
+        }
+        line = end + 2;
+    }
+
+    if (contentLength > REQUEST_BUFFER_SIZE - headerLength) {
+        respondError(connection, 413);
+        return false;
+    }
+    const size_t total = headerLength + contentLength;
+    if (connection.used < total) {
+        return false;
+    }
+
+    // Method, path, If-None-Match and body are terminated in place, the query string is not used
+    *methodEnd = '\0';
+    if (ifNoneMatch != nullptr) {
+        ifNoneMatch[ifNoneMatchLength] = '\0';
+    }
+    char* query = static_cast<char*>(memchr(target, '?', targetEnd - target));
+    *(query != nullptr ? query : targetEnd) = '\0';
+    const char next = buffer[total];
+    buffer[total] = '\0';
+
+    stats.requests++;
+    ConnectionWriter writer(connection.fd, connection.output, sizeof(connection.output), connection.outputUsed, keepAlive, http10);
+    if (rootRedirect != nullptr && strcmp(target, "/") == 0 && strcmp(buffer, "GET") == 0) {
+        writer.setHeader("Location", rootRedirect);
+        writer.begin(302, "text/plain", 0);
+        writer.end();
+    } else {
+        EndpointRequest request(ext.toEndpoint(zap::Str(target), zap::Str(buffer)));
+        request.content = zap::Str(buffer + headerLength);
+        request.offset = 0;
+        request.ifNoneMatch = ifNoneMatch;
+        ext.route(request, writer);
+        if (!writer.hasBegun()) {
+            LOG_TE(TAG_hs, "No response for %s %s", buffer, target);
+            writer.begin(500, "application/json", 0);
+            writer.end();
+        }
+    }
+    buffer[total] = next;
+    requestTime.observe(millis() - connection.requestStart);
+
+    if (writer.getStream() != nullptr) {
+        stats.streams++;
+        connection.stream = writer.getStream();
+        connection.subscriber = writer.getSubscriber();
+        connection.blocked = connection.outputUsed > 0;
+        connection.used = 0;
+        connection.lastActivity = millis();
+        connection.stream->setListener(this);
+        return false;
+    }
+
+    if (writer.hasFailed()) {
+        stats.errors++;
+        closeConnection(connection);
+        return false;
+    }
+    if (!writer.keepsAlive()) {
+        closeWhenSent(connection);
+        return false;
+    }
+
+    // What is left is the start of the next request, it is served once this response is out
+    memmove(buffer, buffer + total, connection.used - total);
+    connection.used -= total;
+    connection.lastActivity = millis();
+    connection.requestStart = connection.lastActivity;
+    connection.blocked = connection.outputUsed > 0;
+    return !connection.blocked;
+}
+
+void HttpServer::sendOutput(Connection& connection, unsigned long now) {
+    const size_t before = connection.outputUsed;
+    if (!sendPending(connection.fd, connection.output, connection.outputUsed)) {
+        stats.errors++;
+        closeConnection(connection);
+        return;
+    }
+    if (connection.outputUsed < before) {
+        connection.lastActivity = now;
+    }
+    if (connection.outputUsed > 0) {
+        return;
+    }
+
+    connection.blocked = false;
+    if (connection.closing) {
+        closeConnection(connection);
+        return;
+    }
+    // The socket has room again, pipelined requests that waited for it go next
+    connection.requestStart = now;
+    while (connection.fd >= 0 && connection.used > 0 && serveRequest(connection)) {
+    }
+}
+
+void HttpServer::sendError(int fd, char* output, size_t capacity, size_t& used, int statusCode) {
+    char body[96];
+    const int length = snprintf(body, sizeof(body), "{\"status\":\"error\",\"message\":\"%s\"}", statusText(statusCode));
+
+    ConnectionWriter writer(fd, output, capacity, used, false, false);
+    writer.begin(statusCode, "application/json", length);
+    writer.write(body, length);
+    writer.end();
+}
+
+void HttpServer::respondError(Connection& connection, int statusCode) {
+    sendError(connection.fd, connection.output, sizeof(connection.output), connection.outputUsed, statusCode);
+    if (statusCode == 408) {
+        stats.timeouts++;
+    } else {
+        stats.errors++;
+    }
+    closeWhenSent(connection);
+}
+
+void HttpServer::sendEvents(Connection& connection, unsigned long now) {
+    // The output buffer is empty once the headers are out, events are read into it
+    char* data = connection.output;
+    for (;;) {
+        const int length = connection.stream->peek(connection.subscriber, data, sizeof(connection.output));
+        if (length == EventStream::OVERRUN) {
+            LOG_TW(TAG_hs, "Event stream client fell behind, closing it");
+            closeConnection(connection);
+            return;
+        }
+        if (length == 0) {
+            return;
+        }
+
+        const ssize_t sent = send(connection.fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                connection.blocked = true;
+            } else {
+                stats.errors++;
+                closeConnection(connection);
+            }
+            return;
+        }
+        connection.stream->consume(connection.subscriber, sent);
+        connection.lastActivity = now;
+        if (sent < length) {
+            connection.blocked = true;
+            return;
+        }
+    }
+}
+
+void HttpServer::closeWhenSent(Connection& connection) {
+    // Nothing more is read, the rest of the buffer is not answered
+    connection.used = 0;
+    if (connection.outputUsed == 0) {
+        closeConnection(connection);
+        return;
+    }
+    connection.closing = true;
+    connection.blocked = true;
+}
+
+void HttpServer::closeConnection(Connection& connection) {
+    if (connection.fd >= 0) {
+        ::close(connection.fd);
+        connection.fd = -1;
+    }
+    if (connection.stream != nullptr) {
+        connection.stream->unsubscribe(connection.subscriber);
+        if (connection.stream->getSubscriberCount() == 0) {
+            connection.stream->setListener(nullptr);
+        }
+        connection.stream = nullptr;
+        connection.subscriber = -1;
+    }
+    connection.used = 0;
+    connection.blocked = false;
+    connection.closing = false;
+    connection.outputUsed = 0;
+}
+
+void HttpServer::expire(unsigned long now) {
+    for (Connection& connection : connections) {
+        if (connection.fd < 0) {
+            continue;
+        }
+        if (connection.stream != nullptr) {
+            // Quiet streams are kept, a comment now and then finds out whether the client is still there
+            if (!connection.blocked && now - connection.lastActivity >= STREAM_KEEPALIVE_MS &&
+                !connection.stream->hasPending(connection.subscriber)) {
+                if (send(connection.fd, ":\n\n", 3, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    closeConnection(connection);
+                    continue;
+                }
+                connection.lastActivity = now;
+            }
+            continue;
+        }
+        if (connection.blocked) {
+            // A client that stopped reading gives up its slot rather than keep it
+            if (now - connection.lastActivity >= SEND_TIMEOUT_MS) {
+                stats.errors++;
+                closeConnection(connection);
+            }
+            continue;
+        }
+        if (connection.used > 0 && now - connection.requestStart >= REQUEST_TIMEOUT_MS) {
+            LOG_TD(TAG_hs, "Request not complete after %u ms", (unsigned int)REQUEST_TIMEOUT_MS);
+            respondError(connection, 408);
+        } else if (connection.used == 0 && now - connection.lastActivity >= IDLE_TIMEOUT_MS) {
+            stats.timeouts++;
+            closeConnection(connection);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "data/event_stream.h"
+#include "endpoints/endpoint_types.h"
+#include "endpoints/response_writer.h"
+#include "zap_str.h"
+
+/**
+ * @brief HTTP/1.1 server on BSD sockets that serves several clients from one task
+ *
+ * One select() call waits on the listening socket and all open connections, and only
+ * sockets with data are read, so a slow client does not hold up the others. Connections
+ * come from a fixed pool and read into fixed buffers. They are kept alive between
+ * requests, and pipelined requests are served in order from the same buffer. A
+ * connection is closed after IDLE_TIMEOUT_MS without a request. A request that is not
+ * complete REQUEST_TIMEOUT_MS after its first byte gets a 408.
+ *
+ * A response is collected in the output buffer of its connection and sent as the handler
+ * writes it, without waiting on the socket. What the socket does not take stays in the
+ * buffer and goes out as select() finds the socket writable again, the next pipelined
+ * request waits until then. A response of unknown length uses chunked encoding. The
+ * connection is dropped when the handler writes more than the socket and the buffer
+ * have room for, or when its output makes no progress for SEND_TIMEOUT_MS.
+ *
+ * A handler can turn its response into an event stream with ResponseWriter::subscribe.
+ * The connection then stays in the pool and gets the events of the stream as they are
+ * published. Those sends never block, a client that does not keep up loses events as
+ * EventStream describes. The producer wakes select() through a UDP socket on the
+ * loopback interface, the same way esp_http_server gets work into its task, so an event
+ * goes out right away rather than at the next poll.
+ *
+ * lwIP and POSIX have the same socket API, so the server also builds on the host.
+ */
+class HttpServer : private EventStream::Listener {
+public:
+    class Externals {
+        public:
+            virtual const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) = 0;
+            virtual void route(const EndpointRequest& request, ResponseWriter& writer) = 0;
+    };
+
+    static const size_t MAX_CONNECTIONS = 4;
+    static const size_t REQUEST_BUFFER_SIZE = 1024;   // Request line, headers and body together
+    static const size_t OUTPUT_BUFFER_SIZE = 2048;    // Headers and chunk framing go out with the data, the rest waits here
+    static const uint32_t IDLE_TIMEOUT_MS = 5000;
+    static const uint32_t REQUEST_TIMEOUT_MS = 5000;
+    static const uint32_t SEND_TIMEOUT_MS = 2000;     // Output that makes no progress this long drops the connection
+    static const uint32_t STREAM_KEEPALIVE_MS = 15000;  // A comment goes out on a quiet event stream
+
+    struct Stats {
+        uint32_t accepted;
+        uint32_t rejected;      // Turned away with a 503, all connections were in use
+        uint32_t requests;
+        uint32_t timeouts;
+        uint32_t errors;        // Malformed or oversized requests and failed sends
+        uint32_t streams;       // Responses turned into event streams
+    };
+
+    HttpServer(Externals& ext, uint16_t port);
+    ~HttpServer();
+
+    /** @brief Opens the listening socket, port 0 picks a free port */
+    bool begin();
+    void stop();
+    bool isRunning() const { return listenFd >= 0; }
+
+    /** @brief Waits up to waitMs for activity and serves every request that is complete */
+    void poll(uint32_t waitMs);
+
+    /** @brief A GET of "/" is redirected here, nullptr answers it like any other path */
+    void setRootRedirect(const char* location) { rootRedirect = location; }
+
+    uint16_t getPort() const { return port; }
+    size_t getOpenConnections() const;
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Connection {
+        int fd;
+        size_t used;
+        unsigned long lastActivity;
+        unsigned long requestStart;
+        EventStream* stream;    // Set when the connection is an event stream
+        int subscriber;
+        bool blocked;           // The last send did not go out in full, nothing more is read until it has
+        bool closing;           // Closed once its output is out
+        size_t outputUsed;
+        char buffer[REQUEST_BUFFER_SIZE + 1];   // One more for a NUL after the body
+        char output[OUTPUT_BUFFER_SIZE];        // Response bytes the socket did not take yet
+    };
+
+    class ConnectionWriter;
+
+    void acceptClient(unsigned long now);
+    void readFrom(Connection& connection, unsigned long now);
+    bool serveRequest(Connection& connection);
+    void sendOutput(Connection& connection, unsigned long now);
+    void respondError(Connection& connection, int statusCode);
+    static void sendError(int fd, char* output, size_t capacity, size_t& used, int statusCode);
+    void sendEvents(Connection& connection, unsigned long now);
+    void closeWhenSent(Connection& connection);
+    void closeConnection(Connection& connection);
+    void expire(unsigned long now);
+    void onPublish() override;
+
+    Externals& ext;
+    uint16_t port;
+    int listenFd;
+    int wakeFd;
+    const char* rootRedirect;
+    Connection connections[MAX_CONNECTIONS];
+    Stats stats;
+};
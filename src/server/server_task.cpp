@@ -58,6 +58,9 @@ void ServerTask::stop() {
         vTaskDelete(taskHandle);
         taskHandle = nullptr;
     }
+
+    // The task is gone, its sockets are closed from here
+    webServer.stop();
     
     LOG_I(TAG, "Server task stopped");
 }
@@ -74,11 +77,8 @@ void ServerTask::taskFunction(void* parameter) {
     
     // Main task loop
     while (serverTask->shouldRun) {
-        // Handle client requests
+        // Blocks in select() until a client sends something, so there is no polling delay
         serverTask->webServer.handleClient();
-        
-        // Yield to other tasks
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
     
     // Task cleanup
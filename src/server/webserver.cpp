@@ -5,53 +5,48 @@
 // Define TAG for logging
 static const char* TAG = "webserver";
 
-WebServerHandler::WebServerHandler(int port) : server(port) {
+// How long handleClient waits for a request, the server task loop runs at least this often
+static const uint32_t POLL_WAIT_MS = 50;
+
+WebServerHandler::WebServerHandler(int port) : server(*this, port) {
 }
 
 void WebServerHandler::begin() {
     server.begin();
 }
 
-void WebServerHandler::handleClient() {
-    server.handleClient();
+void WebServerHandler::stop() {
+    server.stop();
 }
 
-HTTPMethod verbToHttpMethod(Endpoint::Verb verb) {
-    switch (verb) {
-        case Endpoint::Verb::GET: return HTTP_GET;
-        case Endpoint::Verb::POST: return HTTP_POST;
-        case Endpoint::Verb::DELETE: return HTTP_DELETE;
-        default: return HTTP_ANY;
+void WebServerHandler::handleClient() {
+    if (!server.isRunning() && !server.begin()) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        return;
     }
+    server.poll(POLL_WAIT_MS);
+}
+
+const Endpoint& WebServerHandler::toEndpoint(const zap::Str& path, const zap::Str& verb) {
+    return EndpointMapper::toEndpoint(path, verb);
+}
+
+void WebServerHandler::route(const EndpointRequest& request, ResponseWriter& writer) {
+    LOG_I(TAG, "Handling for %s %s request", EndpointMapper::verbToString(request.endpoint.verb).c_str(), request.endpoint.path);
+    EndpointMapper::route(request, writer);
 }
 
 void WebServerHandler::setupEndpoints() {
     LOG_I(TAG, "Setting up endpoints...");
 
     // Print server configuration
-    LOG_I(TAG, "Server port: %d", 80);  // Default port
-    
-    // Handle root path separately as it serves HTML
-    LOG_I(TAG, "Registering root (/) endpoint...");
-    server.on("/", HTTP_GET, [this]() {
-        LOG_I(TAG, "Handling root request");
-        
-        // If already provisioned, redirect to system info
-        server.sendHeader("Location", EndpointMapper::SYSTEM_INFO_PATH, true);
-        server.send(302, "text/plain", "");
-    });
-
-    // loop through all endpoints and register them
+    LOG_I(TAG, "Server port: %d", server.getPort());
+
+    // The root path has no page, it redirects to system info
+    server.setRootRedirect(EndpointMapper::SYSTEM_INFO_PATH);
+
+    // Requests are matched through the EndpointMapper, there is nothing to register
     for (const Endpoint& endpoint : endpointMapper) {
-        server.on(endpoint.path, verbToHttpMethod(endpoint.verb), [this, endpoint]() {
-            LOG_I(TAG, "Handling for %s %s request", EndpointMapper::verbToString(endpoint.verb).c_str(), endpoint.path); // Corrected: endpoint.path is already a const char*
-            EndpointRequest request(endpoint);
-            request.content = server.arg("plain").c_str();
-            request.offset = 0;
-
-            EndpointResponse response = EndpointMapper::route(request);
-            server.send(response.statusCode, response.contentType.c_str(), response.data.c_str());
-        });
+        LOG_D(TAG, "Serving %s %s", EndpointMapper::verbToString(endpoint.verb).c_str(), endpoint.path);
     }
-
-}
\ No newline at end of file
+}
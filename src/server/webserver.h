@@ -1,6 +1,5 @@
 #pragma once
 
-#include <WebServer.h>
 #include <ESPmDNS.h>
 #include <Update.h>
 #include <WiFi.h>
@@ -8,15 +7,21 @@
 #include <Arduino.h>
 #include "endpoints/endpoint_types.h"
 #include "endpoints/endpoint_mapper.h"
+#include "http_server.h"
 
-class WebServerHandler {
+class WebServerHandler : public HttpServer::Externals {
 public:
     explicit WebServerHandler(int port = 80);
     void begin();
+    void stop();
     void handleClient();
     void setupEndpoints();
-    WebServer& getServer() { return server; }
+    HttpServer& getServer() { return server; }
+
+    // HttpServer::Externals, requests are dispatched through the EndpointMapper
+    const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) override;
+    void route(const EndpointRequest& request, ResponseWriter& writer) override;
 
 private:
-    WebServer server;
-}; 
\ No newline at end of file
+    HttpServer server;
+};
@@ -170,6 +170,10 @@ zap::Str WifiManager::getLocalIP() const {
     return zap::Str(WiFi.localIP().toString().c_str());
 }
 
+int WifiManager::getRSSI() const {
+    return isConnected() ? WiFi.RSSI() : 0;
+}
+
 zap::Str WifiManager::getMacAddress() const {
     uint8_t mac[6];
     WiFi.macAddress(mac);
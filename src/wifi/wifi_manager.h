@@ -26,6 +26,7 @@ public:
     virtual bool isConnected() const;
     zap::Str getLocalIP() const;
     int getStatus() const;
+    int getRSSI() const; // dBm, 0 when not connected
     
     // Getters for stored data
     bool isProvisioned() const { return _isProvisioned; }
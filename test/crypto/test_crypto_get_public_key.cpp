@@ -5,6 +5,7 @@
 #include "../src/endpoints/endpoint_types.h"
 #include "config.h"
 #include "crypto.h"
+#include "../src/json_light/json_light.h"
 
 
 // Test the handleCryptoSign endpoint
@@ -13,4 +14,31 @@ void test_crypto_get_public_key(void) {
     Serial.println("Public key: ");
     Serial.println(publicKey.c_str());
     TEST_ASSERT_EQUAL_STRING(EXPECTED_PUBLIC_KEY_HEX, publicKey.c_str());
-} 
\ No newline at end of file
+} 
+
+// The identity from crypto_init() must match the key, and reading it must be far cheaper than deriving the key
+void test_crypto_identity(void) {
+    const DeviceIdentity& identity = crypto_get_identity();
+    TEST_ASSERT_EQUAL_STRING(EXPECTED_PUBLIC_KEY_HEX, identity.publicKeyHex.c_str());
+    TEST_ASSERT_EQUAL(86, identity.publicKeyBase64Url.length());
+    TEST_ASSERT_EQUAL(20, identity.id.length());
+    TEST_ASSERT_EQUAL(0, strncmp(identity.id.c_str(), "zap-", 4));
+    TEST_ASSERT_EQUAL_PTR(&identity.id, &crypto_getId());
+
+    unsigned long start = micros();
+    zap::Str derived = crypto_get_public_key(PRIVATE_KEY_HEX);
+    unsigned long deriveTime = micros() - start;
+
+    start = micros();
+    JsonBuilder json;
+    json.beginObject()
+        .add("deviceName", "software_zap")
+        .add("serialNumber", identity.id.c_str())
+        .add("publicKey", identity.publicKeyHex.c_str());
+    zap::Str response = json.end();
+    unsigned long cachedTime = micros() - start;
+
+    Serial.printf("crypto info with key derivation: %lu us, with cached identity: %lu us\n", deriveTime, cachedTime);
+    TEST_ASSERT_EQUAL_STRING(derived.c_str(), identity.publicKeyHex.c_str());
+    TEST_ASSERT_LESS_THAN(deriveTime, cachedTime);
+}
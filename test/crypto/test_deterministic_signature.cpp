@@ -0,0 +1,47 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "config.h"
+#include "crypto.h"
+
+// RFC 6979 A.2.5, ECDSA with P-256 and SHA-256
+static const char* RFC6979_PRIVATE_KEY_HEX = "c9afa9d845ba75166b5c215767b1d6934e50c3db36e89b127b8a622b120f6721";
+static const char* RFC6979_SAMPLE_SIGNATURE_HEX =
+    "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716"
+    "f7cb1c942d657c41d436c7a1b6e29f65f3e900dbb9aff4064dc4ab2f843acda8";
+static const char* RFC6979_TEST_SIGNATURE_HEX =
+    "f1abb023518351cd71d881567b1ea663ed3efcf6c5132b354f28d3b0b7d38367"
+    "019f4113742a2b14bd25926b49c649155f267e60d3814b4c0cc84250e46f0083";
+
+// JWT signed with PRIVATE_KEY_HEX from config.cpp, any change in header or payload encoding or signing shows up here
+static const char* GOLDEN_JWT =
+    "eyJhbGciOiJFUzI1NiIsInR5cCI6IkpXVCJ9.eyJ0ZXN0IjoiZ29sZGVuIn0."
+    "l7d1_aSPkQasv3G5hqKVhmQ4cigOvynDWLHkg9bmYVem-xtX9c5qItR3qp9kkppJW-Fv1r4y2elAfHZXGSuWPg";
+
+static void sign_rfc6979_vector(const char* message, const char* expectedHex) {
+    uint8_t privateKey[32];
+    for (int i = 0; i < 32; i++) {
+        sscanf(RFC6979_PRIVATE_KEY_HEX + 2 * i, "%2hhx", &privateKey[i]);
+    }
+
+    uint8_t signature[64];
+    TEST_ASSERT_TRUE(Crypto::signMessage(privateKey, (const uint8_t*)message, strlen(message), signature, true));
+
+    char signatureHex[129];
+    bytes_to_hex_string(signature, 64, signatureHex);
+    TEST_ASSERT_EQUAL_STRING(expectedHex, signatureHex);
+}
+
+void test_deterministic_signature_rfc6979(void) {
+    sign_rfc6979_vector("sample", RFC6979_SAMPLE_SIGNATURE_HEX);
+    sign_rfc6979_vector("test", RFC6979_TEST_SIGNATURE_HEX);
+}
+
+void test_deterministic_golden_jwt(void) {
+    crypto_set_deterministic_signing(true);
+    zap::Str first = crypto_create_jwt("{\"alg\":\"ES256\",\"typ\":\"JWT\"}", "{\"test\":\"golden\"}");
+    zap::Str second = crypto_create_jwt("{\"alg\":\"ES256\",\"typ\":\"JWT\"}", "{\"test\":\"golden\"}");
+    crypto_set_deterministic_signing(false);
+
+    TEST_ASSERT_EQUAL_STRING(GOLDEN_JWT, first.c_str());
+    TEST_ASSERT_EQUAL_STRING(first.c_str(), second.c_str());
+}
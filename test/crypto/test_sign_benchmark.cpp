@@ -0,0 +1,83 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "config.h"
+#include "crypto.h"
+
+/**
+ * @brief Largest amount of heap taken at once between begin() and end()
+ *
+ * The low-water mark of the heap cannot be reset, so begin() fills the heap to just
+ * below it. Every allocation after that sets a new low, and the distance from the free
+ * heap at begin() to the new low is the peak.
+ */
+class HeapPeak {
+public:
+    void begin() {
+        count = 0;
+        size_t needed = ESP.getFreeHeap() - ESP.getMinFreeHeap() + 1024;
+        while (needed > 0 && count < MAX_BLOCKS) {
+            // The largest block also holds the allocator header
+            const size_t largest = ESP.getMaxAllocHeap() > 64 ? ESP.getMaxAllocHeap() - 64 : 0;
+            const size_t size = needed < largest ? needed : largest;
+            blocks[count] = size > 0 ? malloc(size) : nullptr;
+            if (blocks[count] == nullptr) {
+                break;
+            }
+            count++;
+            needed -= size;
+        }
+        start = ESP.getFreeHeap();
+    }
+
+    uint32_t end() {
+        const uint32_t peak = start - ESP.getMinFreeHeap();
+        while (count > 0) {
+            free(blocks[--count]);
+        }
+        return peak;
+    }
+
+private:
+    static const int MAX_BLOCKS = 16;
+    void* blocks[MAX_BLOCKS];
+    int count;
+    uint32_t start;
+};
+
+// Compare signing with a fresh context per call against the long-lived signer from crypto_init()
+void test_sign_benchmark(void) {
+    const int iterations = 10;
+    const char* message = "eyJhbGciOiJFUzI1NiIsInR5cCI6IkpXVCJ9.eyJ0ZXN0IjoiYmVuY2htYXJrIn0";
+
+    uint8_t privateKey[32];
+    for (int i = 0; i < 32; i++) {
+        sscanf(PRIVATE_KEY_HEX + 2 * i, "%2hhx", &privateKey[i]);
+    }
+
+    uint8_t signature[64];
+    HeapPeak heap;
+    uint32_t heapBefore = ESP.getFreeHeap();
+
+    heap.begin();
+    unsigned long start = micros();
+    for (int i = 0; i < iterations; i++) {
+        TEST_ASSERT_TRUE(Crypto::signMessage(privateKey, (const uint8_t*)message, strlen(message), signature));
+    }
+    unsigned long perCallContext = (micros() - start) / iterations;
+    const uint32_t perCallPeak = heap.end();
+
+    heap.begin();
+    start = micros();
+    for (int i = 0; i < iterations; i++) {
+        TEST_ASSERT_NOT_EQUAL(0, crypto_create_signature_base64url(message).length());
+    }
+    unsigned long longLivedSigner = (micros() - start) / iterations;
+    const uint32_t longLivedPeak = heap.end();
+
+    Serial.printf("Sign with per call context: %lu us, peak heap %u bytes\n", perCallContext, perCallPeak);
+    Serial.printf("Sign with long-lived signer: %lu us, peak heap %u bytes\n", longLivedSigner, longLivedPeak);
+    Serial.printf("Free heap before: %u, after: %u\n", heapBefore, ESP.getFreeHeap());
+
+    TEST_ASSERT_LESS_OR_EQUAL(perCallContext, longLivedSigner);
+    TEST_ASSERT_LESS_OR_EQUAL(perCallPeak, longLivedPeak);
+}
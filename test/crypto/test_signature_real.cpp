@@ -9,7 +9,7 @@ void test_crypto_create_signature(void) {
     const char* testMessage = "test_message_for_signature_verification";
     
     // Generate signature using the actual implementation
-    zap::Str hexSignature = crypto_create_signature_der_hex(testMessage, PRIVATE_KEY_HEX);
+    zap::Str hexSignature = crypto_create_signature_der_hex(testMessage);
     
     // Print the signature for verification
     Serial.print("Test message: ");
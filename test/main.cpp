@@ -16,6 +16,8 @@
 #include "crypto/test_signature_real.cpp"
 #include "crypto/test_crypto_get_public_key.cpp"
 #include "crypto/test_crypto_sign_endpoint.cpp"
+#include "crypto/test_sign_benchmark.cpp"
+#include "crypto/test_deterministic_signature.cpp"
 #include "json_light/test_json_light.cpp"
 #include "endpoints/test_wifi_endpoint_handlers.cpp"
 
@@ -26,11 +28,17 @@ CryptoSignHandler g_cryptoSignHandler;
 void setup() {
     delay(2000);  // Give serial monitor time to connect
     Serial.begin(115200);
+
+    crypto_init(PRIVATE_KEY_HEX);
     
     UNITY_BEGIN();
     RUN_TEST(test_crypto_create_signature);
     RUN_TEST(test_crypto_get_public_key);
+    RUN_TEST(test_crypto_identity);
     RUN_TEST(test_handle_crypto_sign_endpoint);
+    RUN_TEST(test_sign_benchmark);
+    RUN_TEST(test_deterministic_signature_rfc6979);
+    RUN_TEST(test_deterministic_golden_jwt);
     RUN_TEST(test_wifi_status_handler);
     RUN_TEST(test_json_builder);
     RUN_TEST(test_json_parser);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Counts heap allocations made between begin() and end() on any thread. malloc, calloc
+// and realloc of the test binary are replaced by ones that count and hand on to glibc.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+namespace allocation_counter {
+    static std::atomic<bool> counting(false);
+    static std::atomic<size_t> allocations(0);
+
+    inline void begin() {
+        allocations = 0;
+        counting = true;
+    }
+
+    inline size_t end() {
+        counting = false;
+        return allocations;
+    }
+
+    inline void count() {
+        if (counting.load(std::memory_order_relaxed)) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+extern "C" void* malloc(size_t size) {
+    allocation_counter::count();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocation_counter::count();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocation_counter::count();
+    return __libc_realloc(pointer, size);
+}
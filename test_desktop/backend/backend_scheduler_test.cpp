@@ -0,0 +1,249 @@
+#include <assert.h>
+
+#include "../src/backend/backend_scheduler.h"
+
+namespace backend_scheduler_test {
+
+    typedef BackendScheduler::Priority Priority;
+
+    // A job that records its runs and holds the task for a while, like a slow HTTP request
+    struct FakeJob {
+        char name;
+        unsigned long delayMs;
+        char* log;
+        size_t* logLength;
+    };
+
+    static void runFake(void* context, unsigned long now, const Deadline& deadline) {
+        FakeJob* job = static_cast<FakeJob*>(context);
+        job->log[(*job->logLength)++] = job->name;
+        millis_return_value = now + job->delayMs;
+    }
+
+    int test_priority_order() {
+        millis_return_value = 1000;
+        BackendScheduler scheduler;
+        char log[16] = {0};
+        size_t length = 0;
+        FakeJob ota = {'o', 0, log, &length};
+        FakeJob state = {'s', 0, log, &length};
+        FakeJob data = {'d', 0, log, &length};
+        FakeJob command = {'c', 0, log, &length};
+
+        // Added in reverse, all due at once
+        scheduler.add({"ota", Priority::OTA, 1000, 60000, 1000}, runFake, &ota);
+        scheduler.add({"state", Priority::STATE, 1000, 60000, 1000}, runFake, &state);
+        scheduler.add({"data", Priority::DATA, 1000, 60000, 1000}, runFake, &data);
+        scheduler.add({"command", Priority::INTERACTIVE, 1000, 60000, 1000}, runFake, &command);
+
+        while (scheduler.runNext()) {
+        }
+        assert(strcmp(log, "cdso") == 0);
+        assert(scheduler.getIdleMs(5000) == 1000);
+        assert(scheduler.getIdleMs(500) == 500);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_slow_job_then_command() {
+        // A slow OTA check must not hold the command responses behind data and state as well
+        millis_return_value = 0;
+        BackendScheduler scheduler;
+        char log[16] = {0};
+        size_t length = 0;
+        FakeJob command = {'c', 0, log, &length};
+        FakeJob data = {'d', 0, log, &length};
+        FakeJob state = {'s', 0, log, &length};
+        FakeJob ota = {'o', 15000, log, &length};
+
+        scheduler.add({"command", Priority::INTERACTIVE, 100, 200, 5000}, runFake, &command);
+        scheduler.add({"data", Priority::DATA, 100, 60000, 10000}, runFake, &data);
+        scheduler.add({"state", Priority::STATE, 1000, 60000, 10000}, runFake, &state);
+        scheduler.add({"ota", Priority::OTA, 60000, 60000, 10000}, runFake, &ota);
+
+        for (int i = 0; i < 6; i++) {
+            scheduler.runNext();
+        }
+        assert(strcmp(log, "cdsocd") == 0);
+
+        // The command job waited for the OTA check and no more, the OTA check overran
+        assert(scheduler.getStats(0)->maxLatencyMs == 15000 - 100);
+        assert(scheduler.getStats(0)->late == 1);
+        assert(scheduler.getStats(3)->overruns == 1);
+        assert(scheduler.getStats(3)->maxRunMs == 15000);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_late_job_preempts() {
+        // Data that is always due must not starve the state job past its maximum latency
+        millis_return_value = 0;
+        BackendScheduler scheduler;
+        char log[32] = {0};
+        size_t length = 0;
+        FakeJob data = {'d', 400, log, &length};
+        FakeJob state = {'s', 0, log, &length};
+
+        scheduler.add({"data", Priority::DATA, 0, 60000, 1000}, runFake, &data);
+        scheduler.add({"state", Priority::STATE, 0, 1000, 1000}, runFake, &state);
+
+        for (int i = 0; i < 8; i++) {
+            scheduler.runNext();
+        }
+        // The state job gets a turn every time it waited over a second
+        assert(strcmp(log, "dddsddds") == 0);
+        assert(scheduler.getStats(1)->runs == 2);
+        assert(scheduler.getStats(1)->late == 2);
+        assert(scheduler.getStats(1)->maxLatencyMs == 1200);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_cancel() {
+        millis_return_value = 0;
+        BackendScheduler scheduler;
+        char log[8] = {0};
+        size_t length = 0;
+        FakeJob data = {'d', 0, log, &length};
+        FakeJob ota = {'o', 0, log, &length};
+
+        const int dataId = scheduler.add({"data", Priority::DATA, 100, 1000, 1000}, runFake, &data);
+        const int otaId = scheduler.add({"ota", Priority::OTA, 100, 1000, 1000}, runFake, &ota);
+        scheduler.cancel(otaId);
+
+        while (scheduler.runNext()) {
+        }
+        assert(strcmp(log, "d") == 0);
+        assert(scheduler.getName(otaId) == nullptr);
+        assert(scheduler.getStats(otaId) == nullptr);
+
+        // The slot is free again
+        assert(scheduler.add({"ota", Priority::OTA, 100, 1000, 1000}, runFake, &ota) == otaId);
+        assert(strcmp(scheduler.getName(dataId), "data") == 0);
+
+        scheduler.cancel(dataId);
+        scheduler.cancel(otaId);
+        assert(!scheduler.runNext());
+        assert(scheduler.getIdleMs(100) == 100);
+
+        // Full
+        for (size_t i = 0; i < BackendScheduler::MAX_JOBS; i++) {
+            assert(scheduler.add({"data", Priority::DATA, 100, 1000, 1000}, runFake, &data) >= 0);
+        }
+        assert(scheduler.add({"data", Priority::DATA, 100, 1000, 1000}, runFake, &data) == -1);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_millis_wrap() {
+        millis_return_value = (unsigned long)-50;
+        BackendScheduler scheduler;
+        char log[8] = {0};
+        size_t length = 0;
+        FakeJob data = {'d', 0, log, &length};
+
+        scheduler.add({"data", Priority::DATA, 100, 1000, 1000}, runFake, &data);
+        assert(scheduler.runNext());
+
+        // Due again at 50 after the wrap
+        millis_return_value = 49;
+        assert(!scheduler.runNext());
+        assert(scheduler.getIdleMs(1000) == 1);
+        millis_return_value = 50;
+        assert(scheduler.runNext());
+        assert(scheduler.getStats(0)->maxLatencyMs == 0);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    // Each run gets its budget as a deadline, time spent in the run counts against it
+    int test_deadline_from_budget() {
+        millis_return_value = 5000;
+        BackendScheduler scheduler;
+        static unsigned long deadlineAt;
+        static uint32_t remainingAtStart;
+        static uint32_t remainingAfterWork;
+        scheduler.add({"state", Priority::STATE, 1000, 60000, 3000}, [](void* context, unsigned long now, const Deadline& deadline) {
+            deadlineAt = deadline.getTime();
+            remainingAtStart = deadline.remainingMs();
+            millis_return_value = now + 2500;    // A slow first request
+            remainingAfterWork = deadline.remainingMs();
+            millis_return_value = now + 4000;    // The second one overran
+            assert(deadline.hasPassed());
+        }, nullptr);
+
+        assert(scheduler.runNext());
+        assert(deadlineAt == 8000);
+        assert(remainingAtStart == 3000);
+        assert(remainingAfterWork == 500);
+        assert(scheduler.getStats(0)->overruns == 1);
+
+        // Across the millis() wrap
+        millis_return_value = (unsigned long)-1000;
+        const Deadline deadline = Deadline::in(3000);
+        assert(deadline.remainingMs() == 3000);
+        millis_return_value = 1000;
+        assert(deadline.remainingMs() == 1000);
+        millis_return_value = 2000;
+        assert(deadline.hasPassed());
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_simulated_network() {
+        // A minute of backend work over a slow network, the command job must stay responsive
+        millis_return_value = 0;
+        BackendScheduler scheduler;
+        char log[4096];
+        size_t length = 0;
+        FakeJob command = {'c', 20, log, &length};
+        FakeJob data = {'d', 800, log, &length};
+        FakeJob state = {'s', 3000, log, &length};
+        FakeJob ota = {'o', 9000, log, &length};
+
+        scheduler.add({"command", Priority::INTERACTIVE, 100, 200, 5000}, runFake, &command);
+        // A meter reading to upload every 10 s
+        scheduler.add({"data", Priority::DATA, 10000, 5000, 10000}, runFake, &data);
+        scheduler.add({"state", Priority::STATE, 10000, 30000, 10000}, runFake, &state);
+        scheduler.add({"ota", Priority::OTA, 30000, 5 * 60 * 1000, 15000}, runFake, &ota);
+
+        while (millis() < 60000 && length < sizeof(log)) {
+            if (!scheduler.runNext()) {
+                millis_return_value += scheduler.getIdleMs(100);
+            }
+        }
+
+        const BackendScheduler::JobStats* commandStats = scheduler.getStats(0);
+        assert(commandStats->maxLatencyMs <= 9000);
+        assert(commandStats->totalLatencyMs / commandStats->runs <= 1000);
+        assert(scheduler.getStats(2)->runs >= 5);
+        assert(scheduler.getStats(3)->runs >= 2);
+        assert(scheduler.getStats(1)->late == 0);
+
+        // Never two non-command jobs in a row
+        for (size_t i = 1; i < length; i++) {
+            assert(log[i] == 'c' || log[i - 1] == 'c');
+        }
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int run() {
+        test_priority_order();
+        test_slow_job_then_command();
+        test_late_job_preempts();
+        test_cancel();
+        test_millis_wrap();
+        test_deadline_from_budget();
+        test_simulated_network();
+
+        return 0;
+    }
+}
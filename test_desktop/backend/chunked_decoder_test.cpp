@@ -0,0 +1,181 @@
+#include <assert.h>
+#include <chrono>
+#include <string>
+
+#include "../src/backend/chunked_decoder.h"
+#include "../src/json_light/json_light.h"
+#include "../src/zap_str.h"
+
+namespace chunked_decoder_test {
+
+    // Split a body into chunks of the given size
+    std::string encodeChunked(const std::string& body, size_t chunkSize, const char* extension = "") {
+        std::string out;
+        char sizeLine[32];
+        for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+            const size_t length = body.size() - pos < chunkSize ? body.size() - pos : chunkSize;
+            snprintf(sizeLine, sizeof(sizeLine), "%zx%s\r\n", length, extension);
+            out += sizeLine;
+            out += body.substr(pos, length);
+            out += "\r\n";
+        }
+        out += "0\r\n\r\n";
+        return out;
+    }
+
+    // Decode the way the connection manager does, reading blocks straight into the output buffer
+    std::string decodeInBlocks(const std::string& raw, size_t blockSize, bool* done = nullptr) {
+        ChunkedDecoder decoder;
+        std::string buffer(raw.size(), '\0');
+        size_t length = 0;
+        for (size_t pos = 0; pos < raw.size() && !decoder.isDone(); pos += blockSize) {
+            const size_t count = raw.size() - pos < blockSize ? raw.size() - pos : blockSize;
+            memcpy(&buffer[length], &raw[pos], count);
+            length += decoder.decode((uint8_t*)&buffer[length], count);
+            assert(!decoder.hasError());
+        }
+        if (done != nullptr) {
+            *done = decoder.isDone();
+        }
+        return buffer.substr(0, length);
+    }
+
+    std::string cannedBody() {
+        std::string body = "{\"data\":{\"gatewayConfiguration\":{\"configuration\":{\"data\":\"{";
+        for (int i = 0; i < 40; i++) {
+            body += "\\u0022setting" + std::to_string(i) + "\\u0022: \\u0022value}" + std::to_string(i) + "\\u0022, ";
+        }
+        body += "\\u0022last\\u0022: 1}\"}}}}";
+        return body;
+    }
+
+    int test_single_chunk() {
+        const std::string raw = "2e\r\n{\"data\":{\"setConfiguration\":{\"success\":true}}}\r\n0\r\n\r\n";
+        bool done;
+        assert(decodeInBlocks(raw, raw.size(), &done) == "{\"data\":{\"setConfiguration\":{\"success\":true}}}");
+        assert(done);
+        return 0;
+    }
+
+    int test_split_at_every_boundary() {
+        const std::string body = cannedBody();
+        const std::string raw = encodeChunked(body, 97);
+        for (size_t block = 1; block <= raw.size(); block++) {
+            bool done;
+            assert(decodeInBlocks(raw, block, &done) == body);
+            assert(done);
+        }
+        return 0;
+    }
+
+    int test_extensions_trailers_and_case() {
+        const std::string raw = "A;name=value\r\n0123456789\r\n1B\r\nabcdefghijklmnopqrstuvwxyz!\r\n0\r\nX-Trailer: yes\r\n\r\nignored";
+        bool done;
+        assert(decodeInBlocks(raw, 5, &done) == "0123456789abcdefghijklmnopqrstuvwxyz!");
+        assert(done);
+        return 0;
+    }
+
+    int test_incomplete() {
+        const std::string raw = encodeChunked("hello world", 4);
+        bool done;
+        assert(decodeInBlocks(raw.substr(0, raw.size() - 2), 3, &done) == "hello world");
+        assert(!done);
+        return 0;
+    }
+
+    bool isError(const std::string& raw) {
+        ChunkedDecoder decoder;
+        std::string copy = raw;
+        decoder.decode((uint8_t*)&copy[0], copy.size());
+        return decoder.hasError();
+    }
+
+    int test_errors() {
+        assert(isError("zz\r\nhello\r\n0\r\n\r\n"));
+        assert(isError("\r\n"));
+        assert(isError("5\r\nhelloX\r\n0\r\n\r\n"));
+        assert(isError("5\nhello\r\n0\r\n\r\n"));
+        assert(isError("fffffffff\r\n"));
+        assert(!isError("5\r\nhel"));
+        return 0;
+    }
+
+    // The old client: byte at a time into a growing string, then slice between the outer braces
+    bool parseOld(const std::string& raw, zap::Str& value) {
+        zap::Str responseData;
+        responseData.reserve(512);
+        for (size_t i = 0; i < raw.size(); i++) {
+            responseData += raw[i];
+        }
+        const int start = responseData.indexOf('{');
+        const int end = responseData.lastIndexOf('}');
+        if (start < 0 || end < 0 || start >= end) {
+            return false;
+        }
+        responseData = responseData.substring(start, end + 1);
+        JsonParser parser(responseData.c_str());
+        return parser.getStringByPath("data.gatewayConfiguration.configuration.data", value);
+    }
+
+    // The new client: blocks into a fixed buffer, decoded and parsed in place
+    bool parseNew(const std::string& raw, char* buffer, size_t capacity, zap::Str& value) {
+        ChunkedDecoder decoder;
+        size_t length = 0;
+        for (size_t pos = 0; pos < raw.size() && !decoder.isDone(); pos += 1024) {
+            size_t count = raw.size() - pos < 1024 ? raw.size() - pos : 1024;
+            if (count > capacity - 1 - length) {
+                return false;
+            }
+            memcpy(buffer + length, raw.data() + pos, count);
+            length += decoder.decode((uint8_t*)buffer + length, count);
+        }
+        buffer[length] = '\0';
+        JsonParser parser(buffer);
+        return parser.getStringByPath("data.gatewayConfiguration.configuration.data", value);
+    }
+
+    int test_benchmark() {
+        const std::string body = cannedBody();
+        const std::string singleChunk = encodeChunked(body, body.size());
+        const std::string manyChunks = encodeChunked(body, 256);
+        const int iterations = 2000;
+        char buffer[4096];
+
+        // Slicing only works when the whole body is one chunk
+        zap::Str oldValue, newValue;
+        assert(parseOld(singleChunk, oldValue));
+        assert(parseNew(singleChunk, buffer, sizeof(buffer), newValue));
+        assert(oldValue == newValue);
+        assert(!parseOld(manyChunks, oldValue) || !(oldValue == newValue));
+        assert(parseNew(manyChunks, buffer, sizeof(buffer), newValue));
+        assert(oldValue.length() == 0 || !(oldValue == newValue));
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            parseOld(singleChunk, oldValue);
+        }
+        const double oldNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            parseNew(manyChunks, buffer, sizeof(buffer), newValue);
+        }
+        const double newNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        printf("GraphQL response of %zu bytes: byte reads and slicing %.0f ns, chunked decode in place %.0f ns\n",
+               body.size(), oldNs, newNs);
+        return 0;
+    }
+
+    int run() {
+        test_single_chunk();
+        test_split_at_every_boundary();
+        test_extensions_trailers_and_case();
+        test_incomplete();
+        test_errors();
+        test_benchmark();
+
+        return 0;
+    }
+}
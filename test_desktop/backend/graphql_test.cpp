@@ -78,12 +78,62 @@ namespace graphql_test {
         return 0;
     }
 
+    int test_response_buffer_busy() {
+        WiFiClient::read_buffer = (char*)R"({"data":{"gatewayConfiguration":{"gatewayName":{"name":"Mors Lilla Olle"}}}})";
+
+        {
+            // The backend task holds the configuration buffer for a long request
+            GQL::ResponseBuffer held(GQL::ResponseBuffer::Use::CONFIGURATION, Deadline::in(0));
+            assert(held.isHeld());
+            assert(held.capacity == GQL::RESPONSE_BUFFER_SIZE);
+
+            // Another configuration request gives up at its deadline
+            GQL::BoolResponse response = GQL::setConfiguration(zap::Str("magic_jwt_token"), Deadline::in(10));
+            assert(response.status == GQL::Status::NETWORK_ERROR);
+
+            // The name has its own buffer and does not wait
+            GQL::StringResponse name = GQL::fetchGatewayName(zap::Str("fake_serial_number"));
+            assert(name.isSuccess());
+            assert(name.data == "Mors Lilla Olle");
+        }
+
+        // Released again
+        GQL::ResponseBuffer buffer(GQL::ResponseBuffer::Use::CONFIGURATION, Deadline::in(0));
+        assert(buffer.isHeld());
+
+        WiFiClient::read_buffer = nullptr; // reset the mock response
+        return 0;
+    }
+
+    int test_parseSetConfigurationResult() {
+        // The payload of a WebSocket data message has the same shape as the HTTP response
+        GQL::BoolResponse response = GQL::parseSetConfigurationResult(R"({"data":{"setConfiguration":{"success":true}}})");
+        assert(response.isSuccess());
+        assert(response.data == true);
+
+        response = GQL::parseSetConfigurationResult(R"({"data":{"setConfiguration":{"success":false}}})");
+        assert(response.status == GQL::Status::OPERATION_FAILED);
+
+        response = GQL::parseSetConfigurationResult(R"({"data":null})");
+        assert(response.status == GQL::Status::INVALID_RESPONSE);
+
+        zap::Str request = GQL::setConfigurationRequest(zap::Str("magic_jwt_token"));
+        JsonParser parser(request.c_str());
+        zap::Str query;
+        assert(parser.getString("query", query));
+        assert(query == "mutation SetGatewayConfigurationWithDeviceJWT { setConfiguration(deviceConfigurationInputType: { jwt: \"magic_jwt_token\" }) { success } }");
+
+        return 0;
+    }
+
     int run(){
         
         test_setConfigruation_success();
         test_getConfiguration_success();
         test_getConfiguration_null_data();
         test_fetchGatewayName_success();
+        test_response_buffer_busy();
+        test_parseSetConfigurationResult();
 
         return 0;
     }
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <chrono>
+#include <vector>
+
+#include "../src/backend/heatshrink.h"
+#include "../src/data/p1data_funcs.h"
+#include "../src/data/decoding/ascii_decoder.h"
+#include "../src/data/decoding/dlms_decoder.h"
+#include "../frames.h"
+
+namespace heatshrink_test {
+
+    class FrameData : public IFrameData {
+        public:
+            FrameData(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+            uint8_t getFrameByte(size_t index) const override {
+                return index < size_ ? data_[index] : 0;
+            }
+
+            int getFrameSize() const override {
+                return size_;
+            }
+
+            IFrameData::Type getFrameTypeId() const override {
+                return IFrameData::Type::FRAME_TYPE_UNKNOWN;
+            }
+        private:
+            const uint8_t* data_;
+            size_t size_;
+    };
+
+    static const Heatshrink::Params PARAMS[] = {{4, 3}, {8, 4}, {10, 5}, {11, 4}, {15, 8}};
+
+    static size_t roundTrip(const Heatshrink::Params& params, const uint8_t* input, size_t length) {
+        std::vector<uint8_t> compressed(length + length / 8 + 2);
+        size_t compressedLength;
+        assert(Heatshrink::compress(params, input, length, compressed.data(), compressed.size(), compressedLength));
+
+        std::vector<uint8_t> output(length + 1);
+        size_t outputLength;
+        assert(Heatshrink::decompress(params, compressed.data(), compressedLength, output.data(), output.size(), outputLength));
+        assert(outputLength == length);
+        assert(length == 0 || memcmp(output.data(), input, length) == 0);
+        return compressedLength;
+    }
+
+    int test_bit_format() {
+        // Literal 'a', then a back reference of distance 1 and length 3 that overlaps itself:
+        // 1 01100001 | 0 00000000 0010 | 00 padding
+        const Heatshrink::Params params = {8, 4};
+        uint8_t compressed[8];
+        size_t length;
+        assert(Heatshrink::compress(params, (const uint8_t*)"aaaa", 4, compressed, sizeof(compressed), length));
+        assert(length == 3);
+        assert(compressed[0] == 0xB0);
+        assert(compressed[1] == 0x80);
+        assert(compressed[2] == 0x08);
+
+        uint8_t output[8];
+        assert(Heatshrink::decompress(params, compressed, length, output, sizeof(output), length));
+        assert(length == 4 && memcmp(output, "aaaa", 4) == 0);
+        return 0;
+    }
+
+    int test_round_trips() {
+        std::vector<uint8_t> random(5000);
+        uint32_t state = 12345;
+        for (uint8_t& byte : random) {
+            state = state * 1103515245 + 12345;
+            byte = (uint8_t)(state >> 16);
+        }
+        std::vector<uint8_t> run(3000, 'x');
+        std::vector<uint8_t> pattern(4000);
+        for (size_t i = 0; i < pattern.size(); i++) {
+            pattern[i] = "1-0:21.7.0(0001.234*kW)\r\n"[i % 25];
+        }
+
+        for (const Heatshrink::Params& params : PARAMS) {
+            roundTrip(params, nullptr, 0);
+            roundTrip(params, (const uint8_t*)"a", 1);
+            roundTrip(params, random.data(), random.size());
+            roundTrip(params, pattern.data(), pattern.size());
+
+            // Runs longer than the lookahead and the window
+            assert(roundTrip(params, run.data(), run.size()) < run.size() / 2);
+
+            // Every prefix length of the pattern, so the padding ends on every bit
+            for (size_t length = 1; length < 40; length++) {
+                roundTrip(params, pattern.data(), length);
+            }
+        }
+        return 0;
+    }
+
+    int test_errors() {
+        const Heatshrink::Params params = {8, 4};
+        uint8_t buffer[64];
+        size_t length;
+
+        // Invalid sizes
+        const Heatshrink::Params small = {3, 2};
+        const Heatshrink::Params lookaheadTooLong = {8, 8};
+        assert(!Heatshrink::isValid(small));
+        assert(!Heatshrink::isValid(lookaheadTooLong));
+        assert(!Heatshrink::compress(lookaheadTooLong, (const uint8_t*)"abc", 3, buffer, sizeof(buffer), length));
+
+        // Output does not fit
+        const char* text = "no repetition here";
+        assert(!Heatshrink::compress(params, (const uint8_t*)text, strlen(text), buffer, 4, length));
+        size_t compressedLength;
+        assert(Heatshrink::compress(params, (const uint8_t*)text, strlen(text), buffer, sizeof(buffer), compressedLength));
+        uint8_t output[8];
+        assert(!Heatshrink::decompress(params, buffer, compressedLength, output, sizeof(output), length));
+
+        // A back reference before the start of the output
+        const uint8_t badReference[] = {0x00, 0x80, 0x00};
+        assert(!Heatshrink::decompress(params, badReference, sizeof(badReference), output, sizeof(output), length));
+        return 0;
+    }
+
+    // Payloads as the DataReaderTask builds them from the meter frames in frames.h
+    static void buildFixtures(std::vector<std::vector<char>>& fixtures) {
+        struct Frame {
+            const uint8_t* data;
+            size_t size;
+            bool ascii;
+        };
+        const Frame frames[] = {
+            {ascii_frame_single, sizeof(ascii_frame_single), true},
+            {ascii_frame_multi, sizeof(ascii_frame_multi), true},
+            {decoded_dlsm_cosem_data, sizeof(decoded_dlsm_cosem_data), false},
+        };
+
+        for (const Frame& frame : frames) {
+            P1Data p1data;
+            FrameData frameData(frame.data, frame.size);
+            bool decoded;
+            if (frame.ascii) {
+                AsciiDecoder decoder;
+                decoded = decoder.decodeBuffer(frameData, p1data);
+            } else {
+                DLMSDecoder decoder;
+                decoded = decoder.decodeBuffer(frameData, p1data, 0);
+            }
+            assert(decoded);
+            p1data.timestamp = 1700000000000ULL;
+
+            std::vector<char> payload(MAX_DATA_SIZE);
+            assert(!createP1JWTPayload(p1data, payload.data(), payload.size()));
+            payload.resize(strlen(payload.data()));
+            fixtures.push_back(payload);
+        }
+
+        // A batch of eight ASCII readings as sent on a poor link
+        std::vector<char> batch(1, '{');
+        const std::vector<char>& reading = fixtures[0];
+        for (int i = 0; i < 8; i++) {
+            if (i > 0) {
+                batch.push_back(',');
+            }
+            batch.insert(batch.end(), reading.begin() + 1, reading.end() - 1);
+        }
+        batch.push_back('}');
+        fixtures.push_back(batch);
+    }
+
+    int test_fixture_ratio() {
+        std::vector<std::vector<char>> fixtures;
+        buildFixtures(fixtures);
+        const char* names[] = {"ASCII single", "ASCII multi", "DLMS", "ASCII batch of 8"};
+
+        for (const Heatshrink::Params& params : PARAMS) {
+            for (size_t i = 0; i < fixtures.size(); i++) {
+                const uint8_t* input = (const uint8_t*)fixtures[i].data();
+                const size_t length = fixtures[i].size();
+                const size_t compressedLength = roundTrip(params, input, length);
+                assert(compressedLength < length);
+
+                std::vector<uint8_t> compressed(length);
+                const int iterations = 200;
+                const auto start = std::chrono::steady_clock::now();
+                size_t unused;
+                for (int n = 0; n < iterations; n++) {
+                    Heatshrink::compress(params, input, length, compressed.data(), compressed.size(), unused);
+                }
+                const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+                printf("Heatshrink w%d l%d %-16s %5zu -> %5zu bytes, ratio %.2f, %.1f us per upload\n",
+                       params.windowBits, params.lookaheadBits, names[i], length, compressedLength,
+                       (double)length / compressedLength, us);
+            }
+        }
+        return 0;
+    }
+
+    int run() {
+        test_bit_format();
+        test_round_trips();
+        test_errors();
+        test_fixture_ratio();
+
+        return 0;
+    }
+}
@@ -0,0 +1,105 @@
+#include <assert.h>
+
+#include "../src/backend/mutation_tracker.h"
+
+namespace mutation_tracker_test {
+
+    int test_add_and_take() {
+        MutationTracker tracker;
+        assert(tracker.isEmpty());
+
+        const uint32_t first = tracker.add(zap::Str("jwt1"), 1000);
+        const uint32_t second = tracker.add(zap::Str("jwt2"), 1010);
+        assert(first == MutationTracker::FIRST_ID);
+        assert(second == first + 1);
+        assert(tracker.size() == 2);
+
+        // Results can come in any order
+        zap::Str jwt;
+        unsigned long sentAt;
+        assert(tracker.take(second, jwt, sentAt));
+        assert(jwt == "jwt2");
+        assert(sentAt == 1010);
+        assert(!tracker.take(second, jwt, sentAt));
+
+        assert(tracker.take(first, jwt, sentAt));
+        assert(jwt == "jwt1");
+        assert(tracker.isEmpty());
+
+        // The subscription id and unknown ids are never tracked
+        assert(!tracker.take(1, jwt, sentAt));
+        assert(!tracker.take(0, jwt, sentAt));
+        return 0;
+    }
+
+    int test_full() {
+        MutationTracker tracker;
+        for (size_t i = 0; i < MutationTracker::CAPACITY; i++) {
+            assert(tracker.add(zap::Str("jwt"), 0) != 0);
+        }
+        assert(tracker.add(zap::Str("jwt"), 0) == 0);
+        assert(tracker.size() == MutationTracker::CAPACITY);
+
+        // A freed slot gets a new id
+        zap::Str jwt;
+        unsigned long sentAt;
+        assert(tracker.take(MutationTracker::FIRST_ID, jwt, sentAt));
+        assert(tracker.add(zap::Str("jwt"), 0) == MutationTracker::FIRST_ID + MutationTracker::CAPACITY);
+        return 0;
+    }
+
+    int test_take_expired() {
+        MutationTracker tracker;
+        tracker.add(zap::Str("late"), 2000);
+        tracker.add(zap::Str("early"), 1000);
+
+        zap::Str jwt;
+        assert(!tracker.takeExpired(5999, 5000, jwt));
+
+        // Oldest first
+        assert(tracker.takeExpired(7000, 5000, jwt));
+        assert(jwt == "early");
+        assert(tracker.takeExpired(7000, 5000, jwt));
+        assert(jwt == "late");
+        assert(!tracker.takeExpired(7000, 5000, jwt));
+        assert(tracker.isEmpty());
+        return 0;
+    }
+
+    int test_take_all_on_disconnect() {
+        MutationTracker tracker;
+        tracker.add(zap::Str("a"), 100);
+        tracker.add(zap::Str("b"), 100);
+
+        // A zero timeout hands out everything, e.g. when the socket went down
+        zap::Str jwt;
+        int taken = 0;
+        while (tracker.takeExpired(100, 0, jwt)) {
+            taken++;
+        }
+        assert(taken == 2);
+        assert(tracker.isEmpty());
+        return 0;
+    }
+
+    int test_millis_wrap() {
+        MutationTracker tracker;
+        const unsigned long sentAt = (unsigned long)-1000;
+        tracker.add(zap::Str("jwt"), sentAt);
+
+        zap::Str jwt;
+        assert(!tracker.takeExpired(sentAt + 4999, 5000, jwt));
+        assert(tracker.takeExpired(sentAt + 5000, 5000, jwt));
+        return 0;
+    }
+
+    int run() {
+        test_add_and_take();
+        test_full();
+        test_take_expired();
+        test_take_all_on_disconnect();
+        test_millis_wrap();
+
+        return 0;
+    }
+}
@@ -5,6 +5,7 @@
 
 #include "../src/json_light/json_light.h"
 #include "../src/endpoints/endpoint_types.h"
+#include "../allocation_counter.h"
 
 namespace request_handler_test {
 
@@ -32,6 +33,10 @@ namespace request_handler_test {
                 return response;
             };
 
+            zap::Str createJwt(const char* header, const char* payload) override {
+                return crypto_create_jwt(header, payload);
+            }
+
             const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) override {
                 static MockEndpointFunction mockFunction;
                 static Endpoint endpoint(Endpoint::Type::ECHO, Endpoint::Verb::POST, "api/echo", mockFunction);
@@ -117,10 +122,43 @@ namespace request_handler_test {
         return 0;
     }
 
+    int test_request_in_place() {
+        MockExternals mockExternals;
+        zap::backend::RequestHandler requestHandler(mockExternals);
+
+        zap::Str body("{\\u0022id\\u0022: \\u0022di34bavH72FOxMbk9m8A9\\u0022, \\u0022body\\u0022: \\u0022Hello World\\u0022, \\u0022path\\u0022: \\u0022/api/echo\\u0022, \\u0022query\\u0022: \\u0022{}\\u0022, \\u0022method\\u0022: \\u0022POST\\u0022, \\u0022headers\\u0022: \\u0022{}\\u0022, \\u0022timestamp\\u0022: #ts#}");
+        zap::Str ts = getTimeMilliseconds();
+        body.replace("#ts#", ts.c_str());
+        const zap::Str data = "{\"data\":\"" + zap::Str(body) + "\"}";
+
+        // A read only document, the request is copied out of it
+        JsonParser copied(data.c_str());
+        allocation_counter::begin();
+        requestHandler.handleRequestTask(copied);
+        const size_t copiedAllocations = allocation_counter::end();
+        assert(mockExternals.requestContent == "Hello World");
+
+        // The subscription client's receive buffer, the request is unescaped where it is
+        char buffer[512];
+        strcpy(buffer, data.c_str());
+        JsonParser inPlace(buffer, strlen(buffer));
+        mockExternals.requestContent = "";
+        allocation_counter::begin();
+        requestHandler.handleRequestTask(inPlace);
+        const size_t inPlaceAllocations = allocation_counter::end();
+        assert(mockExternals.requestContent == "Hello World");
+
+        // Most of what is left is signing and sending the response
+        printf("Allocations per request task: %zu copied, %zu unescaped in place\n", copiedAllocations, inPlaceAllocations);
+        assert(inPlaceAllocations < copiedAllocations);
+        return 0;
+    }
+
     int run() {
         test_wifi_request();
         test_echo_request_hello_world();
         test_echo_request_quoted_hello_world();
+        test_request_in_place();
         return 0;
     }
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include <assert.h>
+
+#include "../src/backend/retry_policy.h"
+
+namespace retry_policy_test {
+
+    static const RetryPolicy::Config CONFIG = {1000, 30000, 4, 60000};
+
+    int test_success_never_waits() {
+        RetryPolicy policy("test", CONFIG);
+        assert(policy.shouldAttempt(0));
+        policy.onSuccess(0);
+        assert(policy.shouldAttempt(1));
+        assert(policy.getWaitMs(1) == 0);
+        assert(policy.getState() == RetryPolicy::State::CLOSED);
+        assert(policy.getStats().successes == 1);
+        return 0;
+    }
+
+    int test_backoff_bounds() {
+        // Each delay lies between the base and three times the previous one, capped at the maximum
+        const RetryPolicy::Config config = {1000, 30000, 1000, 60000};
+        RetryPolicy policy("test", config);
+        policy.seed(12345);
+
+        unsigned long now = 0;
+        uint32_t previous = config.baseDelayMs;
+        for (int i = 0; i < 50; i++) {
+            policy.onFailure(now);
+            const uint32_t delay = policy.getStats().delayMs;
+            const uint32_t high = previous * 3 < config.maxDelayMs ? previous * 3 : config.maxDelayMs;
+            assert(delay >= config.baseDelayMs);
+            assert(delay <= high);
+            assert(policy.getState() == RetryPolicy::State::CLOSED);
+
+            // Not before the delay, right at it
+            assert(!policy.shouldAttempt(now + delay - 1));
+            assert(policy.getWaitMs(now + delay - 1) == 1);
+            assert(policy.shouldAttempt(now + delay));
+            now += delay;
+            previous = delay;
+        }
+        return 0;
+    }
+
+    int test_circuit_opens() {
+        RetryPolicy policy("test", CONFIG);
+        unsigned long now = 0;
+        for (uint32_t i = 0; i < CONFIG.failuresToOpen; i++) {
+            while (!policy.shouldAttempt(now)) {
+                now += 100;
+            }
+            policy.onFailure(now);
+        }
+        assert(policy.getState() == RetryPolicy::State::OPEN);
+        assert(policy.getStats().opened == 1);
+
+        // Open for the open duration plus up to half of it
+        const uint32_t delay = policy.getStats().delayMs;
+        assert(delay >= CONFIG.openDurationMs);
+        assert(delay <= CONFIG.openDurationMs + CONFIG.openDurationMs / 2);
+        assert(!policy.shouldAttempt(now + CONFIG.openDurationMs - 1));
+        assert(policy.getState() == RetryPolicy::State::OPEN);
+        return 0;
+    }
+
+    int test_half_open_single_probe() {
+        RetryPolicy policy("test", CONFIG);
+        unsigned long now = 0;
+        for (uint32_t i = 0; i < CONFIG.failuresToOpen; i++) {
+            policy.onFailure(now);
+        }
+        now += policy.getStats().delayMs;
+
+        // One probe, the next attempt waits for its result
+        assert(policy.shouldAttempt(now));
+        assert(policy.getState() == RetryPolicy::State::HALF_OPEN);
+        assert(!policy.shouldAttempt(now + 1));
+
+        // A failed probe opens the circuit again
+        policy.onFailure(now + 10);
+        assert(policy.getState() == RetryPolicy::State::OPEN);
+        assert(policy.getStats().opened == 2);
+        assert(!policy.shouldAttempt(now + 20));
+
+        now += 10 + policy.getStats().delayMs;
+        assert(policy.shouldAttempt(now));
+        policy.onSuccess(now);
+        assert(policy.getState() == RetryPolicy::State::CLOSED);
+        assert(!policy.hasFailures());
+        assert(policy.shouldAttempt(now));
+        return 0;
+    }
+
+    int test_success_resets_delay() {
+        RetryPolicy policy("test", CONFIG);
+        policy.onFailure(0);
+        policy.onFailure(100);
+        policy.onSuccess(200);
+        assert(policy.getStats().consecutiveFailures == 0);
+        assert(policy.getStats().failures == 2);
+
+        // Back to the first step of the backoff
+        policy.onFailure(300);
+        assert(policy.getStats().delayMs <= CONFIG.baseDelayMs * 3);
+        return 0;
+    }
+
+    int test_millis_wrap() {
+        RetryPolicy policy("test", CONFIG);
+        const unsigned long failedAt = (unsigned long)-500;
+        policy.onFailure(failedAt);
+        const uint32_t delay = policy.getStats().delayMs;
+        assert(!policy.shouldAttempt(failedAt + delay - 1));
+        assert(policy.shouldAttempt(failedAt + delay));
+        return 0;
+    }
+
+    int test_devices_spread_out() {
+        // Devices that fail at the same moment must not all retry at the same moment
+        const int DEVICES = 32;
+        uint32_t delays[DEVICES];
+        for (int i = 0; i < DEVICES; i++) {
+            RetryPolicy policy("test", CONFIG);
+            policy.seed(0x1000 + i * 7919);
+            policy.onFailure(0);
+            policy.onFailure(policy.getStats().delayMs);
+            delays[i] = policy.getStats().delayMs;
+        }
+
+        int distinct = 0;
+        for (int i = 0; i < DEVICES; i++) {
+            bool seen = false;
+            for (int j = 0; j < i; j++) {
+                seen = seen || delays[j] == delays[i];
+            }
+            distinct += seen ? 0 : 1;
+        }
+        assert(distinct > DEVICES * 3 / 4);
+        return 0;
+    }
+
+    int test_registry() {
+        RetryPolicy* policy = new RetryPolicy("registered", CONFIG);
+        bool found = false;
+        for (size_t i = 0; i < RetryPolicy::MAX_POLICIES; i++) {
+            found = found || RetryPolicy::get(i) == policy;
+        }
+        assert(found);
+        assert(RetryPolicy::get(RetryPolicy::MAX_POLICIES) == nullptr);
+
+        delete policy;
+        for (size_t i = 0; i < RetryPolicy::MAX_POLICIES; i++) {
+            assert(RetryPolicy::get(i) != policy);
+        }
+        assert(strcmp(RetryPolicy::stateName(RetryPolicy::State::HALF_OPEN), "half_open") == 0);
+        return 0;
+    }
+
+    int run() {
+        test_success_never_waits();
+        test_backoff_bounds();
+        test_circuit_opens();
+        test_half_open_single_probe();
+        test_success_resets_delay();
+        test_millis_wrap();
+        test_devices_spread_out();
+        test_registry();
+
+        return 0;
+    }
+}
@@ -0,0 +1,173 @@
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../src/backend/sign_queue.h"
+#include "../src/backend/signing_task.h"
+
+extern unsigned long crypto_sign_delay_ms;  // In mock/crypto.cpp
+
+namespace sign_queue_test {
+
+    SignJob makeJob(const char* payload) {
+        SignJob job;
+        job.header = "{}";
+        job.payload = payload;
+        job.payloadLength = 0;
+        job.onDone = nullptr;
+        job.context = nullptr;
+        return job;
+    }
+
+    int test_empty() {
+        SignQueue queue;
+        assert(queue.isEmpty());
+        assert(queue.pop() == nullptr);
+        return 0;
+    }
+
+    int test_fifo_within_lane() {
+        SignQueue queue;
+        SignJob a = makeJob("a"), b = makeJob("b"), c = makeJob("c");
+        assert(queue.push(&a, SignJob::Priority::BULK));
+        assert(queue.push(&b, SignJob::Priority::BULK));
+        assert(queue.pop() == &a);
+        assert(queue.push(&c, SignJob::Priority::BULK));
+        assert(queue.pop() == &b);
+        assert(queue.pop() == &c);
+        assert(queue.pop() == nullptr);
+        return 0;
+    }
+
+    int test_high_priority_first() {
+        SignQueue queue;
+        SignJob bulk1 = makeJob("bulk1"), bulk2 = makeJob("bulk2"), state = makeJob("state");
+        assert(queue.push(&bulk1, SignJob::Priority::BULK));
+        assert(queue.push(&bulk2, SignJob::Priority::BULK));
+        assert(queue.push(&state, SignJob::Priority::HIGH));
+        assert(queue.size() == 3);
+        assert(queue.pop() == &state);
+        assert(queue.pop() == &bulk1);
+        assert(queue.pop() == &bulk2);
+        return 0;
+    }
+
+    int test_lanes_are_bounded_separately() {
+        SignQueue queue;
+        SignJob jobs[SignQueue::LANE_CAPACITY + 1];
+        for (size_t i = 0; i < SignQueue::LANE_CAPACITY; i++) {
+            jobs[i] = makeJob("bulk");
+            assert(queue.push(&jobs[i], SignJob::Priority::BULK));
+        }
+        assert(!queue.push(&jobs[0], SignJob::Priority::BULK));
+
+        // A full bulk lane does not hold up high priority jobs
+        jobs[SignQueue::LANE_CAPACITY] = makeJob("state");
+        assert(queue.push(&jobs[SignQueue::LANE_CAPACITY], SignJob::Priority::HIGH));
+        assert(queue.pop() == &jobs[SignQueue::LANE_CAPACITY]);
+        return 0;
+    }
+
+    // Signing and posting cost fixed time and leave the CPU free, as on the device
+    const unsigned long SIGN_TIME_MS = 4;
+    const auto POST_TIME = std::chrono::milliseconds(6);
+
+    // Submits readings to the SigningTask and posts each JWT while the next one is signed,
+    // the way DataSenderTask::loop does. Returns the readings per second.
+    double run_sender(SigningTask& signer, int readings) {
+        std::atomic<bool> done(false);
+        SignJob job = makeJob("reading");
+        job.context = &done;
+        job.onDone = [](SignJob& job) {
+            static_cast<std::atomic<bool>*>(job.context)->store(true);
+        };
+
+        auto submit = [&]() {
+            done.store(false);
+            assert(signer.submit(&job, SignJob::Priority::BULK));
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        submit();
+        for (int posted = 0; posted < readings; posted++) {
+            while (!done.load()) {
+                std::this_thread::yield();
+            }
+            zap::Str jwt = job.jwt;
+            if (posted + 1 < readings) {
+                submit();
+            }
+            assert(jwt == "a.b.c");
+            std::this_thread::sleep_for(POST_TIME);     // The fake post
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return readings / seconds;
+    }
+
+    int test_pipelined_throughput() {
+        const int readings = 40;
+        crypto_sign_delay_ms = SIGN_TIME_MS;
+
+        // Not started, jobs are signed inline by the sender
+        SigningTask signer;
+        const double inlineRate = run_sender(signer, readings);
+
+        signer.begin();
+        const double pipelinedRate = run_sender(signer, readings);
+        signer.stop();
+
+        crypto_sign_delay_ms = 0;
+        printf("Readings/s signing inline: %.1f, pipelined: %.1f\n", inlineRate, pipelinedRate);
+
+        // Without overlap no rate can beat one reading per sign plus post
+        const double serialRate = 1000.0 / (SIGN_TIME_MS + POST_TIME.count());
+        assert(inlineRate <= serialRate);
+        assert(pipelinedRate > serialRate * 1.2);
+        return 0;
+    }
+
+    int test_stop_completes_queued_jobs() {
+        crypto_sign_delay_ms = SIGN_TIME_MS;
+        SigningTask signer;
+        signer.begin();
+
+        std::atomic<int> done(0);
+        SignJob jobs[SignQueue::LANE_CAPACITY];
+        for (size_t i = 0; i < SignQueue::LANE_CAPACITY; i++) {
+            jobs[i] = makeJob("bulk");
+            jobs[i].context = &done;
+            jobs[i].onDone = [](SignJob& job) {
+                static_cast<std::atomic<int>*>(job.context)->fetch_add(1);
+            };
+            assert(signer.submit(&jobs[i], SignJob::Priority::BULK));
+        }
+
+        // The task has exited when stop() returns, so every job is signed by now
+        signer.stop();
+        assert(done.load() == (int)SignQueue::LANE_CAPACITY);
+        for (size_t i = 0; i < SignQueue::LANE_CAPACITY; i++) {
+            assert(jobs[i].jwt == "a.b.c");
+        }
+
+        // It can be started again, and a stopped task signs inline
+        signer.begin();
+        assert(signer.sign("{}", "state") == "a.b.c");
+        signer.stop();
+        assert(signer.sign("{}", "state") == "a.b.c");
+
+        crypto_sign_delay_ms = 0;
+        return 0;
+    }
+
+    int run() {
+        test_empty();
+        test_fifo_within_lane();
+        test_high_priority_first();
+        test_lanes_are_bounded_separately();
+        test_pipelined_throughput();
+        test_stop_completes_queued_jobs();
+
+        return 0;
+    }
+}
@@ -0,0 +1,158 @@
+#include <assert.h>
+
+#include "../src/backend/upload_controller.h"
+
+namespace upload_controller_test {
+
+    typedef UploadController::Link Link;
+
+    static const UploadController::Config CONFIG = {8, 4, 1000, -67, -80, 800, 3000};
+
+    // A link as the controller sees it, one upload and one update per second
+    struct LinkConditions {
+        int rssi;
+        uint32_t latencyMs;
+        bool success;
+        uint8_t backlogPercent;
+    };
+
+    static void simulate(UploadController& controller, unsigned long& now, const LinkConditions& link, int seconds) {
+        for (int i = 0; i < seconds; i++) {
+            now += 1000;
+            controller.onUpload(link.latencyMs, link.success);
+            controller.update(now, link.rssi, link.backlogPercent);
+        }
+    }
+
+    static const LinkConditions GOOD_LINK = {-55, 200, true, 0};
+    static const LinkConditions WEAK_SIGNAL = {-85, 400, true, 0};
+    static const LinkConditions SLOW_LINK = {-60, 5000, true, 10};
+    static const LinkConditions FAILING_LINK = {-60, 1000, false, 0};
+    static const LinkConditions FAIR_LINK = {-72, 1500, true, 0};
+
+    int test_good_link_sends_every_frame() {
+        UploadController controller(CONFIG);
+        unsigned long now = 0;
+        simulate(controller, now, GOOD_LINK, 60);
+        assert(controller.getBatchSize() == 1);
+        assert(controller.getDownsample() == 1);
+        assert(controller.getStats().link == Link::GOOD);
+        return 0;
+    }
+
+    int test_poor_link_batches_then_downsamples() {
+        UploadController controller(CONFIG);
+        unsigned long now = 0;
+
+        // One step per evaluation: batch 2, 4, 8, then downsampling 2, 3, 4
+        simulate(controller, now, WEAK_SIGNAL, 1);
+        assert(controller.getBatchSize() == 2);
+        assert(controller.getDownsample() == 1);
+        simulate(controller, now, WEAK_SIGNAL, 2);
+        assert(controller.getBatchSize() == 8);
+        assert(controller.getDownsample() == 1);
+        simulate(controller, now, WEAK_SIGNAL, 3);
+        assert(controller.getDownsample() == 4);
+        assert(controller.getStats().link == Link::POOR);
+
+        // Stays within the bounds
+        simulate(controller, now, WEAK_SIGNAL, 30);
+        assert(controller.getBatchSize() == CONFIG.maxBatch);
+        assert(controller.getDownsample() == CONFIG.maxDownsample);
+        return 0;
+    }
+
+    int test_recovery_in_reverse() {
+        UploadController controller(CONFIG);
+        unsigned long now = 0;
+        simulate(controller, now, WEAK_SIGNAL, 10);
+
+        // Full resolution comes back before the batches shrink
+        simulate(controller, now, GOOD_LINK, 3);
+        assert(controller.getDownsample() == 1);
+        assert(controller.getBatchSize() == 8);
+        simulate(controller, now, GOOD_LINK, 1);
+        assert(controller.getBatchSize() == 4);
+        simulate(controller, now, GOOD_LINK, 10);
+        assert(controller.getBatchSize() == 1);
+        assert(controller.getDownsample() == 1);
+        return 0;
+    }
+
+    int test_slow_and_failing_links() {
+        UploadController slow(CONFIG);
+        unsigned long now = 0;
+        simulate(slow, now, SLOW_LINK, 5);
+        assert(slow.getBatchSize() > 1);
+        assert(slow.getStats().latencyMs > CONFIG.poorLatencyMs);
+
+        UploadController failing(CONFIG);
+        now = 0;
+        simulate(failing, now, FAILING_LINK, 5);
+        assert(failing.getBatchSize() > 1);
+        assert(failing.getStats().failurePercent > 50);
+
+        // A single failure on a good link is not enough
+        UploadController blip(CONFIG);
+        now = 0;
+        simulate(blip, now, GOOD_LINK, 5);
+        blip.onUpload(200, false);
+        blip.update(now + 1000, GOOD_LINK.rssi, 0);
+        assert(blip.getBatchSize() == 1);
+        return 0;
+    }
+
+    int test_backlog() {
+        UploadController controller(CONFIG);
+        unsigned long now = 0;
+        const LinkConditions backlog = {-55, 200, true, 80};
+        simulate(controller, now, backlog, 2);
+        assert(controller.getBatchSize() == 4);
+        assert(controller.getStats().backlogPercent == 80);
+        return 0;
+    }
+
+    int test_fair_link_holds() {
+        UploadController controller(CONFIG);
+        unsigned long now = 0;
+        simulate(controller, now, WEAK_SIGNAL, 2);
+        assert(controller.getBatchSize() == 4);
+
+        simulate(controller, now, FAIR_LINK, 30);
+        assert(controller.getBatchSize() == 4);
+        assert(controller.getStats().link == Link::FAIR);
+        return 0;
+    }
+
+    int test_evaluation_interval() {
+        UploadController controller(CONFIG);
+        controller.update(1000, -90, 0);
+        assert(controller.getBatchSize() == 2);
+
+        // Not again until the interval has passed
+        controller.update(1500, -90, 0);
+        controller.update(1999, -90, 0);
+        assert(controller.getBatchSize() == 2);
+        controller.update(2000, -90, 0);
+        assert(controller.getBatchSize() == 4);
+
+        // Unknown RSSI is not held against the link
+        UploadController unknown(CONFIG);
+        unknown.update(1000, 0, 0);
+        assert(unknown.getStats().link == Link::GOOD);
+        assert(strcmp(UploadController::linkName(Link::POOR), "poor") == 0);
+        return 0;
+    }
+
+    int run() {
+        test_good_link_sends_every_frame();
+        test_poor_link_batches_then_downsamples();
+        test_recovery_in_reverse();
+        test_slow_and_failing_links();
+        test_backlog();
+        test_fair_link_holds();
+        test_evaluation_interval();
+
+        return 0;
+    }
+}
@@ -0,0 +1,257 @@
+#include <assert.h>
+#include <string>
+#include <vector>
+
+#include "../src/backend/ws_frame_decoder.h"
+
+namespace ws_frame_decoder_test {
+
+    typedef std::vector<uint8_t> Bytes;
+
+    struct Received {
+        uint8_t opcode;
+        std::string data;
+
+        bool operator==(const Received& other) const {
+            return opcode == other.opcode && data == other.data;
+        }
+    };
+
+    enum class LengthEncoding { SHORTEST, BITS_16, BITS_64 };
+
+    // Build one frame, masked frames use a fixed mask
+    void appendFrame(Bytes& out, bool fin, uint8_t opcode, const std::string& payload,
+                     bool masked = false, LengthEncoding encoding = LengthEncoding::SHORTEST) {
+        out.push_back((fin ? 0x80 : 0x00) | opcode);
+
+        const uint8_t maskBit = masked ? 0x80 : 0x00;
+        const size_t length = payload.size();
+        if (encoding == LengthEncoding::SHORTEST && length < 126) {
+            out.push_back(maskBit | (uint8_t)length);
+        } else if (encoding != LengthEncoding::BITS_64 && length < 65536) {
+            out.push_back(maskBit | 126);
+            out.push_back((uint8_t)(length >> 8));
+            out.push_back((uint8_t)length);
+        } else {
+            out.push_back(maskBit | 127);
+            for (int i = 7; i >= 0; i--) {
+                out.push_back((uint8_t)((uint64_t)length >> (i * 8)));
+            }
+        }
+
+        const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+        if (masked) {
+            out.insert(out.end(), mask, mask + 4);
+        }
+        for (size_t i = 0; i < length; i++) {
+            out.push_back((uint8_t)payload[i] ^ (masked ? mask[i % 4] : 0));
+        }
+    }
+
+    void drain(WsFrameDecoder& decoder, std::vector<Received>& out) {
+        WsFrameDecoder::Message message;
+        while (decoder.next(message)) {
+            // The message is terminated where it ends
+            assert(message.data[message.length] == '\0');
+            out.push_back({message.opcode, std::string(message.data, message.length)});
+        }
+    }
+
+    // Feed the stream in chunks of the given sizes, cycling through them
+    std::vector<Received> decodeChunked(const Bytes& stream, const std::vector<size_t>& chunks, size_t capacity = 1024) {
+        WsFrameDecoder decoder(capacity);
+        std::vector<Received> out;
+        size_t pos = 0;
+        for (size_t i = 0; pos < stream.size(); i++) {
+            size_t chunk = chunks[i % chunks.size()];
+            if (chunk > stream.size() - pos) {
+                chunk = stream.size() - pos;
+            }
+            while (chunk > 0) {
+                // Read straight into the buffer like the socket does
+                size_t space;
+                uint8_t* target = decoder.writeBuffer(space);
+                assert(space > 0);
+                const size_t count = chunk < space ? chunk : space;
+                memcpy(target, &stream[pos], count);
+                decoder.commitWrite(count);
+                pos += count;
+                chunk -= count;
+                drain(decoder, out);
+            }
+        }
+        assert(!decoder.hasError());
+        return out;
+    }
+
+    std::string pattern(size_t length) {
+        std::string text;
+        for (size_t i = 0; i < length; i++) {
+            text += (char)('a' + i % 26);
+        }
+        return text;
+    }
+
+    // One of everything the backend can send
+    void buildMixedStream(Bytes& stream, std::vector<Received>& expected) {
+        const std::string big = "{\"type\":\"data\",\"payload\":\"" + pattern(600) + "\"}";
+
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "{\"type\":\"connection_ack\"}");
+        expected.push_back({WsFrameDecoder::TEXT, "{\"type\":\"connection_ack\"}"});
+
+        appendFrame(stream, true, WsFrameDecoder::TEXT, big, false, LengthEncoding::BITS_16);
+        expected.push_back({WsFrameDecoder::TEXT, big});
+
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "sixty four", false, LengthEncoding::BITS_64);
+        expected.push_back({WsFrameDecoder::TEXT, "sixty four"});
+
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "masked", true);
+        expected.push_back({WsFrameDecoder::TEXT, "masked"});
+
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "");
+        expected.push_back({WsFrameDecoder::TEXT, ""});
+
+        // Fragmented with a ping in the middle, the ping is delivered first
+        appendFrame(stream, false, WsFrameDecoder::TEXT, "frag");
+        appendFrame(stream, false, WsFrameDecoder::CONTINUATION, "ment", true);
+        appendFrame(stream, true, WsFrameDecoder::PING, "hi");
+        appendFrame(stream, false, WsFrameDecoder::CONTINUATION, "");
+        appendFrame(stream, true, WsFrameDecoder::CONTINUATION, "ed", false, LengthEncoding::BITS_16);
+        expected.push_back({WsFrameDecoder::PING, "hi"});
+        expected.push_back({WsFrameDecoder::TEXT, "fragmented"});
+
+        appendFrame(stream, true, WsFrameDecoder::PONG, "");
+        expected.push_back({WsFrameDecoder::PONG, ""});
+
+        appendFrame(stream, true, WsFrameDecoder::CLOSE, std::string("\x03\xe8" "bye", 5));
+        expected.push_back({WsFrameDecoder::CLOSE, std::string("\x03\xe8" "bye", 5)});
+    }
+
+    int test_coalesced() {
+        Bytes stream;
+        std::vector<Received> expected;
+        buildMixedStream(stream, expected);
+
+        assert(decodeChunked(stream, {stream.size()}) == expected);
+        return 0;
+    }
+
+    int test_split_at_every_boundary() {
+        Bytes stream;
+        std::vector<Received> expected;
+        buildMixedStream(stream, expected);
+
+        // Two reads split at every position
+        for (size_t split = 1; split < stream.size(); split++) {
+            assert(decodeChunked(stream, {split, stream.size()}) == expected);
+        }
+
+        // Every read size, down to one byte at a time
+        for (size_t chunk = 1; chunk <= 64; chunk++) {
+            assert(decodeChunked(stream, {chunk}) == expected);
+        }
+        assert(decodeChunked(stream, {1, 7, 2, 130, 3}) == expected);
+        return 0;
+    }
+
+    int test_larger_than_old_read_buffer() {
+        // Request tasks over 1 kB used to be lost
+        const std::string task = "{\"type\":\"data\",\"payload\":\"" + pattern(3000) + "\"}";
+        Bytes stream;
+        appendFrame(stream, true, WsFrameDecoder::TEXT, task);
+
+        std::vector<Received> out = decodeChunked(stream, {1024}, 4096);
+        assert(out.size() == 1);
+        assert(out[0].data == task);
+        return 0;
+    }
+
+    int test_oversized_messages_dropped() {
+        Bytes stream;
+        appendFrame(stream, true, WsFrameDecoder::TEXT, pattern(400));
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "after single");
+        // The first fragments fit, the message as a whole does not
+        appendFrame(stream, false, WsFrameDecoder::TEXT, pattern(200));
+        appendFrame(stream, false, WsFrameDecoder::CONTINUATION, pattern(200));
+        appendFrame(stream, true, WsFrameDecoder::PING, "");
+        appendFrame(stream, true, WsFrameDecoder::CONTINUATION, pattern(10));
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "after fragmented");
+
+        const std::vector<Received> expected = {
+            {WsFrameDecoder::TEXT, "after single"},
+            {WsFrameDecoder::PING, ""},
+            {WsFrameDecoder::TEXT, "after fragmented"},
+        };
+        for (size_t chunk = 1; chunk <= 300; chunk += 13) {
+            assert(decodeChunked(stream, {chunk}, 300) == expected);
+        }
+
+        WsFrameDecoder decoder(300);
+        for (size_t pos = 0; pos < stream.size(); ) {
+            pos += decoder.feed(&stream[pos], stream.size() - pos);
+            std::vector<Received> ignored;
+            drain(decoder, ignored);
+        }
+        assert(decoder.getDroppedCount() == 2);
+        return 0;
+    }
+
+    bool isProtocolError(const Bytes& stream) {
+        WsFrameDecoder decoder(1024);
+        decoder.feed(stream.data(), stream.size());
+        std::vector<Received> out;
+        drain(decoder, out);
+        return decoder.hasError() && out.empty();
+    }
+
+    int test_protocol_errors() {
+        Bytes stream;
+        appendFrame(stream, true, WsFrameDecoder::CONTINUATION, "no start");
+        assert(isProtocolError(stream));
+
+        stream.clear();
+        appendFrame(stream, false, WsFrameDecoder::TEXT, "one");
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "two");
+        assert(isProtocolError(stream));
+
+        stream.clear();
+        appendFrame(stream, false, WsFrameDecoder::PING, "");
+        assert(isProtocolError(stream));
+
+        stream.clear();
+        appendFrame(stream, true, WsFrameDecoder::PING, pattern(126), false, LengthEncoding::BITS_16);
+        assert(isProtocolError(stream));
+
+        stream.clear();
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "rsv");
+        stream[0] |= 0x40;
+        assert(isProtocolError(stream));
+
+        stream.clear();
+        appendFrame(stream, true, 0x3, "reserved opcode");
+        assert(isProtocolError(stream));
+
+        // Reset recovers
+        WsFrameDecoder decoder(1024);
+        decoder.feed(stream.data(), stream.size());
+        WsFrameDecoder::Message message;
+        assert(!decoder.next(message));
+        decoder.reset();
+        stream.clear();
+        appendFrame(stream, true, WsFrameDecoder::TEXT, "ok");
+        decoder.feed(stream.data(), stream.size());
+        assert(decoder.next(message));
+        assert(strcmp(message.data, "ok") == 0);
+        return 0;
+    }
+
+    int run() {
+        test_coalesced();
+        test_split_at_every_boundary();
+        test_larger_than_old_read_buffer();
+        test_oversized_messages_dropped();
+        test_protocol_errors();
+
+        return 0;
+    }
+}
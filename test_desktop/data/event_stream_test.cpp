@@ -0,0 +1,278 @@
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../src/data/event_stream.h"
+
+namespace event_stream_test {
+
+    static void publish(EventStream& stream, const std::string& event) {
+        char* buffer = stream.beginEvent();
+        memcpy(buffer, event.data(), event.size());
+        stream.publish(event.size());
+    }
+
+    // Everything a subscriber has to send right now, as if the socket took it all
+    static std::string drain(EventStream& stream, int id, size_t capacity = EventStream::MAX_EVENT_SIZE) {
+        std::string sent;
+        char buffer[EventStream::MAX_EVENT_SIZE];
+        int length;
+        while ((length = stream.peek(id, buffer, capacity)) > 0) {
+            sent.append(buffer, length);
+            stream.consume(id, length);
+        }
+        assert(length == 0);
+        return sent;
+    }
+
+    class CountingListener : public EventStream::Listener {
+        public:
+            int calls = 0;
+            void onPublish() override { calls++; }
+    };
+
+    int test_fan_out() {
+        EventStream stream;
+        CountingListener listener;
+        stream.setListener(&listener);
+
+        const int first = stream.subscribe();
+        const int second = stream.subscribe();
+        assert(first >= 0 && second >= 0 && first != second);
+        assert(stream.getSubscriberCount() == 2);
+        assert(!stream.hasPending(first));
+
+        publish(stream, "data: 1\n\n");
+        publish(stream, "data: 2\n\n");
+        assert(listener.calls == 2);
+        assert(stream.hasPending(first) && stream.hasPending(second));
+
+        assert(drain(stream, first) == "data: 1\n\ndata: 2\n\n");
+        assert(!stream.hasPending(first));
+        // The other one is sent the same bytes, in small pieces
+        assert(drain(stream, second, 3) == "data: 1\n\ndata: 2\n\n");
+
+        const EventStream::Stats& stats = stream.getStats();
+        assert(stats.published == 2);
+        assert(stats.delivered == 4);
+        assert(stats.dropped == 0);
+
+        // A new subscriber starts with the latest event
+        stream.unsubscribe(first);
+        const int third = stream.subscribe();
+        assert(drain(stream, third) == "data: 2\n\n");
+        return 0;
+    }
+
+    int test_partial_sends() {
+        EventStream stream;
+        const int id = stream.subscribe();
+        publish(stream, "data: hello\n\n");
+
+        char buffer[32];
+        assert(stream.peek(id, buffer, sizeof(buffer)) == 13);
+        // The socket took 4 bytes, the rest is offered again
+        stream.consume(id, 4);
+        assert(stream.hasPending(id));
+        assert(stream.peek(id, buffer, sizeof(buffer)) == 9);
+        assert(memcmp(buffer, ": hello\n\n", 9) == 0);
+        stream.consume(id, 9);
+        assert(!stream.hasPending(id));
+        assert(stream.peek(id, buffer, sizeof(buffer)) == 0);
+        return 0;
+    }
+
+    int test_drops_when_behind() {
+        EventStream stream;
+        const int slow = stream.subscribe();
+        const int fast = stream.subscribe();
+
+        for (int i = 0; i < 10; i++) {
+            publish(stream, "data: " + std::to_string(i) + "\n\n");
+            drain(stream, fast);
+        }
+
+        // Only the last SLOTS events are still there
+        std::string last;
+        for (size_t i = 10 - EventStream::SLOTS; i < 10; i++) {
+            last += "data: " + std::to_string(i) + "\n\n";
+        }
+        assert(drain(stream, slow) == last);
+        assert(stream.getStats().dropped == 10 - EventStream::SLOTS);
+        assert(stream.getStats().delivered == 10 + EventStream::SLOTS);
+        assert(stream.getStats().overruns == 0);
+        return 0;
+    }
+
+    int test_overrun() {
+        EventStream stream;
+        const int id = stream.subscribe();
+        publish(stream, "data: first\n\n");
+
+        char buffer[4];
+        assert(stream.peek(id, buffer, sizeof(buffer)) == 4);
+        stream.consume(id, 4);
+
+        // The rest of the event is gone, continuing would send a broken stream
+        for (size_t i = 0; i < EventStream::SLOTS; i++) {
+            publish(stream, "data: next\n\n");
+        }
+        assert(stream.peek(id, buffer, sizeof(buffer)) == EventStream::OVERRUN);
+        assert(stream.getStats().overruns == 1);
+
+        // Without a partial event the same lag only drops
+        stream.unsubscribe(id);
+        const int fresh = stream.subscribe();
+        for (size_t i = 0; i < EventStream::SLOTS + 2; i++) {
+            publish(stream, "data: more\n\n");
+        }
+        assert(drain(stream, fresh).size() == EventStream::SLOTS * strlen("data: more\n\n"));
+        assert(stream.getStats().overruns == 1);
+        return 0;
+    }
+
+    int test_given_up_events() {
+        EventStream stream;
+        const int id = stream.subscribe();
+        for (size_t i = 0; i < EventStream::SLOTS; i++) {
+            publish(stream, "data: " + std::to_string(i) + "\n\n");
+        }
+
+        // Written into the slot of event 0 and then given up, event 0 must not be sent
+        char* buffer = stream.beginEvent();
+        memcpy(buffer, "garbage", 7);
+        stream.publish(0);
+        assert(stream.getStats().published == EventStream::SLOTS);
+        std::string rest;
+        for (size_t i = 1; i < EventStream::SLOTS; i++) {
+            rest += "data: " + std::to_string(i) + "\n\n";
+        }
+        assert(drain(stream, id) == rest);
+        assert(stream.getStats().dropped == 1);
+
+        stream.beginEvent();
+        stream.publish(EventStream::MAX_EVENT_SIZE + 1);
+        assert(stream.getStats().rejected == 1);
+        assert(!stream.hasPending(id));
+
+        // Without beginEvent there is nothing to publish
+        stream.publish(10);
+        assert(stream.getStats().published == EventStream::SLOTS);
+        return 0;
+    }
+
+    int test_subscriber_limit() {
+        EventStream stream;
+        int ids[EventStream::MAX_SUBSCRIBERS];
+        for (size_t i = 0; i < EventStream::MAX_SUBSCRIBERS; i++) {
+            ids[i] = stream.subscribe();
+            assert(ids[i] >= 0);
+        }
+        assert(stream.subscribe() == -1);
+
+        stream.unsubscribe(ids[1]);
+        assert(stream.getSubscriberCount() == EventStream::MAX_SUBSCRIBERS - 1);
+        assert(stream.subscribe() == ids[1]);
+
+        // Ids that were never handed out are ignored
+        char buffer[8];
+        assert(stream.peek(-1, buffer, sizeof(buffer)) == 0);
+        assert(stream.peek((int)EventStream::MAX_SUBSCRIBERS, buffer, sizeof(buffer)) == 0);
+        assert(!stream.hasPending(-1));
+        stream.unsubscribe(-1);
+        return 0;
+    }
+
+    // Every event is "<n>:", n % 500 copies of a letter picked by n and a line feed
+    static size_t makeEvent(uint32_t n, char* out) {
+        int length = sprintf(out, "%u:", (unsigned int)n);
+        const size_t repeat = n % 500;
+        memset(out + length, 'a' + n % 26, repeat);
+        out[length + repeat] = '\n';
+        return length + repeat + 1;
+    }
+
+    static bool isIntact(const std::string& event, uint32_t& n) {
+        n = (uint32_t)strtoul(event.c_str(), nullptr, 10);
+        char expected[EventStream::MAX_EVENT_SIZE];
+        const size_t length = makeEvent(n, expected);
+        return event.size() == length && memcmp(event.data(), expected, length) == 0;
+    }
+
+    int test_concurrent() {
+        // The producer never waits, the subscriber reads in small pieces so it often falls behind
+        EventStream stream;
+        const uint32_t events = 20000;
+        int id = stream.subscribe();
+
+        std::atomic<bool> done(false);
+        std::thread producer([&stream, &done, events]() {
+            for (uint32_t n = 0; n < events; n++) {
+                char* buffer = stream.beginEvent();
+                stream.publish(makeEvent(n, buffer));
+                // Now and then the subscriber gets a chance to catch up
+                if (n % 8 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+            }
+            done = true;
+        });
+
+        uint32_t received = 0;
+        uint32_t last = 0;
+        uint32_t torn = 0;
+        std::string event;
+        char buffer[64];
+        while (!done || stream.hasPending(id)) {
+            const int length = stream.peek(id, buffer, sizeof(buffer));
+            if (length == EventStream::OVERRUN) {
+                // What a client would do, the part it had is thrown away
+                stream.unsubscribe(id);
+                id = stream.subscribe();
+                event.clear();
+                continue;
+            }
+            if (length == 0) {
+                continue;
+            }
+            stream.consume(id, length);
+            for (int i = 0; i < length; i++) {
+                event += buffer[i];
+                if (buffer[i] != '\n') {
+                    continue;
+                }
+                uint32_t n;
+                if (!isIntact(event, n)) {
+                    torn++;
+                } else {
+                    assert(received == 0 || n > last);
+                    last = n;
+                    received++;
+                }
+                event.clear();
+            }
+        }
+        producer.join();
+
+        const EventStream::Stats& stats = stream.getStats();
+        printf("Event stream %u events: %u received, %u dropped, %u overruns\n",
+               (unsigned int)events, (unsigned int)received, (unsigned int)stats.dropped, (unsigned int)stats.overruns);
+        assert(stats.published == events);
+        assert(torn == 0);
+        assert(received > 0);
+        return 0;
+    }
+
+    int run() {
+        test_fan_out();
+        test_partial_sends();
+        test_drops_when_behind();
+        test_overrun();
+        test_given_up_events();
+        test_subscriber_limit();
+        test_concurrent();
+        return 0;
+    }
+}
@@ -0,0 +1,100 @@
+#include <assert.h>
+
+#include "../src/data/reading_aggregator.h"
+
+namespace reading_aggregator_test {
+
+    static void frame(P1Data& data, const char* power, const char* voltage, const char* energy, uint64_t timestamp) {
+        data.clear();
+        data.addObisString("0-0:96.1.0(123456)");
+        data.addObisString(power);
+        data.addObisString(voltage);
+        data.addObisString(energy);
+        data.timestamp = timestamp;
+    }
+
+    int test_average_instantaneous() {
+        ReadingAggregator aggregator;
+        assert(aggregator.isEmpty());
+
+        P1Data data;
+        frame(data, "1-0:1.7.0(01.000*kW)", "1-0:32.7.0(230.0*V)", "1-0:1.8.0(00001000.000*kWh)", 1000);
+        aggregator.add(data);
+        frame(data, "1-0:1.7.0(02.000*kW)", "1-0:32.7.0(231.0*V)", "1-0:1.8.0(00001000.010*kWh)", 2000);
+        aggregator.add(data);
+        frame(data, "1-0:1.7.0(03.500*kW)", "1-0:32.7.0(232.0*V)", "1-0:1.8.0(00001000.020*kWh)", 3000);
+        aggregator.add(data);
+        assert(aggregator.getCount() == 3);
+
+        const P1Data& reading = aggregator.finish();
+        assert(reading.obisStringCount == 4);
+        assert(strcmp(reading.obisStrings[0], "0-0:96.1.0(123456)") == 0);
+        assert(strcmp(reading.obisStrings[1], "1-0:1.7.0(2.167*kW)") == 0);
+        assert(strcmp(reading.obisStrings[2], "1-0:32.7.0(231.0*V)") == 0);
+        // Meter readings and the timestamp are the latest
+        assert(strcmp(reading.obisStrings[3], "1-0:1.8.0(00001000.020*kWh)") == 0);
+        assert(reading.timestamp == 3000);
+
+        aggregator.reset();
+        assert(aggregator.isEmpty());
+        return 0;
+    }
+
+    int test_single_frame_unchanged() {
+        ReadingAggregator aggregator;
+        P1Data data;
+        frame(data, "1-0:1.7.0(01.234*kW)", "1-0:32.7.0(230.1*V)", "1-0:1.8.0(00001000.000*kWh)", 1000);
+        aggregator.add(data);
+
+        const P1Data& reading = aggregator.finish();
+        for (uint8_t i = 0; i < data.obisStringCount; i++) {
+            assert(strcmp(reading.obisStrings[i], data.obisStrings[i]) == 0);
+        }
+        return 0;
+    }
+
+    int test_missing_rows_and_decoder_format() {
+        ReadingAggregator aggregator;
+
+        // DLMS frames are formatted with %f
+        P1Data data;
+        data.addObisString(21, 7, 1.0f, "kW");
+        aggregator.add(data);
+
+        data.clear();
+        data.addObisString(21, 7, 2.0f, "kW");
+        data.addObisString(41, 7, 4.0f, "kW");
+        aggregator.add(data);
+
+        const P1Data& reading = aggregator.finish();
+        assert(strcmp(reading.obisStrings[0], "1-0:21.7.0(1.500000*kW)") == 0);
+        // Only seen once, left as it is
+        assert(strcmp(reading.obisStrings[1], "1-0:41.7.0(4.000000*kW)") == 0);
+        return 0;
+    }
+
+    // Counters also have D = 7, they must be passed on as read rather than averaged
+    int test_counters_not_averaged() {
+        ReadingAggregator aggregator;
+        P1Data data;
+        frame(data, "0-0:96.7.21(00004)", "0-0:96.7.9(00002)", "1-0:21.7.0(01.000*kW)", 1000);
+        aggregator.add(data);
+        frame(data, "0-0:96.7.21(00005)", "0-0:96.7.9(00003)", "1-0:21.7.0(02.000*kW)", 2000);
+        aggregator.add(data);
+
+        const P1Data& reading = aggregator.finish();
+        assert(strcmp(reading.obisStrings[1], "0-0:96.7.21(00005)") == 0);
+        assert(strcmp(reading.obisStrings[2], "0-0:96.7.9(00003)") == 0);
+        assert(strcmp(reading.obisStrings[3], "1-0:21.7.0(1.500*kW)") == 0);
+        return 0;
+    }
+
+    int run() {
+        test_average_instantaneous();
+        test_single_frame_unchanged();
+        test_missing_rows_and_decoder_format();
+        test_counters_not_averaged();
+
+        return 0;
+    }
+}
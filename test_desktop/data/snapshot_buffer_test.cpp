@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <thread>
+
+#include "../src/data/snapshot_buffer.h"
+#include "../src/data/decoding/p1data.h"
+
+namespace snapshot_buffer_test {
+
+    // Every word carries the same generation, any mix means a torn read
+    struct Pattern {
+        uint32_t words[256];
+    };
+
+    void fillPattern(Pattern& pattern, uint32_t generation) {
+        for (size_t i = 0; i < 256; i++) {
+            pattern.words[i] = generation;
+        }
+    }
+
+    bool isConsistent(const Pattern& pattern) {
+        for (size_t i = 1; i < 256; i++) {
+            if (pattern.words[i] != pattern.words[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int test_initial_value() {
+        SnapshotBuffer<P1Data> buffer;
+        P1Data out;
+        out.addObisString("garbage");
+        assert(buffer.read(out) == 0);
+        assert(out.obisStringCount == 0);
+        assert(out.timestamp == 0);
+        assert(buffer.getVersion() == 0);
+        return 0;
+    }
+
+    int test_publish_and_abort() {
+        SnapshotBuffer<P1Data> buffer;
+
+        P1Data& first = buffer.beginWrite();
+        first.clear();
+        first.addObisString("1-0:1.8.0(000001.000*kWh)");
+        first.timestamp = 1000;
+
+        // Not visible until published
+        P1Data out;
+        buffer.read(out);
+        assert(out.obisStringCount == 0);
+
+        buffer.publish();
+        assert(buffer.read(out) == 1);
+        assert(out.obisStringCount == 1);
+        assert(out.timestamp == 1000);
+        assert(strcmp(out.obisStrings[0], "1-0:1.8.0(000001.000*kWh)") == 0);
+
+        // An aborted write leaves the published value alone
+        P1Data& second = buffer.beginWrite();
+        assert(&second != &first);
+        second.clear();
+        second.timestamp = 2000;
+        buffer.abortWrite();
+        assert(buffer.read(out) == 1);
+        assert(out.timestamp == 1000);
+
+        // Publishing twice without a new write does nothing
+        buffer.publish();
+        assert(buffer.getVersion() == 1);
+        return 0;
+    }
+
+    int test_write_never_touches_published_slot() {
+        SnapshotBuffer<Pattern, 3> buffer;
+        for (uint32_t generation = 1; generation < 20; generation++) {
+            Pattern& slot = buffer.beginWrite();
+            fillPattern(slot, generation);
+            // Returns the same slot until published
+            assert(&buffer.beginWrite() == &slot);
+
+            Pattern out;
+            buffer.read(out);
+            assert(isConsistent(out));
+            assert(out.words[0] == generation - 1);
+
+            buffer.publish();
+            buffer.read(out);
+            assert(out.words[0] == generation);
+        }
+        return 0;
+    }
+
+    // One writer publishing as fast as it can against several readers
+    template <size_t N>
+    int torture(uint32_t generations) {
+        SnapshotBuffer<Pattern, N> buffer;
+        std::atomic<bool> done(false);
+
+        std::thread writer([&buffer, &done, generations]() {
+            for (uint32_t generation = 1; generation <= generations; generation++) {
+                fillPattern(buffer.beginWrite(), generation);
+                buffer.publish();
+            }
+            done.store(true);
+        });
+
+        std::atomic<uint32_t> reads(0);
+        auto reader = [&buffer, &done, &reads]() {
+            Pattern out;
+            uint32_t last = 0;
+            while (!done.load()) {
+                const uint32_t version = buffer.read(out);
+                assert(isConsistent(out));
+                assert(out.words[0] >= last);     // Never goes back in time
+                assert(out.words[0] >= version);  // The version is a lower bound
+                last = out.words[0];
+                reads.fetch_add(1);
+            }
+        };
+
+        std::thread reader1(reader);
+        std::thread reader2(reader);
+        writer.join();
+        reader1.join();
+        reader2.join();
+
+        Pattern out;
+        assert(buffer.read(out) == generations);
+        assert(out.words[0] == generations);
+        return 0;
+    }
+
+    int run() {
+        test_initial_value();
+        test_publish_and_abort();
+        test_write_never_touches_published_slot();
+        torture<2>(200000);
+        torture<3>(200000);
+
+        return 0;
+    }
+}
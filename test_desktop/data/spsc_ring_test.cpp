@@ -0,0 +1,247 @@
+#include <assert.h>
+#include <thread>
+
+#include "../src/data/spsc_ring.h"
+
+namespace spsc_ring_test {
+
+    // Writes a record of the given length where every byte is derived from the sequence number
+    bool writeRecord(SpscRing& ring, uint32_t seq, size_t length) {
+        uint8_t* data = ring.reserve(length);
+        if (data == nullptr) {
+            return false;
+        }
+        memcpy(data, &seq, sizeof(seq));
+        for (size_t i = sizeof(seq); i < length; i++) {
+            data[i] = (uint8_t)(seq + i);
+        }
+        return ring.commit(length);
+    }
+
+    // Checks a record written by writeRecord and returns its sequence number
+    uint32_t checkRecord(const SpscRing::Record& record) {
+        uint32_t seq;
+        assert(record.length >= sizeof(seq));
+        memcpy(&seq, record.data, sizeof(seq));
+        for (size_t i = sizeof(seq); i < record.length; i++) {
+            assert(record.data[i] == (uint8_t)(seq + i));
+        }
+        return seq;
+    }
+
+    size_t lengthFor(uint32_t seq) {
+        return 4 + (seq * 37) % 200;
+    }
+
+    int test_constructor() {
+        SpscRing ring(1000);
+        assert(ring.getArenaSize() == 512);     // Rounded down to a power of two
+        assert(ring.isEmpty());
+        assert(ring.usedBytes() == 0);
+        assert(ring.maxRecordLength() == 256 - 4);
+
+        SpscRing::Record record;
+        assert(!ring.peek(record));
+        return 0;
+    }
+
+    int test_reserve_commit_peek_release() {
+        SpscRing ring(256);
+        uint8_t* data = ring.reserve(10);
+        assert(data != nullptr);
+        memcpy(data, "hello", 6);
+        assert(ring.isEmpty());     // Nothing is visible before commit
+        assert(ring.commit(6));
+        assert(!ring.commit(6));    // Only one commit per reservation
+
+        SpscRing::Record record;
+        assert(ring.peek(record));
+        assert(record.length == 6);
+        assert(strcmp((const char*)record.data, "hello") == 0);
+
+        // Peeking again returns the same record until released
+        SpscRing::Record again;
+        assert(ring.peek(again));
+        assert(again.data == record.data);
+
+        ring.release();
+        assert(ring.isEmpty());
+        assert(!ring.peek(record));
+        assert(ring.getCommittedCount() == 1);
+        return 0;
+    }
+
+    int test_commit_longer_than_reserved() {
+        SpscRing ring(256);
+        assert(ring.reserve(8) != nullptr);
+        assert(!ring.commit(9));
+        assert(ring.isEmpty());
+
+        assert(ring.reserve(ring.maxRecordLength() + 1) == nullptr);
+        assert(ring.getRejectedCount() == 1);
+        return 0;
+    }
+
+    int test_wrap_with_padding() {
+        SpscRing ring(64);
+        // Records of 20 bytes take 24 bytes each, the third one does not fit before the end
+        for (uint32_t seq = 0; seq < 50; seq++) {
+            assert(writeRecord(ring, seq, 20));
+            SpscRing::Record record;
+            assert(ring.peek(record));
+            assert(checkRecord(record) == seq);
+            assert(record.length == 20);
+            ring.release();
+            assert(ring.isEmpty());
+        }
+        assert(ring.getDroppedCount() == 0);
+        return 0;
+    }
+
+    int test_drop_oldest() {
+        SpscRing ring(128, SpscRing::Policy::DROP_OLDEST);
+        // 28 byte records are 32 bytes with header, four fill the arena
+        for (uint32_t seq = 0; seq < 4; seq++) {
+            assert(writeRecord(ring, seq, 28));
+        }
+        assert(ring.usedBytes() == 128);
+        assert(writeRecord(ring, 4, 28));
+        assert(ring.getDroppedCount() == 1);
+
+        SpscRing::Record record;
+        for (uint32_t seq = 1; seq < 5; seq++) {
+            assert(ring.peek(record));
+            assert(checkRecord(record) == seq);
+            ring.release();
+        }
+        assert(ring.isEmpty());
+        return 0;
+    }
+
+    int test_drop_oldest_keeps_held_record() {
+        SpscRing ring(128, SpscRing::Policy::DROP_OLDEST);
+        for (uint32_t seq = 0; seq < 4; seq++) {
+            assert(writeRecord(ring, seq, 28));
+        }
+
+        SpscRing::Record record;
+        assert(ring.peek(record));
+        assert(checkRecord(record) == 0);
+
+        // The oldest record is held by the consumer so nothing can be dropped
+        assert(!writeRecord(ring, 4, 28));
+        assert(ring.getDroppedCount() == 0);
+        assert(ring.getRejectedCount() == 1);
+        assert(checkRecord(record) == 0);
+
+        ring.release();
+        assert(writeRecord(ring, 4, 28));
+        assert(ring.getDroppedCount() == 0);
+        return 0;
+    }
+
+    int test_reject_new() {
+        SpscRing ring(128, SpscRing::Policy::REJECT_NEW);
+        for (uint32_t seq = 0; seq < 4; seq++) {
+            assert(writeRecord(ring, seq, 28));
+        }
+        assert(!writeRecord(ring, 4, 28));
+        assert(ring.getRejectedCount() == 1);
+        assert(ring.getDroppedCount() == 0);
+
+        SpscRing::Record record;
+        assert(ring.peek(record));
+        assert(checkRecord(record) == 0);
+        ring.release();
+        return 0;
+    }
+
+    // Two threads, the producer backs off when full so nothing may be lost or reordered
+    int test_stress_no_loss() {
+        const uint32_t count = 200000;
+        SpscRing ring(1024, SpscRing::Policy::REJECT_NEW);
+
+        std::thread producer([&ring, count]() {
+            for (uint32_t seq = 0; seq < count; seq++) {
+                while (!writeRecord(ring, seq, lengthFor(seq))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        uint32_t expected = 0;
+        while (expected < count) {
+            SpscRing::Record record;
+            if (!ring.peek(record)) {
+                std::this_thread::yield();
+                continue;
+            }
+            assert(record.length == lengthFor(expected));
+            assert(checkRecord(record) == expected);
+            ring.release();
+            expected++;
+        }
+        producer.join();
+
+        assert(ring.isEmpty());
+        assert(ring.getCommittedCount() == count);
+        assert(ring.getDroppedCount() == 0);
+        return 0;
+    }
+
+    // Two threads with a slow consumer, records may be dropped but never reordered or torn
+    int test_stress_drop_oldest() {
+        const uint32_t count = 100000;
+        SpscRing ring(512, SpscRing::Policy::DROP_OLDEST);
+        std::atomic<bool> done(false);
+
+        std::thread producer([&ring, &done, count]() {
+            for (uint32_t seq = 0; seq < count; seq++) {
+                // Rejected only while the consumer holds the oldest record
+                while (!writeRecord(ring, seq, lengthFor(seq))) {
+                    std::this_thread::yield();
+                }
+            }
+            done.store(true);
+        });
+
+        uint32_t received = 0;
+        int64_t last = -1;
+        while (true) {
+            SpscRing::Record record;
+            if (!ring.peek(record)) {
+                if (done.load() && ring.isEmpty()) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            const uint32_t seq = checkRecord(record);
+            assert((int64_t)seq > last);
+            assert(record.length == lengthFor(seq));
+            last = seq;
+            received++;
+            ring.release();
+        }
+        producer.join();
+
+        assert(last == count - 1);
+        assert(ring.getCommittedCount() == count);
+        assert(received + ring.getDroppedCount() >= count);
+        return 0;
+    }
+
+    int run() {
+        test_constructor();
+        test_reserve_commit_peek_release();
+        test_commit_longer_than_reserved();
+        test_wrap_with_padding();
+        test_drop_oldest();
+        test_drop_oldest_keeps_held_record();
+        test_reject_new();
+        test_stress_no_loss();
+        test_stress_drop_oldest();
+
+        return 0;
+    }
+}
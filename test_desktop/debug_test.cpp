@@ -2,6 +2,7 @@
 #include "../src/data/circular_buffer.h"
 
 #include <assert.h>
+#include <malloc.h>
 
 namespace debug_test {
 
@@ -40,9 +41,108 @@ namespace debug_test {
         return 0;
     }
 
+    static size_t heapInUse() {
+        return mallinfo2().uordblks;
+    }
+
+    // Records the largest amount of heap in use whenever the report hands over data
+    class HeapSamplingWriter : public ResponseWriter {
+        public:
+            explicit HeapSamplingWriter(zap::Str* body = nullptr) : body(body), bytes(0), peakHeap(0) {}
+
+            void begin(int statusCode, const char* contentType, size_t contentLength) override {
+                sample();
+            }
+            void write(const char* data, size_t length) override {
+                sample();
+                bytes += length;
+                if (body != nullptr) {
+                    body->append(data, length);
+                }
+            }
+            void end() override {
+                sample();
+            }
+
+            zap::Str* body;
+            size_t bytes;
+            size_t peakHeap;
+
+        private:
+            void sample() {
+                const size_t inUse = heapInUse();
+                peakHeap = inUse > peakHeap ? inUse : peakHeap;
+            }
+    };
+
+    int test_streamed_report() {
+        // A full meter buffer and faulty frame, as /api/debug sees them on a meter that fails to decode
+        CircularBuffer buffer(2048);
+        for (int i = 0; i < 2048; i++) {
+            buffer.addByte((uint8_t)i, 1000);
+        }
+        Debug::setMeterDataBuffer(&buffer);
+        uint8_t faulty[1024];
+        for (size_t i = 0; i < sizeof(faulty); i++) {
+            faulty[i] = (uint8_t)(i * 3);
+        }
+        Debug::setFaultyFrameData((const uid_t*)faulty, sizeof(faulty));
+
+        // The same report either way
+        JsonBuilder built;
+        built.beginObject().add("status", "success");
+        Debug::getJsonReport(built);
+        const zap::Str expected = built.end();
+
+        zap::Str body;
+        HeapSamplingWriter collector(&body);
+        StreamingJsonBuilder streamed(collector);
+        streamed.beginObject().add("status", "success");
+        Debug::getJsonReport(streamed);
+        assert(streamed.end() == expected.length());
+        assert(body == expected);
+        assert(expected.length() > 6000);
+
+        // Heap taken by building the response in memory, it is all there when it is sent
+        const size_t builtBase = heapInUse();
+        size_t builtPeak;
+        {
+            HeapSamplingWriter writer;
+            JsonBuilder json;
+            json.beginObject().add("status", "success");
+            Debug::getJsonReport(json);
+            const zap::Str& data = json.end();
+            writer.begin(200, "application/json", data.length());
+            writer.write(data.c_str(), data.length());
+            writer.end();
+            builtPeak = writer.peakHeap - builtBase;
+        }
+
+        // Streamed, only the chunk on the stack and the builder's nesting state
+        const size_t streamedBase = heapInUse();
+        HeapSamplingWriter writer;
+        writer.begin(200, "application/json", ResponseWriter::UNKNOWN_LENGTH);
+        StreamingJsonBuilder json(writer);
+        json.beginObject().add("status", "success");
+        Debug::getJsonReport(json);
+        json.end();
+        writer.end();
+        const size_t streamedPeak = writer.peakHeap > streamedBase ? writer.peakHeap - streamedBase : 0;
+
+        printf("Debug report %zu bytes: built %zu bytes peak heap, streamed %zu bytes peak heap in %zu byte chunks\n",
+               writer.bytes, builtPeak, streamedPeak, RESPONSE_CHUNK_SIZE);
+        assert(builtPeak >= expected.length());
+        assert(streamedPeak <= RESPONSE_CHUNK_SIZE);
+
+        Debug::setMeterDataBuffer(nullptr);
+        Debug::clearFaultyFrameData();
+        return 0;
+    }
+
     int run(){
         
         test_meterDatabuffer();
+        test_streamed_report();
 
         return 0;
     }
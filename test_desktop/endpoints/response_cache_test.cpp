@@ -0,0 +1,251 @@
+#include <assert.h>
+#include <chrono>
+#include <string>
+
+#include "../src/endpoints/response_cache.h"
+#include "../src/data/decoding/p1data.h"
+#include "../src/json_light/json_light.h"
+
+namespace response_cache_test {
+
+    class RecordingWriter : public ResponseWriter {
+        public:
+            int status = 0;
+            std::string etag;
+            std::string body;
+
+            void setHeader(const char* name, const char* value) override {
+                assert(strcmp(name, "ETag") == 0);
+                etag = value;
+            }
+            void begin(int statusCode, const char* contentType, size_t contentLength) override {
+                status = statusCode;
+                body.clear();
+            }
+            void write(const char* data, size_t length) override { body.append(data, length); }
+            void end() override {}
+    };
+
+    class VersionedHandler : public EndpointFunction {
+        public:
+            uint32_t version = 1;
+            bool hasVersion = true;
+            int status = 200;
+            std::string body = "{\"value\":1}";
+            int calls = 0;
+
+            EndpointResponse handle(const zap::Str& contents) override {
+                calls++;
+                EndpointResponse response;
+                response.statusCode = status;
+                response.contentType = "application/json";
+                response.data = body.c_str();
+                return response;
+            }
+
+            bool getCacheVersion(uint32_t& out) override {
+                out = version;
+                return hasVersion;
+            }
+    };
+
+    static RecordingWriter get(ResponseCache& cache, EndpointFunction& handler, const char* ifNoneMatch = nullptr,
+                               Endpoint::Verb verb = Endpoint::Verb::GET) {
+        const Endpoint endpoint(Endpoint::P1_DATA, verb, "/api/data/p1/obis", handler);
+        EndpointRequest request(endpoint);
+        request.ifNoneMatch = ifNoneMatch;
+        RecordingWriter writer;
+        if (!cache.serve(request, writer)) {
+            writer.status = -1;
+        }
+        return writer;
+    }
+
+    int test_versions() {
+        ResponseCache cache;
+        VersionedHandler handler;
+
+        RecordingWriter first = get(cache, handler);
+        assert(first.status == 200);
+        assert(first.body == "{\"value\":1}");
+        assert(first.etag.size() == 18 && first.etag[0] == '"' && first.etag[17] == '"');
+
+        RecordingWriter second = get(cache, handler);
+        assert(second.body == first.body && second.etag == first.etag);
+        assert(handler.calls == 1);
+
+        // A new version runs the handler, the ETag follows the body rather than the version
+        handler.version = 2;
+        assert(get(cache, handler).etag == first.etag);
+        assert(handler.calls == 2);
+
+        handler.version = 3;
+        handler.body = "{\"value\":3}";
+        RecordingWriter third = get(cache, handler);
+        assert(third.body == "{\"value\":3}");
+        assert(third.etag != first.etag);
+        assert(handler.calls == 3);
+
+        const ResponseCache::Stats& stats = cache.getStats();
+        assert(stats.hits == 1);
+        assert(stats.misses == 3);
+        assert(cache.getHitPercent() == 25);
+        return 0;
+    }
+
+    int test_not_modified() {
+        ResponseCache cache;
+        VersionedHandler handler;
+        const std::string etag = get(cache, handler).etag;
+
+        RecordingWriter response = get(cache, handler, etag.c_str());
+        assert(response.status == 304);
+        assert(response.body.empty());
+        assert(response.etag == etag);
+
+        const std::string list = "\"0000000000000000\", W/" + etag;
+        assert(get(cache, handler, list.c_str()).status == 304);
+        assert(get(cache, handler, "*").status == 304);
+        assert(get(cache, handler, "\"0000000000000000\"").status == 200);
+        assert(get(cache, handler, "").status == 200);
+        assert(cache.getStats().notModified == 3);
+
+        // The client's copy is still good after the version changed if the body did not
+        handler.version++;
+        assert(get(cache, handler, etag.c_str()).status == 304);
+        assert(handler.calls == 2);
+        return 0;
+    }
+
+    int test_not_cached() {
+        ResponseCache cache;
+        VersionedHandler handler;
+
+        assert(get(cache, handler, nullptr, Endpoint::Verb::POST).status == -1);
+        handler.hasVersion = false;
+        assert(get(cache, handler).status == -1);
+        assert(handler.calls == 0);
+        handler.hasVersion = true;
+
+        // Errors are passed on and not kept
+        handler.status = 503;
+        RecordingWriter response = get(cache, handler);
+        assert(response.status == 503 && response.etag.empty());
+        get(cache, handler);
+        assert(handler.calls == 2);
+
+        handler.status = 200;
+        handler.body = std::string(ResponseCache::MAX_BODY_SIZE + 1, 'x');
+        assert(get(cache, handler).body.size() == ResponseCache::MAX_BODY_SIZE + 1);
+        get(cache, handler);
+        assert(handler.calls == 4);
+        assert(cache.getStats().uncached == 4);
+        assert(cache.getStats().hits == 0);
+        return 0;
+    }
+
+    int test_least_recently_used() {
+        ResponseCache cache;
+        VersionedHandler handlers[ResponseCache::ENTRIES + 1];
+
+        for (size_t i = 0; i < ResponseCache::ENTRIES; i++) {
+            get(cache, handlers[i]);
+        }
+        // The first one was used last, so the second one goes
+        get(cache, handlers[0]);
+        get(cache, handlers[ResponseCache::ENTRIES]);
+        assert(cache.getStats().evictions == 1);
+
+        get(cache, handlers[0]);
+        get(cache, handlers[1]);
+        assert(handlers[0].calls == 1);
+        assert(handlers[1].calls == 2);
+        return 0;
+    }
+
+    // Builds the same JSON as DataReaderGetHandler, from a full meter reading
+    class ReadingHandler : public EndpointFunction {
+        public:
+            P1Data reading;
+            uint32_t version = 1;
+
+            ReadingHandler() {
+                for (int i = 0; i < 30; i++) {
+                    reading.addObisString(1, i + 1, 1234.567f + i, "kWh");
+                }
+                reading.timestamp = 1718000000000ULL;
+            }
+
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.contentType = "application/json";
+                JsonBuilder json;
+                json.beginObject()
+                    .add("status", "success")
+                    .add("ts", reading.timestamp)
+                    .addArray("data", (const char*)reading.obisStrings, reading.obisStringCount, P1Data::MAX_OBIS_STRING_LEN);
+                response.data = json.end();
+                response.statusCode = 200;
+                return response;
+            }
+
+            bool getCacheVersion(uint32_t& out) override {
+                out = version;
+                return true;
+            }
+    };
+
+    int test_benchmark() {
+        // A dashboard polls several times per meter reading
+        ResponseCache cache;
+        ReadingHandler handler;
+        const Endpoint endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, "/api/data/p1/obis", handler);
+        const int polls = 20000;
+        const int pollsPerReading = 10;
+
+        RecordingWriter writer;
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < polls; n++) {
+            EndpointRequest request(endpoint);
+            handler.stream(request.content, writer);
+            bytes += writer.body.size();
+        }
+        const double uncachedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / polls;
+
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < polls; n++) {
+            handler.version = n / pollsPerReading;
+            EndpointRequest request(endpoint);
+            assert(cache.serve(request, writer));
+            bytes -= writer.body.size();
+        }
+        const double cachedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / polls;
+        assert(bytes == 0);
+        const int hitPercent = cache.getHitPercent();
+
+        const std::string etag = writer.etag;
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < polls; n++) {
+            EndpointRequest request(endpoint);
+            request.ifNoneMatch = etag.c_str();
+            assert(cache.serve(request, writer) && writer.status == 304);
+        }
+        const double notModifiedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / polls;
+
+        printf("Polling a %zu byte reading %d times per version: uncached %.0f ns, cached %.0f ns (%d%% hits), 304 %.0f ns\n",
+               handler.handle(zap::Str()).data.length(), pollsPerReading, uncachedNs, cachedNs, hitPercent, notModifiedNs);
+        assert(hitPercent == 90);
+        assert(cachedNs < uncachedNs);
+        return 0;
+    }
+
+    int run() {
+        test_versions();
+        test_not_modified();
+        test_not_cached();
+        test_least_recently_used();
+        test_benchmark();
+        return 0;
+    }
+}
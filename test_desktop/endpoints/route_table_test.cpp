@@ -0,0 +1,164 @@
+#include <assert.h>
+#include <chrono>
+#include <string.h>
+
+#include "../src/endpoints/route_table.h"
+
+namespace route_table_test {
+
+    class NullHandler : public EndpointFunction {
+        public:
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.statusCode = 200;
+                response.data = contents;
+                return response;
+            }
+    };
+
+    static NullHandler handler;
+
+    // Same paths and verbs as the firmware table in endpoint_mapper.cpp
+    static constexpr Endpoint endpoints[] = {
+        Endpoint(Endpoint::WIFI_CONFIG, Endpoint::Verb::POST, "/api/wifi", handler),
+        Endpoint(Endpoint::SYSTEM_INFO, Endpoint::Verb::GET, "/api/system", handler),
+        Endpoint(Endpoint::SYSTEM_INFO, Endpoint::Verb::POST, "/api/system/reboot", handler),
+        Endpoint(Endpoint::WIFI_RESET, Endpoint::Verb::DELETE, "/api/wifi", handler),
+        Endpoint(Endpoint::CRYPTO_INFO, Endpoint::Verb::GET, "/api/crypto", handler),
+        Endpoint(Endpoint::NAME_INFO, Endpoint::Verb::GET, "/api/name", handler),
+        Endpoint(Endpoint::WIFI_STATUS, Endpoint::Verb::GET, "/api/wifi", handler),
+        Endpoint(Endpoint::WIFI_SCAN, Endpoint::Verb::GET, "/api/wifi/scan", handler),
+        Endpoint(Endpoint::DEBUG, Endpoint::Verb::GET, "/api/debug", handler),
+        Endpoint(Endpoint::METRICS, Endpoint::Verb::GET, "/metrics", handler),
+        Endpoint(Endpoint::BLE_STOP, Endpoint::Verb::POST, "/api/ble/stop", handler),
+        Endpoint(Endpoint::CRYPTO_SIGN, Endpoint::Verb::POST, "/api/crypto/sign", handler),
+        Endpoint(Endpoint::ECHO, Endpoint::Verb::POST, "/api/echo", handler),
+        Endpoint(Endpoint::OTA_UPDATE, Endpoint::Verb::POST, "/api/ota/update", handler),
+        Endpoint(Endpoint::OTA_STATUS, Endpoint::Verb::GET, "/api/ota/status", handler),
+        Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, "/api/data/p1/obis", handler),
+        Endpoint(Endpoint::P1_STREAM, Endpoint::Verb::GET, "/api/data/p1/stream", handler)
+    };
+    ROUTE_TABLE_CHECKS(endpoints);
+    static constexpr route_table::RouteTable<sizeof(endpoints) / sizeof(endpoints[0])> table = route_table::build(endpoints);
+
+    static constexpr Endpoint prefixed[] = {
+        Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, "/api/data/*", handler),
+        Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, "/api/data/p1/obis", handler),
+        Endpoint(Endpoint::P1_DATA, Endpoint::Verb::GET, "/api/data/p1/*", handler),
+        Endpoint(Endpoint::P1_DATA, Endpoint::Verb::DELETE, "/api/data/*", handler),
+        Endpoint(Endpoint::ECHO, Endpoint::Verb::POST, "/api/echo", handler)
+    };
+    ROUTE_TABLE_CHECKS(prefixed);
+    static constexpr route_table::RouteTable<sizeof(prefixed) / sizeof(prefixed[0])> prefixTable = route_table::build(prefixed);
+
+    static constexpr Endpoint duplicated[] = {
+        Endpoint(Endpoint::WIFI_STATUS, Endpoint::Verb::GET, "/api/wifi", handler),
+        Endpoint(Endpoint::WIFI_CONFIG, Endpoint::Verb::POST, "/api/wifi", handler),
+        Endpoint(Endpoint::WIFI_SCAN, Endpoint::Verb::GET, "/api/wifi", handler)
+    };
+
+    // What ROUTE_TABLE_CHECKS rejects, it cannot be asserted on without failing this build
+    static_assert(route_table::hasDuplicates(duplicated), "same path and verb twice is a duplicate");
+    static_assert(!route_table::hasDuplicates(endpoints), "same path with another verb is not a duplicate");
+    static_assert(route_table::isPrefix("/api/data/*"), "trailing /* is a prefix route");
+    static_assert(!route_table::isPrefix("/api/data*") && !route_table::isPrefix("/api/*/x"), "only a trailing /* is");
+
+    template <size_t N>
+    static int find(const route_table::RouteTable<N>& routes, Endpoint::Verb verb, const char* path) {
+        return routes.find(verb, path, strlen(path));
+    }
+
+    int test_exact_paths() {
+        for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); i++) {
+            assert(find(table, endpoints[i].verb, endpoints[i].path) == (int)i);
+        }
+
+        // One path, three verbs
+        assert(find(table, Endpoint::Verb::GET, "/api/wifi") == 6);
+        assert(find(table, Endpoint::Verb::POST, "/api/wifi") == 0);
+        assert(find(table, Endpoint::Verb::DELETE, "/api/wifi") == 3);
+
+        assert(find(table, Endpoint::Verb::DELETE, "/api/system") == -1);
+        assert(find(table, Endpoint::Verb::UNKNOWN, "/api/system") == -1);
+        assert(find(table, Endpoint::Verb::GET, "/api/wif") == -1);
+        assert(find(table, Endpoint::Verb::GET, "/api/wifi/") == -1);
+        assert(find(table, Endpoint::Verb::GET, "/api/wifi/scan/x") == -1);
+        assert(find(table, Endpoint::Verb::GET, "") == -1);
+        assert(find(table, Endpoint::Verb::GET, "/") == -1);
+
+        // The path does not have to be NUL terminated
+        const char* request = "/api/wifi/scan HTTP/1.1";
+        assert(table.find(Endpoint::Verb::GET, request, 9) == 6);
+        assert(table.find(Endpoint::Verb::GET, request, 14) == 7);
+        return 0;
+    }
+
+    int test_prefix_paths() {
+        assert(!table.hasPrefixes);
+        assert(prefixTable.hasPrefixes);
+
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/p1/obis") == 1);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/p1/raw") == 2);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/p1/") == 2);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/p1/obis/1.8.0") == 2);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/p1") == 0);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data/ams/raw") == 0);
+        assert(find(prefixTable, Endpoint::Verb::DELETE, "/api/data/p1/obis") == 3);
+        assert(find(prefixTable, Endpoint::Verb::POST, "/api/data/p1") == -1);
+
+        // The prefix takes everything below it, not the path itself
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/data") == -1);
+        assert(find(prefixTable, Endpoint::Verb::GET, "/api/database") == -1);
+        assert(find(prefixTable, Endpoint::Verb::POST, "/api/echo") == 4);
+        assert(find(prefixTable, Endpoint::Verb::POST, "/api/echo/x") == -1);
+        return 0;
+    }
+
+    int test_benchmark() {
+        // Linear compare over the table, as EndpointMapper::toEndpoint did before
+        const size_t count = sizeof(endpoints) / sizeof(endpoints[0]);
+        const char* requests[] = {"/api/wifi", "/api/data/p1/obis", "/api/ota/status", "/api/crypto/sign", "/api/unknown"};
+        const Endpoint::Verb verbs[] = {Endpoint::Verb::GET, Endpoint::Verb::GET, Endpoint::Verb::GET, Endpoint::Verb::POST, Endpoint::Verb::GET};
+        const int iterations = 200000;
+        const zap::Str paths[] = {zap::Str(requests[0]), zap::Str(requests[1]), zap::Str(requests[2]), zap::Str(requests[3]), zap::Str(requests[4])};
+
+        int found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++) {
+            for (size_t r = 0; r < 5; r++) {
+                const zap::Str& path = paths[r];
+                for (size_t i = 0; i < count; i++) {
+                    if (path == endpoints[i].path && endpoints[i].verb == verbs[r]) {
+                        found += (int)i;
+                        break;
+                    }
+                }
+            }
+        }
+        const double linearNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (iterations * 5.0);
+
+        int hashed = 0;
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; n++) {
+            for (size_t r = 0; r < 5; r++) {
+                const zap::Str& path = paths[r];
+                const int index = table.find(verbs[r], path.c_str(), path.length());
+                if (index >= 0) {
+                    hashed += index;
+                }
+            }
+        }
+        const double tableNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (iterations * 5.0);
+
+        assert(found == hashed);
+        printf("Routing %zu endpoints: linear %.1f ns, route table %.1f ns per lookup\n", count, linearNs, tableNs);
+        return 0;
+    }
+
+    int run() {
+        test_exact_paths();
+        test_prefix_paths();
+        test_benchmark();
+        return 0;
+    }
+}
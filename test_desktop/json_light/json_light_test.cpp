@@ -1,6 +1,9 @@
 #include "../src/json_light/json_light.h"
+#include "../src/data/p1data_funcs.h"
+#include "../allocation_counter.h"
 
 #include <assert.h>
+#include <chrono>
 
 namespace json_light_test {
 
@@ -148,6 +151,227 @@ namespace json_light_test {
         return 0;
     }
 
+    struct ChunkCollector {
+        zap::Str output;
+        size_t writes = 0;
+        size_t largestWrite = 0;
+
+        void write(const char* data, size_t length) {
+            output.append(data, length);
+            writes++;
+            largestWrite = length > largestWrite ? length : largestWrite;
+        }
+    };
+
+    int test_chunked_builder() {
+        // The same document through the dynamic and the chunked buffer
+        std::vector<zap::Str> arr;
+        arr.push_back(zap::Str("item1"));
+        arr.push_back(zap::Str("it\"em2"));
+        uint8_t data[40];
+        for (size_t i = 0; i < sizeof(data); i++) {
+            data[i] = (uint8_t)(i * 7);
+        }
+
+        JsonBuilder reference;
+        ChunkCollector collector;
+        zap::GenericJsonBuilder<zap::JsonBuilderChunkedBuffer<ChunkCollector, 16>> chunked(collector);
+
+        reference.beginObject().add("key", "value").add("number", 42).add("big", (uint64_t)1234567890123ULL)
+            .beginObject("nested").add("boolean", true).endObject()
+            .addArray("array", arr).add("hex", data, sizeof(data))
+            .addHex("odd", 3, [](size_t i) { return (uint8_t)(i * 2 + 1); });
+        chunked.beginObject().add("key", "value").add("number", 42).add("big", (uint64_t)1234567890123ULL)
+            .beginObject("nested").add("boolean", true).endObject()
+            .addArray("array", arr).add("hex", data, sizeof(data))
+            .addHex("odd", 3, [](size_t i) { return (uint8_t)(i * 2 + 1); });
+
+        const zap::Str expected = reference.end();
+        assert(collector.writes > 0);
+        assert(chunked.end() == expected.length());
+        assert(chunked.length() == expected.length());
+        assert(collector.output == expected);
+        assert(expected.indexOf("\"odd\":\"010305\"") != -1);
+
+        // Nothing is written in pieces larger than the chunk
+        assert(collector.largestWrite == 16);
+        assert(collector.writes == (expected.length() + 15) / 16);
+
+        // Ending again does not write the last chunk twice
+        assert(chunked.end() == expected.length());
+        assert(collector.output == expected);
+        return 0;
+    }
+
+    int test_number_format() {
+        // The kernels give what printf gives
+        char text[zap::JsonNumberFormat::MAX_LENGTH + 1];
+        char expected[32];
+        const int ints[] = {0, 7, -7, 42, 100, -100000, 2147483647, (int)-2147483647 - 1};
+        for (int value : ints) {
+            text[zap::JsonNumberFormat::format(value, text)] = '\0';
+            snprintf(expected, sizeof(expected), "%d", value);
+            assert(strcmp(text, expected) == 0);
+        }
+        const uint64_t longs[] = {0, 9, 10, 4294967295ULL, 1746111306022ULL, 18446744073709551615ULL};
+        for (uint64_t value : longs) {
+            text[zap::JsonNumberFormat::format(value, text)] = '\0';
+            snprintf(expected, sizeof(expected), "%llu", (unsigned long long)value);
+            assert(strcmp(text, expected) == 0);
+        }
+
+        const float floats[] = {0.0f, -0.0f, 1.0f, -1.5f, 0.1f, 1234.567f, 999999.0f, 999999.5f, 1e6f, 0.0001f,
+                                0.00009999f, 0.000123456f, 123456.5f, 2.5f, 1e-10f, 3.4e38f, 1.0f / 0.0f, 231.0f, 2.167f};
+        auto same = [&](float value) {
+            text[zap::JsonNumberFormat::format(value, text)] = '\0';
+            snprintf(expected, sizeof(expected), "%g", value);
+            if (strcmp(text, expected) != 0) {
+                printf("%.9g formatted as %s, printf gives %s\n", value, text, expected);
+            }
+            assert(strcmp(text, expected) == 0);
+        };
+        for (float value : floats) {
+            same(value);
+        }
+        // Every exponent and many mantissas, including the halfway cases
+        uint32_t bits = 12345;
+        for (int n = 0; n < 2000000; n++) {
+            bits = bits * 1664525u + 1013904223u;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            if (value == value) {
+                same(value);
+            }
+            same((float)(bits % 2000000) / 8.0f);
+            same((float)(bits % 10000000) / 1000.0f);
+        }
+        return 0;
+    }
+
+    int test_builder_escaping() {
+        char buffer[128];
+        JsonBuilderFixed fixed(buffer, sizeof(buffer));
+        fixed.beginObject().add("text", "plain \"quoted\" back\\slash\ttab\nline\x01\x1f end").add("v", 2.5f);
+        fixed.end();
+        assert(strcmp(buffer, "{\"text\":\"plain \\\"quoted\\\" back\\\\slash\\ttab\\nline\\u0001\\u001f end\",\"v\":2.5}") == 0);
+
+        JsonBuilder dynamic;
+        dynamic.beginObject().add("text", "plain \"quoted\" back\\slash\ttab\nline\x01\x1f end").add("v", 2.5f);
+        assert(dynamic.end() == buffer);
+
+        // Deep nesting is closed by end() without a heap allocated stack
+        char deepBuffer[256];
+        allocation_counter::begin();
+        JsonBuilderFixed deep(deepBuffer, sizeof(deepBuffer));
+        deep.beginObject();
+        for (int i = 0; i < 40; i++) {
+            deep.beginObject("a");
+        }
+        deep.add("x", 1);
+        deep.end();
+        assert(allocation_counter::end() == 0);
+        assert(!deep.hasOverflow());
+        assert(deep.length() == 1 + 40 * 5 + 5 + 41);
+        assert(strcmp(deepBuffer + deep.length() - 42, "1}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}") == 0);
+        return 0;
+    }
+
+    // What StateHandler::sendStateUpdate sends
+    template <typename Builder>
+    static void buildStatePayload(Builder& builder, const std::vector<zap::Str>& ssids) {
+        builder.beginObject()
+            .beginObject("status")
+                .add("uptime", (uint32_t)123456789)
+                .add("version", "1.2.3")
+            .endObject()
+            .beginObject("network")
+                .beginObject("wifi")
+                    .add("connected", "home-network")
+                    .addArray("ssids", ssids)
+                .endObject()
+                .beginObject("address")
+                    .add("ip", "192.168.1.123")
+                    .add("port", 80)
+                    .add("wlan0_mac", "aa:bb:cc:dd:ee:ff")
+                    .beginObject("interfaces")
+                        .add("wlan0", "192.168.1.123")
+                    .endObject()
+                .endObject()
+            .endObject()
+            .add("timestamp", (uint64_t)1746111306022ULL);
+    }
+
+    int test_builder_benchmark() {
+        P1Data reading;
+        for (int i = 0; i < 30; i++) {
+            reading.addObisString(1, i + 1, 1234.567f + i, "kWh");
+        }
+        reading.timestamp = 1746111306022ULL;
+        std::vector<zap::Str> ssids;
+        for (int i = 0; i < 8; i++) {
+            ssids.push_back(zap::Str("neighbour-wifi-") + zap::Str(i));
+        }
+
+        const int runs = 20000;
+        char payload[4096];
+        size_t payloadBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < runs; n++) {
+            assert(!createP1JWTPayload(reading, payload, sizeof(payload)));
+            payloadBytes = strlen(payload);
+        }
+        const double payloadNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / runs;
+        allocation_counter::begin();
+        createP1JWTPayload(reading, payload, sizeof(payload));
+        assert(allocation_counter::end() == 0);
+        const char prefix[] = "{\"1746111306022\":{\"serial_number\":\"";
+        assert(strncmp(payload, prefix, sizeof(prefix) - 1) == 0);
+        assert(strstr(payload, "\"rows\":[\"1-0:1.1.0(") != nullptr);
+        assert(strcmp(payload + payloadBytes - 21, "],\"checksum\":\"DEAD\"}}") == 0);
+
+        size_t stateBytes = 0;
+        size_t stateAllocations = 0;
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < runs; n++) {
+            allocation_counter::begin();
+            JsonBuilder builder;
+            buildStatePayload(builder, ssids);
+            stateBytes = builder.end().length();
+            stateAllocations = allocation_counter::end();
+        }
+        const double stateNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / runs;
+
+        // The same into a fixed buffer does not touch the heap at all
+        allocation_counter::begin();
+        JsonBuilderFixed fixed(payload, sizeof(payload));
+        buildStatePayload(fixed, ssids);
+        fixed.end();
+        assert(allocation_counter::end() == 0);
+        assert(fixed.length() == stateBytes);
+
+        // Readings are floats, the kernel against printf
+        const float values[] = {1234.567f, 0.231f, 50.01f, 231.4f, 2.167f, 17.5f, 0.0015f, 99999.9f};
+        const int numbers = 1000000;
+        volatile size_t sink = 0;
+        char text[zap::JsonNumberFormat::MAX_LENGTH];
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < numbers; n++) {
+            sink += zap::JsonNumberFormat::format(values[n & 7], text);
+        }
+        const double kernelNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numbers;
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < numbers; n++) {
+            sink += snprintf(text, sizeof(text), "%g", values[n & 7]);
+        }
+        const double printfNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numbers;
+
+        printf("JsonBuilder: P1 JWT payload %zu bytes in %.0f ns (%.0f MB/s), state payload %zu bytes in %.0f ns with %zu allocations, "
+               "float %.0f ns against %.0f ns with printf\n",
+               payloadBytes, payloadNs, payloadBytes * 1e3 / payloadNs, stateBytes, stateNs, stateAllocations, kernelNs, printfNs);
+        assert(kernelNs < printfNs);
+        return 0;
+    }
+
     int test_fixed_builder_buffer_overflow() {
         // Test JSON light building
         char buffer[16];
@@ -287,18 +511,231 @@ namespace json_light_test {
         return 0;
     }
 
+    static const char* WEBSOCKET_DATA = "{\"type\":\"data\",\"id\":\"1\",\"payload\":{\"data\":{\"configurationDataChanges\":{\"data\":\"{\\u0022id\\u0022: \\u0022njnMiKW6PmcVxxZOp-ErA\\u0022, \\u0022body\\u0022: \\u0022Wabisabi\\u0022, \\u0022path\\u0022: \\u0022/api/echo\\u0022, \\u0022query\\u0022: \\u0022{}\\u0022, \\u0022method\\u0022: \\u0022POST\\u0022, \\u0022headers\\u0022: \\u0022{}\\u0022, \\u0022timestamp\\u0022: 1745506313254}\",\"subKey\":\"request\"}}}}";
+    static const char* REQUEST_DATA = "{\"id\": \"some-id\", \"body\": {\"psk\": \"bamse-zorba\", \"ssid\": \"eather\"}, \"path\": \"/api/wifi\", \"query\": \"{}\", \"method\": \"POST\", \"headers\": \"{}\", \"timestamp\": 1746111306022}";
+
+    int test_json_parser_tape() {
+        JsonTapeEntry tape[32];
+        JsonParser parser(REQUEST_DATA);
+        const size_t entries = parser.index(tape, 32);
+        // The request, seven members and the two in the body
+        assert(entries == 10);
+        assert(parser.isIndexed());
+        assert(tape[0].next == 10 && tape[0].keyStart == 0);
+        assert(tape[2].keyLength == 4 && strncmp(REQUEST_DATA + tape[2].keyStart, "body", 4) == 0);
+        assert(tape[2].next == 5);
+        assert(REQUEST_DATA[tape[2].valueStart] == '{' && REQUEST_DATA[tape[2].valueEnd - 1] == '}');
+
+        zap::Str id; assert(parser.getString("id", id) && id == "some-id");
+        zap::Str path; assert(parser.getString("path", path) && path == "/api/wifi");
+        zap::Str method; assert(parser.getString("method", method) && method == "POST");
+        uint64_t timestamp; assert(parser.getUInt64("timestamp", timestamp) && timestamp == 1746111306022);
+        assert(!parser.contains("psk"));
+        assert(!parser.contains("i"));
+
+        JsonParser body("");
+        assert(parser.getObject("body", body));
+        assert(body.isIndexed());
+        zap::Str body_string; body.asString(body_string);
+        assert(body_string == "{\"psk\": \"bamse-zorba\", \"ssid\": \"eather\"}");
+        zap::Str ssid; assert(body.getString("ssid", ssid) && ssid == "eather");
+        assert(parser.getStringByPath("body.psk", ssid) && ssid == "bamse-zorba");
+        assert(!parser.getObject("path", body));
+
+        // Same answers as scanning for the subscription message
+        JsonParser message(WEBSOCKET_DATA);
+        assert(message.index(tape, 32) == 8);
+        zap::Str type; assert(message.getString("type", type) && type == "data");
+        JsonParser changes("");
+        assert(message.getObjectByPath("payload.data.configurationDataChanges", changes));
+        zap::Str subKey; assert(changes.getString("subKey", subKey) && subKey == "request");
+        zap::Str data; assert(changes.getString("data", data));
+        zap::Str scanned; assert(JsonParser(WEBSOCKET_DATA).getStringByPath("payload.data.configurationDataChanges.data", scanned));
+        assert(data == scanned);
+        assert(!message.isFieldNullByPath("payload.data.configurationDataChanges.subKey"));
+
+        // Braces in strings and empty containers do not confuse the tape
+        const char* tricky = "{\"a\": \"}{\\\"\", \"b\": {}, \"c\": [1, [], {\"d\": null}], \"e\": {\"f\": true}}";
+        JsonParser trickyParser(tricky);
+        assert(trickyParser.index(tape, 32) == 10);
+        bool f; assert(trickyParser.getBoolByPath("e.f", f) && f);
+        assert(trickyParser.getObject("b", body) && body.isIndexed() && !body.contains("a"));
+        return 0;
+    }
+
+    int test_json_parser_tape_fallback() {
+        JsonTapeEntry tape[8];
+        JsonParser parser(REQUEST_DATA);
+        // Not enough entries, the parser keeps scanning
+        assert(parser.index(tape, 8) == 0);
+        assert(!parser.isIndexed());
+        zap::Str path; assert(parser.getString("path", path) && path == "/api/wifi");
+
+        const char* broken[] = {"", "{", "{\"a\" 1}", "{\"a\": 1", "{\"a\": [1}", "{\"a\": \"x}", "{1: 2}", "[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]"};
+        for (const char* json : broken) {
+            JsonParser brokenParser(json);
+            assert(brokenParser.index(tape, 8) == 0);
+        }
+        JsonParser nested("[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]");
+        assert(nested.index(tape, 8) == 0);
+        JsonTapeEntry deep[32];
+        assert(nested.index(deep, 32) == 17);
+        return 0;
+    }
+
+    int test_json_parser_string_view() {
+        JsonParser parser(WEBSOCKET_DATA);
+        JsonStringView type;
+        assert(parser.getStringView("type", type));
+        assert(type.length == 4 && !type.hasEscapes && type.equals("data"));
+        assert(!type.equals("dat") && !type.equals("datas"));
+        assert(type.data > WEBSOCKET_DATA && type.data < WEBSOCKET_DATA + strlen(WEBSOCKET_DATA));
+        assert(!parser.getStringView("payload", type));
+        assert(!parser.getStringView("missing", type));
+
+        JsonStringView data;
+        assert(parser.getStringViewByPath("payload.data.configurationDataChanges.data", data));
+        assert(data.hasEscapes);
+        zap::Str copied;
+        assert(parser.getStringByPath("payload.data.configurationDataChanges.data", copied));
+        zap::Str viewed;
+        data.copyTo(viewed);
+        assert(viewed == copied);
+        char small[8];
+        assert(!data.copyTo(small, sizeof(small)));
+        assert(strcmp(small, "{\"id\": ") == 0);
+
+        // Escapes are compared by what they stand for
+        JsonParser escaped("{\"a\": \"\\u0022q\\u0022 \\\\ \\/ \\u00e5\\n\"}");
+        JsonStringView a;
+        assert(escaped.getStringView("a", a));
+        assert(a.equals("\"q\" \\ / \xc3\xa5\n"));
+        assert(!a.equals("\"q\" \\ / \xc3\xa5"));
+        char out[32];
+        assert(a.copyTo(out, sizeof(out)) && strcmp(out, "\"q\" \\ / \xc3\xa5\n") == 0);
+
+        // Only a parser over a writable buffer rewrites it
+        assert(parser.unescapeInPlace(data) == nullptr);
+        return 0;
+    }
+
+    int test_json_parser_unescape_in_place() {
+        char buffer[1024];
+        strcpy(buffer, WEBSOCKET_DATA);
+        JsonParser message(buffer, strlen(buffer));
+        JsonParser changes("");
+        assert(message.getObjectByPath("payload.data.configurationDataChanges", changes));
+        JsonStringView subKey;
+        assert(changes.getStringView("subKey", subKey) && subKey.equals("request"));
+        JsonStringView data;
+        assert(changes.getStringView("data", data));
+
+        // What handleMessage and handleRequestTask do, without a single allocation
+        allocation_counter::begin();
+        char* request = changes.unescapeInPlace(data);
+        JsonParser requestDoc(request, strlen(request));
+        JsonStringView id, path, method, body;
+        assert(requestDoc.getStringView("id", id) && id.equals("njnMiKW6PmcVxxZOp-ErA"));
+        assert(requestDoc.getStringView("path", path) && path.equals("/api/echo"));
+        assert(requestDoc.getStringView("method", method) && method.equals("POST"));
+        assert(requestDoc.getStringView("body", body) && body.equals("Wabisabi"));
+        const size_t inPlace = allocation_counter::end();
+
+        // The same with copies
+        allocation_counter::begin();
+        JsonParser copiedMessage(WEBSOCKET_DATA);
+        zap::Str copied;
+        assert(copiedMessage.getStringByPath("payload.data.configurationDataChanges.data", copied));
+        JsonParser copiedDoc(copied.c_str());
+        zap::Str copiedId, copiedPath, copiedMethod, copiedBody;
+        copiedDoc.getString("id", copiedId);
+        copiedDoc.getString("path", copiedPath);
+        copiedDoc.getString("method", copiedMethod);
+        copiedDoc.getString("body", copiedBody);
+        const size_t copies = allocation_counter::end();
+
+        printf("Request in a subscription message: %zu allocations unescaped in place, %zu copied\n", inPlace, copies);
+        assert(inPlace == 0);
+        assert(copies > 4);
+        assert(copiedPath == "/api/echo");
+        assert(strncmp(request, "{\"id\": \"njnMiKW6PmcVxxZOp-ErA\"", 30) == 0);
+        assert(strlen(request) == copied.length());
+        return 0;
+    }
+
+    template <typename Lookups>
+    static double nsPerRun(const char* json, JsonTapeEntry* tape, size_t capacity, Lookups lookups) {
+        const int runs = 20000;
+        const auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < runs; n++) {
+            JsonParser parser(json);
+            if (tape != nullptr) {
+                parser.index(tape, capacity);
+            }
+            lookups(parser);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / runs;
+    }
+
+    int test_json_parser_tape_benchmark() {
+        // What GraphQLSubscriptionClient::handleMessage and RequestHandler::handleRequest look up
+        auto message = [](JsonParser& doc) {
+            zap::Str type; doc.getString("type", type);
+            zap::Str id; doc.getString("id", id);
+            JsonParser changes("");
+            doc.getObjectByPath("payload.data.configurationDataChanges", changes);
+            zap::Str subKey; changes.getString("subKey", subKey);
+            zap::Str data; changes.getString("data", data);
+            assert(subKey == "request");
+        };
+        auto request = [](JsonParser& doc) {
+            assert(doc.contains("id") && doc.contains("path") && doc.contains("method"));
+            zap::Str id; doc.getString("id", id);
+            zap::Str path; doc.getString("path", path);
+            zap::Str method; doc.getString("method", method);
+            zap::Str query; doc.getString("query", query);
+            zap::Str headers; doc.getString("headers", headers);
+            uint64_t timestamp; doc.getUInt64("timestamp", timestamp);
+            zap::Str body;
+            if (!doc.getString("body", body)) {
+                JsonParser bodyDoc("");
+                doc.getObject("body", bodyDoc);
+            }
+            assert(timestamp == 1746111306022);
+        };
+
+        JsonTapeEntry tape[48];
+        const double messageScan = nsPerRun(WEBSOCKET_DATA, nullptr, 0, message);
+        const double messageTape = nsPerRun(WEBSOCKET_DATA, tape, 48, message);
+        const double requestScan = nsPerRun(REQUEST_DATA, nullptr, 0, request);
+        const double requestTape = nsPerRun(REQUEST_DATA, tape, 48, request);
+        printf("JsonParser lookups: subscription message scanned %.0f ns, indexed %.0f ns; request scanned %.0f ns, indexed %.0f ns\n",
+               messageScan, messageTape, requestScan, requestTape);
+        assert(requestTape < requestScan);
+        return 0;
+    }
+
     int run() {
         test_json_parser();
         test_json_parser_asString();
         test_json_parser_value_with_curly_brace();
         test_json_builder();
         test_fixed_builder();
+        test_chunked_builder();
         test_fixed_builder_buffer_overflow();
+        test_number_format();
+        test_builder_escaping();
+        test_builder_benchmark();
         test_json_parser_sub_object();
         test_json_parser_sub_sub_object();
         test_json_parser_request();
         test_json_parser_get_object_by_path();
         test_json_parser_test_websocket_data();
+        test_json_parser_tape();
+        test_json_parser_tape_fallback();
+        test_json_parser_tape_benchmark();
+        test_json_parser_string_view();
+        test_json_parser_unescape_in_place();
         // test_json_parser_test_websocket_ota_request();
         return 0;
     }
@@ -0,0 +1,348 @@
+#include "../src/json_light/json_pull_parser.h"
+#include "../src/json_light/json_light.h"
+#include "../allocation_counter.h"
+
+#include <assert.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace json_pull_parser_test {
+
+    static const char* EVENT_NAMES[] = {"NEED_MORE", "BEGIN_OBJECT", "END_OBJECT", "BEGIN_ARRAY", "END_ARRAY",
+                                        "STRING", "NUMBER", "LITERAL", "END", "ERROR"};
+
+    // Events of a document fed in pieces of the given sizes, one line each, ERROR ends it
+    static std::vector<std::string> events(const std::string& json, const std::vector<size_t>& pieces,
+                                           size_t tokenCapacity = 256) {
+        std::vector<char> token(tokenCapacity);
+        char path[128];
+        JsonPullParser parser(token.data(), token.size(), path, sizeof(path));
+        std::vector<std::string> result;
+
+        size_t offset = 0;
+        size_t piece = 0;
+        for (;;) {
+            const JsonPullParser::Event event = parser.next();
+            // A complete document may still be followed by whitespace
+            const bool more = event == JsonPullParser::Event::NEED_MORE ||
+                              (event == JsonPullParser::Event::END && offset < json.size());
+            if (more) {
+                if (offset == json.size()) {
+                    parser.finish();
+                    continue;
+                }
+                // Every piece is a copy, nothing may be read from a chunk once it is used up
+                const size_t size = std::min(pieces[piece++ % pieces.size()], json.size() - offset);
+                static std::string chunk;
+                chunk.assign(json, offset, size);
+                parser.feed(chunk.data(), chunk.size());
+                offset += size;
+                continue;
+            }
+            std::string line = EVENT_NAMES[(int)event];
+            line += " ";
+            line += parser.getPath();
+            if (event == JsonPullParser::Event::STRING || event == JsonPullParser::Event::NUMBER ||
+                event == JsonPullParser::Event::LITERAL) {
+                line += "=";
+                line.append(parser.getValue(), parser.getValueLength());
+                line += parser.isTruncated() ? "..." : "";
+            }
+            result.push_back(line);
+            if (event == JsonPullParser::Event::ERROR || event == JsonPullParser::Event::END) {
+                return result;
+            }
+        }
+    }
+
+    static std::vector<std::string> events(const std::string& json) {
+        return events(json, std::vector<size_t>(1, json.size() + 1));
+    }
+
+    static const char* OTA_RESPONSE = "{\"id\":\"fw-1\",\"version\":\"0.19.2\",\"released\":true,\"notes\":null,"
+        "\"binary\":{\"downloadUrl\":\"https://example.com/firmware\\/zap-0.19.2.bin?sig=a%2Fb\",\"size\":1048576,"
+        "\"hash\":\"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855\"},\"tags\":[\"stable\",\"c3\"]}";
+
+    int test_events() {
+        const std::vector<std::string> expected = {
+            "BEGIN_OBJECT ",
+            "STRING id=fw-1",
+            "STRING version=0.19.2",
+            "LITERAL released=true",
+            "LITERAL notes=null",
+            "BEGIN_OBJECT binary",
+            "STRING binary.downloadUrl=https://example.com/firmware/zap-0.19.2.bin?sig=a%2Fb",
+            "NUMBER binary.size=1048576",
+            "STRING binary.hash=e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            "END_OBJECT binary",
+            "BEGIN_ARRAY tags",
+            "STRING tags[0]=stable",
+            "STRING tags[1]=c3",
+            "END_ARRAY tags",
+            "END_OBJECT ",
+            "END "
+        };
+        assert(events(OTA_RESPONSE) == expected);
+
+        const std::vector<std::string> nested = {
+            "BEGIN_ARRAY ", "NUMBER [0]=-1.5e3", "BEGIN_OBJECT [1]", "BEGIN_ARRAY [1].a", "END_ARRAY [1].a",
+            "BEGIN_OBJECT [1].o", "END_OBJECT [1].o", "BEGIN_ARRAY [1].m", "BEGIN_ARRAY [1].m[0]", "NUMBER [1].m[0][0]=0",
+            "END_ARRAY [1].m[0]", "END_ARRAY [1].m", "END_OBJECT [1]", "STRING [2]=", "END_ARRAY ", "END "
+        };
+        assert(events(" [ -1.5e3 , {\"a\": [], \"o\" : {}, \"m\":[[0]]}, \"\"]\n") == nested);
+
+        // A number at the top level ends with the input
+        const std::vector<std::string> number = {"NUMBER =42", "END "};
+        assert(events("42") == number);
+        return 0;
+    }
+
+    int test_escapes() {
+        // Strings come out as JsonParser gives them
+        const char* json = "{\"a\\\"b\":\"q\\\"s\\\\b\\/t\\tn\\n\\u0041\\u00e9\\u20ac\",\"k\\u0065y\":\"v\"}";
+        std::vector<std::string> result = events(json);
+        assert(result[1] == "STRING a\"b=q\"s\\b/t\tn\nA\xc3\xa9\xe2\x82\xac");
+        assert(result[2] == "STRING key=v");
+
+        // The nested request of a subscription message is the same text JsonParser reads
+        JsonParser ws(json_light_test::WEBSOCKET_DATA);
+        zap::Str data;
+        assert(ws.getStringByPath("payload.data.configurationDataChanges.data", data));
+        result = events(json_light_test::WEBSOCKET_DATA);
+        assert(result[6] == std::string("STRING payload.data.configurationDataChanges.data=") + data.c_str());
+        return 0;
+    }
+
+    int test_extract() {
+        char type[8];
+        char id[12];
+        char subKey[16];
+        char data[512];
+        char missing[8];
+        JsonPathField fields[] = {
+            JsonPathField("type", type, sizeof(type)),
+            JsonPathField("id", id, sizeof(id)),
+            JsonPathField("payload.data.configurationDataChanges.subKey", subKey, sizeof(subKey)),
+            JsonPathField("payload.data.configurationDataChanges.data", data, sizeof(data)),
+            JsonPathField("payload.data", missing, sizeof(missing))
+        };
+
+        // 40 bytes at a time with a token buffer just large enough for the nested request
+        char token[200];
+        char path[64];
+        JsonPullParser parser(token, sizeof(token), path, sizeof(path));
+        const char* message = json_light_test::WEBSOCKET_DATA;
+        const size_t length = strlen(message);
+        for (size_t offset = 0; offset < length; offset += 40) {
+            assert(parser.extract(message + offset, std::min((size_t)40, length - offset), fields, 5));
+        }
+        assert(parser.isDone());
+
+        assert(fields[0].found && strcmp(type, "data") == 0);
+        assert(fields[1].found && strcmp(id, "1") == 0);
+        assert(fields[2].found && strcmp(subKey, "request") == 0);
+        assert(fields[3].found);
+        assert(!fields[4].found);   // An object, not a value
+
+        // The unescaped request is JSON again
+        JsonParser request(data);
+        char requestPath[16];
+        assert(request.getString("path", requestPath, sizeof(requestPath)));
+        assert(strcmp(requestPath, "/api/echo") == 0);
+
+        // A value larger than its field is not found rather than cut
+        char shortId[2];
+        JsonPathField small[] = {JsonPathField("version", shortId, sizeof(shortId))};
+        parser.reset();
+        assert(parser.extract(OTA_RESPONSE, strlen(OTA_RESPONSE), small, 1));
+        assert(!small[0].found);
+        return 0;
+    }
+
+    int test_errors() {
+        const char* malformed[] = {
+            "{\"a\":1,}", "{\"a\" 1}", "[1,]", "{\"a\":tru}", "{\"a\":nul1}", "{\"a\":1]", "[1}", "{1:2}",
+            "{\"a\":1} x", "{\"a\":\"unterminated", "{\"a\":", "[", "@", "{\"a\":1}}"
+        };
+        for (const char* json : malformed) {
+            const std::vector<std::string> result = events(json);
+            assert(result.back().compare(0, 5, "ERROR") == 0);
+            // Wherever the document is split
+            for (size_t size = 1; size < 4; size++) {
+                assert(events(json, std::vector<size_t>(1, size)).back().compare(0, 5, "ERROR") == 0);
+            }
+        }
+
+        // A value longer than the token buffer is cut, the document goes on
+        const std::vector<std::string> cut = {"BEGIN_ARRAY ", "STRING [0]=012345678...", "NUMBER [1]=123456789...",
+                                              "STRING [2]=ok", "END_ARRAY ", "END "};
+        assert(events("[\"0123456789\",12345678901,\"ok\"]", std::vector<size_t>(1, 3), 10) == cut);
+
+        // Nesting deeper than MAX_DEPTH
+        std::string deep = std::string(JsonPullParser::MAX_DEPTH, '[') + std::string(JsonPullParser::MAX_DEPTH, ']');
+        assert(events(deep).back() == "END ");
+        deep = "[" + deep + "]";
+        assert(events(deep).back().compare(0, 5, "ERROR") == 0);
+        return 0;
+    }
+
+    int test_long_paths() {
+        // Buffers like OtaChecker::FirmwareResponse, the metadata paths do not fit in 32 bytes
+        const std::string response = std::string("{\"metadata\":{\"build\":{\"environment\":{\"toolchain\":\"riscv32-esp\","
+            "\"flags\":[\"-Os\",{\"define\":\"X\"}]}}},") +
+            "\"releaseNotesForTheStableChannelInEnglish\":\"fixes\"," +
+            (OTA_RESPONSE + 1);
+        char version[32];
+        char url[128];
+        char hash[80];
+        JsonPathField fields[] = {
+            JsonPathField("version", version, sizeof(version)),
+            JsonPathField("binary.downloadUrl", url, sizeof(url)),
+            JsonPathField("binary.hash", hash, sizeof(hash))
+        };
+        char token[128];
+        char path[32];
+        JsonPullParser parser(token, sizeof(token), path, sizeof(path));
+        for (size_t offset = 0; offset < response.size(); offset += 7) {
+            assert(parser.extract(response.data() + offset, std::min((size_t)7, response.size() - offset), fields, 3));
+        }
+        assert(parser.isDone());
+        assert(fields[0].found && strcmp(version, "0.19.2") == 0);
+        assert(fields[1].found && strcmp(url, "https://example.com/firmware/zap-0.19.2.bin?sig=a%2Fb") == 0);
+        assert(fields[2].found && hash[0] == 'e' && strlen(hash) == 64);
+
+        // Cut paths are flagged, and whole again once the long key is left
+        parser.reset();
+        parser.feed(response.data(), response.size());
+        size_t truncated = 0;
+        JsonPullParser::Event event;
+        while ((event = parser.next()) != JsonPullParser::Event::END) {
+            assert(event != JsonPullParser::Event::ERROR);
+            if (parser.isPathTruncated()) {
+                assert(strlen(parser.getPath()) == sizeof(path) - 1);
+                truncated++;
+            }
+            if (event == JsonPullParser::Event::STRING && strcmp(parser.getValue(), "fw-1") == 0) {
+                assert(!parser.isPathTruncated() && strcmp(parser.getPath(), "id") == 0);
+            }
+        }
+        // toolchain, the six events of the flags array, and the release notes
+        assert(truncated == 8);
+
+        // A cut path that reads like a wanted one is not taken for it
+        char cutPath[12];
+        JsonPathField hashOnly[] = {JsonPathField("binary.hash", hash, sizeof(hash))};
+        JsonPullParser small(token, sizeof(token), cutPath, sizeof(cutPath));
+        const char* json = "{\"binary\":{\"hashAlgorithm\":\"sha256\",\"hash\":\"abc\"}}";
+        assert(small.extract(json, strlen(json), hashOnly, 1));
+        assert(small.isDone());
+        assert(hashOnly[0].found && strcmp(hash, "abc") == 0);
+        return 0;
+    }
+
+    int test_chunk_boundaries() {
+        // Documents split at random must give the same events as in one piece
+        std::vector<std::string> documents = {
+            OTA_RESPONSE,
+            json_light_test::WEBSOCKET_DATA,
+            json_light_test::REQUEST_DATA,
+            "{\"a\\\"b\":\"q\\\"s\\\\b\\/t\\tn\\n\\u0041\\u00e9\\u20ac\",\"k\\u0065y\":[true,false,null,-0.5E+2]}",
+            " [ -1.5e3 , {\"a\": [], \"o\" : {}, \"m\":[[0]]}, \"\"]\n",
+            "-12.75e-3",
+            "\"top\\u0020level\"",
+            "{\"a\":1,}",
+            "[1, 2 3]"
+        };
+        std::mt19937 random(2024);
+        size_t splits = 0;
+        for (const std::string& json : documents) {
+            const std::vector<std::string> expected = events(json);
+            const std::vector<std::string> expectedCut = events(json, std::vector<size_t>(1, json.size()), 8);
+            // Every split into two pieces
+            for (size_t at = 1; at < json.size(); at++) {
+                std::vector<size_t> pieces = {at, json.size()};
+                assert(events(json, pieces) == expected);
+                assert(events(json, pieces, 8) == expectedCut);
+                splits++;
+            }
+            // One byte at a time and random sizes
+            assert(events(json, std::vector<size_t>(1, 1)) == expected);
+            for (int run = 0; run < 500; run++) {
+                std::vector<size_t> pieces;
+                for (int i = 0; i < 32; i++) {
+                    pieces.push_back(1 + random() % 12);
+                }
+                assert(events(json, pieces) == expected);
+                splits++;
+            }
+        }
+        printf("JsonPullParser: %zu ways of splitting %zu documents give the same events\n", splits, documents.size());
+        return 0;
+    }
+
+    int test_streaming_benchmark() {
+        // A response far larger than the buffers, as a list of readings
+        std::string json = "{\"readings\":[";
+        for (int i = 0; i < 2000; i++) {
+            char reading[128];
+            snprintf(reading, sizeof(reading), "%s{\"ts\":%d,\"obis\":\"1-0:1.8.0(%08d.%03d*kWh)\",\"valid\":true}",
+                     i > 0 ? "," : "", 1746111306 + i, i * 37, i % 1000);
+            json += reading;
+        }
+        json += "],\"last\":\"done\"}";
+
+        char token[64];
+        char path[48];
+        char last[8];
+        char obis[32];
+        JsonPathField fields[] = {
+            JsonPathField("last", last, sizeof(last)),
+            JsonPathField("readings[1999].obis", obis, sizeof(obis))
+        };
+        const size_t chunkSize = 512;
+        const int runs = 50;
+        JsonPullParser parser(token, sizeof(token), path, sizeof(path));
+
+        allocation_counter::begin();
+        auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs; run++) {
+            parser.reset();
+            fields[0].found = fields[1].found = false;
+            for (size_t offset = 0; offset < json.size(); offset += chunkSize) {
+                assert(parser.extract(json.data() + offset, std::min(chunkSize, json.size() - offset), fields, 2));
+            }
+        }
+        const double pullUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+        assert(allocation_counter::end() == 0);
+        assert(parser.isDone());
+        assert(fields[0].found && strcmp(last, "done") == 0);
+        assert(fields[1].found && strcmp(obis, "1-0:1.8.0(00073963.999*kWh)") == 0);
+
+        start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs; run++) {
+            JsonParser parser(json.c_str());
+            char value[8];
+            assert(parser.getString("last", value, sizeof(value)));
+        }
+        const double wholeUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+
+        printf("JsonPullParser: %zu byte document in %zu byte chunks with %zu bytes of buffers in %.0f us (%.0f MB/s), "
+               "JsonParser needs it all and %.0f us\n",
+               json.size(), chunkSize, sizeof(token) + sizeof(path) + sizeof(JsonPullParser), pullUs, json.size() / pullUs,
+               wholeUs);
+        return 0;
+    }
+
+    int run() {
+        test_events();
+        test_escapes();
+        test_extract();
+        test_errors();
+        test_long_paths();
+        test_chunk_boundaries();
+        test_streaming_benchmark();
+        return 0;
+    }
+}
@@ -9,14 +9,32 @@
 #include "frames.h"
 
 #include "../src/data/circular_buffer.cpp"
+#include "../src/data/spsc_ring.cpp"
+#include "../src/data/event_stream.cpp"
+#include "../src/data/reading_aggregator.cpp"
+#include "../src/data/p1data_funcs.cpp"
 #include "../src/debug.cpp"
+#include "../src/metrics.cpp"
+#include "../src/merkle_tree.cpp"
 
 #include "../src/backend/graphql.cpp"
 #include "../src/backend/request_handler.cpp"
+#include "../src/backend/sign_queue.cpp"
+#include "../src/backend/signing_task.cpp"
+#include "../src/backend/mutation_tracker.cpp"
+#include "../src/backend/ws_frame_decoder.cpp"
+#include "../src/backend/chunked_decoder.cpp"
+#include "../src/backend/retry_policy.cpp"
+#include "../src/backend/backend_scheduler.cpp"
+#include "../src/backend/upload_controller.cpp"
+#include "../src/backend/heatshrink.cpp"
 
 #include "../src/main_actions.cpp"
+#include "../src/endpoints/response_cache.cpp"
+#include "../src/server/http_server.cpp"
 
 #include "../src/json_light/json_light.cpp"
+#include "../src/json_light/json_pull_parser.cpp"
 #include "../src/data/decoding/ascii_decoder.cpp"
 #include "../src/data/decoding/dlms_decoder.cpp"
 #include "../src/data/decoding/mbus_decoder.cpp"
@@ -26,18 +44,38 @@
 
 #include "zap_str_test.cpp"
 #include "debug_test.cpp"
+#include "metrics_test.cpp"
 #include "main_actions_test.cpp"
+#include "merkle_tree_test.cpp"
 
 #include "data/circular_buffer_test.cpp"
+#include "data/spsc_ring_test.cpp"
+#include "data/reading_aggregator_test.cpp"
+#include "data/snapshot_buffer_test.cpp"
+#include "data/event_stream_test.cpp"
 #include "data/frame_detector_test.cpp"
 #include "data/ascii_decoder_test.cpp"
 #include "data/mbus_decoder_test.cpp"
 #include "data/dlms_decoder_test.cpp"
 
 #include "json_light/json_light_test.cpp"
+#include "json_light/json_pull_parser_test.cpp"
 
 #include "backend/graphql_test.cpp"
 #include "backend/request_handler_test.cpp"
+#include "backend/sign_queue_test.cpp"
+#include "backend/mutation_tracker_test.cpp"
+#include "backend/ws_frame_decoder_test.cpp"
+#include "backend/chunked_decoder_test.cpp"
+#include "backend/retry_policy_test.cpp"
+#include "backend/backend_scheduler_test.cpp"
+#include "backend/upload_controller_test.cpp"
+#include "backend/heatshrink_test.cpp"
+
+#include "endpoints/route_table_test.cpp"
+#include "endpoints/response_cache_test.cpp"
+
+#include "server/http_server_test.cpp"
 
 
 class FrameData : public IFrameData {
@@ -91,8 +129,6 @@ int main() {
     
     try {
         // testBasicFunctionality();
-        DataPackage dataPackage;
-
         P1Data p1data;
         p1data.setDeviceId("12345678901234567890");
         DLMSDecoder decoder;
@@ -103,17 +139,35 @@ int main() {
         test_decoder_frame();
 
         circular_buffer_test::run();
+        spsc_ring_test::run();
+        reading_aggregator_test::run();
+        snapshot_buffer_test::run();
+        event_stream_test::run();
         frame_detector_test::run();
         ascii_decoder_test::run();
         mbus_decoder_test::run();
         dlms_decoder_test::run();
 
         json_light_test::run();
+        json_pull_parser_test::run();
         graphql_test::run();
         zap_str_test::run();
         debug_test::run();
+        metrics_test::run();
         request_handler_test::run();
+        sign_queue_test::run();
+        mutation_tracker_test::run();
+        ws_frame_decoder_test::run();
+        chunked_decoder_test::run();
+        retry_policy_test::run();
+        backend_scheduler_test::run();
+        upload_controller_test::run();
+        heatshrink_test::run();
+        route_table_test::run();
+        response_cache_test::run();
+        http_server_test::run();
         main_actions_test::run();
+        merkle_tree_test::run();
 
         std::cout << "All tests passed!" << std::endl;
         return 0;
@@ -0,0 +1,235 @@
+#include <assert.h>
+#include <chrono>
+#include <vector>
+
+#include "../src/merkle_tree.h"
+
+namespace merkle_tree_test {
+
+    typedef std::vector<uint8_t> Bytes;
+
+    Bytes sha256(const Bytes& data) {
+        Bytes out(32);
+        mbedtls_sha256(data.data(), data.size(), out.data(), 0);
+        return out;
+    }
+
+    Bytes concat(uint8_t prefix, const Bytes& a, const Bytes& b = Bytes()) {
+        Bytes out(1, prefix);
+        out.insert(out.end(), a.begin(), a.end());
+        out.insert(out.end(), b.begin(), b.end());
+        return out;
+    }
+
+    Bytes reading(size_t i) {
+        char text[64];
+        snprintf(text, sizeof(text), "{\"ts\":%zu,\"obis\":\"1-0:1.8.0(%06zu.000*kWh)\"}", 1700000000 + i, i);
+        return Bytes(text, text + strlen(text));
+    }
+
+    // Root computed straight from the definition, independent of MerkleTree
+    Bytes referenceRoot(const std::vector<Bytes>& readings) {
+        std::vector<Bytes> level;
+        for (const Bytes& r : readings) {
+            level.push_back(sha256(concat(0x00, r)));
+        }
+        while (level.size() > 1) {
+            std::vector<Bytes> next;
+            for (size_t i = 0; i < level.size(); i += 2) {
+                next.push_back(i + 1 < level.size() ? sha256(concat(0x01, level[i], level[i + 1])) : level[i]);
+            }
+            level = next;
+        }
+        const size_t n = readings.size();
+        const Bytes count = {(uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+        return sha256(concat(0x02, count, level[0]));
+    }
+
+    // What the backend does with a single reading, written without MerkleTree
+    bool backendVerify(const Bytes& data, size_t index, size_t leafCount, const std::vector<Bytes>& proof, const Bytes& root) {
+        Bytes hash = sha256(concat(0x00, data));
+        size_t used = 0;
+        for (size_t count = leafCount; count > 1; count = (count + 1) / 2, index /= 2) {
+            if ((index ^ 1) >= count) {
+                continue;
+            }
+            if (used == proof.size()) {
+                return false;
+            }
+            hash = (index & 1) ? sha256(concat(0x01, proof[used], hash)) : sha256(concat(0x01, hash, proof[used]));
+            used++;
+        }
+        const Bytes count = {(uint8_t)(leafCount >> 24), (uint8_t)(leafCount >> 16), (uint8_t)(leafCount >> 8), (uint8_t)leafCount};
+        return used == proof.size() && sha256(concat(0x02, count, hash)) == root;
+    }
+
+    int test_sha256_mock() {
+        const char* abc = "abc";
+        uint8_t out[32];
+        mbedtls_sha256((const uint8_t*)abc, 3, out, 0);
+        const uint8_t expected[4] = {0xba, 0x78, 0x16, 0xbf};
+        assert(memcmp(out, expected, 4) == 0);
+        assert(out[31] == 0xad);
+        return 0;
+    }
+
+    int test_empty_and_full() {
+        MerkleTree tree(2);
+        assert(!tree.build());
+        assert(tree.getRoot() == nullptr);
+        const uint8_t data[1] = {1};
+        assert(tree.addLeaf(data, 1));
+        assert(tree.addLeaf(data, 1));
+        assert(!tree.addLeaf(data, 1));
+        assert(tree.getRoot() == nullptr);   // Not built yet
+        assert(tree.build());
+        assert(tree.getRoot() != nullptr);
+        tree.clear();
+        assert(tree.getLeafCount() == 0);
+        assert(tree.getRoot() == nullptr);
+        return 0;
+    }
+
+    int test_single_leaf() {
+        MerkleTree tree(1);
+        Bytes r = reading(0);
+        assert(tree.addLeaf(r.data(), r.size()));
+        assert(tree.build());
+        // The leaf on its own is not the root
+        assert(memcmp(tree.getRoot(), sha256(concat(0x00, r)).data(), 32) != 0);
+        assert(memcmp(tree.getRoot(), referenceRoot({r}).data(), 32) == 0);
+        assert(tree.getProofLength(0) == 0);
+        assert(MerkleTree::verify(r.data(), r.size(), 0, 1, nullptr, 0, tree.getRoot()));
+        return 0;
+    }
+
+    // Every leaf of every batch size up to 33 must verify against the reference root, with both verifiers
+    int test_all_sizes() {
+        MerkleTree tree(33);
+        for (size_t n = 1; n <= 33; n++) {
+            std::vector<Bytes> readings;
+            tree.clear();
+            for (size_t i = 0; i < n; i++) {
+                readings.push_back(reading(i));
+                assert(tree.addLeaf(readings[i].data(), readings[i].size()));
+            }
+            assert(tree.build());
+            const Bytes root(tree.getRoot(), tree.getRoot() + 32);
+            assert(root == referenceRoot(readings));
+
+            for (size_t i = 0; i < n; i++) {
+                uint8_t proof[8 * 32];
+                const size_t length = tree.getProof(i, proof, sizeof(proof));
+                assert(length == tree.getProofLength(i));
+                assert(length <= 6);
+
+                std::vector<Bytes> proofHashes;
+                for (size_t h = 0; h < length; h++) {
+                    proofHashes.push_back(Bytes(proof + h * 32, proof + (h + 1) * 32));
+                }
+
+                assert(MerkleTree::verify(readings[i].data(), readings[i].size(), i, n, proof, length, tree.getRoot()));
+                assert(backendVerify(readings[i], i, n, proofHashes, root));
+
+                // Wrong index, tampered reading or truncated proof must fail
+                if (n > 1) {
+                    assert(!backendVerify(readings[i], (i + 1) % n, n, proofHashes, root) || readings[i] == readings[(i + 1) % n]);
+                }
+                Bytes tampered = readings[i];
+                tampered[0] ^= 1;
+                assert(!MerkleTree::verify(tampered.data(), tampered.size(), i, n, proof, length, tree.getRoot()));
+                if (length > 0) {
+                    assert(!MerkleTree::verify(readings[i].data(), readings[i].size(), i, n, proof, length - 1, tree.getRoot()));
+                }
+            }
+        }
+        return 0;
+    }
+
+    // A proof must not hold for a batch of another size with the same top node
+    int test_leaf_count_in_root() {
+        std::vector<Bytes> readings;
+        MerkleTree tree(3);
+        for (size_t i = 0; i < 3; i++) {
+            readings.push_back(reading(i));
+            tree.addLeaf(readings[i].data(), readings[i].size());
+        }
+        tree.build();
+
+        // Leaf 2 of 3 is carried up, its one proof hash is the node over leaves 0 and 1
+        uint8_t proof[2 * 32];
+        const size_t length = tree.getProof(2, proof, sizeof(proof));
+        assert(length == 1);
+        assert(MerkleTree::verify(readings[2].data(), readings[2].size(), 2, 3, proof, length, tree.getRoot()));
+
+        // The same hashes make leaf 1 of a batch of 2, which only the leaf count in the root rules out
+        assert(!MerkleTree::verify(readings[2].data(), readings[2].size(), 1, 2, proof, length, tree.getRoot()));
+
+        uint8_t top[32];
+        MerkleTree::hashLeaf(readings[2].data(), readings[2].size(), top);
+        MerkleTree::hashNode(proof, top, top);
+        assert(memcmp(top, tree.getRoot(), 32) != 0);
+        MerkleTree::hashRoot(3, top, top);
+        assert(memcmp(top, tree.getRoot(), 32) == 0);
+        return 0;
+    }
+
+    int test_proof_buffer_too_small() {
+        MerkleTree tree(8);
+        for (size_t i = 0; i < 8; i++) {
+            Bytes r = reading(i);
+            tree.addLeaf(r.data(), r.size());
+        }
+        uint8_t proof[3 * 32];
+        assert(tree.getProof(0, proof, sizeof(proof)) == 0);   // Not built
+        tree.build();
+        assert(tree.getProof(0, proof, sizeof(proof) - 1) == 0);
+        assert(tree.getProof(0, proof, sizeof(proof)) == 3);
+        assert(tree.getProof(8, proof, sizeof(proof)) == 0);
+        return 0;
+    }
+
+    // Signing cost per reading: one ECDSA signature per batch plus the hashing done here
+    int bench_batch_sizes() {
+        const size_t sizes[] = {1, 8, 64, 512};
+        std::vector<Bytes> readings;
+        for (size_t i = 0; i < 512; i++) {
+            readings.push_back(reading(i));
+        }
+
+        for (size_t n : sizes) {
+            MerkleTree tree(n);
+            const int rounds = 4096 / n;
+            uint8_t proof[16 * 32];
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++) {
+                tree.clear();
+                for (size_t i = 0; i < n; i++) {
+                    tree.addLeaf(readings[i].data(), readings[i].size());
+                }
+                tree.build();
+                for (size_t i = 0; i < n; i++) {
+                    tree.getProof(i, proof, sizeof(proof));
+                }
+            }
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+            printf("Merkle batch %3zu: %6.0f ns hashing per reading, %.4f ECDSA signatures per reading, proof %zu bytes\n",
+                   n, ns / (rounds * n), 1.0 / n, tree.getProofLength(0) * MerkleTree::HASH_SIZE);
+        }
+        return 0;
+    }
+
+    int run() {
+        test_sha256_mock();
+        test_empty_and_full();
+        test_single_leaf();
+        test_all_sizes();
+        test_leaf_count_in_root();
+        test_proof_buffer_too_small();
+        bench_batch_sizes();
+
+        return 0;
+    }
+}
@@ -0,0 +1,193 @@
+#include "../src/metrics.h"
+
+#include <assert.h>
+#include <chrono>
+#include <malloc.h>
+#include <string>
+#include <thread>
+
+namespace metrics_test {
+
+    // Records what is rendered and the most heap in use while it was
+    class RenderWriter : public ResponseWriter {
+        public:
+            std::string body;
+            size_t writes = 0;
+            size_t peakHeap = 0;
+
+            void begin(int statusCode, const char* contentType, size_t contentLength) override {}
+            void write(const char* data, size_t length) override {
+                const size_t inUse = mallinfo2().uordblks;
+                peakHeap = inUse > peakHeap ? inUse : peakHeap;
+                body.append(data, length);
+                writes++;
+            }
+            void end() override {}
+    };
+
+    static std::string render() {
+        RenderWriter writer;
+        assert(Metric::renderAll(writer) == writer.body.size());
+        return writer.body;
+    }
+
+    static bool contains(const std::string& text, const std::string& part) {
+        return text.find(part) != std::string::npos;
+    }
+
+    int test_registry() {
+        size_t before = 0;
+        for (size_t i = 0; i < Metric::MAX_METRICS; i++) {
+            before += Metric::get(i) != nullptr ? 1 : 0;
+        }
+        {
+            Counter counter("test_registry_total", "Registered while in scope");
+            size_t during = 0;
+            bool found = false;
+            for (size_t i = 0; i < Metric::MAX_METRICS; i++) {
+                during += Metric::get(i) != nullptr ? 1 : 0;
+                found = found || Metric::get(i) == &counter;
+            }
+            assert(found);
+            assert(during == before + 1);
+            assert(contains(render(), "test_registry_total 0\n"));
+        }
+        assert(!contains(render(), "test_registry_total"));
+        assert(Metric::get(Metric::MAX_METRICS) == nullptr);
+        return 0;
+    }
+
+    int test_format() {
+        Counter counter("test_requests_total", "Requests seen");
+        counter.increment();
+        counter.increment(41);
+
+        Gauge gauge("test_temperature_celsius", "Temperature");
+        gauge.set(20);
+        gauge.add(-25);
+
+        Gauge polled("test_polled_bytes", "Read on render", []() { return (int32_t)1234; });
+
+        static const char* const codes[] = {"2xx", "4xx"};
+        LabeledCounter labeled("test_responses_total", "Responses", "code", codes, 2);
+        labeled.increment(0, 3);
+        labeled.increment(1);
+        labeled.increment(2);   // Not a value, ignored
+
+        static const uint32_t bounds[] = {10, 100};
+        Histogram histogram("test_latency_ms", "Latency", bounds, 2);
+        histogram.observe(5);
+        histogram.observe(10);
+        histogram.observe(50);
+        histogram.observe(5000);
+
+        const std::string text = render();
+        assert(contains(text, "# HELP test_requests_total Requests seen\n# TYPE test_requests_total counter\ntest_requests_total 42\n"));
+        assert(contains(text, "# TYPE test_temperature_celsius gauge\ntest_temperature_celsius -5\n"));
+        assert(contains(text, "test_polled_bytes 1234\n"));
+        assert(contains(text, "# TYPE test_responses_total counter\n"
+                              "test_responses_total{code=\"2xx\"} 3\n"
+                              "test_responses_total{code=\"4xx\"} 1\n# "));
+        assert(contains(text, "# HELP test_latency_ms Latency\n# TYPE test_latency_ms histogram\n"
+                              "test_latency_ms_bucket{le=\"10\"} 2\n"
+                              "test_latency_ms_bucket{le=\"100\"} 3\n"
+                              "test_latency_ms_bucket{le=\"+Inf\"} 4\n"
+                              "test_latency_ms_sum 5065\n"
+                              "test_latency_ms_count 4\n"));
+        assert(histogram.getCount() == 4);
+        assert(histogram.getBucket(2) == 1);
+        return 0;
+    }
+
+    int test_concurrent_updates() {
+        Counter counter("test_concurrent_total", "Incremented from several threads");
+        static const uint32_t bounds[] = {0, 1, 2};
+        Histogram histogram("test_concurrent_values", "Observed from several threads", bounds, 3);
+        const int threads = 4;
+        const uint32_t perThread = 100000;
+
+        std::thread workers[threads];
+        for (int t = 0; t < threads; t++) {
+            workers[t] = std::thread([&counter, &histogram, perThread]() {
+                for (uint32_t n = 0; n < perThread; n++) {
+                    counter.increment();
+                    histogram.observe(n % 4);
+                }
+            });
+        }
+        // Rendering while they run must not get in the way
+        while (counter.get() < threads * perThread / 2) {
+            render();
+        }
+        for (int t = 0; t < threads; t++) {
+            workers[t].join();
+        }
+
+        assert(counter.get() == threads * perThread);
+        assert(histogram.getCount() == threads * perThread);
+        assert(histogram.getSum() == threads * (perThread / 4) * (0 + 1 + 2 + 3));
+        for (size_t i = 0; i <= 3; i++) {
+            assert(histogram.getBucket(i) == threads * perThread / 4);
+        }
+        return 0;
+    }
+
+    int test_render_without_heap() {
+        // Enough metrics that the text spans several chunks
+        Counter counters[12] = {
+            {"test_heap_a_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_b_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_c_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_d_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_e_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_f_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_g_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_h_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_i_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_j_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_k_total", "A counter with a fairly long help text to fill the chunks"},
+            {"test_heap_l_total", "A counter with a fairly long help text to fill the chunks"}
+        };
+        static const uint32_t bounds[] = {1, 5, 10, 25, 50, 100, 250, 1000};
+        Histogram histogram("test_heap_histogram", "Buckets", bounds, 8);
+        for (Counter& counter : counters) {
+            counter.increment(123456);
+        }
+
+        RenderWriter writer;
+        writer.body.reserve(16384);
+        const size_t base = mallinfo2().uordblks;
+        const size_t bytes = Metric::renderAll(writer);
+        assert(bytes > 2 * RESPONSE_CHUNK_SIZE);
+        assert(writer.writes == (bytes + RESPONSE_CHUNK_SIZE - 1) / RESPONSE_CHUNK_SIZE);
+        assert(writer.peakHeap <= base);
+
+        const int renders = 2000;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < renders; n++) {
+            writer.body.clear();
+            Metric::renderAll(writer);
+        }
+        const double renderUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / renders;
+
+        start = std::chrono::steady_clock::now();
+        const uint32_t increments = 1000000;
+        for (uint32_t n = 0; n < increments; n++) {
+            counters[0].increment();
+            histogram.observe(n & 511);
+        }
+        const double updateNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / increments;
+
+        printf("Metrics: %zu bytes rendered in %.1f us without heap, counter and histogram update %.1f ns\n",
+               bytes, renderUs, updateNs);
+        return 0;
+    }
+
+    int run() {
+        test_registry();
+        test_format();
+        test_concurrent_updates();
+        test_render_without_heap();
+        return 0;
+    }
+}
@@ -1,17 +1,37 @@
-#include "../src/zap_str.h"
+#include "../src/crypto.h"
 
-zap::Str crypto_create_signature_hex(const char* data, const char* private_key_hex) {
+#include <chrono>
+#include <thread>
+
+// Time a JWT takes to sign, for tests that need the cost of the device
+unsigned long crypto_sign_delay_ms = 0;
+
+zap::Str crypto_create_signature_hex(const char* data) {
     
     char hex_result[129]; 
     return zap::Str(hex_result);
 }
 
-zap::Str crypto_getId() {
-    
-    return zap::Str("zap-testtesttestee");
+const DeviceIdentity& crypto_get_identity() {
+    static DeviceIdentity identity;
+    if (identity.id.isEmpty()) {
+        identity.id = "zap-testtesttestee";
+        identity.jwtHeaderPrefix = "{\"alg\":\"ES256\",\"typ\":\"JWT\",\"device\":\"zap-testtesttestee\"";
+    }
+    return identity;
 }
 
-zap::Str crypto_create_jwt(const char* header, const char* payload, const char* private_key_hex) {
-    
+const zap::Str& crypto_getId() {
+    return crypto_get_identity().id;
+}
+
+zap::Str crypto_create_jwt(const char* header, const char* payload) {
+    if (crypto_sign_delay_ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(crypto_sign_delay_ms));
+    }
     return zap::Str("a.b.c");
+}
+
+zap::Str crypto_create_jwt(const char* header, const char* payload, size_t payloadLength) {
+    return crypto_create_jwt(header, payload);
 }
\ No newline at end of file
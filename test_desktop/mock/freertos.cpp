@@ -0,0 +1,111 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// A counting semaphore, a mutex starts with its one token
+struct MockSemaphore {
+    std::mutex mutex;
+    std::condition_variable available;
+    uint32_t count;
+    uint32_t max;
+
+    MockSemaphore(uint32_t count, uint32_t max) : count(count), max(max) {}
+
+    bool take(TickType_t ticks) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (ticks == portMAX_DELAY) {
+            available.wait(lock, [this]() { return count > 0; });
+        } else if (!available.wait_for(lock, std::chrono::milliseconds(ticks), [this]() { return count > 0; })) {
+            return false;
+        }
+        count--;
+        return true;
+    }
+
+    bool give() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == max) {
+            return false;
+        }
+        count++;
+        available.notify_one();
+        return true;
+    }
+};
+
+// The notification value of a task is a semaphore without a limit
+struct MockTask {
+    MockSemaphore notification;
+
+    MockTask() : notification(0, 0xffffffffUL) {}
+};
+
+static thread_local MockTask* s_currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackSize, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    MockTask* task = new MockTask();
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread([task, function, parameter]() {
+        s_currentTask = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr && s_currentTask != nullptr) {
+        delete s_currentTask;
+        s_currentTask = nullptr;
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    task->notification.give();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    MockSemaphore& notification = s_currentTask->notification;
+    if (!notification.take(ticks)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(notification.mutex);
+    const uint32_t value = notification.count + 1;
+    notification.count = clearOnExit ? 0 : notification.count;
+    return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new MockSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) {
+    return new MockSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new MockSemaphore(0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return semaphore->take(ticks) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return semaphore->give() ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
@@ -0,0 +1,56 @@
+#include "../src/backend/http_connection_manager.h"
+#include <HTTPClient.h>
+
+// Responds with WiFiClient::read_buffer like the HTTPClient mock
+static HttpConnectionManager::Stats stats = {};
+
+void HttpConnectionManager::begin() {
+}
+
+int HttpConnectionManager::post(const char* url, const char* contentType, const char* body, zap::Str& response,
+                                const Deadline& deadline) {
+    stats.requests++;
+    response = WiFiClient::read_buffer != nullptr ? WiFiClient::read_buffer : "";
+    return 200;
+}
+
+int HttpConnectionManager::post(const char* url, const char* contentType, const char* body, char* buffer, size_t capacity, size_t& length,
+                                const Deadline& deadline) {
+    stats.requests++;
+    const char* response = WiFiClient::read_buffer != nullptr ? WiFiClient::read_buffer : "";
+    length = strlen(response);
+    if (length >= capacity) {
+        length = 0;
+        return -8;  // HTTPC_ERROR_TOO_LESS_RAM
+    }
+    memcpy(buffer, response, length + 1);
+    return 200;
+}
+
+int HttpConnectionManager::get(const char* url, zap::Str& response, const Deadline& deadline) {
+    return post(url, nullptr, nullptr, response, deadline);
+}
+
+int HttpConnectionManager::get(const char* url, BodyReader& reader, const Deadline& deadline) {
+    // In small blocks so readers see a body split up
+    stats.requests++;
+    const char* response = WiFiClient::read_buffer != nullptr ? WiFiClient::read_buffer : "";
+    const size_t length = strlen(response);
+    for (size_t offset = 0; offset < length; offset += 16) {
+        if (!reader.read(response + offset, length - offset < 16 ? length - offset : 16)) {
+            return -10;  // HTTPC_ERROR_STREAM_WRITE
+        }
+    }
+    return 200;
+}
+
+bool HttpConnectionManager::acceptsEncoding(const char* url, const char* coding) {
+    return false;
+}
+
+void HttpConnectionManager::closeIdle() {
+}
+
+HttpConnectionManager::Stats HttpConnectionManager::getStats() {
+    return stats;
+}
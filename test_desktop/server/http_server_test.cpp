@@ -0,0 +1,849 @@
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../src/server/http_server.h"
+#include "../src/endpoints/route_table.h"
+#include "../src/endpoints/response_cache.h"
+#include "../src/data/decoding/ascii_decoder.h"
+#include "../src/data/p1data_funcs.h"
+#include "../frames.h"
+
+namespace http_server_test {
+
+    class OkHandler : public EndpointFunction {
+        public:
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.statusCode = 200;
+                response.contentType = "application/json";
+                response.data = "{\"ok\":true}";
+                return response;
+            }
+    };
+
+    class EchoHandler : public EndpointFunction {
+        public:
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.statusCode = 200;
+                response.contentType = "text/plain";
+                response.data = contents;
+                return response;
+            }
+    };
+
+    // Streams a few kilobytes of JSON, it goes out in chunks
+    class StreamHandler : public EndpointFunction {
+        public:
+            EndpointResponse handle(const zap::Str& contents) override {
+                return EndpointResponse();
+            }
+
+            void stream(const zap::Str& contents, ResponseWriter& writer) override {
+                writer.begin(200, "application/json");
+                StreamingJsonBuilder json(writer);
+                json.beginObject().addHex("data", 1500, [](size_t i) { return (uint8_t)i; });
+                json.end();
+                writer.end();
+            }
+    };
+
+    // Same body until the version changes
+    class VersionedHandler : public EndpointFunction {
+        public:
+            uint32_t version = 1;
+
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.statusCode = 200;
+                response.contentType = "application/json";
+                response.data = zap::Str("{\"version\":") + zap::Str((int)version) + zap::Str("}");
+                return response;
+            }
+
+            bool getCacheVersion(uint32_t& out) override {
+                out = version;
+                return true;
+            }
+    };
+
+    // A body that fits the output buffer of a connection with its headers
+    class BlockHandler : public EndpointFunction {
+        public:
+            static const size_t SIZE = 1500;
+
+            EndpointResponse handle(const zap::Str& contents) override {
+                EndpointResponse response;
+                response.statusCode = 200;
+                response.contentType = "text/plain";
+                response.data = zap::Str(std::string(SIZE, 'x').c_str());
+                return response;
+            }
+    };
+
+    static EventStream liveEvents;
+
+    // Subscribes to liveEvents like the live reading endpoint does
+    class LiveHandler : public EndpointFunction {
+        public:
+            EndpointResponse handle(const zap::Str& contents) override {
+                return EndpointResponse();
+            }
+
+            void stream(const zap::Str& contents, ResponseWriter& writer) override {
+                if (!writer.subscribe(liveEvents)) {
+                    writer.begin(503, "application/json", 0);
+                    writer.end();
+                }
+            }
+    };
+
+    static OkHandler okHandler;
+    static EchoHandler echoHandler;
+    static StreamHandler streamHandler;
+    static LiveHandler liveHandler;
+    static VersionedHandler versionedHandler;
+    static BlockHandler blockHandler;
+
+    static constexpr Endpoint endpoints[] = {
+        Endpoint(Endpoint::NAME_INFO, Endpoint::Verb::GET, "/api/name", okHandler),
+        Endpoint(Endpoint::ECHO, Endpoint::Verb::POST, "/api/echo", echoHandler),
+        Endpoint(Endpoint::DEBUG, Endpoint::Verb::GET, "/api/debug", streamHandler),
+        Endpoint(Endpoint::P1_STREAM, Endpoint::Verb::GET, "/api/data/p1/stream", liveHandler),
+        Endpoint(Endpoint::CRYPTO_INFO, Endpoint::Verb::GET, "/api/crypto", versionedHandler),
+        Endpoint(Endpoint::SYSTEM_INFO, Endpoint::Verb::GET, "/api/block", blockHandler)
+    };
+    ROUTE_TABLE_CHECKS(endpoints);
+    static constexpr route_table::RouteTable<sizeof(endpoints) / sizeof(endpoints[0])> table = route_table::build(endpoints);
+
+    class Router : public HttpServer::Externals {
+        public:
+            const Endpoint& toEndpoint(const zap::Str& path, const zap::Str& verb) override {
+                static const Endpoint unknown(Endpoint::UNKNOWN, Endpoint::Verb::UNKNOWN, "", okHandler);
+                const Endpoint::Verb v = verb == "GET" ? Endpoint::Verb::GET : verb == "POST" ? Endpoint::Verb::POST : Endpoint::Verb::UNKNOWN;
+                const int index = table.find(v, path.c_str(), path.length());
+                return index >= 0 ? endpoints[index] : unknown;
+            }
+
+            void route(const EndpointRequest& request, ResponseWriter& writer) override {
+                if (request.endpoint.type == Endpoint::UNKNOWN) {
+                    const char* body = "{\"status\":\"error\",\"message\":\"Endpoint not found\"}";
+                    writer.begin(404, "application/json", strlen(body));
+                    writer.write(body, strlen(body));
+                    writer.end();
+                    return;
+                }
+                // Like EndpointMapper::route
+                if (!cache.serve(request, writer)) {
+                    request.endpoint.handler.stream(request.content, writer);
+                }
+            }
+
+            ResponseCache cache;
+    };
+
+    struct Response {
+        int status = 0;
+        std::string headers;
+        std::string body;
+        bool chunked = false;
+    };
+
+    // Blocking test client, keeps what it read past one response for the next
+    struct Client {
+        int fd = -1;
+        std::string pending;
+
+        // A small receiveBuffer makes the server run out of room sooner
+        explicit Client(uint16_t port, int receiveBuffer = 0) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (receiveBuffer > 0) {
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+            }
+            struct sockaddr_in address;
+            memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            assert(connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0);
+            struct timeval timeout = {5, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        ~Client() {
+            close();
+        }
+
+        void close() {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        void send(const std::string& data) {
+            assert(::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size());
+        }
+
+        bool fill() {
+            char buffer[2048];
+            const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                return false;
+            }
+            pending.append(buffer, received);
+            return true;
+        }
+
+        // True when the server closed the connection
+        bool closed() {
+            char c;
+            return recv(fd, &c, 1, 0) == 0;
+        }
+
+        bool read(Response& response) {
+            size_t headerEnd;
+            while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            response.headers = pending.substr(0, headerEnd + 4);
+            response.status = atoi(response.headers.c_str() + 9);
+            pending.erase(0, headerEnd + 4);
+            response.body.clear();
+            // Never has a body, whatever the headers say
+            if (response.status == 304) {
+                return true;
+            }
+
+            const size_t lengthAt = response.headers.find("Content-Length: ");
+            response.chunked = response.headers.find("Transfer-Encoding: chunked") != std::string::npos;
+            if (response.chunked) {
+                while (true) {
+                    size_t lineEnd;
+                    while ((lineEnd = pending.find("\r\n")) == std::string::npos) {
+                        assert(fill());
+                    }
+                    const size_t size = strtoul(pending.c_str(), nullptr, 16);
+                    while (pending.size() < lineEnd + 2 + size + 2) {
+                        assert(fill());
+                    }
+                    response.body += pending.substr(lineEnd + 2, size);
+                    pending.erase(0, lineEnd + 2 + size + 2);
+                    if (size == 0) {
+                        return true;
+                    }
+                }
+            }
+            if (lengthAt != std::string::npos) {
+                const size_t length = atoi(response.headers.c_str() + lengthAt + 16);
+                while (pending.size() < length) {
+                    assert(fill());
+                }
+                response.body = pending.substr(0, length);
+                pending.erase(0, length);
+                return true;
+            }
+            // Delimited by the end of the connection
+            while (fill()) {
+            }
+            response.body = pending;
+            pending.clear();
+            return true;
+        }
+    };
+
+    // Headers of an event stream response, the body never ends
+    static std::string readHeaders(Client& client) {
+        size_t headerEnd;
+        while ((headerEnd = client.pending.find("\r\n\r\n")) == std::string::npos) {
+            assert(client.fill());
+        }
+        const std::string headers = client.pending.substr(0, headerEnd + 4);
+        client.pending.erase(0, headerEnd + 4);
+        return headers;
+    }
+
+    static std::string readEvent(Client& client) {
+        size_t eventEnd;
+        while ((eventEnd = client.pending.find("\n\n")) == std::string::npos) {
+            if (!client.fill()) {
+                return "";
+            }
+        }
+        const std::string event = client.pending.substr(0, eventEnd + 2);
+        client.pending.erase(0, eventEnd + 2);
+        return event;
+    }
+
+    static void publish(const std::string& event) {
+        memcpy(liveEvents.beginEvent(), event.data(), event.size());
+        liveEvents.publish(event.size());
+    }
+
+    static void pump(HttpServer& server) {
+        for (int i = 0; i < 4; i++) {
+            server.poll(5);
+        }
+    }
+
+    static Response request(HttpServer& server, Client& client, const std::string& data) {
+        client.send(data);
+        pump(server);
+        Response response;
+        assert(client.read(response));
+        return response;
+    }
+
+    int test_requests() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+        server.setRootRedirect("/api/name");
+
+        Client client(server.getPort());
+        Response response = request(server, client, "GET /api/name HTTP/1.1\r\nHost: zap\r\n\r\n");
+        assert(response.status == 200);
+        assert(response.body == "{\"ok\":true}");
+        assert(response.headers.find("Connection: keep-alive") != std::string::npos);
+
+        // The query string is not part of the path, the body comes with the request
+        response = request(server, client, "POST /api/echo?x=1 HTTP/1.1\r\ncontent-length: 5\r\n\r\nhello");
+        assert(response.status == 200);
+        assert(response.body == "hello");
+
+        response = request(server, client, "GET /api/missing HTTP/1.1\r\n\r\n");
+        assert(response.status == 404);
+
+        response = request(server, client, "GET / HTTP/1.1\r\n\r\n");
+        assert(response.status == 302);
+        assert(response.headers.find("Location: /api/name\r\n") != std::string::npos);
+
+        // Streamed, in chunks
+        response = request(server, client, "GET /api/debug HTTP/1.1\r\n\r\n");
+        assert(response.status == 200);
+        assert(response.chunked);
+        assert(response.body.size() == 3000 + strlen("{\"data\":\"\"}"));
+        assert(response.body.compare(0, 17, "{\"data\":\"00010203") == 0);
+
+        // All of it over one connection
+        assert(server.getStats().accepted == 1);
+        assert(server.getStats().requests == 5);
+        assert(server.getOpenConnections() == 1);
+        return 0;
+    }
+
+    int test_pipelining() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        Client client(server.getPort());
+        client.send("GET /api/name HTTP/1.1\r\n\r\nPOST /api/echo HTTP/1.1\r\nContent-Length: 3\r\n\r\nabcGET /api/na");
+        pump(server);
+        Response response;
+        assert(client.read(response) && response.body == "{\"ok\":true}");
+        assert(client.read(response) && response.body == "abc");
+
+        // The rest of the third request arrives later
+        client.send("me HTTP/1.1\r\n\r\n");
+        pump(server);
+        assert(client.read(response) && response.status == 200);
+        assert(server.getStats().requests == 3);
+        return 0;
+    }
+
+    int test_connection_close() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        {
+            Client client(server.getPort());
+            const Response response = request(server, client, "GET /api/name HTTP/1.1\r\nConnection: close\r\n\r\n");
+            assert(response.headers.find("Connection: close") != std::string::npos);
+            assert(client.closed());
+        }
+
+        // A HTTP/1.0 client gets no chunks, the streamed body ends with the connection
+        {
+            Client client(server.getPort());
+            client.send("GET /api/debug HTTP/1.0\r\n\r\n");
+            pump(server);
+            Response response;
+            assert(client.read(response));
+            assert(!response.chunked);
+            assert(response.body.size() == 3011);
+        }
+
+        {
+            Client client(server.getPort());
+            const Response response = request(server, client, "GET /api/name HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+            assert(response.status == 200);
+            assert(server.getOpenConnections() == 1);
+        }
+        pump(server);
+        assert(server.getOpenConnections() == 0);
+        return 0;
+    }
+
+    int test_bad_requests() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        const char* requests[] = {
+            "GARBAGE\r\n\r\n",
+            "GET /api/name\r\n\r\n",
+            "GET /api/name HTTP/2.0\r\n\r\n",
+            "POST /api/echo HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+            "POST /api/echo HTTP/1.1\r\nContent-Length: 5000\r\n\r\n",
+            "POST /api/echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        };
+        const int expected[] = {400, 400, 400, 400, 413, 501};
+
+        for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+            Client client(server.getPort());
+            const Response response = request(server, client, requests[i]);
+            assert(response.status == expected[i]);
+            assert(client.closed());
+        }
+
+        // Headers that do not fit the buffer
+        Client client(server.getPort());
+        const std::string start = "GET /api/name HTTP/1.1\r\nX-Filler: ";
+        const Response response = request(server, client, start + std::string(HttpServer::REQUEST_BUFFER_SIZE - start.size(), 'a'));
+        assert(response.status == 431);
+        assert(client.closed());
+        return 0;
+    }
+
+    int test_timeouts() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+        millis_return_value = 100000;
+
+        Client idle(server.getPort());
+        Client partial(server.getPort());
+        request(server, idle, "GET /api/name HTTP/1.1\r\n\r\n");
+        partial.send("GET /api/na");
+        pump(server);
+        assert(server.getOpenConnections() == 2);
+
+        // Half a request is answered with a 408
+        millis_return_value += HttpServer::REQUEST_TIMEOUT_MS;
+        pump(server);
+        Response response;
+        assert(partial.read(response) && response.status == 408);
+        assert(partial.closed());
+        assert(server.getOpenConnections() == 0);
+        assert(idle.closed());
+        assert(server.getStats().timeouts == 2);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_connection_pool() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        std::vector<Client*> clients;
+        for (size_t i = 0; i < HttpServer::MAX_CONNECTIONS; i++) {
+            clients.push_back(new Client(server.getPort()));
+            pump(server);
+        }
+        assert(server.getOpenConnections() == HttpServer::MAX_CONNECTIONS);
+
+        Client extra(server.getPort());
+        pump(server);
+        Response response;
+        assert(extra.read(response) && response.status == 503);
+        assert(server.getStats().rejected == 1);
+
+        // The slots still work
+        for (Client* client : clients) {
+            assert(request(server, *client, "GET /api/name HTTP/1.1\r\n\r\n").status == 200);
+            delete client;
+        }
+        pump(server);
+        assert(server.getOpenConnections() == 0);
+        return 0;
+    }
+
+    int test_load() {
+        // Dashboards polling over keep-alive while one client dribbles its requests in byte by byte
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        std::atomic<bool> running(true);
+        std::thread serverThread([&]() {
+            while (running) {
+                server.poll(10);
+            }
+        });
+
+        const int fastClients = HttpServer::MAX_CONNECTIONS - 1;
+        const int requestsPerClient = 300;
+        std::vector<std::vector<double>> latencies(fastClients);
+        std::atomic<bool> fastDone(false);
+
+        std::thread slowThread([&]() {
+            Client client(server.getPort());
+            const std::string slowRequest = "POST /api/echo HTTP/1.1\r\nContent-Length: 4\r\n\r\nslow";
+            while (!fastDone) {
+                for (char c : slowRequest) {
+                    client.send(std::string(1, c));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+                Response response;
+                assert(client.read(response) && response.body == "slow");
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < fastClients; t++) {
+            threads.emplace_back([&, t]() {
+                Client client(server.getPort());
+                for (int n = 0; n < requestsPerClient; n++) {
+                    const auto start = std::chrono::steady_clock::now();
+                    client.send(n % 10 == 9 ? "GET /api/debug HTTP/1.1\r\n\r\n" : "GET /api/name HTTP/1.1\r\n\r\n");
+                    Response response;
+                    assert(client.read(response) && response.status == 200);
+                    latencies[t].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        fastDone = true;
+        slowThread.join();
+        running = false;
+        serverThread.join();
+
+        std::vector<double> all;
+        for (const std::vector<double>& clientLatencies : latencies) {
+            all.insert(all.end(), clientLatencies.begin(), clientLatencies.end());
+        }
+        std::sort(all.begin(), all.end());
+        const double p50 = all[all.size() / 2];
+        const double p99 = all[all.size() * 99 / 100];
+
+        printf("HTTP server %d keep-alive clients and a slow one, %zu requests: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               fastClients, all.size(), p50, p99, all.back());
+        assert(all.size() == (size_t)(fastClients * requestsPerClient));
+        assert(server.getStats().rejected == 0);
+        // A slow client sending one byte every 2 ms must not hold up the others for its whole request
+        assert(p99 < 50.0);
+        return 0;
+    }
+
+    int test_slow_reader() {
+        // One client asks for a lot and does not read it, the socket buffers fill up
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+
+        std::string pipelined;
+        for (int i = 0; i < 150; i++) {
+            pipelined += "GET /api/block HTTP/1.1\r\n\r\n";
+        }
+        const int rounds = 20;
+
+        std::atomic<bool> running(true);
+        std::thread serverThread([&]() {
+            while (running) {
+                server.poll(10);
+            }
+        });
+
+        Client slow(server.getPort(), 4096);
+        for (int i = 0; i < rounds; i++) {
+            slow.send(pipelined);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // The server does not wait on the slow client to serve another one
+        Client fast(server.getPort());
+        double slowest = 0;
+        for (int n = 0; n < 20; n++) {
+            const auto start = std::chrono::steady_clock::now();
+            fast.send("GET /api/name HTTP/1.1\r\n\r\n");
+            Response response;
+            assert(fast.read(response) && response.status == 200);
+            slowest = std::max(slowest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        printf("HTTP server with a client that stopped reading: slowest of 20 requests %.3f ms\n", slowest);
+        assert(slowest < HttpServer::SEND_TIMEOUT_MS / 4);
+
+        // Once it reads, every response comes out whole and in order
+        for (int i = 0; i < rounds * 150; i++) {
+            Response response;
+            assert(slow.read(response) && response.status == 200);
+            assert(response.body.size() == BlockHandler::SIZE);
+        }
+        running = false;
+        serverThread.join();
+        assert(server.getStats().errors == 0);
+
+        slow.close();
+        fast.close();
+        pump(server);
+        assert(server.getOpenConnections() == 0);
+
+        // A client that never reads again loses its slot after SEND_TIMEOUT_MS
+        millis_return_value = 100000;
+        Client stalled(server.getPort(), 4096);
+        for (int quiet = 0; quiet < 10;) {
+            // More until the responses no longer fit anywhere and the server stops serving them for a while
+            const uint32_t served = server.getStats().requests;
+            if (quiet == 0) {
+                stalled.send(pipelined);
+            }
+            pump(server);
+            quiet = server.getStats().requests == served ? quiet + 1 : 0;
+        }
+        assert(server.getOpenConnections() == 1);
+        millis_return_value += HttpServer::SEND_TIMEOUT_MS;
+        pump(server);
+        assert(server.getOpenConnections() == 0);
+        assert(server.getStats().errors == 1);
+
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    int test_conditional_get() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+        Client client(server.getPort());
+
+        Response response = request(server, client, "GET /api/crypto HTTP/1.1\r\n\r\n");
+        assert(response.status == 200);
+        assert(response.body == "{\"version\":1}");
+        const size_t etagAt = response.headers.find("ETag: \"");
+        assert(etagAt != std::string::npos);
+        const std::string etag = response.headers.substr(etagAt + 6, 18);
+
+        // No body and no length, the next response on the connection must still line up
+        response = request(server, client, "GET /api/crypto HTTP/1.1\r\nIf-None-Match: " + etag + "\r\nAccept: */*\r\n\r\n");
+        assert(response.status == 304);
+        assert(response.body.empty());
+        assert(response.headers.find("Content-Length") == std::string::npos);
+        assert(response.headers.find("ETag: " + etag + "\r\n") != std::string::npos);
+
+        // As the last header, with a pipelined request behind it
+        client.send("GET /api/crypto HTTP/1.1\r\nIf-None-Match:  " + etag + " \r\n\r\nGET /api/name HTTP/1.1\r\n\r\n");
+        pump(server);
+        assert(client.read(response) && response.status == 304);
+        assert(client.read(response) && response.status == 200 && response.body == "{\"ok\":true}");
+
+        versionedHandler.version = 2;
+        response = request(server, client, "GET /api/crypto HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+        assert(response.status == 200);
+        assert(response.body == "{\"version\":2}");
+        assert(response.headers.find(etag) == std::string::npos);
+
+        assert(router.cache.getStats().hits == 2);
+        assert(router.cache.getStats().misses == 2);
+        assert(router.cache.getStats().notModified == 2);
+        return 0;
+    }
+
+    int test_event_stream() {
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+        millis_return_value = 100000;
+        publish("data: before\n\n");
+
+        Client first(server.getPort());
+        first.send("GET /api/data/p1/stream HTTP/1.1\r\n\r\n");
+        pump(server);
+        const std::string headers = readHeaders(first);
+        assert(headers.find("HTTP/1.1 200 OK\r\n") == 0);
+        assert(headers.find("Content-Type: text/event-stream\r\n") != std::string::npos);
+        assert(headers.find("Content-Length") == std::string::npos);
+        assert(headers.find("chunked") == std::string::npos);
+        // The latest reading goes out right away
+        assert(readEvent(first) == "data: before\n\n");
+
+        Client second(server.getPort());
+        second.send("GET /api/data/p1/stream HTTP/1.1\r\n\r\n");
+        pump(server);
+        readHeaders(second);
+        assert(readEvent(second) == "data: before\n\n");
+
+        publish("data: 1\n\n");
+        publish("data: 2\n\n");
+        pump(server);
+        for (Client* client : {&first, &second}) {
+            assert(readEvent(*client) == "data: 1\n\n");
+            assert(readEvent(*client) == "data: 2\n\n");
+        }
+
+        // A quiet stream outlives the idle timeout and is sent a comment now and then
+        millis_return_value += HttpServer::STREAM_KEEPALIVE_MS;
+        pump(server);
+        assert(readEvent(first) == ":\n\n");
+        assert(readEvent(second) == ":\n\n");
+        assert(server.getOpenConnections() == 2);
+
+        {
+            Client third(server.getPort());
+            third.send("GET /api/data/p1/stream HTTP/1.1\r\n\r\n");
+            pump(server);
+            assert(readHeaders(third).find("200 OK") != std::string::npos);
+
+            // Every subscription is taken, the connection itself is still good for requests
+            Client fourth(server.getPort());
+            Response response = request(server, fourth, "GET /api/data/p1/stream HTTP/1.1\r\n\r\n");
+            assert(response.status == 503);
+            assert(request(server, fourth, "GET /api/name HTTP/1.1\r\n\r\n").status == 200);
+            assert(liveEvents.getSubscriberCount() == EventStream::MAX_SUBSCRIBERS);
+        }
+
+        // Clients that hang up give their subscription back
+        pump(server);
+        assert(liveEvents.getSubscriberCount() == 2);
+        assert(server.getStats().streams == 3);
+
+        server.stop();
+        assert(liveEvents.getSubscriberCount() == 0);
+        millis_return_value = millis_default_return_value;
+        return 0;
+    }
+
+    class FrameData : public IFrameData {
+        public:
+            FrameData(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+            uint8_t getFrameByte(size_t index) const override { return index < size_ ? data_[index] : 0; }
+            int getFrameSize() const override { return size_; }
+            IFrameData::Type getFrameTypeId() const override { return IFrameData::Type::FRAME_TYPE_ASCII; }
+        private:
+            const uint8_t* data_;
+            size_t size_;
+    };
+
+    int test_event_latency() {
+        // Meter frames go through the decoder and out to the subscribers like in DataReaderTask::handleFrame.
+        // The server task polls the way WebServerHandler::handleClient does.
+        Router router;
+        HttpServer server(router, 0);
+        assert(server.begin());
+        // What the subscribers get first, it is not measured
+        publish("data: {\"ts\":-1,\"data\":[\"\"]}\n\n");
+        const uint32_t droppedBefore = liveEvents.getStats().dropped;
+
+        std::atomic<bool> running(true);
+        std::thread serverThread([&]() {
+            while (running) {
+                server.poll(50);
+            }
+        });
+
+        const int subscribers = EventStream::MAX_SUBSCRIBERS;
+        const int frames = 200;
+        std::vector<std::atomic<int64_t>> frameEnds(frames);
+        std::vector<std::vector<double>> latencies(subscribers);
+        std::atomic<int> ready(0);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < subscribers; t++) {
+            threads.emplace_back([&, t]() {
+                Client client(server.getPort());
+                client.send("GET /api/data/p1/stream HTTP/1.1\r\n\r\n");
+                readHeaders(client);
+                ready++;
+                while (true) {
+                    const std::string event = readEvent(client);
+                    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+                    assert(event.compare(0, 12, "data: {\"ts\":") == 0);
+                    // The frame number stands in for the timestamp
+                    const int frame = atoi(event.c_str() + 12);
+                    assert(event.find("\"data\":[\"") != std::string::npos);
+                    if (frame < 0) {
+                        continue;
+                    }
+                    latencies[t].push_back(std::chrono::duration<double, std::milli>(
+                        now - std::chrono::nanoseconds(frameEnds[frame].load())).count());
+                    if (frame == frames - 1) {
+                        return;
+                    }
+                }
+            });
+        }
+
+        while (ready < subscribers) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        P1Data p1data;
+        AsciiDecoder decoder;
+        FrameData frame(ascii_frame_single, sizeof(ascii_frame_single));
+        for (int n = 0; n < frames; n++) {
+            frameEnds[n] = std::chrono::steady_clock::now().time_since_epoch().count();
+            p1data.clear();
+            assert(decoder.decodeBuffer(frame, p1data));
+            p1data.timestamp = n;
+            char* event = liveEvents.beginEvent();
+            liveEvents.publish(createP1Event(p1data, event, EventStream::MAX_EVENT_SIZE));
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        running = false;
+        serverThread.join();
+
+        std::vector<double> all;
+        for (const std::vector<double>& subscriberLatencies : latencies) {
+            // A subscriber that keeps up loses nothing
+            assert(subscriberLatencies.size() == (size_t)frames);
+            all.insert(all.end(), subscriberLatencies.begin(), subscriberLatencies.end());
+        }
+        std::sort(all.begin(), all.end());
+        const double p50 = all[all.size() / 2];
+        const double p99 = all[all.size() * 99 / 100];
+
+        printf("Event stream %d frames to %d subscribers, frame to client: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               frames, subscribers, p50, p99, all.back());
+        assert(liveEvents.getStats().dropped == droppedBefore);
+        // The server waits in select() for 50 ms at a time, a publish has to wake it
+        assert(p99 < 50.0);
+
+        server.stop();
+        return 0;
+    }
+
+    int run() {
+        test_requests();
+        test_pipelining();
+        test_connection_close();
+        test_bad_requests();
+        test_timeouts();
+        test_connection_pool();
+        test_load();
+        test_slow_reader();
+        test_conditional_get();
+        test_event_stream();
+        test_event_latency();
+        return 0;
+    }
+}